@@ -0,0 +1,826 @@
+// Golden-image and frame-time regression runs for the Renderer.
+//
+// Renders a few fixed scenes offscreen, on whatever Vulkan ICD the loader
+// picks (lavapipe included), for a number of frames each, then
+//  - compares the last frame with <golden>/<scene>.png, allowing small
+//    perceptual differences (rasterization and filtering vary a little
+//    between drivers), and
+//  - compares the frame-time percentiles with the baseline, failing when
+//    p50 or p95 got slower by more than the threshold.
+// Any failure makes the exit status nonzero. A scene without a golden image
+// or baseline entry is reported as skipped, not failed, so a fresh checkout
+// passes until they are recorded:
+//
+//   render_regression [--frames N] [--warmup N] [--threshold 0.10]
+//                     [--tolerance 0.1] [--max-diff 0.001]
+//                     [--golden regression/golden]
+//                     [--baseline regression/baseline.json]
+//                     [--out regression_out] [--update]
+//
+// --update records the goldens and the baseline instead of checking them;
+// run it on the reference machine after intended changes. Frame times are
+// only compared against a baseline recorded on the same device. Rendered
+// frames, diff images and the results JSON are written to --out.
+//
+// Must be started from the repository root (textures are loaded through
+// relative paths, same as the Renderer executable).
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stb_image.h>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../src/Renderer/Buffer/Buffer.h"
+#include "../src/Renderer/Capture/FrameReadback.h"
+#include "../src/Renderer/Capture/PngEncoder.h"
+#include "../src/Renderer/Command/CommandBuffer.h"
+#include "../src/Renderer/Command/CommandPool.h"
+#include "../src/Renderer/Device/Device.h"
+#include "../src/Renderer/Helpers/helpers.h"
+#include "../src/Renderer/Instance/Instance.h"
+#include "../src/Renderer/Pipeline/Pipeline.h"
+#include "../src/Renderer/Texture/Texture.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+constexpr vk::Format TARGET_FORMAT = vk::Format::eR8G8B8A8Unorm;
+constexpr uint32_t TARGET_WIDTH = 320;
+constexpr uint32_t TARGET_HEIGHT = 240;
+
+// Slower percentiles within this are timer noise, not regressions
+constexpr double NOISE_FLOOR_MS = 0.05;
+
+// Camera only, as in main.cpp
+struct UniformBufferObject {
+  alignas(16) glm::mat4 view;
+  alignas(16) glm::mat4 proj;
+};
+
+const std::vector<Renderer::Vertex> QUAD_VERTICES = {
+    {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+    {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+    {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}};
+
+const std::vector<uint16_t> QUAD_INDICES = {0, 1, 2, 2, 3, 0};
+
+// A scene is a set of quads posed as a function of t in [0, 1]. The checked
+// frame is always the one at t = 1, so goldens don't depend on --frames.
+struct Scene {
+  const char *name;
+  glm::vec3 eye;
+  void (*pose)(float t, std::vector<glm::mat4> &models);
+};
+
+const glm::vec3 UP(0.0f, 0.0f, 1.0f);
+
+// The two quads of the Renderer executable
+void poseQuads(float t, std::vector<glm::mat4> &models) {
+  glm::mat4 spin = glm::rotate(glm::mat4(1.0f), t * glm::radians(180.0f), UP);
+  models.push_back(spin);
+  models.push_back(glm::translate(spin, glm::vec3(0.0f, 0.0f, -0.5f)));
+}
+
+// Many small draws, for the cost of the per-draw path
+void poseGrid(float t, std::vector<glm::mat4> &models) {
+  constexpr int SIDE = 32;
+  for (int y = 0; y < SIDE; ++y) {
+    for (int x = 0; x < SIDE; ++x) {
+      glm::vec3 position(-1.0f + 2.0f * (x + 0.5f) / SIDE,
+                         -1.0f + 2.0f * (y + 0.5f) / SIDE, 0.0f);
+      float phase = 0.1f * static_cast<float>(x + y);
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+      model = glm::rotate(model, t * glm::radians(90.0f) + phase, UP);
+      models.push_back(glm::scale(model, glm::vec3(1.5f / SIDE)));
+    }
+  }
+}
+
+// Overlapping quads at interleaved depths, drawn back and forth, so wrong
+// depth testing shows up in the image
+void poseDepth(float t, std::vector<glm::mat4> &models) {
+  constexpr int LAYERS = 24;
+  for (int i = 0; i < LAYERS; ++i) {
+    int layer = (i % 2 == 0) ? i : LAYERS - i;
+    glm::vec3 offset(0.03f * layer, -0.02f * layer, -0.04f * layer);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), offset);
+    models.push_back(glm::rotate(
+        model, t * glm::radians(45.0f) + 0.2f * layer, UP));
+  }
+}
+
+const std::array<Scene, 3> SCENES = {{
+    {"quads", glm::vec3(2.0f, 2.0f, 2.0f), poseQuads},
+    {"grid", glm::vec3(0.0f, -2.0f, 2.2f), poseGrid},
+    {"depth", glm::vec3(1.8f, 1.8f, 1.6f), poseDepth},
+}};
+
+struct Options {
+  uint32_t frames = 240;
+  uint32_t warmup = 30;
+  // Allowed slowdown of p50 and p95, as a fraction of the baseline
+  double threshold = 0.10;
+  // Per-pixel perceptual delta in [0, 1] above which a pixel differs
+  double tolerance = 0.1;
+  // Fraction of differing pixels above which the image fails
+  double maxDiff = 0.001;
+  std::string goldenDir = "regression/golden";
+  std::string baselinePath = "regression/baseline.json";
+  std::string outDir = "regression_out";
+  bool update = false;
+};
+
+struct SceneResult {
+  std::string name;
+  std::vector<double> frameMs;
+  double p50 = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  Renderer::ReadbackImage image;
+
+  // Filled by the checks
+  double differingFraction = 0.0;
+  std::optional<double> baselineP50;
+  std::optional<double> baselineP95;
+  bool imagePassed = true;
+  bool timingPassed = true;
+  // Nothing recorded to compare against
+  bool imageSkipped = false;
+  bool timingSkipped = false;
+};
+
+struct Baseline {
+  std::string device;
+  struct Entry {
+    std::string name;
+    double p50 = 0.0;
+    double p95 = 0.0;
+  };
+  std::vector<Entry> scenes;
+};
+
+double percentile(std::vector<double> sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+  size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+std::string escapeJson(const std::string &in) {
+  std::string out;
+  for (char c : in) {
+    if (c == '"' || c == '\\')
+      out.push_back('\\');
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out.push_back(c);
+  }
+  return out;
+}
+
+// Readers for the flat JSON written below (one scene per line); this is not
+// a general JSON parser
+std::optional<std::string> jsonString(const std::string &line,
+                                      const std::string &key) {
+  std::string pattern = "\"" + key + "\": \"";
+  size_t start = line.find(pattern);
+  if (start == std::string::npos)
+    return std::nullopt;
+  std::string value;
+  for (size_t i = start + pattern.size(); i < line.size(); ++i) {
+    if (line[i] == '\\' && i + 1 < line.size())
+      value.push_back(line[++i]);
+    else if (line[i] == '"')
+      return value;
+    else
+      value.push_back(line[i]);
+  }
+  return std::nullopt;
+}
+
+std::optional<double> jsonNumber(const std::string &line,
+                                 const std::string &key) {
+  std::string pattern = "\"" + key + "\": ";
+  size_t start = line.find(pattern);
+  if (start == std::string::npos)
+    return std::nullopt;
+  const char *begin = line.c_str() + start + pattern.size();
+  char *end = nullptr;
+  double value = std::strtod(begin, &end);
+  if (end == begin)
+    return std::nullopt;
+  return value;
+}
+
+std::optional<Baseline> readBaseline(const std::string &path) {
+  std::ifstream in(path);
+  if (!in.is_open())
+    return std::nullopt;
+
+  Baseline baseline;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (auto device = jsonString(line, "device")) {
+      baseline.device = *device;
+      continue;
+    }
+    auto name = jsonString(line, "name");
+    auto p50 = jsonNumber(line, "p50_ms");
+    auto p95 = jsonNumber(line, "p95_ms");
+    if (name && p50 && p95)
+      baseline.scenes.push_back({*name, *p50, *p95});
+  }
+  return baseline;
+}
+
+void writeJson(std::ostream &out, const std::string &device,
+               const Options &options,
+               const std::vector<SceneResult> &results) {
+  out << "{\n";
+  out << "  \"device\": \"" << escapeJson(device) << "\",\n";
+  out << "  \"frames\": " << options.frames << ",\n";
+  out << "  \"scenes\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const SceneResult &r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"p50_ms\": " << r.p50
+        << ", \"p95_ms\": " << r.p95 << ", \"p99_ms\": " << r.p99
+        << ", \"differing_pixels\": " << r.differingFraction;
+    if (r.baselineP50 && r.baselineP95) {
+      out << ", \"baseline_p50_ms\": " << *r.baselineP50
+          << ", \"baseline_p95_ms\": " << *r.baselineP95;
+    }
+    out << ", \"passed\": "
+        << (r.imagePassed && r.timingPassed ? "true" : "false")
+        << ", \"image_skipped\": " << (r.imageSkipped ? "true" : "false")
+        << ", \"timing_skipped\": " << (r.timingSkipped ? "true" : "false")
+        << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+// Distance in YIQ space, weighted as in pixelmatch and normalized to [0, 1]
+// (never above 1). Alpha is ignored; readbacks are opaque.
+double colorDelta(const uint8_t *a, const uint8_t *b) {
+  constexpr double MAX_DELTA = 35215.0;
+  double r = static_cast<double>(a[0]) - b[0];
+  double g = static_cast<double>(a[1]) - b[1];
+  double bl = static_cast<double>(a[2]) - b[2];
+  double y = r * 0.29889531 + g * 0.58662247 + bl * 0.11448223;
+  double i = r * 0.59597799 - g * 0.27417610 - bl * 0.32180189;
+  double q = r * 0.21147017 - g * 0.52261711 + bl * 0.31114694;
+  double delta = 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+  return std::sqrt(delta / MAX_DELTA);
+}
+
+// Fraction of pixels further apart than the tolerance. `diff` gets the
+// golden faded to grey with the differing pixels in red.
+double compareImages(const uint8_t *golden, const uint8_t *actual,
+                     uint32_t width, uint32_t height, double tolerance,
+                     std::vector<uint8_t> &diff) {
+  size_t pixelCount = static_cast<size_t>(width) * height;
+  diff.resize(pixelCount * 4);
+
+  size_t differing = 0;
+  for (size_t p = 0; p < pixelCount; ++p) {
+    const uint8_t *g = golden + p * 4;
+    uint8_t *d = diff.data() + p * 4;
+    if (colorDelta(g, actual + p * 4) > tolerance) {
+      differing++;
+      d[0] = 255;
+      d[1] = 0;
+      d[2] = 0;
+    } else {
+      uint8_t luma = static_cast<uint8_t>(
+          (g[0] * 77 + g[1] * 150 + g[2] * 29) / 256 / 4 + 191);
+      d[0] = d[1] = d[2] = luma;
+    }
+    d[3] = 255;
+  }
+  return pixelCount ? static_cast<double>(differing) / pixelCount : 0.0;
+}
+
+vk::Format findDepthFormat(Renderer::Device &device) {
+  for (vk::Format format :
+       {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint,
+        vk::Format::eD24UnormS8Uint}) {
+    vk::FormatProperties props =
+        device.GetPhysicalDevice().getFormatProperties(format);
+    if (props.optimalTilingFeatures &
+        vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+      return format;
+  }
+  throw std::runtime_error("failed to find supported format!");
+}
+
+// Everything the scenes share: one target, one pipeline, the quad
+struct RenderContext {
+  std::vector<vk::raii::Buffer> uniformBuffers;
+  std::vector<Renderer::DeviceMemory> uniformBuffersMemory;
+  std::vector<void *> uniformBuffersMapped;
+
+  vk::raii::Buffer vertexBuffer = nullptr;
+  Renderer::DeviceMemory vertexBufferMemory = nullptr;
+  vk::raii::Buffer indexBuffer = nullptr;
+  Renderer::DeviceMemory indexBufferMemory = nullptr;
+
+  vk::raii::Image target = nullptr;
+  Renderer::DeviceMemory targetMemory = nullptr;
+  vk::raii::ImageView targetView = nullptr;
+  vk::Format depthFormat = vk::Format::eUndefined;
+  vk::raii::Image depth = nullptr;
+  Renderer::DeviceMemory depthMemory = nullptr;
+  vk::raii::ImageView depthView = nullptr;
+
+  std::vector<std::unique_ptr<Renderer::CommandBuffer>> commandBuffers;
+  std::vector<vk::raii::Fence> fences;
+};
+
+void createRenderContext(Renderer::Device &device,
+                         Renderer::CommandPool &commandPool,
+                         Renderer::BufferManager &bufferManager,
+                         RenderContext &ctx) {
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    vk::raii::Buffer buffer = nullptr;
+    Renderer::DeviceMemory memory = nullptr;
+    bufferManager.CreateBuffer(device, sizeof(UniformBufferObject),
+                               vk::BufferUsageFlagBits::eUniformBuffer,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               buffer, memory);
+    ctx.uniformBuffersMapped.push_back(
+        memory.mapMemory(0, sizeof(UniformBufferObject)));
+    ctx.uniformBuffers.emplace_back(std::move(buffer));
+    ctx.uniformBuffersMemory.emplace_back(std::move(memory));
+  }
+
+  bufferManager.CreateBufferWithData(
+      device, commandPool, QUAD_VERTICES.data(),
+      sizeof(Renderer::Vertex) * QUAD_VERTICES.size(),
+      vk::BufferUsageFlagBits::eVertexBuffer, ctx.vertexBuffer,
+      ctx.vertexBufferMemory);
+  bufferManager.CreateBufferWithData(
+      device, commandPool, QUAD_INDICES.data(),
+      sizeof(uint16_t) * QUAD_INDICES.size(),
+      vk::BufferUsageFlagBits::eIndexBuffer, ctx.indexBuffer,
+      ctx.indexBufferMemory);
+
+  Renderer::createImage(device, TARGET_WIDTH, TARGET_HEIGHT, TARGET_FORMAT,
+                        vk::ImageTiling::eOptimal,
+                        vk::ImageUsageFlagBits::eColorAttachment |
+                            vk::ImageUsageFlagBits::eTransferSrc,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, ctx.target,
+                        ctx.targetMemory);
+  ctx.targetView = Renderer::createImageView(device, ctx.target, TARGET_FORMAT,
+                                             vk::ImageAspectFlagBits::eColor);
+
+  ctx.depthFormat = findDepthFormat(device);
+  Renderer::createImage(device, TARGET_WIDTH, TARGET_HEIGHT, ctx.depthFormat,
+                        vk::ImageTiling::eOptimal,
+                        vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, ctx.depth,
+                        ctx.depthMemory);
+  ctx.depthView = Renderer::createImageView(device, ctx.depth, ctx.depthFormat,
+                                            vk::ImageAspectFlagBits::eDepth);
+
+  ctx.commandBuffers = commandPool.allocatePrimary(MAX_FRAMES_IN_FLIGHT);
+  vk::FenceCreateInfo fenceInfo{};
+  fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+    ctx.fences.emplace_back(device.GetDevice(), fenceInfo);
+}
+
+void recordFrame(RenderContext &ctx, Renderer::Pipeline &pipeline,
+                 Renderer::CommandBuffer &commandBuffer, uint32_t frameIndex,
+                 const std::vector<glm::mat4> &models) {
+  const vk::raii::CommandBuffer &cmd = commandBuffer.get();
+
+  // Both attachments are cleared, so their previous contents can go
+  vk::ImageMemoryBarrier2 colorBarrier{};
+  colorBarrier.srcStageMask = vk::PipelineStageFlagBits2::eAllCommands;
+  colorBarrier.dstStageMask =
+      vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+  colorBarrier.dstAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite;
+  colorBarrier.oldLayout = vk::ImageLayout::eUndefined;
+  colorBarrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  colorBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  colorBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  colorBarrier.image = *ctx.target;
+  colorBarrier.subresourceRange =
+      vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+  vk::ImageAspectFlags depthAspect = vk::ImageAspectFlagBits::eDepth;
+  if (Renderer::hasStencilComponent(ctx.depthFormat))
+    depthAspect |= vk::ImageAspectFlagBits::eStencil;
+  vk::ImageMemoryBarrier2 depthBarrier = colorBarrier;
+  depthBarrier.dstStageMask =
+      vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+      vk::PipelineStageFlagBits2::eLateFragmentTests;
+  depthBarrier.dstAccessMask =
+      vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+      vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+  depthBarrier.newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  depthBarrier.image = *ctx.depth;
+  depthBarrier.subresourceRange =
+      vk::ImageSubresourceRange(depthAspect, 0, 1, 0, 1);
+
+  std::array<vk::ImageMemoryBarrier2, 2> barriers = {colorBarrier,
+                                                     depthBarrier};
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount =
+      static_cast<uint32_t>(barriers.size());
+  dependencyInfo.pImageMemoryBarriers = barriers.data();
+  cmd.pipelineBarrier2(dependencyInfo);
+
+  vk::RenderingAttachmentInfo colorAttachment{};
+  colorAttachment.imageView = *ctx.targetView;
+  colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  colorAttachment.clearValue =
+      vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
+
+  vk::RenderingAttachmentInfo depthAttachment{};
+  depthAttachment.imageView = *ctx.depthView;
+  depthAttachment.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+  depthAttachment.clearValue = vk::ClearDepthStencilValue(1.0f, 0);
+
+  vk::RenderingInfo renderingInfo{};
+  renderingInfo.renderArea.extent = vk::Extent2D{TARGET_WIDTH, TARGET_HEIGHT};
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthAttachment;
+
+  vk::Viewport viewport{};
+  viewport.width = static_cast<float>(TARGET_WIDTH);
+  viewport.height = static_cast<float>(TARGET_HEIGHT);
+  viewport.maxDepth = 1.0f;
+  vk::Rect2D scissor{};
+  scissor.extent = renderingInfo.renderArea.extent;
+
+  cmd.beginRendering(renderingInfo);
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                             *pipeline.Get());
+  commandBuffer.setViewport(viewport);
+  commandBuffer.setScissor(scissor);
+  commandBuffer.bindVertexBuffer(0, *ctx.vertexBuffer);
+  commandBuffer.bindIndexBuffer(*ctx.indexBuffer, vk::IndexType::eUint16);
+  commandBuffer.bindDescriptorSets(
+      vk::PipelineBindPoint::eGraphics, *pipeline.GetLayout(), 0,
+      {pipeline.GetDescriptorSets()[frameIndex]});
+
+  Renderer::DrawConstants drawConstants{};
+  for (const glm::mat4 &model : models) {
+    drawConstants.model = model;
+    commandBuffer.pushConstants(*pipeline.GetLayout(),
+                                vk::ShaderStageFlagBits::eVertex,
+                                drawConstants);
+    commandBuffer.drawIndexed(static_cast<uint32_t>(QUAD_INDICES.size()));
+  }
+  cmd.endRendering();
+}
+
+// Runs warmup + frames frames of the scene with MAX_FRAMES_IN_FLIGHT in
+// flight. A frame's time is the interval between the starts of consecutive
+// frames (after the fence wait), so it covers CPU and GPU work alike.
+SceneResult runScene(Renderer::Device &device, RenderContext &ctx,
+                     Renderer::Pipeline &pipeline,
+                     Renderer::FrameReadback &readback, const Scene &scene,
+                     const Options &options) {
+  SceneResult result;
+  result.name = scene.name;
+  result.frameMs.reserve(options.frames);
+
+  UniformBufferObject ubo{};
+  ubo.view = glm::lookAt(scene.eye, glm::vec3(0.0f), UP);
+  ubo.proj = glm::perspective(glm::radians(45.0f),
+                              static_cast<float>(TARGET_WIDTH) /
+                                  static_cast<float>(TARGET_HEIGHT),
+                              0.1f, 10.0f);
+  // Flip the Y coordinate
+  ubo.proj[1][1] *= -1;
+
+  vk::raii::Queue queue = device.GetGraphicsQueue();
+  std::vector<glm::mat4> models;
+  std::future<Renderer::ReadbackImage> capture;
+
+  uint32_t total = options.warmup + options.frames;
+  uint32_t frameIndex = 0;
+  Clock::time_point frameStart;
+  for (uint32_t frame = 0; frame < total; ++frame) {
+    frameIndex = frame % MAX_FRAMES_IN_FLIGHT;
+    vk::raii::Fence &fence = ctx.fences[frameIndex];
+    if (device.GetDevice().waitForFences(*fence, vk::True, UINT64_MAX) !=
+        vk::Result::eSuccess)
+      throw std::runtime_error("failed to wait for frame fence!");
+
+    Clock::time_point now = Clock::now();
+    if (frame > options.warmup) {
+      result.frameMs.push_back(
+          std::chrono::duration<double, std::milli>(now - frameStart)
+              .count());
+    }
+    frameStart = now;
+
+    device.GetDevice().resetFences(*fence);
+    readback.BeginFrame(frameIndex);
+
+    float t = total > 1 ? static_cast<float>(frame) /
+                              static_cast<float>(total - 1)
+                        : 1.0f;
+    models.clear();
+    scene.pose(t, models);
+    std::memcpy(ctx.uniformBuffersMapped[frameIndex], &ubo, sizeof(ubo));
+
+    Renderer::CommandBuffer &commandBuffer = *ctx.commandBuffers[frameIndex];
+    commandBuffer.reset();
+    commandBuffer.begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+    recordFrame(ctx, pipeline, commandBuffer, frameIndex, models);
+    if (frame + 1 == total) {
+      capture = readback.Capture(
+          commandBuffer.get(), *ctx.target,
+          vk::ImageLayout::eColorAttachmentOptimal, TARGET_FORMAT,
+          vk::Extent2D{TARGET_WIDTH, TARGET_HEIGHT});
+    }
+    commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &*commandBuffer.get();
+    queue.submit(submitInfo, *fence);
+  }
+
+  device.GetDevice().waitIdle();
+  if (options.frames > 0) {
+    result.frameMs.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - frameStart)
+            .count());
+  }
+
+  // The last frame is complete, so this hands its capture over
+  readback.BeginFrame(frameIndex);
+  if (!capture.valid())
+    throw std::runtime_error("no readback slot for the checked frame");
+  result.image = capture.get();
+
+  result.p50 = percentile(result.frameMs, 0.5);
+  result.p95 = percentile(result.frameMs, 0.95);
+  result.p99 = percentile(result.frameMs, 0.99);
+  return result;
+}
+
+void checkImage(SceneResult &result, const Options &options) {
+  const Renderer::ReadbackImage &image = result.image;
+  std::string goldenPath =
+      (std::filesystem::path(options.goldenDir) / (result.name + ".png"))
+          .string();
+
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc *golden = stbi_load(goldenPath.c_str(), &width, &height, &channels,
+                              STBI_rgb_alpha);
+  if (!golden) {
+    std::cerr << result.name << ": no golden image at " << goldenPath
+              << ", image check skipped (record one with --update)"
+              << std::endl;
+    result.imageSkipped = true;
+    return;
+  }
+  if (static_cast<uint32_t>(width) != image.width ||
+      static_cast<uint32_t>(height) != image.height) {
+    std::cerr << result.name << ": golden image is " << width << "x"
+              << height << ", rendered " << image.width << "x"
+              << image.height << std::endl;
+    stbi_image_free(golden);
+    result.imagePassed = false;
+    return;
+  }
+
+  std::vector<uint8_t> diff;
+  result.differingFraction =
+      compareImages(golden, image.pixels.data(), image.width, image.height,
+                    options.tolerance, diff);
+  stbi_image_free(golden);
+
+  result.imagePassed = result.differingFraction <= options.maxDiff;
+  if (!result.imagePassed) {
+    std::string diffPath =
+        (std::filesystem::path(options.outDir) / (result.name + ".diff.png"))
+            .string();
+    Renderer::WriteFile(diffPath,
+                        Renderer::EncodePng(diff.data(), image.width,
+                                            image.height));
+    std::cerr << result.name << ": " << result.differingFraction * 100.0
+              << "% of pixels differ from the golden image (allowed "
+              << options.maxDiff * 100.0 << "%), see " << diffPath
+              << std::endl;
+  }
+}
+
+void checkTiming(SceneResult &result, const Baseline &baseline,
+                 const Options &options) {
+  auto entry = std::find_if(
+      baseline.scenes.begin(), baseline.scenes.end(),
+      [&](const Baseline::Entry &e) { return e.name == result.name; });
+  if (entry == baseline.scenes.end()) {
+    std::cerr << result.name << ": no frame-time baseline, timing check "
+              << "skipped (record one with --update)" << std::endl;
+    result.timingSkipped = true;
+    return;
+  }
+  result.baselineP50 = entry->p50;
+  result.baselineP95 = entry->p95;
+
+  auto regressed = [&](const char *label, double value, double reference) {
+    double limit = reference * (1.0 + options.threshold);
+    if (value <= limit || value - reference <= NOISE_FLOOR_MS)
+      return false;
+    std::cerr << result.name << ": " << label << " frame time " << value
+              << " ms, baseline " << reference << " ms (+"
+              << (value / reference - 1.0) * 100.0 << "%, allowed +"
+              << options.threshold * 100.0 << "%)" << std::endl;
+    return true;
+  };
+  bool p50Regressed = regressed("p50", result.p50, entry->p50);
+  bool p95Regressed = regressed("p95", result.p95, entry->p95);
+  result.timingPassed = !p50Regressed && !p95Regressed;
+}
+
+bool parseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--frames" && hasValue) {
+      options.frames =
+          static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--warmup" && hasValue) {
+      options.warmup =
+          static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--threshold" && hasValue) {
+      options.threshold = std::max(0.0, std::atof(argv[++i]));
+    } else if (arg == "--tolerance" && hasValue) {
+      options.tolerance = std::clamp(std::atof(argv[++i]), 0.0, 1.0);
+    } else if (arg == "--max-diff" && hasValue) {
+      options.maxDiff = std::clamp(std::atof(argv[++i]), 0.0, 1.0);
+    } else if (arg == "--golden" && hasValue) {
+      options.goldenDir = argv[++i];
+    } else if (arg == "--baseline" && hasValue) {
+      options.baselinePath = argv[++i];
+    } else if (arg == "--out" && hasValue) {
+      options.outDir = argv[++i];
+    } else if (arg == "--update") {
+      options.update = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0]
+              << " [--frames N] [--warmup N] [--threshold F]"
+                 " [--tolerance F] [--max-diff F] [--golden DIR]"
+                 " [--baseline FILE] [--out DIR] [--update]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  bool passed = true;
+  try {
+    // Validation layers would dominate the frame times
+    Renderer::Instance instance("Renderer Regression", true, false);
+    Renderer::Device device(instance);
+    Renderer::CommandPool commandPool(
+        device, vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+    Renderer::BufferManager bufferManager;
+
+    Renderer::Texture texture(bufferManager);
+    texture.loadFromFile(device, commandPool, bufferManager,
+                         "textures/owl.jpg");
+
+    RenderContext ctx;
+    createRenderContext(device, commandPool, bufferManager, ctx);
+    Renderer::Pipeline pipeline(device, TARGET_FORMAT, MAX_FRAMES_IN_FLIGHT,
+                                ctx.uniformBuffers,
+                                sizeof(UniformBufferObject), texture,
+                                ctx.depthFormat);
+    Renderer::FrameReadback readback(device, MAX_FRAMES_IN_FLIGHT,
+                                     vk::Extent2D{TARGET_WIDTH,
+                                                  TARGET_HEIGHT});
+
+    std::string deviceName(
+        device.GetPhysicalDevice().getProperties().deviceName);
+    std::filesystem::create_directories(options.outDir);
+
+    std::vector<SceneResult> results;
+    for (const Scene &scene : SCENES) {
+      results.push_back(
+          runScene(device, ctx, pipeline, readback, scene, options));
+      const SceneResult &r = results.back();
+      Renderer::WriteFile(
+          (std::filesystem::path(options.outDir) / (r.name + ".png"))
+              .string(),
+          Renderer::EncodePng(r.image.pixels.data(), r.image.width,
+                              r.image.height));
+    }
+
+    if (options.update) {
+      std::filesystem::create_directories(options.goldenDir);
+      for (const SceneResult &r : results) {
+        Renderer::WriteFile(
+            (std::filesystem::path(options.goldenDir) / (r.name + ".png"))
+                .string(),
+            Renderer::EncodePng(r.image.pixels.data(), r.image.width,
+                                r.image.height));
+      }
+      std::filesystem::path baselineDir =
+          std::filesystem::path(options.baselinePath).parent_path();
+      if (!baselineDir.empty())
+        std::filesystem::create_directories(baselineDir);
+      std::ofstream out(options.baselinePath);
+      if (!out.is_open()) {
+        throw std::runtime_error("failed to open baseline output: " +
+                                 options.baselinePath);
+      }
+      writeJson(out, deviceName, options, results);
+      std::cerr << "Goldens written to " << options.goldenDir
+                << ", baseline to " << options.baselinePath << std::endl;
+    } else {
+      for (SceneResult &r : results)
+        checkImage(r, options);
+
+      std::optional<Baseline> baseline = readBaseline(options.baselinePath);
+      if (!baseline) {
+        std::cerr << "no frame-time baseline at " << options.baselinePath
+                  << ", frame times not checked (record one with --update)"
+                  << std::endl;
+        for (SceneResult &r : results)
+          r.timingSkipped = true;
+      } else if (baseline->device != deviceName) {
+        // Timings from another device say nothing about this one
+        std::cerr << "frame-time baseline is from \"" << baseline->device
+                  << "\", running on \"" << deviceName
+                  << "\"; frame times not checked" << std::endl;
+      } else {
+        for (SceneResult &r : results)
+          checkTiming(r, *baseline, options);
+      }
+
+      for (const SceneResult &r : results)
+        passed = passed && r.imagePassed && r.timingPassed;
+    }
+
+    for (const SceneResult &r : results) {
+      std::cerr << r.name << ": p50 " << r.p50 << " ms, p95 " << r.p95
+                << " ms, p99 " << r.p99 << " ms"
+                << (r.imagePassed && r.timingPassed ? "" : " FAILED")
+                << (r.imageSkipped ? " (image skipped)" : "")
+                << (r.timingSkipped ? " (timing skipped)" : "") << std::endl;
+    }
+
+    std::string resultsPath =
+        (std::filesystem::path(options.outDir) / "regression.json").string();
+    std::ofstream out(resultsPath);
+    if (!out.is_open()) {
+      throw std::runtime_error("failed to open regression output: " +
+                               resultsPath);
+    }
+    writeJson(out, deviceName, options, results);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,741 @@
+// Headless microbenchmarks for the Renderer subsystems.
+//
+// Runs against whatever Vulkan ICD the loader picks (lavapipe included) and
+// writes the results as JSON so they can be diffed between releases:
+//
+//   renderer_bench [--iterations N] [--out renderer_bench.json]
+//
+// Must be started from the repository root (textures are loaded through
+// relative paths, same as the Renderer executable).
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../src/Renderer/Asset/AssetPack.h"
+#include "../src/Renderer/Buffer/Buffer.h"
+#include "../src/Renderer/Command/CommandBuffer.h"
+#include "../src/Renderer/Command/CommandPool.h"
+#include "../src/Renderer/Culling/FrustumCuller.h"
+#include "../src/Renderer/Descriptor/DescriptorAllocator.h"
+#include "../src/Renderer/Device/Device.h"
+#include "../src/Renderer/Helpers/helpers.h"
+#include "../src/Renderer/Instance/Instance.h"
+#include "../src/Renderer/Pipeline/Pipeline.h"
+#include "../src/Renderer/Scene/DrawList.h"
+#include "../src/Renderer/Scene/TransformHierarchy.h"
+#include "../src/Renderer/Texture/Texture.h"
+#include "../src/Renderer/Texture/TextureAtlas.h"
+#include "../src/Renderer/Threading/ThreadPool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+constexpr vk::Format TARGET_FORMAT = vk::Format::eR8G8B8A8Unorm;
+constexpr uint32_t TARGET_SIZE = 256;
+
+struct BenchResult {
+  std::string name;
+  uint64_t param = 0;  // size in bytes, draw count, ... (0 if unused)
+  uint64_t bytes = 0;  // bytes moved per sample, for throughput
+  uint64_t units = 1;  // work items per sample (draws, sets)
+  std::vector<double> samplesUs;
+};
+
+double elapsedUs(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+double percentile(std::vector<double> sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  std::sort(sorted.begin(), sorted.end());
+  size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+std::string escapeJson(const std::string &in) {
+  std::string out;
+  for (char c : in) {
+    if (c == '"' || c == '\\')
+      out.push_back('\\');
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out.push_back(c);
+  }
+  return out;
+}
+
+void writeJson(std::ostream &out, Renderer::Device &device,
+               const std::vector<BenchResult> &results) {
+  vk::PhysicalDeviceProperties props =
+      device.GetPhysicalDevice().getProperties();
+
+  out << "{\n";
+  out << "  \"device\": \"" << escapeJson(std::string(props.deviceName))
+      << "\",\n";
+  out << "  \"vendor_id\": " << props.vendorID << ",\n";
+  out << "  \"driver_version\": " << props.driverVersion << ",\n";
+  out << "  \"api_version\": \"" << VK_API_VERSION_MAJOR(props.apiVersion)
+      << "." << VK_API_VERSION_MINOR(props.apiVersion) << "."
+      << VK_API_VERSION_PATCH(props.apiVersion) << "\",\n";
+  out << "  \"results\": [\n";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult &r = results[i];
+    double mean = r.samplesUs.empty()
+                      ? 0.0
+                      : std::accumulate(r.samplesUs.begin(),
+                                        r.samplesUs.end(), 0.0) /
+                            r.samplesUs.size();
+    double median = percentile(r.samplesUs, 0.5);
+
+    out << "    {\"name\": \"" << r.name << "\", \"param\": " << r.param
+        << ", \"samples\": " << r.samplesUs.size()
+        << ", \"min_us\": " << percentile(r.samplesUs, 0.0)
+        << ", \"median_us\": " << median << ", \"mean_us\": " << mean
+        << ", \"p95_us\": " << percentile(r.samplesUs, 0.95)
+        << ", \"per_unit_us\": " << median / r.units;
+    if (r.bytes > 0 && median > 0.0) {
+      out << ", \"throughput_mb_s\": "
+          << (r.bytes / (1024.0 * 1024.0)) / (median / 1e6);
+    }
+    out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  out << "  ]\n";
+  out << "}\n";
+}
+
+const std::vector<vk::DeviceSize> BUFFER_SIZES = {
+    4ull << 10, 64ull << 10, 1ull << 20, 16ull << 20, 64ull << 20};
+
+void benchCreateBuffer(Renderer::Device &device,
+                       Renderer::BufferManager &bufferManager,
+                       uint32_t iterations,
+                       std::vector<BenchResult> &results) {
+  for (vk::DeviceSize size : BUFFER_SIZES) {
+    BenchResult result{"BufferManager::CreateBuffer", size, size};
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+      vk::raii::Buffer buffer = nullptr;
+      Renderer::DeviceMemory memory = nullptr;
+
+      auto start = Clock::now();
+      bufferManager.CreateBuffer(device, size,
+                                 vk::BufferUsageFlagBits::eTransferDst |
+                                     vk::BufferUsageFlagBits::eVertexBuffer,
+                                 vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                 buffer, memory);
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+void benchCopyBuffer(Renderer::Device &device,
+                     Renderer::CommandPool &commandPool,
+                     Renderer::BufferManager &bufferManager,
+                     uint32_t iterations, std::vector<BenchResult> &results) {
+  for (vk::DeviceSize size : BUFFER_SIZES) {
+    BenchResult result{"BufferManager::CopyBuffer", size, size};
+
+    vk::raii::Buffer staging = nullptr;
+    Renderer::DeviceMemory stagingMemory = nullptr;
+    bufferManager.CreateBuffer(device, size,
+                               vk::BufferUsageFlagBits::eTransferSrc,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               staging, stagingMemory);
+
+    vk::raii::Buffer target = nullptr;
+    Renderer::DeviceMemory targetMemory = nullptr;
+    bufferManager.CreateBuffer(device, size,
+                               vk::BufferUsageFlagBits::eTransferDst |
+                                   vk::BufferUsageFlagBits::eVertexBuffer,
+                               vk::MemoryPropertyFlagBits::eDeviceLocal,
+                               target, targetMemory);
+
+    void *data = stagingMemory.mapMemory(0, size);
+    memset(data, 0xAB, static_cast<size_t>(size));
+    stagingMemory.unmapMemory();
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+      auto start = Clock::now();
+      bufferManager.CopyBuffer(device, commandPool, staging, target, size);
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+void benchUploadBuffer(Renderer::Device &device,
+                       Renderer::CommandPool &commandPool,
+                       Renderer::BufferManager &bufferManager,
+                       uint32_t iterations,
+                       std::vector<BenchResult> &results) {
+  for (vk::DeviceSize size : BUFFER_SIZES) {
+    BenchResult result{"BufferManager::CreateBufferWithData", size, size};
+    std::vector<unsigned char> data(static_cast<size_t>(size), 0xAB);
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+      vk::raii::Buffer buffer = nullptr;
+      Renderer::DeviceMemory memory = nullptr;
+
+      auto start = Clock::now();
+      bufferManager.CreateBufferWithData(
+          device, commandPool, data.data(), size,
+          vk::BufferUsageFlagBits::eVertexBuffer, buffer, memory);
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+void benchTextureLoad(Renderer::Device &device,
+                      Renderer::CommandPool &commandPool,
+                      Renderer::BufferManager &bufferManager,
+                      uint32_t iterations, std::vector<BenchResult> &results) {
+  BenchResult result{"Texture::loadFromFile"};
+
+  for (uint32_t i = 0; i < iterations; ++i) {
+    Renderer::Texture texture(bufferManager);
+
+    auto start = Clock::now();
+    texture.loadFromFile(device, commandPool, bufferManager,
+                         "textures/owl.jpg");
+    result.samplesUs.push_back(elapsedUs(start));
+
+    result.param = texture.getWidth() * texture.getHeight();
+  }
+  results.push_back(std::move(result));
+}
+
+// Same image as benchTextureLoad, but pre-decoded with mips in an asset
+// pack: the difference is what the offline packer saves at load time
+void benchPackTextureLoad(Renderer::Device &device,
+                          Renderer::CommandPool &commandPool,
+                          Renderer::BufferManager &bufferManager,
+                          uint32_t iterations,
+                          std::vector<BenchResult> &results) {
+  int width, height, channels;
+  stbi_uc *pixels = stbi_load("textures/owl.jpg", &width, &height, &channels,
+                              STBI_rgb_alpha);
+  if (!pixels) {
+    throw std::runtime_error("failed to load texture image!");
+  }
+  uint32_t mipLevels = std::min(Renderer::getMipLevelCount(width, height),
+                                Renderer::MAX_PACK_MIPS);
+  auto mips = Renderer::generateMipChain(pixels, width, height, mipLevels);
+  stbi_image_free(pixels);
+
+  std::string packPath =
+      (std::filesystem::temp_directory_path() / "renderer_bench.pack")
+          .string();
+  Renderer::AssetPackWriter writer;
+  writer.AddTexture("owl", vk::Format::eR8G8B8A8Srgb, width, height, mips);
+  writer.Write(packPath);
+
+  BenchResult result{"Texture::loadFromPack"};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    Renderer::Texture texture(bufferManager);
+
+    auto start = Clock::now();
+    Renderer::AssetPack pack(packPath);
+    texture.loadFromPack(device, commandPool, bufferManager, pack, "owl");
+    result.samplesUs.push_back(elapsedUs(start));
+
+    result.param = texture.getWidth() * texture.getHeight();
+  }
+  results.push_back(std::move(result));
+
+  std::filesystem::remove(packPath);
+}
+
+// Many small textures packed into one array image: one staging buffer and
+// one copy for the whole set instead of one upload per texture
+void benchTextureAtlas(Renderer::Device &device,
+                       Renderer::CommandPool &commandPool,
+                       Renderer::BufferManager &bufferManager,
+                       uint32_t iterations,
+                       std::vector<BenchResult> &results) {
+  constexpr uint32_t TEXTURE_COUNT = 256;
+
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint32_t> size(16, 128);
+  std::uniform_int_distribution<int> texel(0, 255);
+
+  std::vector<std::array<uint32_t, 2>> extents(TEXTURE_COUNT);
+  std::vector<std::vector<unsigned char>> pixels(TEXTURE_COUNT);
+  uint64_t bytes = 0;
+  for (uint32_t i = 0; i < TEXTURE_COUNT; ++i) {
+    extents[i] = {size(rng), size(rng)};
+    pixels[i].resize(static_cast<size_t>(extents[i][0]) * extents[i][1] * 4);
+    for (unsigned char &value : pixels[i])
+      value = static_cast<unsigned char>(texel(rng));
+    bytes += pixels[i].size();
+  }
+
+  BenchResult result{"TextureAtlas::Build", TEXTURE_COUNT, bytes,
+                     TEXTURE_COUNT};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    auto start = Clock::now();
+    Renderer::TextureAtlas atlas;
+    for (uint32_t t = 0; t < TEXTURE_COUNT; ++t) {
+      if (!atlas.Add(pixels[t].data(), extents[t][0], extents[t][1])) {
+        throw std::runtime_error("bench texture does not fit the atlas!");
+      }
+    }
+    atlas.Build(device, commandPool, bufferManager);
+    result.samplesUs.push_back(elapsedUs(start));
+  }
+  results.push_back(std::move(result));
+}
+
+struct DrawResources {
+  std::vector<vk::raii::Buffer> uniformBuffers;
+  std::vector<Renderer::DeviceMemory> uniformBuffersMemory;
+
+  vk::raii::Buffer vertexBuffer = nullptr;
+  Renderer::DeviceMemory vertexBufferMemory = nullptr;
+  vk::raii::Buffer indexBuffer = nullptr;
+  Renderer::DeviceMemory indexBufferMemory = nullptr;
+
+  vk::raii::Image target = nullptr;
+  Renderer::DeviceMemory targetMemory = nullptr;
+  vk::raii::ImageView targetView = nullptr;
+};
+
+void createDrawResources(Renderer::Device &device,
+                         Renderer::BufferManager &bufferManager,
+                         DrawResources &res) {
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    vk::raii::Buffer buffer = nullptr;
+    Renderer::DeviceMemory memory = nullptr;
+    bufferManager.CreateBuffer(device, 2 * sizeof(glm::mat4),
+                               vk::BufferUsageFlagBits::eUniformBuffer,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               buffer, memory);
+    res.uniformBuffers.emplace_back(std::move(buffer));
+    res.uniformBuffersMemory.emplace_back(std::move(memory));
+  }
+
+  bufferManager.CreateBuffer(device, 4 * sizeof(Renderer::Vertex),
+                             vk::BufferUsageFlagBits::eVertexBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             res.vertexBuffer, res.vertexBufferMemory);
+  bufferManager.CreateBuffer(device, 6 * sizeof(uint16_t),
+                             vk::BufferUsageFlagBits::eIndexBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             res.indexBuffer, res.indexBufferMemory);
+
+  Renderer::createImage(device, TARGET_SIZE, TARGET_SIZE, TARGET_FORMAT,
+                        vk::ImageTiling::eOptimal,
+                        vk::ImageUsageFlagBits::eColorAttachment,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal, res.target,
+                        res.targetMemory);
+  res.targetView = Renderer::createImageView(device, res.target, TARGET_FORMAT,
+                                             vk::ImageAspectFlagBits::eColor);
+}
+
+void benchPipeline(Renderer::Device &device, Renderer::Texture &texture,
+                   DrawResources &res, uint32_t iterations,
+                   std::vector<BenchResult> &results) {
+  BenchResult result{"Pipeline::Pipeline"};
+
+  for (uint32_t i = 0; i < iterations; ++i) {
+    auto start = Clock::now();
+    Renderer::Pipeline pipeline(device, TARGET_FORMAT, MAX_FRAMES_IN_FLIGHT,
+                                res.uniformBuffers, 2 * sizeof(glm::mat4),
+                                texture);
+    result.samplesUs.push_back(elapsedUs(start));
+  }
+  results.push_back(std::move(result));
+}
+
+void benchDescriptorAlloc(Renderer::Device &device,
+                          Renderer::Pipeline &pipeline, uint32_t iterations,
+                          std::vector<BenchResult> &results) {
+  constexpr uint32_t SETS_PER_POOL = 256;
+
+  vk::DescriptorPoolSize uniPoolSize(vk::DescriptorType::eUniformBuffer,
+                                     SETS_PER_POOL);
+  vk::DescriptorPoolSize texPoolSize(vk::DescriptorType::eCombinedImageSampler,
+                                     SETS_PER_POOL);
+  std::array<vk::DescriptorPoolSize, 2> poolSize = {uniPoolSize, texPoolSize};
+
+  vk::DescriptorPoolCreateInfo poolInfo{};
+  poolInfo.maxSets = SETS_PER_POOL;
+  poolInfo.poolSizeCount = poolSize.size();
+  poolInfo.pPoolSizes = poolSize.data();
+  vk::raii::DescriptorPool pool(device.GetDevice(), poolInfo);
+
+  vk::DescriptorSetLayout layout = pipeline.GetDescriptorSetLayout();
+  vk::DescriptorSetAllocateInfo allocInfo{};
+  allocInfo.descriptorPool = *pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  BenchResult result{"DescriptorSet::allocate", SETS_PER_POOL};
+  result.units = SETS_PER_POOL;
+
+  for (uint32_t i = 0; i < iterations; ++i) {
+    auto start = Clock::now();
+    for (uint32_t s = 0; s < SETS_PER_POOL; ++s) {
+      // The pool is reset wholesale below, so hand the handle back instead
+      // of letting the RAII wrapper free it individually.
+      device.GetDevice().allocateDescriptorSets(allocInfo).front().release();
+    }
+    result.samplesUs.push_back(elapsedUs(start));
+    pool.reset();
+  }
+  results.push_back(std::move(result));
+
+  // Same through the growable allocator, starting with pools too small so
+  // the growth path is part of the measurement
+  constexpr uint32_t GROWTH_SETS = 4 * SETS_PER_POOL;
+  Renderer::DescriptorAllocator allocator(
+      Renderer::DescriptorAllocator::GetDefaultRatios(), 16);
+  BenchResult growResult{"DescriptorAllocator::Allocate", GROWTH_SETS};
+  growResult.units = GROWTH_SETS;
+
+  for (uint32_t i = 0; i < iterations; ++i) {
+    auto start = Clock::now();
+    for (uint32_t s = 0; s < GROWTH_SETS; ++s)
+      allocator.Allocate(device, layout);
+    growResult.samplesUs.push_back(elapsedUs(start));
+    allocator.Reset();
+  }
+  results.push_back(std::move(growResult));
+}
+
+void benchRecordDraws(Renderer::Device &device,
+                      Renderer::CommandPool &commandPool,
+                      Renderer::Pipeline &pipeline, DrawResources &res,
+                      uint32_t iterations, std::vector<BenchResult> &results) {
+  auto commandBuffer = commandPool.allocatePrimary();
+  const vk::raii::CommandBuffer &cmd = commandBuffer->get();
+
+  vk::RenderingAttachmentInfo attachmentInfo{};
+  attachmentInfo.imageView = *res.targetView;
+  attachmentInfo.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  attachmentInfo.loadOp = vk::AttachmentLoadOp::eClear;
+  attachmentInfo.storeOp = vk::AttachmentStoreOp::eStore;
+
+  vk::RenderingInfo renderingInfo{};
+  renderingInfo.renderArea.extent = vk::Extent2D{TARGET_SIZE, TARGET_SIZE};
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &attachmentInfo;
+
+  vk::Viewport viewport{};
+  viewport.width = static_cast<float>(TARGET_SIZE);
+  viewport.height = static_cast<float>(TARGET_SIZE);
+  viewport.maxDepth = 1.0f;
+  vk::Rect2D scissor{};
+  scissor.extent = renderingInfo.renderArea.extent;
+
+  Renderer::DrawConstants drawConstants{};
+  drawConstants.model = glm::mat4(1.0f);
+
+  // Second variant: state bound once, only the push constants change
+  for (bool pushOnly : {false, true}) {
+    for (uint32_t drawCount : {1u, 100u, 1000u, 10000u}) {
+      BenchResult result{pushOnly ? "CommandBuffer::recordPushConstantDraws"
+                                  : "CommandBuffer::recordDrawIndexed",
+                         drawCount};
+      result.units = drawCount;
+
+      for (uint32_t i = 0; i < iterations; ++i) {
+        commandBuffer->reset();
+
+        auto start = Clock::now();
+        cmd.begin({});
+        cmd.beginRendering(renderingInfo);
+        cmd.setViewport(0, viewport);
+        cmd.setScissor(0, scissor);
+        for (uint32_t d = 0; d < drawCount; ++d) {
+          if (!pushOnly || d == 0) {
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                             *pipeline.Get());
+            cmd.bindVertexBuffers(0, *res.vertexBuffer, {0});
+            cmd.bindIndexBuffer(*res.indexBuffer, 0, vk::IndexType::eUint16);
+          }
+          if (!pushOnly || d == 0) {
+            cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                   *pipeline.GetLayout(), 0,
+                                   pipeline.GetDescriptorSets()[d % 2],
+                                   nullptr);
+          }
+          if (pushOnly || d == 0) {
+            drawConstants.model[3][0] = static_cast<float>(d);
+            commandBuffer->pushConstants(*pipeline.GetLayout(),
+                                         vk::ShaderStageFlagBits::eVertex,
+                                         drawConstants);
+          }
+          cmd.drawIndexed(6, 1, 0, 0, 0);
+        }
+        cmd.endRendering();
+        cmd.end();
+        result.samplesUs.push_back(elapsedUs(start));
+      }
+      results.push_back(std::move(result));
+    }
+  }
+
+  // Naive per-draw binds through the wrapper, which drops the repeats
+  for (uint32_t drawCount : {1u, 100u, 1000u, 10000u}) {
+    BenchResult result{"CommandBuffer::recordFilteredDraws", drawCount};
+    result.units = drawCount;
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+      commandBuffer->reset();
+
+      auto start = Clock::now();
+      commandBuffer->begin();
+      cmd.beginRendering(renderingInfo);
+      for (uint32_t d = 0; d < drawCount; ++d) {
+        commandBuffer->bindPipeline(vk::PipelineBindPoint::eGraphics,
+                                    *pipeline.Get());
+        commandBuffer->setViewport(viewport);
+        commandBuffer->setScissor(scissor);
+        commandBuffer->bindVertexBuffer(0, *res.vertexBuffer);
+        commandBuffer->bindIndexBuffer(*res.indexBuffer,
+                                       vk::IndexType::eUint16);
+        commandBuffer->bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                          *pipeline.GetLayout(), 0,
+                                          {pipeline.GetDescriptorSets()[0]});
+        drawConstants.model[3][0] = static_cast<float>(d);
+        commandBuffer->pushConstants(*pipeline.GetLayout(),
+                                     vk::ShaderStageFlagBits::eVertex,
+                                     drawConstants);
+        commandBuffer->drawIndexed(6);
+      }
+      cmd.endRendering();
+      commandBuffer->end();
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+void benchFrustumCull(uint32_t iterations,
+                      std::vector<BenchResult> &results) {
+  glm::mat4 proj(0.0f);
+  proj[0][0] = 1.0f;
+  proj[1][1] = -1.0f;
+  proj[2][2] = -1.0f;
+  proj[2][3] = -1.0f;
+  proj[3][2] = -0.1f; // 90 degree fov, near 0.1, far ~inf, camera at origin
+  Renderer::Frustum frustum = Renderer::Frustum::FromMatrix(proj);
+
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+  for (uint32_t count : {10000u, 100000u, 1000000u}) {
+    Renderer::BoundingSpheres spheres;
+    Renderer::BoundingBoxes boxes;
+    spheres.Reserve(count);
+    boxes.Reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      glm::vec3 center(position(rng), position(rng), position(rng));
+      float radius = size(rng);
+      spheres.Add(center, radius);
+      boxes.Add(center - glm::vec3(radius), center + glm::vec3(radius));
+    }
+
+    for (auto kernel : {Renderer::FrustumCuller::Kernel::Scalar,
+                        Renderer::FrustumCuller::Kernel::SSE,
+                        Renderer::FrustumCuller::Kernel::AVX2,
+                        Renderer::FrustumCuller::Kernel::NEON}) {
+      if (!Renderer::FrustumCuller::IsSupported(kernel))
+        continue;
+      Renderer::FrustumCuller culler(kernel);
+      std::string name = std::string("FrustumCuller::Cull/") +
+                         Renderer::FrustumCuller::GetKernelName(kernel);
+      std::vector<uint32_t> visible;
+
+      BenchResult sphereResult{name + "/spheres", count, 0, count};
+      BenchResult boxResult{name + "/boxes", count, 0, count};
+      for (uint32_t i = 0; i < iterations; ++i) {
+        auto start = Clock::now();
+        culler.Cull(frustum, spheres, visible);
+        sphereResult.samplesUs.push_back(elapsedUs(start));
+
+        start = Clock::now();
+        culler.Cull(frustum, boxes, visible);
+        boxResult.samplesUs.push_back(elapsedUs(start));
+      }
+      results.push_back(std::move(sphereResult));
+      results.push_back(std::move(boxResult));
+    }
+  }
+}
+
+void benchTransformUpdate(uint32_t iterations,
+                          std::vector<BenchResult> &results) {
+  Renderer::ThreadPool pool;
+
+  // Wide and shallow: 1000 roots, each with a chain of children fanning out
+  constexpr uint32_t NODE_COUNT = 100000;
+  Renderer::TransformHierarchy hierarchy;
+  hierarchy.Reserve(NODE_COUNT);
+  for (uint32_t i = 0; i < NODE_COUNT; ++i) {
+    uint32_t parent = i < 1000 ? Renderer::TransformHierarchy::InvalidNode
+                               : (i - 1000) / 4;
+    hierarchy.AddNode(parent, glm::vec3(1.0f, 0.0f, 0.0f));
+  }
+  hierarchy.SetTargetCount(1);
+  std::vector<glm::mat4> instances(NODE_COUNT);
+
+  for (bool threaded : {false, true}) {
+    BenchResult result{threaded ? "TransformHierarchy::Update/threads"
+                                : "TransformHierarchy::Update/serial",
+                       NODE_COUNT, 0, NODE_COUNT};
+    for (uint32_t i = 0; i < iterations; ++i) {
+      // Animate the roots, so every node is recomputed and written
+      glm::quat rotation =
+          glm::angleAxis(0.01f * i, glm::vec3(0.0f, 0.0f, 1.0f));
+      for (uint32_t root = 0; root < 1000; ++root)
+        hierarchy.SetRotation(root, rotation);
+
+      auto start = Clock::now();
+      hierarchy.Update(threaded ? &pool : nullptr);
+      hierarchy.Write(0, instances.data(), sizeof(glm::mat4),
+                      threaded ? &pool : nullptr);
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+void benchDrawListSort(uint32_t iterations,
+                       std::vector<BenchResult> &results) {
+  Renderer::ThreadPool pool;
+
+  // A mixed scene: a few pipelines, many materials and meshes, one draw in
+  // ten transparent
+  constexpr uint32_t DRAW_COUNT = 200000;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<uint32_t> pipelineDist(0, 7);
+  std::uniform_int_distribution<uint32_t> materialDist(0, 999);
+  std::uniform_int_distribution<uint32_t> meshDist(0, 4999);
+  std::uniform_real_distribution<float> distanceDist(0.1f, 500.0f);
+  std::vector<uint64_t> keys(DRAW_COUNT);
+  for (uint32_t i = 0; i < DRAW_COUNT; ++i) {
+    uint32_t pipeline = pipelineDist(rng);
+    uint32_t material = materialDist(rng);
+    uint32_t mesh = meshDist(rng);
+    float distance = distanceDist(rng);
+    keys[i] = i % 10 == 0 ? Renderer::DrawList::MakeTransparentKey(
+                                pipeline, material, mesh, distance)
+                          : Renderer::DrawList::MakeOpaqueKey(
+                                pipeline, material, mesh, distance);
+  }
+
+  Renderer::DrawList list;
+  list.Reserve(DRAW_COUNT);
+  for (bool threaded : {false, true}) {
+    BenchResult result{threaded ? "DrawList::Sort/threads"
+                                : "DrawList::Sort/serial",
+                       DRAW_COUNT, 0, DRAW_COUNT};
+    for (uint32_t i = 0; i < iterations; ++i) {
+      list.Clear();
+      for (uint32_t d = 0; d < DRAW_COUNT; ++d)
+        list.Add(keys[d], d);
+
+      auto start = Clock::now();
+      list.Sort(threaded ? &pool : nullptr);
+      result.samplesUs.push_back(elapsedUs(start));
+    }
+    results.push_back(std::move(result));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t iterations = 20;
+  std::string outPath = "renderer_bench.json";
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--iterations" && i + 1 < argc) {
+      iterations = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (arg == "--out" && i + 1 < argc) {
+      outPath = argv[++i];
+    } else {
+      std::cerr << "usage: " << argv[0]
+                << " [--iterations N] [--out file.json]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  try {
+    Renderer::Instance instance("Renderer Bench", true);
+    Renderer::Device device(instance);
+    Renderer::CommandPool commandPool(
+        device, vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+    Renderer::BufferManager bufferManager;
+
+    std::vector<BenchResult> results;
+
+    benchCreateBuffer(device, bufferManager, iterations, results);
+    benchCopyBuffer(device, commandPool, bufferManager, iterations, results);
+    benchUploadBuffer(device, commandPool, bufferManager, iterations, results);
+    benchTextureLoad(device, commandPool, bufferManager, iterations, results);
+    benchPackTextureLoad(device, commandPool, bufferManager, iterations,
+                         results);
+    benchTextureAtlas(device, commandPool, bufferManager, iterations,
+                      results);
+
+    Renderer::Texture texture(bufferManager);
+    texture.loadFromFile(device, commandPool, bufferManager,
+                         "textures/owl.jpg");
+
+    DrawResources res;
+    createDrawResources(device, bufferManager, res);
+    benchPipeline(device, texture, res, iterations, results);
+
+    Renderer::Pipeline pipeline(device, TARGET_FORMAT, MAX_FRAMES_IN_FLIGHT,
+                                res.uniformBuffers, 2 * sizeof(glm::mat4),
+                                texture);
+    benchDescriptorAlloc(device, pipeline, iterations, results);
+    benchRecordDraws(device, commandPool, pipeline, res, iterations, results);
+    benchFrustumCull(iterations, results);
+    benchTransformUpdate(iterations, results);
+    benchDrawListSort(iterations, results);
+
+    device.GetDevice().waitIdle();
+
+    std::ofstream out(outPath);
+    if (!out.is_open()) {
+      throw std::runtime_error("failed to open benchmark output: " + outPath);
+    }
+    writeJson(out, device, results);
+    std::cerr << "Benchmark results written to " << outPath << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+# Turns a SPIR-V binary into a header with a constexpr word array.
+#
+#   cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -DSOURCE=<file>
+#         -P EmbedSpirv.cmake
+#
+# The array is emitted as uint32_t words so it can go straight into
+# vk::ShaderModuleCreateInfo::pCode without copying or realigning.
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" hexLength)
+math(EXPR remainder "${hexLength} % 8")
+if(hexLength EQUAL 0 OR NOT remainder EQUAL 0)
+  message(FATAL_ERROR "${INPUT} is not a SPIR-V module")
+endif()
+
+# SPIR-V words are little endian in the file
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+set(word "[^ ]+ ")
+string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word})" "\\1\n    "
+       words "${words}")
+string(REGEX REPLACE " +\n" "\n" words "${words}")
+string(STRIP "${words}" words)
+
+set(content
+"// Generated from ${SOURCE} by cmake/EmbedSpirv.cmake, do not edit
+#pragma once
+
+#include <cstdint>
+
+namespace Renderer::Shaders {
+
+inline constexpr uint32_t ${SYMBOL}[] = {
+    ${words}
+};
+
+} // namespace Renderer::Shaders
+")
+
+file(WRITE "${OUTPUT}" "${content}")
@@ -1,5 +1,8 @@
 #!/bin/bash
 
+# The CMake build compiles and embeds these itself (renderer_add_shader);
+# this only writes loose .spv files for inspecting or external tools.
+
 ./shaders/slang/build/RelWithDebInfo/bin/slangc \
   shaders/shader.slang \
   -target spirv \
@@ -9,3 +12,41 @@
   -entry vertMain \
   -entry fragMain \
   -o shaders/slang.spv
+
+./shaders/slang/build/RelWithDebInfo/bin/slangc \
+  shaders/hiz_downsample.slang \
+  -target spirv \
+  -profile spirv_1_4 \
+  -emit-spirv-directly \
+  -fvk-use-entrypoint-name \
+  -entry downsampleMain \
+  -o shaders/hiz_downsample.spv
+
+./shaders/slang/build/RelWithDebInfo/bin/slangc \
+  shaders/occlusion_cull.slang \
+  -target spirv \
+  -profile spirv_1_4 \
+  -emit-spirv-directly \
+  -fvk-use-entrypoint-name \
+  -entry cullMain \
+  -o shaders/occlusion_cull.spv
+
+./shaders/slang/build/RelWithDebInfo/bin/slangc \
+  shaders/meshlet_cull.slang \
+  -target spirv \
+  -profile spirv_1_4 \
+  -emit-spirv-directly \
+  -fvk-use-entrypoint-name \
+  -entry cullMain \
+  -o shaders/meshlet_cull.spv
+
+./shaders/slang/build/RelWithDebInfo/bin/slangc \
+  shaders/meshlet_mesh.slang \
+  -target spirv \
+  -profile spirv_1_4 \
+  -emit-spirv-directly \
+  -fvk-use-entrypoint-name \
+  -entry taskMain \
+  -entry meshMain \
+  -entry fragMain \
+  -o shaders/meshlet_mesh.spv
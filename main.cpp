@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
@@ -21,20 +26,71 @@
 
 #include <chrono>
 
+#include "src/Renderer/Asset/AssetPack.h"
 #include "src/Renderer/Buffer/Buffer.h"
+#include "src/Renderer/Capture/FrameReadback.h"
 #include "src/Renderer/Command/CommandBuffer.h"
 #include "src/Renderer/Command/CommandPool.h"
+#include "src/Renderer/Command/FrameCommandContext.h"
+#include "src/Renderer/Culling/FrustumCuller.h"
+#include "src/Renderer/Culling/HiZPyramid.h"
+#include "src/Renderer/Culling/OcclusionCuller.h"
+#include "src/Renderer/Descriptor/DescriptorAllocator.h"
+#include "src/Renderer/Descriptor/DescriptorBuffer.h"
 #include "src/Renderer/Device/Device.h"
 #include "src/Renderer/Helpers/helpers.h"
 #include "src/Renderer/Instance/Instance.h"
+#include "src/Renderer/Mesh/MeshLod.h"
+#include "src/Renderer/Mesh/Meshlet.h"
+#include "src/Renderer/Mesh/MeshletRenderer.h"
 #include "src/Renderer/Pipeline/Pipeline.h"
+#include "src/Renderer/Profiling/GpuProfiler.h"
+#include "src/Renderer/Profiling/Profiler.h"
+#include "src/Renderer/Resolution/DynamicResolution.h"
+#include "src/Renderer/Scene/DrawList.h"
+#include "src/Renderer/Scene/TransformHierarchy.h"
 #include "src/Renderer/Swapchain/Swapchain.h"
 #include "src/Renderer/Texture/Texture.h"
+#include "src/Renderer/Texture/TextureStreamer.h"
+#include "src/Renderer/Threading/TaskGraph.h"
+#include "src/Renderer/Threading/ThreadPool.h"
 #include "src/Renderer/Window/Window.h"
 
 constexpr uint32_t WIDTH = 800;
 constexpr uint32_t HEIGHT = 600;
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr vk::DeviceSize TEXTURE_STREAMING_BUDGET = 256ull << 20;
+// Two-phase GPU occlusion culling, the culling path frames start with; off
+// leaves only CPU frustum culling
+constexpr bool OCCLUSION_CULLING = true;
+// Key that switches between GPU occlusion culling and CPU frustum culling
+// with a sorted draw list, for comparing the two
+constexpr int CULLING_KEY = GLFW_KEY_F10;
+constexpr uint32_t MAX_OCCLUSION_OBJECTS = 4096;
+// Cull and draw the mesh per meshlet instead of per object, through task
+// and mesh shaders when the device has them (ignores mesh LODs). Needs
+// OCCLUSION_CULLING for the pyramid.
+constexpr bool MESHLET_RENDERING = true;
+// Scale the scene resolution to hold the GPU frame time, then upscale
+constexpr bool DYNAMIC_RESOLUTION = true;
+// Write the scene's descriptors straight into buffer memory
+// (VK_EXT_descriptor_buffer) when the device supports it, otherwise use
+// per-frame descriptor sets
+constexpr bool DESCRIPTOR_BUFFER = true;
+// Key that saves the presented frame as screenshot_<frame>.png; the copy
+// rides along with the frame and encoding happens on a worker
+constexpr int SCREENSHOT_KEY = GLFW_KEY_F12;
+constexpr uint32_t READBACK_SLOTS = MAX_FRAMES_IN_FLIGHT + 1;
+// Per-task startup timings on stderr
+constexpr bool PRINT_STARTUP_TIMINGS = true;
+// Key that writes the recent CPU/GPU profiling zones to trace_<frame>.json
+// (Chrome trace format); only with the RENDERER_PROFILING build option
+constexpr int TRACE_KEY = GLFW_KEY_F11;
+
+// Built by tools/AssetPacker.cpp, e.g.
+//   asset_packer assets/scene.pack --texture owl=textures/owl.jpg
+//                --mesh scene=model.obj
+constexpr const char *ASSET_PACK_PATH = "assets/scene.pack";
 
 const std::vector validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
@@ -51,8 +107,8 @@ const std::vector<Renderer::Vertex> vertices = {
 
 const std::vector<uint16_t> indices = {0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4};
 
+// Camera only; the model matrix is pushed per draw (Renderer::DrawConstants)
 struct UniformBufferObject {
-  alignas(16) glm::mat4 model;
   alignas(16) glm::mat4 view;
   alignas(16) glm::mat4 proj;
 };
@@ -60,6 +116,7 @@ struct UniformBufferObject {
 class RendererApp {
 public:
   void run() {
+    RENDERER_PROFILE_THREAD("Main");
     m_Window = std::make_unique<Renderer::Window>(
         WIDTH, HEIGHT, framebufferResizeCallback, this);
     initVulkan();
@@ -68,40 +125,281 @@ public:
   }
 
 private:
+  // Startup as a dependency graph: CPU work (asset loading, texture decode)
+  // and pipeline compilation run on workers while the device, swapchain and
+  // GPU resources come up. Tasks that touch the window, the command pool or
+  // the queue, and every device memory allocation, stay on this thread.
   void initVulkan() {
-    m_Instance = std::make_unique<Renderer::Instance>("Vulkan App");
-    m_Window->CreateSurface(*m_Instance);
-    m_DeviceHand = std::make_unique<Renderer::Device>(*m_Instance,
-                                                      *m_Window->GetSurface());
+    using Affinity = Renderer::TaskGraph::Affinity;
+    Renderer::TaskGraph startup;
 
-    m_SwapChain =
-        std::make_unique<Renderer::Swapchain>(*m_DeviceHand, *m_Window);
-    m_SwapChain->CreateImageViews(*m_DeviceHand);
+    m_BufferManager = std::make_unique<Renderer::BufferManager>();
+    m_FrameDescriptors = std::make_unique<Renderer::FrameDescriptorAllocator>(
+        MAX_FRAMES_IN_FLIGHT);
+    Renderer::TextureImageData textureImage;
+
+    auto instance = startup.Add(
+        "instance", {},
+        [this] {
+          m_Instance = std::make_unique<Renderer::Instance>("Vulkan App");
+        },
+        Affinity::Caller);
+    auto surface = startup.Add(
+        "surface", {instance},
+        [this] { m_Window->CreateSurface(*m_Instance); }, Affinity::Caller);
+    auto device = startup.Add("device", {surface}, [this] {
+      m_DeviceHand = std::make_unique<Renderer::Device>(
+          *m_Instance, *m_Window->GetSurface());
+      setBudgetPressureCallback();
+    });
+
+    auto assets = startup.Add("asset pack", {}, [this] { loadAssetPack(); });
+    auto decodeTexture =
+        startup.Add("texture decode", {assets}, [this, &textureImage] {
+          if (!m_AssetPack.Find("owl", Renderer::AssetType::Texture))
+            textureImage =
+                Renderer::Texture::decodeFile("textures/owl.jpg", true);
+        });
+    auto scene = startup.Add("scene", {}, [this] { createScene(); });
+    auto meshlets = startup.Add("meshlet build", {assets}, [this] {
+      if (useMeshlets())
+        m_MeshletMesh = Renderer::BuildMeshlets(
+            &m_MeshVertexData[0].pos.x, m_MeshVertexCount,
+            sizeof(Renderer::Vertex), m_MeshIndices);
+    });
+
+    auto swapchain = startup.Add(
+        "swapchain", {device},
+        [this] {
+          m_SwapChain =
+              std::make_unique<Renderer::Swapchain>(*m_DeviceHand, *m_Window);
+          m_SwapChain->CreateImageViews(*m_DeviceHand);
+        },
+        Affinity::Caller);
+    auto depthFormat = startup.Add("depth format", {device}, [this] {
+      m_DepthFormat = findDepthFormat();
+    });
+    // Descriptor sets are per frame (m_FrameDescriptors), so the pipeline
+    // needs no resources
+    auto pipeline =
+        startup.Add("pipeline compile", {swapchain, depthFormat}, [this] {
+          m_GraphicsPipeline = std::make_unique<Renderer::Pipeline>(
+              *m_DeviceHand, m_SwapChain->GetFormat(), m_DepthFormat,
+              useDescriptorBuffer());
+        });
+    startup.Add(
+        "descriptor buffer", {pipeline},
+        [this] {
+          if (useDescriptorBuffer())
+            m_DescriptorBuffer = std::make_unique<Renderer::DescriptorBuffer>(
+                *m_DeviceHand, *m_BufferManager,
+                m_GraphicsPipeline->GetDescriptorSetLayout(), 1,
+                MAX_FRAMES_IN_FLIGHT);
+        },
+        Affinity::Caller);
+
+    auto commandPool = startup.Add(
+        "command pool", {device},
+        [this] {
+          // Uploads only; frames record from the transient per-frame pools
+          m_CommandPool = std::make_unique<Renderer::CommandPool>(
+              *m_DeviceHand);
+          m_FrameCommands = std::make_unique<Renderer::FrameCommandContext>(
+              *m_DeviceHand, MAX_FRAMES_IN_FLIGHT);
+        },
+        Affinity::Caller);
+    startup.Add(
+        "texture upload", {commandPool, decodeTexture},
+        [this, &textureImage] {
+          m_TestTexture =
+              std::make_unique<Renderer::Texture>(*m_BufferManager);
+          if (textureImage.mips.empty()) {
+            m_TestTexture->loadFromPack(*m_DeviceHand, *m_CommandPool,
+                                        *m_BufferManager, m_AssetPack, "owl");
+          } else {
+            m_TestTexture->loadFromImageData(*m_DeviceHand, *m_CommandPool,
+                                             *m_BufferManager,
+                                             std::move(textureImage));
+          }
+          m_TextureStreamer = std::make_unique<Renderer::TextureStreamer>(
+              TEXTURE_STREAMING_BUDGET, MAX_FRAMES_IN_FLIGHT);
+          m_TextureStreamer->Register(*m_TestTexture);
+        },
+        Affinity::Caller);
+    auto meshes = startup.Add(
+        "mesh upload", {commandPool, assets},
+        [this] {
+          createVertexBuffer();
+          createIndexBuffer();
+          createObjectBounds();
+        },
+        Affinity::Caller);
+    startup.Add(
+        "uniform buffers", {device}, [this] { createUniformBuffers(); },
+        Affinity::Caller);
+
+    startup.Add(
+        "sync objects", {swapchain}, [this] { createSyncObjects(); },
+        Affinity::Caller);
+    startup.Add(
+        "frame readback", {swapchain}, [this] { createFrameReadback(); },
+        Affinity::Caller);
+    auto depth = startup.Add(
+        "depth targets", {swapchain, depthFormat},
+        [this] { createDepthResources(); }, Affinity::Caller);
+    startup.Add(
+        "gpu profiler", {commandPool},
+        [this] {
+          if (Renderer::PROFILING_ENABLED)
+            m_GpuProfiler = std::make_unique<Renderer::GpuProfiler>(
+                *m_DeviceHand, *m_CommandPool, MAX_FRAMES_IN_FLIGHT);
+        },
+        Affinity::Caller);
+    startup.Add(
+        "dynamic resolution", {swapchain},
+        [this] { createDynamicResolution(); }, Affinity::Caller);
+    startup.Add(
+        "occlusion culling", {depth, commandPool, meshes, scene, meshlets},
+        [this] { createOcclusionCulling(); }, Affinity::Caller);
+
+    startup.Run();
+
+    if (PRINT_STARTUP_TIMINGS) {
+      std::cerr << "Startup: ";
+      startup.PrintReport(std::cerr);
+    }
+  }
 
-    m_CommandPool = std::make_unique<Renderer::CommandPool>(
-        *m_DeviceHand,
-        vk::CommandPoolCreateFlags::BitsType::eResetCommandBuffer);
+  static constexpr bool useMeshlets() {
+    return MESHLET_RENDERING && OCCLUSION_CULLING;
+  }
 
-    m_BufferManager = std::make_unique<Renderer::BufferManager>();
-    m_TestTexture = std::make_unique<Renderer::Texture>(*m_BufferManager);
-    m_TestTexture->loadFromFile(*m_DeviceHand, *m_CommandPool, *m_BufferManager,
-                                "textures/owl.jpg");
-    createVertexBuffer();
-    createIndexBuffer();
-    createUniformBuffers();
+  bool useDescriptorBuffer() const {
+    return DESCRIPTOR_BUFFER && m_DeviceHand->HasDescriptorBuffer();
+  }
 
-    m_GraphicsPipeline = std::make_unique<Renderer::Pipeline>(
-        *m_DeviceHand, *m_SwapChain, MAX_FRAMES_IN_FLIGHT, m_UniformBuffers,
-        sizeof(UniformBufferObject), *m_TestTexture);
+  void setBudgetPressureCallback() {
+    m_DeviceHand->SetBudgetPressureCallback(
+        0.9f,
+        [this](uint32_t heapIndex, const Renderer::MemoryHeapStats &heap,
+               bool underPressure) {
+          std::cerr << "Memory heap " << heapIndex
+                    << (underPressure ? " near budget: "
+                                      : " back below budget: ")
+                    << heap.driverUsage << " / " << heap.budget << " bytes"
+                    << std::endl;
+          if (underPressure)
+            m_HeapsUnderPressure |= 1u << heapIndex;
+          else
+            m_HeapsUnderPressure &= ~(1u << heapIndex);
+          if (!m_TextureStreamer)
+            return;
+          // Streamed textures own their full chain already, so evicting
+          // frees nothing; hold streaming where it is to stop further
+          // staging uploads, and resume once no heap is under pressure
+          if (underPressure) {
+            m_TextureStreamer->SetBudget(m_TextureStreamer->GetResidentSize());
+          } else if (m_HeapsUnderPressure == 0) {
+            m_TextureStreamer->SetBudget(TEXTURE_STREAMING_BUDGET);
+          }
+        });
+  }
 
-    m_CommandBuffers = m_CommandPool->allocatePrimary(MAX_FRAMES_IN_FLIGHT);
-    createSyncObjects();
+  void createDynamicResolution() {
+    m_RenderExtent = m_SwapChain->GetExtend2D();
+    // Needs to blit into the swapchain images, otherwise render at full size
+    if (!DYNAMIC_RESOLUTION ||
+        !(m_SwapChain->GetImageUsage() &
+          vk::ImageUsageFlagBits::eTransferDst) ||
+        !Renderer::DynamicResolution::SupportsUpscale(
+            *m_DeviceHand, m_SwapChain->GetFormat()))
+      return;
+
+    m_DynamicResolution = std::make_unique<Renderer::DynamicResolution>(
+        *m_DeviceHand, MAX_FRAMES_IN_FLIGHT);
+    createSceneColorResources();
+  }
 
+  // Sized for full resolution; lower scales use the top left corner
+  void createSceneColorResources() {
+    int numImages = m_SwapChain->GetImages().size();
+    for (int i = 0; i < numImages; ++i) {
+      m_sceneColorImageViews.emplace_back(nullptr);
+      m_sceneColorImages.emplace_back(nullptr);
+      m_sceneColorImageMemories.emplace_back(nullptr);
+
+      Renderer::createImage(*m_DeviceHand, m_SwapChain->GetExtend2D().width,
+                            m_SwapChain->GetExtend2D().height,
+                            m_SwapChain->GetFormat(), vk::ImageTiling::eOptimal,
+                            vk::ImageUsageFlagBits::eColorAttachment |
+                                vk::ImageUsageFlagBits::eTransferSrc,
+                            vk::MemoryPropertyFlagBits::eDeviceLocal,
+                            m_sceneColorImages[i],
+                            m_sceneColorImageMemories[i]);
+      m_sceneColorImageViews[i] = Renderer::createImageView(
+          *m_DeviceHand, m_sceneColorImages[i], m_SwapChain->GetFormat(),
+          vk::ImageAspectFlagBits::eColor);
+    }
+  }
+
+  void createFrameReadback() {
+    if (!(m_SwapChain->GetImageUsage() &
+          vk::ImageUsageFlagBits::eTransferSrc) ||
+        !Renderer::FrameReadback::SupportsFormat(m_SwapChain->GetFormat()))
+      return;
+    m_FrameReadback = std::make_unique<Renderer::FrameReadback>(
+        *m_DeviceHand, READBACK_SLOTS, m_SwapChain->GetExtend2D());
+  }
+
+  void createOcclusionCulling() {
+    if (!OCCLUSION_CULLING)
+      return;
+
+    m_HiZPyramid = std::make_unique<Renderer::HiZPyramid>(
+        *m_DeviceHand, m_depthImageViews, m_SwapChain->GetExtend2D());
+    m_GpuCulling = true;
+    if (useMeshlets()) {
+      m_MeshletRenderer = std::make_unique<Renderer::MeshletRenderer>(
+          *m_DeviceHand, *m_CommandPool, *m_BufferManager, *m_HiZPyramid,
+          m_MeshletMesh, *m_VertexBuffer, MAX_FRAMES_IN_FLIGHT,
+          m_SwapChain->GetFormat(), m_DepthFormat,
+          m_DeviceHand->HasMeshShader());
+      return;
+    }
+    m_OcclusionCuller = std::make_unique<Renderer::OcclusionCuller>(
+        *m_DeviceHand, *m_CommandPool, *m_BufferManager, *m_HiZPyramid,
+        MAX_OCCLUSION_OBJECTS, MAX_FRAMES_IN_FLIGHT);
+  }
+
+  // Everything sized from the swapchain follows it. RecreateSwapChain leaves
+  // the device idle, so the old targets can go right away.
+  void recreateSwapChain() {
+    m_SwapChain->RecreateSwapChain(*m_DeviceHand, *m_Window);
+
+    m_depthImageViews.clear();
+    m_depthImages.clear();
+    m_depthImageMemories.clear();
     createDepthResources();
+
+    if (m_DynamicResolution) {
+      m_sceneColorImageViews.clear();
+      m_sceneColorImages.clear();
+      m_sceneColorImageMemories.clear();
+      createSceneColorResources();
+    }
+
+    if (m_HiZPyramid) {
+      m_HiZPyramid->Resize(*m_DeviceHand, m_depthImageViews,
+                           m_SwapChain->GetExtend2D());
+      if (m_MeshletRenderer)
+        m_MeshletRenderer->RefreshPyramidDescriptors(*m_DeviceHand);
+      else
+        m_OcclusionCuller->RefreshPyramidDescriptors(*m_DeviceHand);
+    }
   }
 
   void createDepthResources() {
-    vk::Format depthFormat = findDepthFormat();
+    vk::Format depthFormat = m_DepthFormat;
     int numImages = m_SwapChain->GetImages().size();
 
     for (int i = 0; i < numImages; ++i) {
@@ -112,7 +410,8 @@ private:
       Renderer::createImage(*m_DeviceHand, m_SwapChain->GetExtend2D().width,
                             m_SwapChain->GetExtend2D().height, depthFormat,
                             vk::ImageTiling::eOptimal,
-                            vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                            vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                                vk::ImageUsageFlagBits::eSampled,
                             vk::MemoryPropertyFlagBits::eDeviceLocal,
                             m_depthImages[i], m_depthImageMemories[i]);
       m_depthImageViews[i] = Renderer::createImageView(
@@ -155,75 +454,146 @@ private:
         vk::FormatFeatureFlagBits::eDepthStencilAttachment);
   }
 
+  // Pre-built assets, if there is a pack. Otherwise textures/owl.jpg is
+  // decoded at startup and the geometry comes from the literals above.
+  void loadAssetPack() {
+    m_MeshVertexData = vertices.data();
+    m_MeshVertexCount = static_cast<uint32_t>(vertices.size());
+    m_MeshIndices.assign(indices.begin(), indices.end());
+
+    if (!std::filesystem::exists(ASSET_PACK_PATH))
+      return;
+    m_AssetPack.Open(ASSET_PACK_PATH);
+
+    const Renderer::PackEntry *entry =
+        m_AssetPack.Find("scene", Renderer::AssetType::Mesh);
+    if (!entry)
+      return;
+    const Renderer::PackMesh &mesh = entry->mesh;
+    if (mesh.vertexStride != sizeof(Renderer::Vertex))
+      throw std::runtime_error("asset pack mesh has a different vertex layout");
+
+    // Vertices are used in place; indices are widened for LOD generation
+    m_AssetPack.Prefetch(*entry);
+    m_MeshVertexData =
+        static_cast<const Renderer::Vertex *>(m_AssetPack.GetVertexData(mesh));
+    m_MeshVertexCount = mesh.vertexCount;
+    const void *packedIndices = m_AssetPack.GetIndexData(mesh);
+    if (static_cast<vk::IndexType>(mesh.indexType) == vk::IndexType::eUint16) {
+      const auto *first = static_cast<const uint16_t *>(packedIndices);
+      m_MeshIndices.assign(first, first + mesh.indexCount);
+    } else {
+      const auto *first = static_cast<const uint32_t *>(packedIndices);
+      m_MeshIndices.assign(first, first + mesh.indexCount);
+    }
+  }
+
   void createIndexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+    // Every LOD indexes the same vertex buffer, so they all share one index
+    // buffer back to back
+    Renderer::LodChain chain = Renderer::GenerateLodChain(
+        &m_MeshVertexData[0].pos.x, m_MeshVertexCount,
+        sizeof(Renderer::Vertex), m_MeshIndices);
+    m_MeshLods = chain.lods;
+    m_MeshLod = 0;
+
+    if (m_MeshVertexCount > UINT16_MAX + 1) {
+      m_IndexType = vk::IndexType::eUint32;
+      m_BufferManager->CreateBufferWithData(
+          *m_DeviceHand, *m_CommandPool, chain.indices.data(),
+          sizeof(uint32_t) * chain.indices.size(),
+          vk::BufferUsageFlagBits::eIndexBuffer, m_IndexBuffer,
+          m_IndexBufferMemory);
+      return;
+    }
 
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    m_BufferManager->CreateBuffer(*m_DeviceHand, bufferSize,
-                                  vk::BufferUsageFlagBits::eTransferSrc,
-                                  vk::MemoryPropertyFlagBits::eHostVisible |
-                                      vk::MemoryPropertyFlagBits::eHostCoherent,
-                                  stagingBuffer, stagingBufferMemory);
+    m_IndexType = vk::IndexType::eUint16;
+    std::vector<uint16_t> lodIndices(chain.indices.begin(),
+                                     chain.indices.end());
+    vk::DeviceSize bufferSize = sizeof(lodIndices[0]) * lodIndices.size();
 
-    void *data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, indices.data(), (size_t)bufferSize);
-    stagingBufferMemory.unmapMemory();
+    m_BufferManager->CreateBufferWithData(
+        *m_DeviceHand, *m_CommandPool, lodIndices.data(), bufferSize,
+        vk::BufferUsageFlagBits::eIndexBuffer, m_IndexBuffer,
+        m_IndexBufferMemory);
+  }
 
-    m_BufferManager->CreateBuffer(*m_DeviceHand, bufferSize,
-                                  vk::BufferUsageFlagBits::eTransferDst |
-                                      vk::BufferUsageFlagBits::eIndexBuffer,
-                                  vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                  m_IndexBuffer, m_IndexBufferMemory);
+  void createObjectBounds() {
+    // Object space bounding sphere of the mesh, moved with the model matrix
+    glm::vec3 center(0.0f);
+    for (uint32_t i = 0; i < m_MeshVertexCount; ++i)
+      center += m_MeshVertexData[i].pos;
+    center /= static_cast<float>(m_MeshVertexCount);
+
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < m_MeshVertexCount; ++i)
+      radius = std::max(radius,
+                        glm::length(m_MeshVertexData[i].pos - center));
+
+    m_MeshBoundsCenter = center;
+    m_ObjectBounds.Clear();
+    m_ObjectBounds.Add(center, radius);
+  }
 
-    m_BufferManager->CopyBuffer(*m_DeviceHand, *m_CommandPool, stagingBuffer,
-                                m_IndexBuffer, bufferSize);
+  void createScene() {
+    m_ThreadPool = std::make_unique<Renderer::ThreadPool>();
+    m_MeshNode = m_SceneTransforms.AddNode();
+    // The one object in m_ObjectBounds is the mesh
+    m_ObjectNodes.assign(1, m_MeshNode);
   }
 
   void createUniformBuffers() {
     m_UniformBuffers.clear();
     m_UniformBuffersMapped.clear();
     m_UniformBuffersMemory.clear();
+    m_UniformBufferAddresses.clear();
+
+    // Descriptor buffers refer to the uniform buffers by device address
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eUniformBuffer;
+    if (useDescriptorBuffer())
+      usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
       vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
       vk::raii::Buffer buffer({});
-      vk::raii::DeviceMemory bufferMem({});
-      m_BufferManager->CreateBuffer(
-          *m_DeviceHand, bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
-          vk::MemoryPropertyFlagBits::eHostVisible |
-              vk::MemoryPropertyFlagBits::eHostCoherent,
-          buffer, bufferMem);
+      Renderer::DeviceMemory bufferMem = nullptr;
+      // Prefer device local memory the CPU can write, so the shader reads
+      // don't go over the bus
+      if (!m_BufferManager->CreateDirectWriteBuffer(
+              *m_DeviceHand, bufferSize, usage, buffer, bufferMem)) {
+        m_BufferManager->CreateBuffer(
+            *m_DeviceHand, bufferSize, usage,
+            vk::MemoryPropertyFlagBits::eHostVisible |
+                vk::MemoryPropertyFlagBits::eHostCoherent,
+            buffer, bufferMem);
+      }
       m_UniformBuffers.emplace_back(std::move(buffer));
       m_UniformBuffersMemory.emplace_back(std::move(bufferMem));
       m_UniformBuffersMapped.emplace_back(
           m_UniformBuffersMemory[i].mapMemory(0, bufferSize));
+
+      if (useDescriptorBuffer()) {
+        vk::BufferDeviceAddressInfo addressInfo{};
+        addressInfo.buffer = *m_UniformBuffers[i];
+        m_UniformBufferAddresses.push_back(
+            m_DeviceHand->GetDevice().getBufferAddress(addressInfo));
+      }
     }
   }
 
   void createVertexBuffer() {
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-    vk::raii::Buffer stagingBuffer({});
-    vk::raii::DeviceMemory stagingBufferMemory({});
-    m_BufferManager->CreateBuffer(*m_DeviceHand, bufferSize,
-                                  vk::BufferUsageFlagBits::eTransferSrc,
-                                  vk::MemoryPropertyFlagBits::eHostVisible |
-                                      vk::MemoryPropertyFlagBits::eHostCoherent,
-                                  stagingBuffer, stagingBufferMemory);
-
-    void *data = stagingBufferMemory.mapMemory(0, bufferSize);
-    memcpy(data, vertices.data(), (size_t)bufferSize);
-    stagingBufferMemory.unmapMemory();
-
-    m_BufferManager->CreateBuffer(*m_DeviceHand, bufferSize,
-                                  vk::BufferUsageFlagBits::eTransferDst |
-                                      vk::BufferUsageFlagBits::eVertexBuffer,
-                                  vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                  m_VertexBuffer, m_VertexBufferMemory);
-
-    m_BufferManager->CopyBuffer(*m_DeviceHand, *m_CommandPool, stagingBuffer,
-                                m_VertexBuffer, bufferSize);
+    // Straight from the pack mapping when the mesh came from one
+    vk::DeviceSize bufferSize = sizeof(Renderer::Vertex) * m_MeshVertexCount;
+
+    // Mesh shaders fetch their vertices themselves
+    vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer;
+    if (useMeshlets())
+      usage |= vk::BufferUsageFlagBits::eStorageBuffer;
+
+    m_BufferManager->CreateBufferWithData(*m_DeviceHand, *m_CommandPool,
+                                          m_MeshVertexData, bufferSize, usage,
+                                          m_VertexBuffer,
+                                          m_VertexBufferMemory);
   }
 
   void createSyncObjects() {
@@ -249,24 +619,41 @@ private:
     while (!glfwWindowShouldClose(m_Window->GetWindow())) {
       glfwPollEvents();
       drawFrame();
+      pollCullingToggle();
+      if (Renderer::PROFILING_ENABLED)
+        pollTraceExport();
     }
     m_DeviceHand->GetDevice().waitIdle();
   }
 
   void drawFrame() {
-    while (vk::Result::eTimeout ==
-           m_DeviceHand->GetDevice().waitForFences(
-               *m_InFlightFences[m_CurrentFrame], vk::True, UINT64_MAX))
-      ;
+    RENDERER_PROFILE_ZONE("drawFrame");
+    {
+      RENDERER_PROFILE_ZONE("wait for frame fence");
+      while (vk::Result::eTimeout ==
+             m_DeviceHand->GetDevice().waitForFences(
+                 *m_InFlightFences[m_CurrentFrame], vk::True, UINT64_MAX))
+        ;
+    }
+
+    // Captures from this frame slot's last submission are complete now
+    if (m_FrameReadback) {
+      m_FrameReadback->BeginFrame(m_CurrentFrame);
+      pollScreenshots();
+    }
 
     auto [result, imageIndex] = m_SwapChain->Get().acquireNextImage(
         UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], nullptr);
 
-    if (result == vk::Result::eErrorOutOfDateKHR ||
-        result == vk::Result::eSuboptimalKHR) {
-      m_SwapChain->RecreateSwapChain(*m_DeviceHand, *m_Window);
-      m_FramebufferResized = true;
+    // No image was acquired from an out-of-date swapchain. A suboptimal one
+    // still renders this frame and is recreated after presenting, so the
+    // image index stays valid for the targets it picks.
+    if (result == vk::Result::eErrorOutOfDateKHR) {
+      recreateSwapChain();
+      return;
     }
+    if (result == vk::Result::eSuboptimalKHR)
+      m_FramebufferResized = true;
 
     if (result != vk::Result::eSuccess &&
         result != vk::Result::eSuboptimalKHR) {
@@ -274,10 +661,13 @@ private:
     }
 
     updateUniformBuffer(m_CurrentFrame);
+    m_DeviceHand->UpdateMemoryBudget();
 
     m_DeviceHand->GetDevice().resetFences(*m_InFlightFences[m_CurrentFrame]);
 
-    m_CommandBuffers[m_CurrentFrame]->reset();
+    // The fence covers everything recorded from this frame's pools
+    m_FrameCommands->BeginFrame(m_CurrentFrame);
+    m_CommandBuffer = &m_FrameCommands->AllocatePrimary();
     recordCommandBuffer(imageIndex);
 
     vk::PipelineStageFlags waitDestinationStageMask(
@@ -288,12 +678,15 @@ private:
     submitInfo.pWaitSemaphores = &*m_ImageAvailableSemaphores[m_CurrentFrame];
     submitInfo.pWaitDstStageMask = &waitDestinationStageMask;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &*(m_CommandBuffers[m_CurrentFrame]->get());
+    submitInfo.pCommandBuffers = &*(m_CommandBuffer->get());
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = &*m_RenderFinishedSemaphores[imageIndex];
 
-    m_DeviceHand->GetGraphicsQueue().submit(submitInfo,
-                                            *m_InFlightFences[m_CurrentFrame]);
+    {
+      RENDERER_PROFILE_ZONE("submit");
+      m_DeviceHand->GetGraphicsQueue().submit(
+          submitInfo, *m_InFlightFences[m_CurrentFrame]);
+    }
 
     // Present the rendered image
     const vk::PresentInfoKHR presentInfoKHR{
@@ -306,7 +699,10 @@ private:
         .pImageIndices = &imageIndex,
     };
 
-    result = m_DeviceHand->GetPresentQueue().presentKHR(presentInfoKHR);
+    {
+      RENDERER_PROFILE_ZONE("present");
+      result = m_DeviceHand->GetPresentQueue().presentKHR(presentInfoKHR);
+    }
 
     switch (result) {
     case vk::Result::eSuccess:
@@ -314,7 +710,7 @@ private:
 
     case vk::Result::eErrorOutOfDateKHR:
     case vk::Result::eSuboptimalKHR:
-      m_SwapChain->RecreateSwapChain(*m_DeviceHand, *m_Window);
+      m_FramebufferResized = true;
       break;
     default:
       break;
@@ -322,13 +718,83 @@ private:
 
     if (m_FramebufferResized) {
       m_FramebufferResized = false;
-      m_SwapChain->RecreateSwapChain(*m_DeviceHand, *m_Window);
+      recreateSwapChain();
     }
 
     m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    m_FrameNumber++;
+  }
+
+  // Requests a capture on the key's press edge and reports finished ones;
+  // never waits on a capture that isn't ready
+  void pollScreenshots() {
+    bool keyDown =
+        glfwGetKey(m_Window->GetWindow(), SCREENSHOT_KEY) == GLFW_PRESS;
+    m_ScreenshotRequested = keyDown && !m_ScreenshotKeyDown;
+    m_ScreenshotKeyDown = keyDown;
+
+    auto ready = [](std::future<Renderer::ReadbackImage> &screenshot) {
+      return screenshot.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready;
+    };
+    for (auto &screenshot : m_Screenshots) {
+      if (!ready(screenshot))
+        continue;
+      try {
+        Renderer::ReadbackImage image = screenshot.get();
+        std::cerr << "Saved screenshot of frame " << image.frameNumber
+                  << std::endl;
+      } catch (const std::exception &e) {
+        std::cerr << "Screenshot failed: " << e.what() << std::endl;
+      }
+    }
+    m_Screenshots.erase(std::remove_if(m_Screenshots.begin(),
+                                       m_Screenshots.end(),
+                                       [](const auto &screenshot) {
+                                         return !screenshot.valid();
+                                       }),
+                        m_Screenshots.end());
+  }
+
+  // Switches the culling path between frames on the key's press edge. The
+  // GPU visibility left from before a switch only makes the first frame
+  // back draw too much.
+  void pollCullingToggle() {
+    bool keyDown =
+        glfwGetKey(m_Window->GetWindow(), CULLING_KEY) == GLFW_PRESS;
+    bool pressed = keyDown && !m_CullingKeyDown;
+    m_CullingKeyDown = keyDown;
+    if (!pressed || !m_HiZPyramid)
+      return;
+
+    m_GpuCulling = !m_GpuCulling;
+    std::cerr << "Culling: " << (m_GpuCulling ? "GPU occlusion" : "CPU frustum")
+              << std::endl;
+  }
+
+  // Drains the threads' profiling zones once per frame and writes the
+  // recent timeline on the key's press edge. Writing stalls this frame.
+  void pollTraceExport() {
+    Renderer::Profiler &profiler = Renderer::Profiler::Get();
+    profiler.Collect();
+
+    bool keyDown = glfwGetKey(m_Window->GetWindow(), TRACE_KEY) == GLFW_PRESS;
+    bool pressed = keyDown && !m_TraceKeyDown;
+    m_TraceKeyDown = keyDown;
+    if (!pressed)
+      return;
+
+    std::string path = "trace_" + std::to_string(m_FrameNumber) + ".json";
+    try {
+      profiler.WriteChromeTrace(path);
+      std::cerr << "Saved profiling trace " << path << std::endl;
+    } catch (const std::exception &e) {
+      std::cerr << "Trace export failed: " << e.what() << std::endl;
+    }
   }
 
   void updateUniformBuffer(uint32_t currentImage) {
+    RENDERER_PROFILE_ZONE("updateUniformBuffer");
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
@@ -336,11 +802,15 @@ private:
                      currentTime - startTime)
                      .count();
 
+    m_SceneTransforms.SetRotation(
+        m_MeshNode, glm::angleAxis(time * glm::radians(90.0f),
+                                   glm::vec3(0.0f, 0.0f, 1.0f)));
+    m_SceneTransforms.Update(m_ThreadPool.get());
+
     UniformBufferObject ubo{};
-    ubo.model = rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
-                       glm::vec3(0.0f, 0.0f, 1.0f));
 
-    ubo.view = lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+    const glm::vec3 eye(2.0f, 2.0f, 2.0f);
+    ubo.view = lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f),
                       glm::vec3(0.0f, 0.0f, 1.0f));
 
     ubo.proj = glm::perspective(
@@ -352,7 +822,65 @@ private:
     // Flip the Y coordinate
     ubo.proj[1][1] *= -1;
 
-    // Now we wrtite the new uniform buffer in the used one
+    // Cull against this frame's camera; the model only rotates, so the
+    // sphere keeps its radius
+    const glm::mat4 &model = m_SceneTransforms.GetWorldMatrix(m_MeshNode);
+    m_ObjectBounds.Set(0,
+                       glm::vec3(model * glm::vec4(m_MeshBoundsCenter, 1.0f)),
+                       m_ObjectBounds.radius[0]);
+    m_ViewProj = ubo.proj * ubo.view;
+
+    // LOD from the projected error at the sphere's nearest point
+    m_LodSelector.SetProjection(
+        ubo.proj, static_cast<float>(m_SwapChain->GetExtend2D().height));
+    glm::vec3 center(m_ObjectBounds.centerX[0], m_ObjectBounds.centerY[0],
+                     m_ObjectBounds.centerZ[0]);
+    m_MeshLod = m_LodSelector.Select(
+        m_MeshLods, glm::length(eye - center) - m_ObjectBounds.radius[0],
+        m_MeshLod);
+    const Renderer::MeshLod &lod = m_MeshLods[m_MeshLod];
+
+    // Texture mip from the sphere's projected size: the texture spans the
+    // mesh once, so past the mip with as many texels as the object covers
+    // pixels the extra detail is never seen
+    float screenSize = m_ObjectBounds.radius[0] * std::abs(ubo.proj[1][1]) /
+                       std::max(glm::length(eye - center), 0.1f) *
+                       static_cast<float>(m_SwapChain->GetExtend2D().height);
+    float textureSize = static_cast<float>(
+        std::max(m_TestTexture->getWidth(), m_TestTexture->getHeight()));
+    m_TextureLod = std::log2(textureSize / std::max(screenSize, 1.0f));
+
+    if (m_GpuCulling && m_MeshletRenderer) {
+      m_MeshletRenderer->SetInstance(currentImage, model, m_ViewProj, eye);
+    } else if (m_GpuCulling) {
+      m_OcclusionObjects.clear();
+      for (size_t i = 0; i < m_ObjectBounds.Size(); ++i) {
+        Renderer::OcclusionObject object{};
+        object.sphere =
+            glm::vec4(m_ObjectBounds.centerX[i], m_ObjectBounds.centerY[i],
+                      m_ObjectBounds.centerZ[i], m_ObjectBounds.radius[i]);
+        object.indexCount = lod.indexCount;
+        object.firstIndex = lod.firstIndex;
+        m_OcclusionObjects.push_back(object);
+      }
+      m_OcclusionCuller->SetObjects(currentImage, m_OcclusionObjects);
+    } else {
+      m_Culler.Cull(Renderer::Frustum::FromMatrix(m_ViewProj), m_ObjectBounds,
+                    m_VisibleObjects);
+
+      // Everything shares one pipeline and material for now, so the order
+      // comes down to mesh LOD and then front to back
+      m_DrawList.Clear();
+      for (uint32_t object : m_VisibleObjects) {
+        glm::vec3 objectCenter(m_ObjectBounds.centerX[object],
+                               m_ObjectBounds.centerY[object],
+                               m_ObjectBounds.centerZ[object]);
+        m_DrawList.AddOpaque(0, 0, m_MeshLod,
+                             glm::length(eye - objectCenter), object);
+      }
+      m_DrawList.Sort(m_ThreadPool.get());
+    }
+
     memcpy(m_UniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
   }
 
@@ -360,6 +888,9 @@ private:
 
     m_DeviceHand->GetDevice().waitIdle();
 
+    m_FrameDescriptors.reset();
+    m_DescriptorBuffer.reset();
+
     m_IndexBufferMemory.clear();
     m_IndexBuffer.clear();
 
@@ -384,7 +915,65 @@ private:
   }
 
   void recordCommandBuffer(uint32_t imageIndex) {
-    m_CommandBuffers[m_CurrentFrame]->get().begin({});
+    RENDERER_PROFILE_ZONE("recordCommandBuffer");
+    // Recorded anew every frame from a pool reset with the frame's fence
+    m_CommandBuffer->begin(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+
+    // Zones of the last frame that used this slot are complete
+    if (m_GpuProfiler)
+      m_GpuProfiler->BeginFrame(m_CommandBuffer->get(), m_CurrentFrame);
+
+    // Mip uploads go ahead of the pass that samples them
+    m_TextureStreamer->RequestLod(*m_TestTexture, m_TextureLod);
+    m_TextureStreamer->Update(*m_DeviceHand, *m_BufferManager,
+                              m_CommandBuffer->get());
+
+    // The frame's fence has signalled, so its transient descriptors can be
+    // reset and written again, pointing at the texture's current view
+    if (m_DescriptorBuffer) {
+      m_DescriptorBuffer->BeginFrame(m_CurrentFrame);
+      m_SceneDescriptorOffset = m_DescriptorBuffer->AllocateSet();
+      Renderer::Pipeline::WriteDescriptors(
+          *m_DeviceHand, *m_DescriptorBuffer, m_SceneDescriptorOffset,
+          m_UniformBufferAddresses[m_CurrentFrame],
+          sizeof(UniformBufferObject), *m_TestTexture);
+    } else {
+      m_FrameDescriptors->BeginFrame(m_CurrentFrame);
+      m_SceneDescriptorSet = m_FrameDescriptors->Allocate(
+          *m_DeviceHand, m_GraphicsPipeline->GetDescriptorSetLayout());
+      Renderer::Pipeline::WriteDescriptorSet(
+          *m_DeviceHand, m_SceneDescriptorSet,
+          *m_UniformBuffers[m_CurrentFrame], sizeof(UniformBufferObject),
+          *m_TestTexture);
+    }
+    if (m_MeshletRenderer)
+      m_MeshletRenderer->RefreshTextureDescriptor(
+          *m_DeviceHand, m_CurrentFrame, *m_TestTexture);
+
+    const vk::raii::CommandBuffer &commandBuffer =
+        m_CommandBuffer->get();
+
+    // This frame's resolution comes from the GPU time of the last frame that
+    // used the same slot
+    if (m_DynamicResolution) {
+      m_DynamicResolution->BeginFrame(commandBuffer, m_CurrentFrame);
+      m_RenderExtent =
+          m_DynamicResolution->GetRenderExtent(m_SwapChain->GetExtend2D());
+    } else {
+      m_RenderExtent = m_SwapChain->GetExtend2D();
+    }
+
+    // Phase one re-emits last frame's visible set
+    {
+      RENDERER_PROFILE_GPU_ZONE(m_GpuProfiler.get(), commandBuffer,
+                                "early cull");
+      if (m_GpuCulling && m_MeshletRenderer)
+        m_MeshletRenderer->RecordEarly(commandBuffer, m_CurrentFrame);
+      else if (m_GpuCulling)
+        m_OcclusionCuller->RecordEarly(commandBuffer, m_CurrentFrame,
+                                       m_ViewProj);
+    }
+
     transition_image_layout(
         imageIndex, vk::ImageLayout::eUndefined,
         vk::ImageLayout::eColorAttachmentOptimal,
@@ -393,70 +982,223 @@ private:
         vk::PipelineStageFlagBits2::eTopOfPipe,            // srcStage
         vk::PipelineStageFlagBits2::eColorAttachmentOutput // dstStage
     );
+    transition_depth_layout(
+        imageIndex, vk::ImageLayout::eUndefined,
+        vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+        vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+            vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+        vk::PipelineStageFlagBits2::eLateFragmentTests |
+            vk::PipelineStageFlagBits2::eComputeShader,
+        vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+            vk::PipelineStageFlagBits2::eLateFragmentTests);
+
+    drawScene(imageIndex, vk::AttachmentLoadOp::eClear, false);
+
+    if (m_GpuCulling) {
+      // Phase two: build the pyramid from what was just drawn, test every
+      // object against it and draw the newly visible ones on top
+      transition_depth_layout(
+          imageIndex, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+          vk::ImageLayout::eShaderReadOnlyOptimal,
+          vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+          vk::AccessFlagBits2::eShaderSampledRead,
+          vk::PipelineStageFlagBits2::eLateFragmentTests,
+          vk::PipelineStageFlagBits2::eComputeShader);
+
+      {
+        RENDERER_PROFILE_GPU_ZONE(m_GpuProfiler.get(), commandBuffer,
+                                  "hi-z and late cull");
+        m_HiZPyramid->Build(commandBuffer, imageIndex, m_RenderExtent);
+        if (m_MeshletRenderer)
+          m_MeshletRenderer->RecordLate(commandBuffer, m_CurrentFrame);
+        else
+          m_OcclusionCuller->RecordLate(commandBuffer, m_CurrentFrame,
+                                        m_ViewProj);
+      }
+
+      transition_depth_layout(
+          imageIndex, vk::ImageLayout::eShaderReadOnlyOptimal,
+          vk::ImageLayout::eDepthStencilAttachmentOptimal, {},
+          vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+              vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+          vk::PipelineStageFlagBits2::eComputeShader,
+          vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+              vk::PipelineStageFlagBits2::eLateFragmentTests);
+      transition_image_layout(
+          imageIndex, vk::ImageLayout::eColorAttachmentOptimal,
+          vk::ImageLayout::eColorAttachmentOptimal,
+          vk::AccessFlagBits2::eColorAttachmentWrite,
+          vk::AccessFlagBits2::eColorAttachmentRead |
+              vk::AccessFlagBits2::eColorAttachmentWrite,
+          vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+          vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+
+      drawScene(imageIndex, vk::AttachmentLoadOp::eLoad, true);
+    }
 
+    if (m_DynamicResolution) {
+      RENDERER_PROFILE_GPU_ZONE(m_GpuProfiler.get(), commandBuffer,
+                                "upscale");
+      Renderer::DynamicResolution::Upscale(
+          commandBuffer, *m_sceneColorImages[imageIndex], m_RenderExtent,
+          m_SwapChain->GetImages()[imageIndex], m_SwapChain->GetExtend2D(),
+          vk::ImageLayout::ePresentSrcKHR);
+      m_DynamicResolution->EndFrame(commandBuffer, m_CurrentFrame);
+    } else {
+      transition_image_layout(
+          imageIndex, vk::ImageLayout::eColorAttachmentOptimal,
+          vk::ImageLayout::ePresentSrcKHR,
+          vk::AccessFlagBits2::eColorAttachmentWrite,         // srcAccessMask
+          {},                                                 // dstAccessMask
+          vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
+          vk::PipelineStageFlagBits2::eBottomOfPipe           // dstStage
+      );
+    }
+
+    if (m_ScreenshotRequested) {
+      m_ScreenshotRequested = false;
+      Renderer::CaptureOptions options;
+      options.pngPath =
+          "screenshot_" + std::to_string(m_FrameNumber) + ".png";
+      std::future<Renderer::ReadbackImage> screenshot =
+          m_FrameReadback->Capture(
+              commandBuffer, m_SwapChain->GetImages()[imageIndex],
+              vk::ImageLayout::ePresentSrcKHR, m_SwapChain->GetFormat(),
+              m_SwapChain->GetExtend2D(), std::move(options));
+      if (screenshot.valid())
+        m_Screenshots.push_back(std::move(screenshot));
+      else
+        std::cerr << "Screenshot dropped, readback slots busy" << std::endl;
+    }
+
+    m_CommandBuffer->end();
+  }
+
+  // One dynamic rendering pass over the scene. The late pass of occlusion
+  // culling loads the attachments the early pass left behind.
+  void drawScene(uint32_t imageIndex, vk::AttachmentLoadOp loadOp, bool late) {
+    RENDERER_PROFILE_GPU_ZONE(m_GpuProfiler.get(), m_CommandBuffer->get(),
+                              late ? "late pass" : "early pass");
     vk::ClearValue clearColor =
         vk::ClearValue{{std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}}};
 
     vk::RenderingAttachmentInfo attachmentInfo = {
-        .imageView = m_SwapChain->GetImageViews()[imageIndex],
+        .imageView = m_DynamicResolution
+                         ? *m_sceneColorImageViews[imageIndex]
+                         : *m_SwapChain->GetImageViews()[imageIndex],
         .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-        .loadOp = vk::AttachmentLoadOp::eClear,
+        .loadOp = loadOp,
         .storeOp = vk::AttachmentStoreOp::eStore,
         .clearValue = clearColor};
 
+    vk::RenderingAttachmentInfo depthAttachmentInfo = {
+        .imageView = m_depthImageViews[imageIndex],
+        .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        .loadOp = loadOp,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .clearValue = vk::ClearValue{.depthStencil = {1.0f, 0}}};
+
     vk::RenderingInfo renderingInfo = {
-        .renderArea = {.offset = {0, 0}, .extent = m_SwapChain->GetExtend2D()},
+        .renderArea = {.offset = {0, 0}, .extent = m_RenderExtent},
         .layerCount = 1,
         .colorAttachmentCount = 1,
-        .pColorAttachments = &attachmentInfo};
+        .pColorAttachments = &attachmentInfo,
+        .pDepthAttachment = &depthAttachmentInfo};
 
     // Start Rendering
-    m_CommandBuffers[m_CurrentFrame]->get().beginRendering(renderingInfo);
+    Renderer::CommandBuffer &commandBuffer = *m_CommandBuffer;
+    commandBuffer.get().beginRendering(renderingInfo);
 
     vk::Viewport viewport{
         .x = 0.0f,
         .y = 0.0f,
-        .width = static_cast<float>(m_SwapChain->GetExtend2D().width),
-        .height = static_cast<float>(m_SwapChain->GetExtend2D().height),
+        .width = static_cast<float>(m_RenderExtent.width),
+        .height = static_cast<float>(m_RenderExtent.height),
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
 
     vk::Rect2D scissor{
         .offset = {0, 0},
-        .extent = m_SwapChain->GetExtend2D(),
+        .extent = m_RenderExtent,
     };
 
-    m_CommandBuffers[m_CurrentFrame]->get().setViewport(0, viewport);
-    m_CommandBuffers[m_CurrentFrame]->get().setScissor(0, scissor);
-
-    m_CommandBuffers[m_CurrentFrame]->get().bindPipeline(
-        vk::PipelineBindPoint::eGraphics, *m_GraphicsPipeline->Get());
-
-    m_CommandBuffers[m_CurrentFrame]->get().bindVertexBuffers(
-        0, *m_VertexBuffer, {0});
-    m_CommandBuffers[m_CurrentFrame]->get().bindIndexBuffer(
-        m_IndexBuffer, 0, vk::IndexType::eUint16);
-
-    m_CommandBuffers[m_CurrentFrame]->get().bindDescriptorSets(
-        vk::PipelineBindPoint::eGraphics, m_GraphicsPipeline->GetLayout(), 0,
-        *m_GraphicsPipeline->GetDescriptorSets()[m_CurrentFrame], nullptr);
-
-    m_CommandBuffers[m_CurrentFrame]->get().drawIndexed(indices.size(), 1, 0, 0,
-                                                        0);
+    // Mesh shaders bring their own pipeline and resources
+    if (m_GpuCulling && m_MeshletRenderer &&
+        m_MeshletRenderer->UsesMeshShaders()) {
+      commandBuffer.setViewport(viewport);
+      commandBuffer.setScissor(scissor);
+      if (late) {
+        m_MeshletRenderer->DrawLate(commandBuffer, m_CurrentFrame);
+      } else {
+        m_MeshletRenderer->DrawEarly(commandBuffer, m_CurrentFrame);
+      }
+      commandBuffer.get().endRendering();
+      return;
+    }
 
-    m_CommandBuffers[m_CurrentFrame]->get().endRendering();
+    // The late pass finds all of this still bound from the early one, and
+    // the wrapper drops the repeats
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                               *m_GraphicsPipeline->Get());
+    commandBuffer.setViewport(viewport);
+    commandBuffer.setScissor(scissor);
+
+    commandBuffer.bindVertexBuffer(0, *m_VertexBuffer);
+    // Meshlets are drawn from their own meshlet-ordered index buffer
+    if (!m_GpuCulling || !m_MeshletRenderer)
+      commandBuffer.bindIndexBuffer(*m_IndexBuffer, m_IndexType);
+
+    if (m_DescriptorBuffer) {
+      m_DescriptorBuffer->Bind(commandBuffer.get(),
+                               vk::PipelineBindPoint::eGraphics,
+                               *m_GraphicsPipeline->GetLayout(), 0,
+                               m_SceneDescriptorOffset);
+    } else {
+      commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                       *m_GraphicsPipeline->GetLayout(), 0,
+                                       {m_SceneDescriptorSet});
+    }
 
-    transition_image_layout(
-        imageIndex, vk::ImageLayout::eColorAttachmentOptimal,
-        vk::ImageLayout::ePresentSrcKHR,
-        vk::AccessFlagBits2::eColorAttachmentWrite,         // srcAccessMask
-        {},                                                 // dstAccessMask
-        vk::PipelineStageFlagBits2::eColorAttachmentOutput, // srcStage
-        vk::PipelineStageFlagBits2::eBottomOfPipe           // dstStage
-    );
+    // World matrices come from the hierarchy at record time, no uniform
+    // buffer writes per object
+    Renderer::DrawConstants drawConstants{};
+    drawConstants.model = m_SceneTransforms.GetWorldMatrix(m_MeshNode);
+
+    if (m_GpuCulling && m_MeshletRenderer) {
+      commandBuffer.pushConstants(*m_GraphicsPipeline->GetLayout(),
+                                  vk::ShaderStageFlagBits::eVertex,
+                                  drawConstants);
+      if (late) {
+        m_MeshletRenderer->DrawLate(commandBuffer, m_CurrentFrame);
+      } else {
+        m_MeshletRenderer->DrawEarly(commandBuffer, m_CurrentFrame);
+      }
+    } else if (m_GpuCulling) {
+      commandBuffer.pushConstants(*m_GraphicsPipeline->GetLayout(),
+                                  vk::ShaderStageFlagBits::eVertex,
+                                  drawConstants);
+      if (late) {
+        m_OcclusionCuller->DrawLate(commandBuffer, m_CurrentFrame);
+      } else {
+        m_OcclusionCuller->DrawEarly(commandBuffer, m_CurrentFrame);
+      }
+    } else {
+      // Sorted order; the payload is the object, the key holds its LOD
+      for (const Renderer::DrawListEntry &entry : m_DrawList.GetEntries()) {
+        drawConstants.model =
+            m_SceneTransforms.GetWorldMatrix(m_ObjectNodes[entry.payload]);
+        commandBuffer.pushConstants(*m_GraphicsPipeline->GetLayout(),
+                                    vk::ShaderStageFlagBits::eVertex,
+                                    drawConstants);
+        const Renderer::MeshLod &lod =
+            m_MeshLods[Renderer::DrawList::GetMesh(entry.key)];
+        commandBuffer.drawIndexed(lod.indexCount, 1, lod.firstIndex);
+      }
+    }
 
-    m_CommandBuffers[m_CurrentFrame]->get().end();
+    commandBuffer.get().endRendering();
   }
 
   void transition_image_layout(uint32_t imageIndex, vk::ImageLayout oldLayout,
@@ -474,7 +1216,8 @@ private:
         .newLayout = newLayout,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = m_SwapChain->GetImages()[imageIndex],
+        .image = m_DynamicResolution ? *m_sceneColorImages[imageIndex]
+                                     : m_SwapChain->GetImages()[imageIndex],
         .subresourceRange =
             {
                 .aspectMask = vk::ImageAspectFlagBits::eColor,
@@ -489,7 +1232,44 @@ private:
         .imageMemoryBarrierCount = 1,
         .pImageMemoryBarriers = &barrier,
     };
-    m_CommandBuffers[m_CurrentFrame]->get().pipelineBarrier2(dependencyInfo);
+    m_CommandBuffer->get().pipelineBarrier2(dependencyInfo);
+  }
+
+  void transition_depth_layout(uint32_t imageIndex, vk::ImageLayout oldLayout,
+                               vk::ImageLayout newLayout,
+                               vk::AccessFlags2 srcAccessMask,
+                               vk::AccessFlags2 dstAccessMask,
+                               vk::PipelineStageFlags2 srcStageMask,
+                               vk::PipelineStageFlags2 dstStageMask) {
+    vk::ImageAspectFlags aspectMask = vk::ImageAspectFlagBits::eDepth;
+    if (Renderer::hasStencilComponent(m_DepthFormat))
+      aspectMask |= vk::ImageAspectFlagBits::eStencil;
+
+    vk::ImageMemoryBarrier2 barrier = {
+        .srcStageMask = srcStageMask,
+        .srcAccessMask = srcAccessMask,
+        .dstStageMask = dstStageMask,
+        .dstAccessMask = dstAccessMask,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = m_depthImages[imageIndex],
+        .subresourceRange =
+            {
+                .aspectMask = aspectMask,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+    };
+    vk::DependencyInfo dependencyInfo = {
+        .dependencyFlags = {},
+        .imageMemoryBarrierCount = 1,
+        .pImageMemoryBarriers = &barrier,
+    };
+    m_CommandBuffer->get().pipelineBarrier2(dependencyInfo);
   }
 
   static void framebufferResizeCallback(GLFWwindow *window, int width,
@@ -510,31 +1290,99 @@ private:
   std::unique_ptr<Renderer::BufferManager> m_BufferManager;
   std::unique_ptr<Renderer::Texture> m_TestTexture;
 
+  std::unique_ptr<Renderer::FrameDescriptorAllocator> m_FrameDescriptors;
+  vk::DescriptorSet m_SceneDescriptorSet;
+  // Used instead of the frame allocator when the device has descriptor
+  // buffers
+  std::unique_ptr<Renderer::DescriptorBuffer> m_DescriptorBuffer;
+  vk::DeviceSize m_SceneDescriptorOffset = 0;
+  std::unique_ptr<Renderer::TextureStreamer> m_TextureStreamer;
+  // Bit per memory heap (VK_MAX_MEMORY_HEAPS is 16) over the pressure
+  // threshold
+  uint32_t m_HeapsUnderPressure = 0;
+
   std::unique_ptr<Renderer::CommandPool> m_CommandPool;
-  std::vector<std::unique_ptr<Renderer::CommandBuffer>> m_CommandBuffers;
+  std::unique_ptr<Renderer::FrameCommandContext> m_FrameCommands;
+  // Taken from m_FrameCommands each frame
+  Renderer::CommandBuffer *m_CommandBuffer = nullptr;
 
   // Syncronization primitives
   std::vector<vk::raii::Semaphore> m_ImageAvailableSemaphores;
   std::vector<vk::raii::Semaphore> m_RenderFinishedSemaphores;
   std::vector<vk::raii::Fence> m_InFlightFences;
   uint32_t m_CurrentFrame = 0;
+  uint64_t m_FrameNumber = 0;
 
   bool m_FramebufferResized = false;
 
+  // Screenshots
+  std::unique_ptr<Renderer::FrameReadback> m_FrameReadback;
+  std::vector<std::future<Renderer::ReadbackImage>> m_Screenshots;
+  bool m_ScreenshotKeyDown = false;
+  bool m_ScreenshotRequested = false;
+
+  // Profiling; the GPU profiler exists only with RENDERER_PROFILING
+  std::unique_ptr<Renderer::GpuProfiler> m_GpuProfiler;
+  bool m_TraceKeyDown = false;
+
   vk::raii::Buffer m_VertexBuffer = nullptr;
-  vk::raii::DeviceMemory m_VertexBufferMemory = nullptr;
+  Renderer::DeviceMemory m_VertexBufferMemory = nullptr;
 
   vk::raii::Buffer m_IndexBuffer = nullptr;
-  vk::raii::DeviceMemory m_IndexBufferMemory = nullptr;
+  Renderer::DeviceMemory m_IndexBufferMemory = nullptr;
+  vk::IndexType m_IndexType = vk::IndexType::eUint16;
+
+  // Mesh source, either the geometry literals or the asset pack's mapping
+  Renderer::AssetPack m_AssetPack;
+  const Renderer::Vertex *m_MeshVertexData = nullptr;
+  uint32_t m_MeshVertexCount = 0;
+  std::vector<uint32_t> m_MeshIndices;
 
   std::vector<vk::raii::Buffer> m_UniformBuffers;
-  std::vector<vk::raii::DeviceMemory> m_UniformBuffersMemory;
+  std::vector<Renderer::DeviceMemory> m_UniformBuffersMemory;
   std::vector<void *> m_UniformBuffersMapped;
+  std::vector<vk::DeviceAddress> m_UniformBufferAddresses;
+
+  // Scene
+  std::unique_ptr<Renderer::ThreadPool> m_ThreadPool;
+  Renderer::TransformHierarchy m_SceneTransforms;
+  uint32_t m_MeshNode = 0;
+  std::vector<Renderer::MeshLod> m_MeshLods;
+  Renderer::LodSelector m_LodSelector;
+  uint32_t m_MeshLod = 0;
+  // Finest mip of m_TestTexture worth streaming at the mesh's screen size
+  float m_TextureLod = 0.0f;
+
+  // Visibility. GPU culling is on whenever its resources exist, unless
+  // CULLING_KEY switched to the CPU path.
+  bool m_GpuCulling = false;
+  bool m_CullingKeyDown = false;
+  Renderer::FrustumCuller m_Culler;
+  Renderer::BoundingSpheres m_ObjectBounds;
+  // Scene node of each object in m_ObjectBounds
+  std::vector<uint32_t> m_ObjectNodes;
+  std::vector<uint32_t> m_VisibleObjects;
+  Renderer::DrawList m_DrawList;
+  glm::vec3 m_MeshBoundsCenter{0.0f};
+  glm::mat4 m_ViewProj{1.0f};
+  std::unique_ptr<Renderer::HiZPyramid> m_HiZPyramid;
+  std::unique_ptr<Renderer::OcclusionCuller> m_OcclusionCuller;
+  std::vector<Renderer::OcclusionObject> m_OcclusionObjects;
+  Renderer::MeshletMesh m_MeshletMesh;
+  std::unique_ptr<Renderer::MeshletRenderer> m_MeshletRenderer;
 
   // Depth resources
+  vk::Format m_DepthFormat = vk::Format::eUndefined;
   std::vector<vk::raii::Image> m_depthImages;
-  std::vector<vk::raii::DeviceMemory> m_depthImageMemories;
+  std::vector<Renderer::DeviceMemory> m_depthImageMemories;
   std::vector<vk::raii::ImageView> m_depthImageViews;
+
+  // Dynamic resolution; the scene color target exists only while it's on
+  std::unique_ptr<Renderer::DynamicResolution> m_DynamicResolution;
+  vk::Extent2D m_RenderExtent;
+  std::vector<vk::raii::Image> m_sceneColorImages;
+  std::vector<Renderer::DeviceMemory> m_sceneColorImageMemories;
+  std::vector<vk::raii::ImageView> m_sceneColorImageViews;
 };
 
 int main() {
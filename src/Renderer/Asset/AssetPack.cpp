@@ -0,0 +1,325 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Renderer {
+
+namespace {
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t indexSize(uint32_t indexType) {
+  switch (static_cast<vk::IndexType>(indexType)) {
+  case vk::IndexType::eUint16:
+    return 2;
+  case vk::IndexType::eUint32:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+// Bytes per texel of the formats textures are packed in, 0 for any other
+uint32_t texelSize(uint32_t format) {
+  switch (static_cast<vk::Format>(format)) {
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+  case vk::Format::eB8G8R8A8Unorm:
+  case vk::Format::eB8G8R8A8Srgb:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+// The mip table has to describe exactly the chain its format and extent
+// imply, since the texture upload copies mipSize bytes per level into a
+// staging buffer sized from the same table
+bool validTexture(const PackTexture &texture) {
+  uint32_t texel = texelSize(texture.format);
+  if (texel == 0 || texture.width == 0 || texture.height == 0)
+    return false;
+
+  uint32_t fullChain = 1;
+  while ((std::max(texture.width, texture.height) >> fullChain) != 0)
+    ++fullChain;
+  if (texture.mipLevels == 0 ||
+      texture.mipLevels > std::min(fullChain, MAX_PACK_MIPS))
+    return false;
+
+  for (uint32_t level = 0; level < texture.mipLevels; ++level) {
+    uint64_t width = std::max(texture.width >> level, 1u);
+    uint64_t height = std::max(texture.height >> level, 1u);
+    if (texture.mipSize[level] != width * height * texel)
+      return false;
+  }
+  return true;
+}
+} // namespace
+
+AssetPack::AssetPack(const std::string &path) { Open(path); }
+
+AssetPack::~AssetPack() { Close(); }
+
+AssetPack::AssetPack(AssetPack &&other) noexcept { *this = std::move(other); }
+
+AssetPack &AssetPack::operator=(AssetPack &&other) noexcept {
+  if (this != &other) {
+    Close();
+    std::swap(m_Data, other.m_Data);
+    std::swap(m_Size, other.m_Size);
+    std::swap(m_Entries, other.m_Entries);
+    std::swap(m_EntryCount, other.m_EntryCount);
+  }
+  return *this;
+}
+
+void AssetPack::Open(const std::string &path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("failed to open asset pack: " + path);
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    throw std::runtime_error("failed to stat asset pack: " + path);
+  }
+
+  void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                       MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping keeps the file referenced
+  if (mapping == MAP_FAILED)
+    throw std::runtime_error("failed to map asset pack: " + path);
+
+  m_Data = static_cast<const unsigned char *>(mapping);
+  m_Size = static_cast<size_t>(info.st_size);
+
+  try {
+    Validate();
+  } catch (const std::runtime_error &error) {
+    Close();
+    throw std::runtime_error(path + ": " + error.what());
+  }
+}
+
+void AssetPack::Close() {
+  if (m_Data)
+    munmap(const_cast<unsigned char *>(m_Data), m_Size);
+  m_Data = nullptr;
+  m_Size = 0;
+  m_Entries = nullptr;
+  m_EntryCount = 0;
+}
+
+void AssetPack::Validate() {
+  auto inRange = [this](uint64_t offset, uint64_t size) {
+    return size <= m_Size && offset <= m_Size - size;
+  };
+
+  if (m_Size < sizeof(PackHeader))
+    throw std::runtime_error("asset pack is truncated");
+
+  const auto *header = reinterpret_cast<const PackHeader *>(m_Data);
+  if (header->magic != ASSET_PACK_MAGIC)
+    throw std::runtime_error("not an asset pack");
+  if (header->version != ASSET_PACK_VERSION)
+    throw std::runtime_error("unsupported asset pack version " +
+                             std::to_string(header->version));
+  if (header->fileSize != m_Size ||
+      header->entryOffset % alignof(PackEntry) != 0 ||
+      !inRange(header->entryOffset,
+               uint64_t(header->entryCount) * sizeof(PackEntry)))
+    throw std::runtime_error("asset pack is truncated");
+
+  m_Entries = reinterpret_cast<const PackEntry *>(m_Data + header->entryOffset);
+  m_EntryCount = header->entryCount;
+
+  for (uint32_t i = 0; i < m_EntryCount; ++i) {
+    const PackEntry &entry = m_Entries[i];
+    if (memchr(entry.name, '\0', MAX_ASSET_NAME) == nullptr)
+      throw std::runtime_error("asset pack entry name is not terminated");
+    if (i > 0 && strcmp(m_Entries[i - 1].name, entry.name) >= 0)
+      throw std::runtime_error("asset pack entries are not sorted");
+
+    bool valid = false;
+    if (entry.type == AssetType::Mesh) {
+      const PackMesh &mesh = entry.mesh;
+      valid = indexSize(mesh.indexType) != 0 &&
+              inRange(mesh.vertexOffset,
+                      uint64_t(mesh.vertexCount) * mesh.vertexStride) &&
+              inRange(mesh.indexOffset, uint64_t(mesh.indexCount) *
+                                            indexSize(mesh.indexType));
+    } else if (entry.type == AssetType::Texture) {
+      const PackTexture &texture = entry.texture;
+      valid = validTexture(texture);
+      for (uint32_t level = 0; valid && level < texture.mipLevels; ++level)
+        valid = inRange(texture.mipOffset[level], texture.mipSize[level]);
+    }
+    if (!valid)
+      throw std::runtime_error(std::string("asset pack entry '") +
+                               entry.name + "' is corrupt");
+  }
+}
+
+const PackEntry *AssetPack::Find(const std::string &name,
+                                 AssetType type) const {
+  const PackEntry *end = m_Entries + m_EntryCount;
+  const PackEntry *it = std::lower_bound(
+      m_Entries, end, name, [](const PackEntry &entry, const std::string &key) {
+        return strcmp(entry.name, key.c_str()) < 0;
+      });
+  if (it == end || name != it->name || it->type != type)
+    return nullptr;
+  return it;
+}
+
+void AssetPack::Prefetch(const PackEntry &entry) const {
+  if (entry.type == AssetType::Mesh) {
+    Prefetch(entry.mesh.vertexOffset,
+             uint64_t(entry.mesh.vertexCount) * entry.mesh.vertexStride);
+    Prefetch(entry.mesh.indexOffset,
+             uint64_t(entry.mesh.indexCount) * indexSize(entry.mesh.indexType));
+  } else if (entry.type == AssetType::Texture) {
+    // Mips are written back to back, one range covers them all
+    const PackTexture &texture = entry.texture;
+    uint32_t last = texture.mipLevels - 1;
+    Prefetch(texture.mipOffset[0], texture.mipOffset[last] +
+                                       texture.mipSize[last] -
+                                       texture.mipOffset[0]);
+  }
+}
+
+void AssetPack::Prefetch(uint64_t offset, uint64_t size) const {
+  // madvise wants a page aligned start
+  const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  const uint64_t begin = offset / pageSize * pageSize;
+  madvise(const_cast<unsigned char *>(m_Data) + begin, offset + size - begin,
+          MADV_WILLNEED);
+}
+
+PackEntry &AssetPackWriter::AddEntry(const std::string &name,
+                                     AssetType type) {
+  if (name.empty() || name.size() >= MAX_ASSET_NAME)
+    throw std::runtime_error("invalid asset name: '" + name + "'");
+
+  PackEntry entry{};
+  memcpy(entry.name, name.c_str(), name.size());
+  entry.type = type;
+  m_Entries.push_back(entry);
+  return m_Entries.back();
+}
+
+uint64_t AssetPackWriter::AppendBlob(const void *data, size_t size) {
+  uint64_t offset = alignUp(m_Blobs.size(), ASSET_PACK_ALIGNMENT);
+  m_Blobs.resize(offset + size);
+  memcpy(m_Blobs.data() + offset, data, size);
+  return offset;
+}
+
+void AssetPackWriter::AddMesh(const std::string &name, const void *vertices,
+                              uint32_t vertexCount, uint32_t vertexStride,
+                              const void *indices, uint32_t indexCount,
+                              vk::IndexType indexType) {
+  uint32_t indexBytes = indexSize(static_cast<uint32_t>(indexType));
+  if (indexBytes == 0)
+    throw std::runtime_error("unsupported index type for mesh " + name);
+
+  PackMesh mesh{};
+  mesh.vertexCount = vertexCount;
+  mesh.vertexStride = vertexStride;
+  mesh.indexCount = indexCount;
+  mesh.indexType = static_cast<uint32_t>(indexType);
+  mesh.vertexOffset =
+      AppendBlob(vertices, size_t(vertexCount) * vertexStride);
+  mesh.indexOffset = AppendBlob(indices, size_t(indexCount) * indexBytes);
+
+  AddEntry(name, AssetType::Mesh).mesh = mesh;
+}
+
+void AssetPackWriter::AddTexture(
+    const std::string &name, vk::Format format, uint32_t width,
+    uint32_t height, const std::vector<std::vector<unsigned char>> &mips) {
+  if (mips.empty() || mips.size() > MAX_PACK_MIPS)
+    throw std::runtime_error("unsupported mip count for texture " + name);
+
+  PackTexture texture{};
+  texture.format = static_cast<uint32_t>(format);
+  texture.width = width;
+  texture.height = height;
+  texture.mipLevels = static_cast<uint32_t>(mips.size());
+  for (size_t level = 0; level < mips.size(); ++level)
+    texture.mipSize[level] = mips[level].size();
+  // Same check the reader makes, so a bad chain fails here and not on load
+  if (!validTexture(texture))
+    throw std::runtime_error("mips don't match the format and size of "
+                             "texture " + name);
+
+  for (size_t level = 0; level < mips.size(); ++level) {
+    texture.mipOffset[level] =
+        AppendBlob(mips[level].data(), mips[level].size());
+  }
+
+  AddEntry(name, AssetType::Texture).texture = texture;
+}
+
+void AssetPackWriter::Write(const std::string &path) const {
+  std::vector<PackEntry> entries = m_Entries;
+  std::sort(entries.begin(), entries.end(),
+            [](const PackEntry &a, const PackEntry &b) {
+              return strcmp(a.name, b.name) < 0;
+            });
+  for (size_t i = 1; i < entries.size(); ++i) {
+    if (strcmp(entries[i - 1].name, entries[i].name) == 0)
+      throw std::runtime_error(std::string("duplicate asset name: ") +
+                               entries[i].name);
+  }
+
+  // Blob offsets were recorded relative to the data section
+  PackHeader header{};
+  header.magic = ASSET_PACK_MAGIC;
+  header.version = ASSET_PACK_VERSION;
+  header.entryCount = static_cast<uint32_t>(entries.size());
+  header.entryOffset = alignUp(sizeof(PackHeader), alignof(PackEntry));
+  const uint64_t dataOffset =
+      alignUp(header.entryOffset + entries.size() * sizeof(PackEntry),
+              ASSET_PACK_ALIGNMENT);
+  header.fileSize = dataOffset + m_Blobs.size();
+
+  for (PackEntry &entry : entries) {
+    if (entry.type == AssetType::Mesh) {
+      entry.mesh.vertexOffset += dataOffset;
+      entry.mesh.indexOffset += dataOffset;
+    } else {
+      for (uint32_t level = 0; level < entry.texture.mipLevels; ++level)
+        entry.texture.mipOffset[level] += dataOffset;
+    }
+  }
+
+  std::vector<unsigned char> prefix(dataOffset, 0);
+  memcpy(prefix.data(), &header, sizeof(header));
+  memcpy(prefix.data() + header.entryOffset, entries.data(),
+         entries.size() * sizeof(PackEntry));
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+    throw std::runtime_error("failed to create asset pack: " + path);
+  file.write(reinterpret_cast<const char *>(prefix.data()),
+             static_cast<std::streamsize>(prefix.size()));
+  file.write(reinterpret_cast<const char *>(m_Blobs.data()),
+             static_cast<std::streamsize>(m_Blobs.size()));
+  if (!file)
+    throw std::runtime_error("failed to write asset pack: " + path);
+}
+
+} // namespace Renderer
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer {
+
+// On-disk layout of an asset pack (little endian, written by AssetPackWriter,
+// see tools/AssetPacker.cpp):
+//
+//   PackHeader | PackEntry[entryCount], sorted by name | data blobs
+//
+// Every blob starts on an ASSET_PACK_ALIGNMENT boundary and is stored exactly
+// as the GPU consumes it: vertex and index buffers in their final layout,
+// texture mips in their final format, finest first. Loading is a copy out of
+// the mapping, nothing is decoded.
+constexpr uint32_t ASSET_PACK_MAGIC = 0x4b415052; // "RPAK"
+constexpr uint32_t ASSET_PACK_VERSION = 1;
+constexpr uint64_t ASSET_PACK_ALIGNMENT = 256;
+constexpr uint32_t MAX_ASSET_NAME = 48;
+constexpr uint32_t MAX_PACK_MIPS = 16;
+
+enum class AssetType : uint32_t { Mesh = 1, Texture = 2 };
+
+struct PackHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+  uint64_t entryOffset;
+  uint64_t fileSize;
+};
+
+// Offsets are from the start of the file
+struct PackMesh {
+  uint32_t vertexCount;
+  uint32_t vertexStride;
+  uint32_t indexCount;
+  uint32_t indexType; // VkIndexType
+  uint64_t vertexOffset;
+  uint64_t indexOffset;
+};
+
+// Mips are tightly packed 8-bit RGBA or BGRA, at most the full chain
+struct PackTexture {
+  uint32_t format; // VkFormat
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipLevels;
+  uint64_t mipOffset[MAX_PACK_MIPS];
+  uint64_t mipSize[MAX_PACK_MIPS];
+};
+
+struct PackEntry {
+  char name[MAX_ASSET_NAME]; // NUL terminated
+  AssetType type;
+  uint32_t reserved;
+  union {
+    PackMesh mesh;
+    PackTexture texture;
+  };
+};
+
+// Read-only memory mapping of a pack. The header and entry table are
+// validated once on open; after that lookups are a binary search and data
+// accessors are plain pointer arithmetic into the mapping.
+class AssetPack {
+public:
+  AssetPack() = default;
+  explicit AssetPack(const std::string &path);
+  ~AssetPack();
+
+  AssetPack(const AssetPack &) = delete;
+  AssetPack &operator=(const AssetPack &) = delete;
+  AssetPack(AssetPack &&other) noexcept;
+  AssetPack &operator=(AssetPack &&other) noexcept;
+
+  // Throws std::runtime_error if the file can't be mapped or isn't a valid
+  // pack
+  void Open(const std::string &path);
+  void Close();
+  bool IsOpen() const { return m_Data != nullptr; }
+
+  const PackEntry *Find(const std::string &name, AssetType type) const;
+  const PackEntry *GetEntries() const { return m_Entries; }
+  uint32_t GetEntryCount() const { return m_EntryCount; }
+
+  const void *GetVertexData(const PackMesh &mesh) const {
+    return m_Data + mesh.vertexOffset;
+  }
+  const void *GetIndexData(const PackMesh &mesh) const {
+    return m_Data + mesh.indexOffset;
+  }
+  const void *GetMipData(const PackTexture &texture, uint32_t level) const {
+    return m_Data + texture.mipOffset[level];
+  }
+
+  // Starts kernel readahead for an entry's blobs, so page faults during
+  // the copy find the data already in flight
+  void Prefetch(const PackEntry &entry) const;
+
+private:
+  void Validate();
+  void Prefetch(uint64_t offset, uint64_t size) const;
+
+private:
+  const unsigned char *m_Data = nullptr;
+  size_t m_Size = 0;
+  const PackEntry *m_Entries = nullptr;
+  uint32_t m_EntryCount = 0;
+};
+
+// Builds a pack in memory and writes it out in one go (offline, packer tool)
+class AssetPackWriter {
+public:
+  void AddMesh(const std::string &name, const void *vertices,
+               uint32_t vertexCount, uint32_t vertexStride,
+               const void *indices, uint32_t indexCount,
+               vk::IndexType indexType);
+  // mips[0] is the full size image; each level is copied as is. Throws if
+  // the levels aren't the chain `format` and the size imply.
+  void AddTexture(const std::string &name, vk::Format format, uint32_t width,
+                  uint32_t height,
+                  const std::vector<std::vector<unsigned char>> &mips);
+
+  // Throws std::runtime_error on duplicate names or I/O failure
+  void Write(const std::string &path) const;
+
+private:
+  PackEntry &AddEntry(const std::string &name, AssetType type);
+  // Returns the blob's offset from the start of the data section
+  uint64_t AppendBlob(const void *data, size_t size);
+
+private:
+  std::vector<PackEntry> m_Entries;
+  std::vector<unsigned char> m_Blobs;
+};
+
+} // namespace Renderer
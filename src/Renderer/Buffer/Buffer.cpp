@@ -1,4 +1,7 @@
 #include "Buffer.h"
+#include "../Profiling/Profiler.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Renderer {
 
@@ -6,7 +9,8 @@ void BufferManager::CreateBuffer(Renderer::Device &device, vk::DeviceSize size,
                                  vk::BufferUsageFlags usage,
                                  vk::MemoryPropertyFlags properties,
                                  vk::raii::Buffer &buffer,
-                                 vk::raii::DeviceMemory &bufferMemory) {
+                                 Renderer::DeviceMemory &bufferMemory) {
+  RENDERER_PROFILE_ZONE("BufferManager::CreateBuffer");
   vk::BufferCreateInfo bufferInfo{};
   bufferInfo.size = size;
   bufferInfo.usage = usage;
@@ -17,11 +21,19 @@ void BufferManager::CreateBuffer(Renderer::Device &device, vk::DeviceSize size,
   vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
 
   vk::MemoryAllocateInfo allocInfo{};
-  allocInfo.allocationSize = memRequirements.size,
+  allocInfo.allocationSize = memRequirements.size;
   allocInfo.memoryTypeIndex =
-      device.FindMemoryType(memRequirements.memoryTypeBits, properties),
-
-  bufferMemory = vk::raii::DeviceMemory(device.GetDevice(), allocInfo);
+      device.FindMemoryType(memRequirements.memoryTypeBits, properties);
+  vk::MemoryAllocateFlagsInfo allocFlags{};
+  allocFlags.flags = vk::MemoryAllocateFlagBits::eDeviceAddress;
+  if (usage & vk::BufferUsageFlagBits::eShaderDeviceAddress)
+    allocInfo.pNext = &allocFlags;
+
+  // Transfer-source-only buffers are upload staging
+  MemoryCategory category = usage == vk::BufferUsageFlagBits::eTransferSrc
+                                ? MemoryCategory::Staging
+                                : MemoryCategory::Buffer;
+  bufferMemory = Renderer::DeviceMemory(device, allocInfo, category);
 
   buffer.bindMemory(*bufferMemory, 0);
 }
@@ -31,6 +43,7 @@ void BufferManager::CopyBuffer(Renderer::Device &device,
                                vk::raii::Buffer &srcBuffer,
                                vk::raii::Buffer &dstBuffer,
                                vk::DeviceSize size) {
+  RENDERER_PROFILE_ZONE("BufferManager::CopyBuffer");
 
   vk::CommandBufferAllocateInfo allocInfo{};
   allocInfo.commandPool = *commandPool.Get();
@@ -59,4 +72,107 @@ void BufferManager::CopyBuffer(Renderer::Device &device,
 
   device.GetGraphicsQueue().waitIdle();
 }
+
+// Host-visible device-local heaps no bigger than this are the legacy PCIe
+// BAR window, small and shared with the driver: keep them for small data
+constexpr vk::DeviceSize BarWindowSize = 256ull << 20;
+constexpr vk::DeviceSize SmallAllocationSize = 64ull << 10;
+
+std::optional<uint32_t>
+BufferManager::FindDirectWriteMemoryType(Renderer::Device &device,
+                                         uint32_t typeFilter,
+                                         vk::DeviceSize size) {
+  const vk::MemoryPropertyFlags wanted =
+      vk::MemoryPropertyFlagBits::eDeviceLocal |
+      vk::MemoryPropertyFlagBits::eHostVisible |
+      vk::MemoryPropertyFlagBits::eHostCoherent;
+
+  const vk::PhysicalDeviceMemoryProperties &memProperties =
+      device.GetMemoryProperties();
+
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    const vk::MemoryType &type = memProperties.memoryTypes[i];
+    if (!(typeFilter & (1 << i)) || (type.propertyFlags & wanted) != wanted)
+      continue;
+
+    const vk::MemoryHeap &heap = memProperties.memoryHeaps[type.heapIndex];
+    if (heap.size <= BarWindowSize && size > SmallAllocationSize)
+      continue;
+
+    MemoryHeapStats heapStats = device.GetMemoryStats().heaps[type.heapIndex];
+    vk::DeviceSize used =
+        std::max(heapStats.driverUsage, heapStats.usage.TotalBytes());
+    if (used + size > heapStats.budget)
+      continue;
+
+    return i;
+  }
+
+  return std::nullopt;
+}
+
+bool BufferManager::CreateDirectWriteBuffer(
+    Renderer::Device &device, vk::DeviceSize size, vk::BufferUsageFlags usage,
+    vk::raii::Buffer &buffer, Renderer::DeviceMemory &bufferMemory) {
+  RENDERER_PROFILE_ZONE("BufferManager::CreateDirectWriteBuffer");
+  vk::BufferCreateInfo bufferInfo{};
+  bufferInfo.size = size;
+  bufferInfo.usage = usage;
+  bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+  vk::raii::Buffer directBuffer(device.GetDevice(), bufferInfo);
+
+  vk::MemoryRequirements memRequirements =
+      directBuffer.getMemoryRequirements();
+  std::optional<uint32_t> memoryType = FindDirectWriteMemoryType(
+      device, memRequirements.memoryTypeBits, memRequirements.size);
+  if (!memoryType)
+    return false;
+
+  vk::MemoryAllocateInfo allocInfo{};
+  allocInfo.allocationSize = memRequirements.size;
+  allocInfo.memoryTypeIndex = *memoryType;
+  vk::MemoryAllocateFlagsInfo allocFlags{};
+  allocFlags.flags = vk::MemoryAllocateFlagBits::eDeviceAddress;
+  if (usage & vk::BufferUsageFlagBits::eShaderDeviceAddress)
+    allocInfo.pNext = &allocFlags;
+
+  bufferMemory =
+      Renderer::DeviceMemory(device, allocInfo, MemoryCategory::Buffer);
+  buffer = std::move(directBuffer);
+  buffer.bindMemory(*bufferMemory, 0);
+  return true;
+}
+
+void BufferManager::CreateBufferWithData(Renderer::Device &device,
+                                         Renderer::CommandPool &commandPool,
+                                         const void *data, vk::DeviceSize size,
+                                         vk::BufferUsageFlags usage,
+                                         vk::raii::Buffer &buffer,
+                                         Renderer::DeviceMemory &bufferMemory) {
+  RENDERER_PROFILE_ZONE("BufferManager::CreateBufferWithData");
+  // No staging copy, no submit, no queue wait
+  if (CreateDirectWriteBuffer(device, size, usage, buffer, bufferMemory)) {
+    void *mapped = bufferMemory.mapMemory(0, size);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    bufferMemory.unmapMemory();
+    return;
+  }
+
+  vk::raii::Buffer stagingBuffer = nullptr;
+  Renderer::DeviceMemory stagingBufferMemory = nullptr;
+  CreateBuffer(device, size, vk::BufferUsageFlagBits::eTransferSrc,
+               vk::MemoryPropertyFlagBits::eHostVisible |
+                   vk::MemoryPropertyFlagBits::eHostCoherent,
+               stagingBuffer, stagingBufferMemory);
+
+  void *mapped = stagingBufferMemory.mapMemory(0, size);
+  memcpy(mapped, data, static_cast<size_t>(size));
+  stagingBufferMemory.unmapMemory();
+
+  CreateBuffer(device, size, usage | vk::BufferUsageFlagBits::eTransferDst,
+               vk::MemoryPropertyFlagBits::eDeviceLocal, buffer, bufferMemory);
+
+  CopyBuffer(device, commandPool, stagingBuffer, buffer, size);
+}
 } // namespace Renderer
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <optional>
 #include <vulkan/vulkan_raii.hpp>
 
 #include "../Command/CommandPool.h"
 #include "../Device/Device.h"
+#include "../Device/DeviceMemory.h"
 
 namespace Renderer {
 
@@ -16,13 +18,36 @@ public:
                     vk::BufferUsageFlags usage,
                     vk::MemoryPropertyFlags properties,
                     vk::raii::Buffer &buffer,
-                    vk::raii::DeviceMemory &bufferMemory);
+                    Renderer::DeviceMemory &bufferMemory);
 
   void CopyBuffer(Renderer::Device &device, Renderer::CommandPool &commandPool,
                   vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer,
                   vk::DeviceSize size);
 
+  // Creates the buffer in memory that is both DEVICE_LOCAL and HOST_VISIBLE
+  // (integrated GPUs, resizable BAR, CPU implementations) so the CPU can
+  // write it directly. Returns false and leaves buffer/bufferMemory untouched
+  // when no such memory is available for this size.
+  bool CreateDirectWriteBuffer(Renderer::Device &device, vk::DeviceSize size,
+                               vk::BufferUsageFlags usage,
+                               vk::raii::Buffer &buffer,
+                               Renderer::DeviceMemory &bufferMemory);
+
+  // Creates a device local buffer holding `data`. Written in place when
+  // CreateDirectWriteBuffer succeeds, otherwise uploaded through a staging
+  // buffer and a GPU copy.
+  void CreateBufferWithData(Renderer::Device &device,
+                            Renderer::CommandPool &commandPool,
+                            const void *data, vk::DeviceSize size,
+                            vk::BufferUsageFlags usage,
+                            vk::raii::Buffer &buffer,
+                            Renderer::DeviceMemory &bufferMemory);
+
 private:
+  std::optional<uint32_t> FindDirectWriteMemoryType(Renderer::Device &device,
+                                                    uint32_t typeFilter,
+                                                    vk::DeviceSize size);
+
 private:
 };
 
@@ -0,0 +1,264 @@
+#include "FrameReadback.h"
+#include "PngEncoder.h"
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Renderer {
+
+FrameReadback::FrameReadback(Renderer::Device &device, uint32_t slotCount,
+                             vk::Extent2D initialExtent)
+    : m_Device(device), m_Slots(slotCount) {
+  if (slotCount == 0)
+    throw std::runtime_error("frame readback needs at least one slot");
+  vk::DeviceSize size =
+      static_cast<vk::DeviceSize>(initialExtent.width) * initialExtent.height *
+      4;
+  if (size > 0) {
+    for (Slot &slot : m_Slots)
+      Allocate(slot, size);
+  }
+  m_Worker = std::thread([this] { WorkerLoop(); });
+}
+
+FrameReadback::~FrameReadback() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_WorkAvailable.notify_all();
+  m_Worker.join();
+}
+
+bool FrameReadback::SupportsFormat(vk::Format format) {
+  switch (format) {
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+  case vk::Format::eB8G8R8A8Unorm:
+  case vk::Format::eB8G8R8A8Srgb:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void FrameReadback::Allocate(Slot &slot, vk::DeviceSize size) {
+  vk::BufferCreateInfo bufferInfo{};
+  bufferInfo.size = size;
+  bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+  bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+  vk::raii::Buffer buffer(m_Device.GetDevice(), bufferInfo);
+
+  // The CPU reads every byte, so prefer cached memory; coherent memory is
+  // usually uncached and slow to read from
+  vk::MemoryRequirements requirements = buffer.getMemoryRequirements();
+  const vk::PhysicalDeviceMemoryProperties &properties =
+      m_Device.GetMemoryProperties();
+  vk::MemoryPropertyFlags wanted = vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCached;
+  bool hasCached = false;
+  for (uint32_t i = 0; i < properties.memoryTypeCount; ++i) {
+    if ((requirements.memoryTypeBits & (1u << i)) &&
+        (properties.memoryTypes[i].propertyFlags & wanted) == wanted)
+      hasCached = true;
+  }
+  if (!hasCached)
+    wanted = vk::MemoryPropertyFlagBits::eHostVisible |
+             vk::MemoryPropertyFlagBits::eHostCoherent;
+
+  vk::MemoryAllocateInfo allocInfo{};
+  allocInfo.allocationSize = requirements.size;
+  allocInfo.memoryTypeIndex =
+      m_Device.FindMemoryType(requirements.memoryTypeBits, wanted);
+
+  // Release the old buffer before its memory
+  slot.buffer = nullptr;
+  slot.memory = Renderer::DeviceMemory(m_Device, allocInfo,
+                                       MemoryCategory::Buffer);
+  buffer.bindMemory(*slot.memory, 0);
+  slot.buffer = std::move(buffer);
+  slot.mapped = static_cast<const uint8_t *>(slot.memory.mapMemory(0, size));
+  slot.capacity = size;
+  slot.coherent =
+      static_cast<bool>(properties.memoryTypes[allocInfo.memoryTypeIndex]
+                            .propertyFlags &
+                        vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+void FrameReadback::BeginFrame(uint32_t frameIndex) {
+  m_FrameIndex = frameIndex;
+  m_FrameNumber++;
+
+  bool queued = false;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (Slot &slot : m_Slots) {
+      if (slot.state != SlotState::Recorded || slot.frameIndex != frameIndex)
+        continue;
+      if (!slot.coherent) {
+        vk::MappedMemoryRange range{};
+        range.memory = *slot.memory;
+        range.offset = 0;
+        range.size = vk::WholeSize;
+        m_Device.GetDevice().invalidateMappedMemoryRanges(range);
+      }
+      slot.state = SlotState::Processing;
+      m_Queue.push_back(&slot);
+      queued = true;
+    }
+  }
+  if (queued)
+    m_WorkAvailable.notify_one();
+}
+
+std::future<ReadbackImage>
+FrameReadback::Capture(const vk::raii::CommandBuffer &commandBuffer,
+                       vk::Image image, vk::ImageLayout layout,
+                       vk::Format format, vk::Extent2D extent,
+                       CaptureOptions options) {
+  if (!SupportsFormat(format))
+    throw std::runtime_error("unsupported frame readback format!");
+
+  Slot *slot = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto found = std::find_if(
+        m_Slots.begin(), m_Slots.end(),
+        [](const Slot &s) { return s.state == SlotState::Free; });
+    if (found == m_Slots.end()) {
+      m_DroppedCount++;
+      return {};
+    }
+    slot = &*found;
+    // Only this thread hands slots to the worker (BeginFrame), so the rest
+    // can be filled in without the lock
+    slot->state = SlotState::Recorded;
+  }
+
+  vk::DeviceSize size =
+      static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+  if (size > slot->capacity)
+    Allocate(*slot, size);
+
+  vk::ImageMemoryBarrier2 imageBarrier{};
+  imageBarrier.srcStageMask = vk::PipelineStageFlagBits2::eAllCommands;
+  imageBarrier.srcAccessMask = vk::AccessFlagBits2::eMemoryWrite;
+  imageBarrier.dstStageMask = vk::PipelineStageFlagBits2::eCopy;
+  imageBarrier.dstAccessMask = vk::AccessFlagBits2::eTransferRead;
+  imageBarrier.oldLayout = layout;
+  imageBarrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+  imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  imageBarrier.image = image;
+  imageBarrier.subresourceRange =
+      vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount = 1;
+  dependencyInfo.pImageMemoryBarriers = &imageBarrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  vk::BufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0; // tightly packed
+  region.bufferImageHeight = 0;
+  region.imageSubresource =
+      vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+  region.imageOffset = vk::Offset3D{0, 0, 0};
+  region.imageExtent = vk::Extent3D{extent.width, extent.height, 1};
+  commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal,
+                                  *slot->buffer, region);
+
+  // Back to where the image was, and make the copy visible to the host
+  imageBarrier.srcStageMask = vk::PipelineStageFlagBits2::eCopy;
+  imageBarrier.srcAccessMask = {};
+  imageBarrier.dstStageMask = vk::PipelineStageFlagBits2::eAllCommands;
+  imageBarrier.dstAccessMask =
+      vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite;
+  imageBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+  imageBarrier.newLayout = layout;
+
+  vk::BufferMemoryBarrier2 bufferBarrier{};
+  bufferBarrier.srcStageMask = vk::PipelineStageFlagBits2::eCopy;
+  bufferBarrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  bufferBarrier.dstStageMask = vk::PipelineStageFlagBits2::eHost;
+  bufferBarrier.dstAccessMask = vk::AccessFlagBits2::eHostRead;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = *slot->buffer;
+  bufferBarrier.offset = 0;
+  bufferBarrier.size = size;
+
+  dependencyInfo.bufferMemoryBarrierCount = 1;
+  dependencyInfo.pBufferMemoryBarriers = &bufferBarrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  slot->frameIndex = m_FrameIndex;
+  slot->frameNumber = m_FrameNumber;
+  slot->extent = extent;
+  slot->swapRedBlue = format == vk::Format::eB8G8R8A8Unorm ||
+                      format == vk::Format::eB8G8R8A8Srgb;
+  slot->options = std::move(options);
+  slot->promise = std::promise<ReadbackImage>();
+  return slot->promise.get_future();
+}
+
+void FrameReadback::WorkerLoop() {
+  RENDERER_PROFILE_THREAD("Frame readback");
+  for (;;) {
+    Slot *slot = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_WorkAvailable.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+      // Finish what was handed over before stopping
+      if (m_Queue.empty())
+        return;
+      slot = m_Queue.front();
+      m_Queue.pop_front();
+    }
+    Process(*slot);
+  }
+}
+
+void FrameReadback::Process(Slot &slot) {
+  RENDERER_PROFILE_ZONE("FrameReadback::Process");
+  ReadbackImage result;
+  result.width = slot.extent.width;
+  result.height = slot.extent.height;
+  result.frameNumber = slot.frameNumber;
+
+  size_t pixelCount = static_cast<size_t>(result.width) * result.height;
+  result.pixels.resize(pixelCount * 4);
+  memcpy(result.pixels.data(), slot.mapped, result.pixels.size());
+
+  bool swapRedBlue = slot.swapRedBlue;
+  CaptureOptions options = std::move(slot.options);
+  std::promise<ReadbackImage> promise = std::move(slot.promise);
+  // The pixels are out of the buffer, the slot can take the next capture
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    slot.state = SlotState::Free;
+  }
+
+  uint8_t *pixel = result.pixels.data();
+  for (size_t i = 0; i < pixelCount; ++i, pixel += 4) {
+    if (swapRedBlue)
+      std::swap(pixel[0], pixel[2]);
+    pixel[3] = 255;
+  }
+
+  try {
+    if (options.encodePng || !options.pngPath.empty())
+      result.png = EncodePng(result.pixels.data(), result.width,
+                             result.height);
+    if (!options.pngPath.empty())
+      WriteFile(options.pngPath, result.png);
+    promise.set_value(std::move(result));
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+}
+
+} // namespace Renderer
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Device/Device.h"
+#include "../Device/DeviceMemory.h"
+
+namespace Renderer {
+
+struct ReadbackImage {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // Frames begun before the capture was recorded
+  uint64_t frameNumber = 0;
+  // RGBA8, top row first, alpha forced opaque as presented
+  std::vector<uint8_t> pixels;
+  // Filled when encoding was requested
+  std::vector<uint8_t> png;
+};
+
+struct CaptureOptions {
+  bool encodePng = false;
+  // Written by the worker when not empty; implies encodePng
+  std::string pngPath;
+};
+
+// Copies rendered images into a ring of host-visible buffers as part of the
+// frame's own command buffer and hands the pixels over without ever waiting
+// on the GPU. Per frame in flight:
+//
+//   fence wait -> BeginFrame(frameIndex) -> record, Capture(...) -> submit
+//
+// BeginFrame passes every capture recorded the last time frameIndex was
+// used, now known to be complete, to a worker thread that converts the
+// pixels, optionally encodes and writes a PNG, and resolves the future.
+// When every slot is still busy the capture is dropped instead.
+class FrameReadback {
+public:
+  // Slots are allocated for initialExtent up front and grown on demand
+  FrameReadback(Renderer::Device &device, uint32_t slotCount,
+                vk::Extent2D initialExtent);
+  // Waits for the worker; captures not yet handed over are abandoned
+  // (their futures report a broken promise)
+  ~FrameReadback();
+
+  FrameReadback(const FrameReadback &) = delete;
+  FrameReadback &operator=(const FrameReadback &) = delete;
+
+  // Only once the frame's previous submission has completed
+  void BeginFrame(uint32_t frameIndex);
+
+  // Records a copy of `image` (extent from the top left corner, color
+  // aspect, mip 0, layer 0). The image needs eTransferSrc usage and is
+  // left in `layout`. Formats are 8-bit RGBA or BGRA. Returns an empty
+  // future (valid() == false) when no slot is free.
+  std::future<ReadbackImage>
+  Capture(const vk::raii::CommandBuffer &commandBuffer, vk::Image image,
+          vk::ImageLayout layout, vk::Format format, vk::Extent2D extent,
+          CaptureOptions options = {});
+
+  static bool SupportsFormat(vk::Format format);
+
+  uint64_t GetDroppedCount() const { return m_DroppedCount; }
+
+private:
+  enum class SlotState { Free, Recorded, Processing };
+
+  struct Slot {
+    vk::raii::Buffer buffer = nullptr;
+    Renderer::DeviceMemory memory = nullptr;
+    const uint8_t *mapped = nullptr;
+    vk::DeviceSize capacity = 0;
+    bool coherent = true;
+
+    SlotState state = SlotState::Free;
+    uint32_t frameIndex = 0;
+    uint64_t frameNumber = 0;
+    vk::Extent2D extent;
+    bool swapRedBlue = false;
+    CaptureOptions options;
+    std::promise<ReadbackImage> promise;
+  };
+
+  void Allocate(Slot &slot, vk::DeviceSize size);
+  void WorkerLoop();
+  void Process(Slot &slot);
+
+private:
+  Renderer::Device &m_Device;
+  std::vector<Slot> m_Slots;
+  uint32_t m_FrameIndex = 0;
+  uint64_t m_FrameNumber = 0;
+  uint64_t m_DroppedCount = 0;
+
+  // Guards slot states and the queue
+  std::mutex m_Mutex;
+  std::condition_variable m_WorkAvailable;
+  std::deque<Slot *> m_Queue;
+  bool m_Stop = false;
+  std::thread m_Worker;
+};
+
+} // namespace Renderer
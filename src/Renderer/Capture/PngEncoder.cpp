@@ -0,0 +1,131 @@
+#include "PngEncoder.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+// Largest payload of a stored deflate block
+constexpr size_t MAX_STORED_BLOCK = 65535;
+
+std::array<uint32_t, 256> MakeCrcTable() {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t n = 0; n < 256; ++n) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; ++k)
+      c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    table[n] = c;
+  }
+  return table;
+}
+
+uint32_t Crc32(const uint8_t *data, size_t size) {
+  static const std::array<uint32_t, 256> table = MakeCrcTable();
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+uint32_t Adler32(const uint8_t *data, size_t size) {
+  // 5552 bytes is the most that can be summed before the 32-bit sums
+  // could overflow
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    size_t run = std::min<size_t>(size, 5552);
+    size -= run;
+    for (size_t i = 0; i < run; ++i) {
+      a += data[i];
+      b += a;
+    }
+    data += run;
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+void PutBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+void PutChunk(std::vector<uint8_t> &out, const char *type,
+              const std::vector<uint8_t> &data) {
+  PutBigEndian(out, static_cast<uint32_t>(data.size()));
+  size_t typeOffset = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  // The CRC covers the type and the data
+  PutBigEndian(out, Crc32(out.data() + typeOffset, out.size() - typeOffset));
+}
+} // namespace
+
+std::vector<uint8_t> EncodePng(const uint8_t *rgba, uint32_t width,
+                               uint32_t height) {
+  if (width == 0 || height == 0)
+    throw std::runtime_error("cannot encode an empty image");
+
+  // Filter type 0 (none) ahead of every row
+  size_t rowSize = static_cast<size_t>(width) * 4;
+  std::vector<uint8_t> raw((rowSize + 1) * height);
+  for (uint32_t y = 0; y < height; ++y) {
+    uint8_t *row = raw.data() + (rowSize + 1) * y;
+    row[0] = 0;
+    std::copy(rgba + rowSize * y, rgba + rowSize * (y + 1), row + 1);
+  }
+
+  // zlib stream: header, stored blocks, Adler-32 of the raw data
+  std::vector<uint8_t> idat;
+  size_t blockCount = (raw.size() + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+  idat.reserve(raw.size() + blockCount * 5 + 6);
+  idat.push_back(0x78);
+  idat.push_back(0x01);
+  for (size_t offset = 0; offset < raw.size(); offset += MAX_STORED_BLOCK) {
+    size_t length = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+    bool last = offset + length == raw.size();
+    idat.push_back(last ? 1 : 0);
+    idat.push_back(static_cast<uint8_t>(length));
+    idat.push_back(static_cast<uint8_t>(length >> 8));
+    idat.push_back(static_cast<uint8_t>(~length));
+    idat.push_back(static_cast<uint8_t>(~length >> 8));
+    idat.insert(idat.end(), raw.begin() + offset,
+                raw.begin() + offset + length);
+  }
+  PutBigEndian(idat, Adler32(raw.data(), raw.size()));
+
+  std::vector<uint8_t> header;
+  PutBigEndian(header, width);
+  PutBigEndian(header, height);
+  header.push_back(8); // bit depth
+  header.push_back(6); // RGBA
+  header.push_back(0); // deflate
+  header.push_back(0); // adaptive filtering
+  header.push_back(0); // no interlace
+
+  static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n',
+                                      0x1A, '\n'};
+  std::vector<uint8_t> png(std::begin(signature), std::end(signature));
+  png.reserve(idat.size() + 64);
+  PutChunk(png, "IHDR", header);
+  PutChunk(png, "IDAT", idat);
+  PutChunk(png, "IEND", {});
+  return png;
+}
+
+void WriteFile(const std::string &path, const std::vector<uint8_t> &data) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+    throw std::runtime_error("failed to open " + path + " for writing!");
+  file.write(reinterpret_cast<const char *>(data.data()),
+             static_cast<std::streamsize>(data.size()));
+  if (!file)
+    throw std::runtime_error("failed to write " + path + "!");
+}
+
+} // namespace Renderer
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Renderer {
+
+// 8-bit RGBA PNG, rows top to bottom without padding. The image data goes
+// into stored (uncompressed) deflate blocks: files are about as big as the
+// raw pixels, but encoding is a copy plus two checksums, cheap enough to
+// keep up with per-frame capture.
+std::vector<uint8_t> EncodePng(const uint8_t *rgba, uint32_t width,
+                               uint32_t height);
+
+// Throws if the file can't be written
+void WriteFile(const std::string &path, const std::vector<uint8_t> &data);
+
+} // namespace Renderer
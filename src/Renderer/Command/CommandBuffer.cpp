@@ -1,35 +1,202 @@
 #include "CommandBuffer.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace Renderer {
 
-void CommandBuffer::begin(vk::CommandBufferUsageFlags flags) {}
-void CommandBuffer::end() {}
+void CommandBuffer::begin(vk::CommandBufferUsageFlags flags) {
+  vk::CommandBufferBeginInfo beginInfo{};
+  beginInfo.flags = flags;
+  commandBuffer_.begin(beginInfo);
+
+  // Nothing is bound at the start of a command buffer
+  invalidateState();
+  stats_ = {};
+}
+
+void CommandBuffer::end() { commandBuffer_.end(); }
+
 void CommandBuffer::reset(vk::CommandBufferResetFlags flags) {
   commandBuffer_.reset(flags);
 }
 
 void CommandBuffer::bindVertexBuffer(uint32_t binding, const vk::Buffer &buffer,
-                                     vk::DeviceSize offset) {}
+                                     vk::DeviceSize offset) {
+  if (binding < MAX_TRACKED_VERTEX_BINDINGS) {
+    BoundVertexBuffer &bound = vertexBuffers_[binding];
+    if (bound.buffer == buffer && bound.offset == offset) {
+      stats_.skippedBinds++;
+      return;
+    }
+    bound = {buffer, offset};
+  }
+  commandBuffer_.bindVertexBuffers(binding, buffer, offset);
+  stats_.vertexBufferBinds++;
+}
+
 void CommandBuffer::bindVertexBuffers(
     uint32_t firstBinding, const std::vector<vk::Buffer> &buffers,
-    const std::vector<vk::DeviceSize> &offsets) {}
+    const std::vector<vk::DeviceSize> &offsets) {
+  if (!offsets.empty() && offsets.size() != buffers.size())
+    throw std::runtime_error("vertex buffer and offset counts differ");
+
+  // Only the bindings that changed are re-bound, as one call spanning them
+  uint32_t first = UINT32_MAX;
+  uint32_t last = 0;
+  for (uint32_t i = 0; i < buffers.size(); ++i) {
+    uint32_t binding = firstBinding + i;
+    vk::DeviceSize offset = offsets.empty() ? 0 : offsets[i];
+    if (binding < MAX_TRACKED_VERTEX_BINDINGS) {
+      BoundVertexBuffer &bound = vertexBuffers_[binding];
+      if (bound.buffer == buffers[i] && bound.offset == offset)
+        continue;
+      bound = {buffers[i], offset};
+    }
+    first = std::min(first, i);
+    last = i;
+  }
+  if (first == UINT32_MAX) {
+    stats_.skippedBinds++;
+    return;
+  }
+
+  uint32_t count = last - first + 1;
+  std::vector<vk::DeviceSize> rangeOffsets(count, 0);
+  if (!offsets.empty())
+    std::copy_n(offsets.begin() + first, count, rangeOffsets.begin());
+  commandBuffer_.bindVertexBuffers(
+      firstBinding + first,
+      vk::ArrayProxy<const vk::Buffer>(count, buffers.data() + first),
+      rangeOffsets);
+  stats_.vertexBufferBinds++;
+}
 
 void CommandBuffer::bindIndexBuffer(const vk::Buffer &buffer,
                                     vk::IndexType indexType,
-                                    vk::DeviceSize offset) {}
+                                    vk::DeviceSize offset) {
+  if (indexBuffer_ == buffer && indexOffset_ == offset &&
+      indexType_ == indexType) {
+    stats_.skippedBinds++;
+    return;
+  }
+  indexBuffer_ = buffer;
+  indexOffset_ = offset;
+  indexType_ = indexType;
+  commandBuffer_.bindIndexBuffer(buffer, offset, indexType);
+  stats_.indexBufferBinds++;
+}
+
 void CommandBuffer::bindDescriptorSets(
     vk::PipelineBindPoint bindPoint, const vk::PipelineLayout &layout,
     uint32_t firstSet, const std::vector<vk::DescriptorSet> &sets,
-    const std::vector<uint32_t> &dynamicOffsets) {}
+    const std::vector<uint32_t> &dynamicOffsets) {
+  BindPointState &state = bindPoints_[bindPointIndex(bindPoint)];
+  uint32_t lastSet = firstSet + static_cast<uint32_t>(sets.size());
+
+  if (dynamicOffsets.empty() && lastSet <= MAX_TRACKED_SETS) {
+    bool current = true;
+    for (uint32_t i = 0; i < sets.size() && current; ++i) {
+      const BoundSet &bound = state.sets[firstSet + i];
+      current = bound.layout == layout && bound.set == sets[i];
+    }
+    if (current) {
+      stats_.skippedBinds++;
+      return;
+    }
+  }
+
+  commandBuffer_.bindDescriptorSets(bindPoint, layout, firstSet, sets,
+                                    dynamicOffsets);
+  stats_.descriptorSetBinds++;
+
+  // Sets bound with dynamic offsets are not remembered, and binding with a
+  // different layout may disturb the sets outside the range
+  for (uint32_t i = 0; i < MAX_TRACKED_SETS; ++i) {
+    if (i >= firstSet && i < lastSet) {
+      state.sets[i] = dynamicOffsets.empty()
+                          ? BoundSet{layout, sets[i - firstSet]}
+                          : BoundSet{};
+    } else if (state.sets[i].layout != layout) {
+      state.sets[i] = {};
+    }
+  }
+}
 
 void CommandBuffer::bindPipeline(vk::PipelineBindPoint bindPoint,
-                                 const vk::Pipeline &pipeline) {}
+                                 const vk::Pipeline &pipeline) {
+  BindPointState &state = bindPoints_[bindPointIndex(bindPoint)];
+  if (state.pipeline == pipeline) {
+    stats_.skippedBinds++;
+    return;
+  }
+  state.pipeline = pipeline;
+  commandBuffer_.bindPipeline(bindPoint, pipeline);
+  stats_.pipelineBinds++;
+
+  // A pipeline with static viewport or scissor overwrites the dynamic values
+  if (bindPoint == vk::PipelineBindPoint::eGraphics) {
+    viewportValid_ = false;
+    scissorValid_ = false;
+  }
+}
+
+void CommandBuffer::setViewport(const vk::Viewport &viewport) {
+  if (viewportValid_ && viewport_ == viewport) {
+    stats_.skippedBinds++;
+    return;
+  }
+  viewport_ = viewport;
+  viewportValid_ = true;
+  commandBuffer_.setViewport(0, viewport);
+  stats_.viewportSets++;
+}
+
+void CommandBuffer::setScissor(const vk::Rect2D &scissor) {
+  if (scissorValid_ && scissor_ == scissor) {
+    stats_.skippedBinds++;
+    return;
+  }
+  scissor_ = scissor;
+  scissorValid_ = true;
+  commandBuffer_.setScissor(0, scissor);
+  stats_.scissorSets++;
+}
 
 void CommandBuffer::draw(uint32_t vertexCount, uint32_t instanceCount,
-                         uint32_t firstVertex, uint32_t firstInstance) {}
+                         uint32_t firstVertex, uint32_t firstInstance) {
+  commandBuffer_.draw(vertexCount, instanceCount, firstVertex, firstInstance);
+  stats_.draws++;
+}
+
 void CommandBuffer::drawIndexed(uint32_t indexCount, uint32_t instanceCount,
                                 uint32_t firstIndex, int32_t vertexOffset,
-                                uint32_t firstInstance) {}
+                                uint32_t firstInstance) {
+  commandBuffer_.drawIndexed(indexCount, instanceCount, firstIndex,
+                             vertexOffset, firstInstance);
+  stats_.draws++;
+}
+
+void CommandBuffer::invalidateState() {
+  bindPoints_ = {};
+  vertexBuffers_ = {};
+  indexBuffer_ = nullptr;
+  indexOffset_ = 0;
+  indexType_ = vk::IndexType::eUint16;
+  viewportValid_ = false;
+  scissorValid_ = false;
+}
+
+uint32_t CommandBuffer::bindPointIndex(vk::PipelineBindPoint bindPoint) {
+  switch (bindPoint) {
+  case vk::PipelineBindPoint::eGraphics:
+    return 0;
+  case vk::PipelineBindPoint::eCompute:
+    return 1;
+  default:
+    return 2;
+  }
+}
 
 CommandBuffer::CommandBuffer(vk::raii::CommandBuffer &&commandBuffer)
     : commandBuffer_(std::move(commandBuffer)) {}
@@ -1,9 +1,30 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
 #include <vulkan/vulkan_raii.hpp>
 
 namespace Renderer {
 
+// What went into the command buffer since the last begin(). Binds that were
+// dropped because the state was already current count as skippedBinds only.
+struct CommandBufferStats {
+  uint32_t pipelineBinds = 0;
+  uint32_t descriptorSetBinds = 0;
+  uint32_t vertexBufferBinds = 0;
+  uint32_t indexBufferBinds = 0;
+  uint32_t viewportSets = 0;
+  uint32_t scissorSets = 0;
+  uint32_t pushConstants = 0;
+  uint32_t draws = 0;
+  uint32_t skippedBinds = 0;
+};
+
+// Recording goes through here so binds of state that is already current can
+// be dropped. Anything recorded through get() bypasses the tracking, so call
+// invalidateState() afterwards if it may have changed bound state.
 class CommandBuffer {
 public:
   ~CommandBuffer() = default;
@@ -13,7 +34,7 @@ public:
   CommandBuffer(CommandBuffer &&) = default;
   CommandBuffer &operator=(CommandBuffer &&) = default;
 
-  // Recording
+  // Recording. begin() forgets all tracked state and the stats.
   void begin(vk::CommandBufferUsageFlags flags = {});
   void end();
   void reset(vk::CommandBufferResetFlags flags = {});
@@ -25,6 +46,7 @@ public:
                          const std::vector<vk::DeviceSize> &offsets = {});
   void bindIndexBuffer(const vk::Buffer &buffer, vk::IndexType indexType,
                        vk::DeviceSize offset = 0);
+  // Binds with dynamic offsets are never filtered
   void bindDescriptorSets(vk::PipelineBindPoint bindPoint,
                           const vk::PipelineLayout &layout, uint32_t firstSet,
                           const std::vector<vk::DescriptorSet> &sets,
@@ -32,12 +54,35 @@ public:
   void bindPipeline(vk::PipelineBindPoint bindPoint,
                     const vk::Pipeline &pipeline);
 
+  // Viewport and scissor 0
+  void setViewport(const vk::Viewport &viewport);
+  void setScissor(const vk::Rect2D &scissor);
+
+  // Writes `value` at `offset` of the layout's push constant block. T is
+  // copied byte for byte, so it has to match the shader's declaration.
+  template <typename T>
+  void pushConstants(const vk::PipelineLayout &layout,
+                     vk::ShaderStageFlags stages, const T &value,
+                     uint32_t offset = 0) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "push constants are copied as raw bytes");
+    static_assert(sizeof(T) % 4 == 0,
+                  "push constant size must be a multiple of 4");
+    commandBuffer_.pushConstants<T>(layout, stages, offset, value);
+    stats_.pushConstants++;
+  }
+
   void draw(uint32_t vertexCount, uint32_t instanceCount = 1,
             uint32_t firstVertex = 0, uint32_t firstInstance = 0);
   void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1,
                    uint32_t firstIndex = 0, int32_t vertexOffset = 0,
                    uint32_t firstInstance = 0);
 
+  // The next bind of every kind goes through to the command buffer
+  void invalidateState();
+
+  const CommandBufferStats &getStats() const { return stats_; }
+
   // Access to underlying RAII object
   const vk::raii::CommandBuffer &get() const { return commandBuffer_; }
   operator const vk::raii::CommandBuffer &() const { return commandBuffer_; }
@@ -49,6 +94,38 @@ private:
   friend class CommandPool; // For constuction
   CommandBuffer(vk::raii::CommandBuffer &&commandBuffer);
 
+  // Graphics, compute and ray tracing keep separate bindings
+  static constexpr uint32_t BIND_POINT_COUNT = 3;
+  static constexpr uint32_t MAX_TRACKED_SETS = 8;
+  static constexpr uint32_t MAX_TRACKED_VERTEX_BINDINGS = 8;
+
+  struct BoundSet {
+    vk::PipelineLayout layout;
+    vk::DescriptorSet set;
+  };
+  struct BindPointState {
+    vk::Pipeline pipeline;
+    std::array<BoundSet, MAX_TRACKED_SETS> sets{};
+  };
+  struct BoundVertexBuffer {
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+  };
+
+  static uint32_t bindPointIndex(vk::PipelineBindPoint bindPoint);
+
   vk::raii::CommandBuffer commandBuffer_;
+
+  std::array<BindPointState, BIND_POINT_COUNT> bindPoints_{};
+  std::array<BoundVertexBuffer, MAX_TRACKED_VERTEX_BINDINGS> vertexBuffers_{};
+  vk::Buffer indexBuffer_;
+  vk::DeviceSize indexOffset_ = 0;
+  vk::IndexType indexType_ = vk::IndexType::eUint16;
+  bool viewportValid_ = false;
+  vk::Viewport viewport_{};
+  bool scissorValid_ = false;
+  vk::Rect2D scissor_{};
+
+  CommandBufferStats stats_{};
 };
 } // namespace Renderer
@@ -1,18 +1,23 @@
 #include "CommandPool.h"
+#include "../Profiling/Profiler.h"
 #include <cstdint>
 
 namespace Renderer {
 // CommandPool constructor
 CommandPool::CommandPool(Renderer::Device &device,
                          vk::CommandPoolCreateFlags flags)
+    : CommandPool(device, device.GetGraphicsIndex(), flags) {}
+
+CommandPool::CommandPool(Renderer::Device &device, uint32_t queueFamilyIndex,
+                         vk::CommandPoolCreateFlags flags)
     : m_Device(device.GetDevice()),
-      m_CommandPool(
-          device.GetDevice(),
-          vk::CommandPoolCreateInfo{flags, device.GetGraphicsIndex()}),
-      m_QueueFamilyIndex(device.GetGraphicsIndex()) {}
+      m_CommandPool(device.GetDevice(),
+                    vk::CommandPoolCreateInfo{flags, queueFamilyIndex}),
+      m_QueueFamilyIndex(queueFamilyIndex) {}
 
 // Single command buffer allocation
 std::unique_ptr<CommandBuffer> CommandPool::allocatePrimary() {
+  RENDERER_PROFILE_ZONE("CommandPool::allocatePrimary");
   vk::CommandBufferAllocateInfo allocInfo{};
   allocInfo.commandPool = m_CommandPool;
   allocInfo.level = vk::CommandBufferLevel::ePrimary;
@@ -25,6 +30,7 @@ std::unique_ptr<CommandBuffer> CommandPool::allocatePrimary() {
 
 std::vector<std::unique_ptr<CommandBuffer>>
 CommandPool::allocatePrimary(uint32_t maxFramesInFlight) {
+  RENDERER_PROFILE_ZONE("CommandPool::allocatePrimary");
   vk::CommandBufferAllocateInfo allocInfo{};
   allocInfo.commandPool = m_CommandPool;
   allocInfo.level = vk::CommandBufferLevel::ePrimary;
@@ -44,6 +50,7 @@ CommandPool::allocatePrimary(uint32_t maxFramesInFlight) {
 }
 
 std::unique_ptr<CommandBuffer> CommandPool::allocateSecondary() {
+  RENDERER_PROFILE_ZONE("CommandPool::allocateSecondary");
   vk::CommandBufferAllocateInfo allocInfo{};
   allocInfo.commandPool = m_CommandPool;
   allocInfo.level = vk::CommandBufferLevel::eSecondary;
@@ -55,10 +62,12 @@ std::unique_ptr<CommandBuffer> CommandPool::allocateSecondary() {
 }
 
 void CommandPool::reset(vk::CommandPoolResetFlags flags) {
+  RENDERER_PROFILE_ZONE("CommandPool::reset");
   m_CommandPool.reset(flags);
 }
 
 vk::raii::CommandBuffer CommandPool::beginSingleTimeCommands(Device &device) {
+  RENDERER_PROFILE_ZONE("CommandPool::beginSingleTimeCommands");
   vk::CommandBufferAllocateInfo allocInfo(m_CommandPool,
                                           vk::CommandBufferLevel::ePrimary, 1);
   vk::raii::CommandBuffer commandBuffer =
@@ -72,6 +81,7 @@ vk::raii::CommandBuffer CommandPool::beginSingleTimeCommands(Device &device) {
 }
 void CommandPool::endSingleTimeCommands(
     Device &device, vk::raii::CommandBuffer &commandBuffer) {
+  RENDERER_PROFILE_ZONE("CommandPool::endSingleTimeCommands");
   commandBuffer.end();
 
   vk::SubmitInfo submitInfo({}, {}, {*commandBuffer});
@@ -9,6 +9,9 @@ namespace Renderer {
 class CommandPool {
 public:
   CommandPool(Renderer::Device &device, vk::CommandPoolCreateFlags flags = {});
+  // Pool on another queue family (e.g. Device::GetPresentIndex())
+  CommandPool(Renderer::Device &device, uint32_t queueFamilyIndex,
+              vk::CommandPoolCreateFlags flags = {});
 
   CommandPool(const CommandPool &) = delete;
   CommandPool &operator=(const CommandPool &) = delete;
@@ -27,6 +30,7 @@ public:
   void reset(vk::CommandPoolResetFlags flags = {});
 
   const vk::raii::CommandPool &Get() const { return m_CommandPool; }
+  uint32_t GetQueueFamilyIndex() const { return m_QueueFamilyIndex; }
 
 private:
   const vk::raii::Device &m_Device;
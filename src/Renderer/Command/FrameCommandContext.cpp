@@ -0,0 +1,65 @@
+#include "FrameCommandContext.h"
+
+#include <stdexcept>
+
+namespace Renderer {
+
+FrameCommandContext::FrameCommandContext(Renderer::Device &device,
+                                         uint32_t framesInFlight,
+                                         uint32_t threadCount)
+    : FrameCommandContext(device, device.GetGraphicsIndex(), framesInFlight,
+                          threadCount) {}
+
+FrameCommandContext::FrameCommandContext(Renderer::Device &device,
+                                         uint32_t queueFamilyIndex,
+                                         uint32_t framesInFlight,
+                                         uint32_t threadCount)
+    : m_ThreadCount(threadCount) {
+  if (framesInFlight == 0 || threadCount == 0)
+    throw std::runtime_error("frame command context needs at least one pool");
+
+  // No eResetCommandBuffer: the pools are only ever reset as a whole
+  m_Pools.reserve(static_cast<size_t>(framesInFlight) * threadCount);
+  for (uint32_t i = 0; i < framesInFlight * threadCount; ++i) {
+    m_Pools.push_back(ThreadPools{
+        CommandPool(device, queueFamilyIndex,
+                    vk::CommandPoolCreateFlagBits::eTransient),
+        {},
+        {}});
+  }
+}
+
+void FrameCommandContext::BeginFrame(uint32_t frameIndex) {
+  m_CurrentFrame = frameIndex;
+  for (uint32_t thread = 0; thread < m_ThreadCount; ++thread) {
+    ThreadPools &pools = GetPools(thread);
+    // Keeps the pool's memory for the next frame's recording
+    pools.pool.reset();
+    pools.primariesUsed = 0;
+    pools.secondariesUsed = 0;
+  }
+}
+
+CommandBuffer &FrameCommandContext::AllocatePrimary(uint32_t threadIndex) {
+  ThreadPools &pools = GetPools(threadIndex);
+  if (pools.primariesUsed == pools.primaries.size())
+    pools.primaries.push_back(pools.pool.allocatePrimary());
+  return *pools.primaries[pools.primariesUsed++];
+}
+
+CommandBuffer &FrameCommandContext::AllocateSecondary(uint32_t threadIndex) {
+  ThreadPools &pools = GetPools(threadIndex);
+  if (pools.secondariesUsed == pools.secondaries.size())
+    pools.secondaries.push_back(pools.pool.allocateSecondary());
+  return *pools.secondaries[pools.secondariesUsed++];
+}
+
+FrameCommandContext::ThreadPools &
+FrameCommandContext::GetPools(uint32_t threadIndex) {
+  if (threadIndex >= m_ThreadCount)
+    throw std::runtime_error("command context thread index out of range");
+  return m_Pools[static_cast<size_t>(m_CurrentFrame) * m_ThreadCount +
+                 threadIndex];
+}
+
+} // namespace Renderer
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Device/Device.h"
+#include "CommandBuffer.h"
+#include "CommandPool.h"
+
+namespace Renderer {
+
+// Transient command pools, one per frame in flight per recording thread.
+// Command buffers are never reset one by one: BeginFrame resets the frame's
+// pools wholesale, and the buffers allocated from them are handed out again
+// in order. A buffer is only valid for the frame it was taken in.
+//
+// Each recording thread passes its own index and only ever touches its own
+// pool, so threads need no locking between them. BeginFrame must not run
+// concurrently with any allocation.
+class FrameCommandContext {
+public:
+  FrameCommandContext(Renderer::Device &device, uint32_t framesInFlight,
+                      uint32_t threadCount = 1);
+  // Pools on another queue family (e.g. Device::GetPresentIndex())
+  FrameCommandContext(Renderer::Device &device, uint32_t queueFamilyIndex,
+                      uint32_t framesInFlight, uint32_t threadCount);
+
+  FrameCommandContext(const FrameCommandContext &) = delete;
+  FrameCommandContext &operator=(const FrameCommandContext &) = delete;
+
+  // Only once the frame's previous submission has completed
+  void BeginFrame(uint32_t frameIndex);
+
+  // Buffers in the initial state, ready for begin(). They only live until
+  // the pool's next BeginFrame, so begin them with eOneTimeSubmit.
+  CommandBuffer &AllocatePrimary(uint32_t threadIndex = 0);
+  CommandBuffer &AllocateSecondary(uint32_t threadIndex = 0);
+
+  uint32_t GetThreadCount() const { return m_ThreadCount; }
+  uint32_t GetCurrentFrame() const { return m_CurrentFrame; }
+
+private:
+  struct ThreadPools {
+    CommandPool pool;
+    std::vector<std::unique_ptr<CommandBuffer>> primaries;
+    std::vector<std::unique_ptr<CommandBuffer>> secondaries;
+    size_t primariesUsed = 0;
+    size_t secondariesUsed = 0;
+  };
+
+  ThreadPools &GetPools(uint32_t threadIndex);
+
+private:
+  uint32_t m_ThreadCount;
+  uint32_t m_CurrentFrame = 0;
+  // Frame-major: frame * m_ThreadCount + thread
+  std::vector<ThreadPools> m_Pools;
+};
+
+} // namespace Renderer
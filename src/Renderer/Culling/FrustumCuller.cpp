@@ -0,0 +1,487 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#if defined(__SSE2__)
+#define RENDERER_CULL_SSE 1
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define RENDERER_CULL_AVX2 1
+#endif
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define RENDERER_CULL_NEON 1
+#endif
+
+namespace Renderer {
+
+Frustum Frustum::FromMatrix(const glm::mat4 &m, bool zeroToOne) {
+  // glm is column major: row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+  auto row = [&m](int r) {
+    return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+  };
+  const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+  glm::vec4 planes[Count];
+  planes[Left] = r3 + r0;
+  planes[Right] = r3 - r0;
+  planes[Bottom] = r3 + r1;
+  planes[Top] = r3 - r1;
+  planes[Near] = zeroToOne ? r2 : r3 + r2;
+  planes[Far] = r3 - r2;
+
+  Frustum frustum{};
+  for (uint32_t p = 0; p < Count; ++p) {
+    // Normalized so the distance compares directly against a radius
+    float length = std::sqrt(planes[p].x * planes[p].x +
+                             planes[p].y * planes[p].y +
+                             planes[p].z * planes[p].z);
+    float inv = length > 0.0f ? 1.0f / length : 0.0f;
+    frustum.a[p] = planes[p].x * inv;
+    frustum.b[p] = planes[p].y * inv;
+    frustum.c[p] = planes[p].z * inv;
+    frustum.d[p] = planes[p].w * inv;
+  }
+  return frustum;
+}
+
+uint32_t BoundingSpheres::Add(const glm::vec3 &center, float r) {
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  radius.push_back(r);
+  return static_cast<uint32_t>(radius.size() - 1);
+}
+
+void BoundingSpheres::Set(uint32_t index, const glm::vec3 &center, float r) {
+  centerX[index] = center.x;
+  centerY[index] = center.y;
+  centerZ[index] = center.z;
+  radius[index] = r;
+}
+
+void BoundingSpheres::Reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  radius.reserve(count);
+}
+
+void BoundingSpheres::Clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  radius.clear();
+}
+
+uint32_t BoundingBoxes::Add(const glm::vec3 &min, const glm::vec3 &max) {
+  centerX.push_back(0.0f);
+  centerY.push_back(0.0f);
+  centerZ.push_back(0.0f);
+  extentX.push_back(0.0f);
+  extentY.push_back(0.0f);
+  extentZ.push_back(0.0f);
+  uint32_t index = static_cast<uint32_t>(centerX.size() - 1);
+  Set(index, min, max);
+  return index;
+}
+
+void BoundingBoxes::Set(uint32_t index, const glm::vec3 &min,
+                        const glm::vec3 &max) {
+  centerX[index] = (min.x + max.x) * 0.5f;
+  centerY[index] = (min.y + max.y) * 0.5f;
+  centerZ[index] = (min.z + max.z) * 0.5f;
+  extentX[index] = (max.x - min.x) * 0.5f;
+  extentY[index] = (max.y - min.y) * 0.5f;
+  extentZ[index] = (max.z - min.z) * 0.5f;
+}
+
+void BoundingBoxes::Reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  extentX.reserve(count);
+  extentY.reserve(count);
+  extentZ.reserve(count);
+}
+
+void BoundingBoxes::Clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+
+namespace {
+
+// Appends base + i for every set bit i of an 8-lane visibility mask
+inline void EmitVisible(uint32_t mask, uint32_t base, uint32_t *out,
+                        size_t &count) {
+  while (mask) {
+    out[count++] = base + static_cast<uint32_t>(__builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+}
+
+size_t CullSpheresScalar(const Frustum &f, const BoundingSpheres &s,
+                         size_t begin, uint32_t *out) {
+  size_t count = 0;
+  for (size_t i = begin; i < s.Size(); ++i) {
+    bool inside = true;
+    for (uint32_t p = 0; p < Frustum::Count && inside; ++p) {
+      float distance = f.a[p] * s.centerX[i] + f.b[p] * s.centerY[i] +
+                       f.c[p] * s.centerZ[i] + f.d[p];
+      inside = distance >= -s.radius[i];
+    }
+    if (inside)
+      out[count++] = static_cast<uint32_t>(i);
+  }
+  return count;
+}
+
+size_t CullBoxesScalar(const Frustum &f, const BoundingBoxes &b, size_t begin,
+                       uint32_t *out) {
+  size_t count = 0;
+  for (size_t i = begin; i < b.Size(); ++i) {
+    bool inside = true;
+    for (uint32_t p = 0; p < Frustum::Count && inside; ++p) {
+      float distance = f.a[p] * b.centerX[i] + f.b[p] * b.centerY[i] +
+                       f.c[p] * b.centerZ[i] + f.d[p];
+      float radius = std::fabs(f.a[p]) * b.extentX[i] +
+                     std::fabs(f.b[p]) * b.extentY[i] +
+                     std::fabs(f.c[p]) * b.extentZ[i];
+      inside = distance + radius >= 0.0f;
+    }
+    if (inside)
+      out[count++] = static_cast<uint32_t>(i);
+  }
+  return count;
+}
+
+#if RENDERER_CULL_SSE
+// Two 4-wide halves per iteration so every kernel consumes 8 volumes
+size_t CullSpheresSSE(const Frustum &f, const BoundingSpheres &s,
+                      uint32_t *out) {
+  const size_t total = s.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < 8; half += 4) {
+      const size_t j = i + half;
+      __m128 x = _mm_loadu_ps(&s.centerX[j]);
+      __m128 y = _mm_loadu_ps(&s.centerY[j]);
+      __m128 z = _mm_loadu_ps(&s.centerZ[j]);
+      __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&s.radius[j]));
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (uint32_t p = 0; p < Frustum::Count; ++p) {
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.a[p]), x),
+                       _mm_mul_ps(_mm_set1_ps(f.b[p]), y)),
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.c[p]), z),
+                       _mm_set1_ps(f.d[p])));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negR));
+      }
+      mask |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << half;
+    }
+    EmitVisible(mask, static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullSpheresScalar(f, s, i, out + count);
+}
+
+size_t CullBoxesSSE(const Frustum &f, const BoundingBoxes &b, uint32_t *out) {
+  const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const size_t total = b.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < 8; half += 4) {
+      const size_t j = i + half;
+      __m128 x = _mm_loadu_ps(&b.centerX[j]);
+      __m128 y = _mm_loadu_ps(&b.centerY[j]);
+      __m128 z = _mm_loadu_ps(&b.centerZ[j]);
+      __m128 ex = _mm_loadu_ps(&b.extentX[j]);
+      __m128 ey = _mm_loadu_ps(&b.extentY[j]);
+      __m128 ez = _mm_loadu_ps(&b.extentZ[j]);
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (uint32_t p = 0; p < Frustum::Count; ++p) {
+        __m128 pa = _mm_set1_ps(f.a[p]);
+        __m128 pb = _mm_set1_ps(f.b[p]);
+        __m128 pc = _mm_set1_ps(f.c[p]);
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(pa, x), _mm_mul_ps(pb, y)),
+            _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(f.d[p])));
+        __m128 radius = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_and_ps(pa, signMask), ex),
+                       _mm_mul_ps(_mm_and_ps(pb, signMask), ey)),
+            _mm_mul_ps(_mm_and_ps(pc, signMask), ez));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius),
+                                                 _mm_setzero_ps()));
+      }
+      mask |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << half;
+    }
+    EmitVisible(mask, static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullBoxesScalar(f, b, i, out + count);
+}
+#endif
+
+#if RENDERER_CULL_AVX2
+// Compiled for AVX2/FMA regardless of the global flags, only called after
+// the runtime check in IsSupported()
+__attribute__((target("avx2,fma"))) size_t
+CullSpheresAVX2(const Frustum &f, const BoundingSpheres &s, uint32_t *out) {
+  __m256 pa[Frustum::Count], pb[Frustum::Count], pc[Frustum::Count],
+      pd[Frustum::Count];
+  for (uint32_t p = 0; p < Frustum::Count; ++p) {
+    pa[p] = _mm256_set1_ps(f.a[p]);
+    pb[p] = _mm256_set1_ps(f.b[p]);
+    pc[p] = _mm256_set1_ps(f.c[p]);
+    pd[p] = _mm256_set1_ps(f.d[p]);
+  }
+
+  const size_t total = s.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    __m256 x = _mm256_loadu_ps(&s.centerX[i]);
+    __m256 y = _mm256_loadu_ps(&s.centerY[i]);
+    __m256 z = _mm256_loadu_ps(&s.centerZ[i]);
+    __m256 negR =
+        _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&s.radius[i]));
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (uint32_t p = 0; p < Frustum::Count; ++p) {
+      __m256 distance = _mm256_fmadd_ps(pc[p], z, pd[p]);
+      distance = _mm256_fmadd_ps(pb[p], y, distance);
+      distance = _mm256_fmadd_ps(pa[p], x, distance);
+      inside =
+          _mm256_and_ps(inside, _mm256_cmp_ps(distance, negR, _CMP_GE_OQ));
+    }
+    EmitVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)),
+                static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullSpheresScalar(f, s, i, out + count);
+}
+
+__attribute__((target("avx2,fma"))) size_t
+CullBoxesAVX2(const Frustum &f, const BoundingBoxes &b, uint32_t *out) {
+  __m256 pa[Frustum::Count], pb[Frustum::Count], pc[Frustum::Count],
+      pd[Frustum::Count];
+  __m256 absA[Frustum::Count], absB[Frustum::Count], absC[Frustum::Count];
+  for (uint32_t p = 0; p < Frustum::Count; ++p) {
+    pa[p] = _mm256_set1_ps(f.a[p]);
+    pb[p] = _mm256_set1_ps(f.b[p]);
+    pc[p] = _mm256_set1_ps(f.c[p]);
+    pd[p] = _mm256_set1_ps(f.d[p]);
+    absA[p] = _mm256_set1_ps(std::fabs(f.a[p]));
+    absB[p] = _mm256_set1_ps(std::fabs(f.b[p]));
+    absC[p] = _mm256_set1_ps(std::fabs(f.c[p]));
+  }
+
+  const size_t total = b.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    __m256 x = _mm256_loadu_ps(&b.centerX[i]);
+    __m256 y = _mm256_loadu_ps(&b.centerY[i]);
+    __m256 z = _mm256_loadu_ps(&b.centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&b.extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&b.extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&b.extentZ[i]);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (uint32_t p = 0; p < Frustum::Count; ++p) {
+      // distance + projected radius, accumulated in one FMA chain
+      __m256 sum = _mm256_fmadd_ps(pc[p], z, pd[p]);
+      sum = _mm256_fmadd_ps(pb[p], y, sum);
+      sum = _mm256_fmadd_ps(pa[p], x, sum);
+      sum = _mm256_fmadd_ps(
+          absA[p], ex,
+          _mm256_fmadd_ps(absB[p], ey, _mm256_fmadd_ps(absC[p], ez, sum)));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(sum, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    EmitVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)),
+                static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullBoxesScalar(f, b, i, out + count);
+}
+#endif
+
+#if RENDERER_CULL_NEON
+inline uint32_t MoveMask(uint32x4_t mask) {
+  static const uint32_t bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(mask, vld1q_u32(bits)));
+}
+
+size_t CullSpheresNEON(const Frustum &f, const BoundingSpheres &s,
+                       uint32_t *out) {
+  const size_t total = s.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < 8; half += 4) {
+      const size_t j = i + half;
+      float32x4_t x = vld1q_f32(&s.centerX[j]);
+      float32x4_t y = vld1q_f32(&s.centerY[j]);
+      float32x4_t z = vld1q_f32(&s.centerZ[j]);
+      float32x4_t negR = vnegq_f32(vld1q_f32(&s.radius[j]));
+      uint32x4_t inside = vdupq_n_u32(~0u);
+      for (uint32_t p = 0; p < Frustum::Count; ++p) {
+        float32x4_t distance = vdupq_n_f32(f.d[p]);
+        distance = vfmaq_n_f32(distance, x, f.a[p]);
+        distance = vfmaq_n_f32(distance, y, f.b[p]);
+        distance = vfmaq_n_f32(distance, z, f.c[p]);
+        inside = vandq_u32(inside, vcgeq_f32(distance, negR));
+      }
+      mask |= MoveMask(inside) << half;
+    }
+    EmitVisible(mask, static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullSpheresScalar(f, s, i, out + count);
+}
+
+size_t CullBoxesNEON(const Frustum &f, const BoundingBoxes &b, uint32_t *out) {
+  const size_t total = b.Size();
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= total; i += 8) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < 8; half += 4) {
+      const size_t j = i + half;
+      float32x4_t x = vld1q_f32(&b.centerX[j]);
+      float32x4_t y = vld1q_f32(&b.centerY[j]);
+      float32x4_t z = vld1q_f32(&b.centerZ[j]);
+      float32x4_t ex = vld1q_f32(&b.extentX[j]);
+      float32x4_t ey = vld1q_f32(&b.extentY[j]);
+      float32x4_t ez = vld1q_f32(&b.extentZ[j]);
+      uint32x4_t inside = vdupq_n_u32(~0u);
+      for (uint32_t p = 0; p < Frustum::Count; ++p) {
+        float32x4_t sum = vdupq_n_f32(f.d[p]);
+        sum = vfmaq_n_f32(sum, x, f.a[p]);
+        sum = vfmaq_n_f32(sum, y, f.b[p]);
+        sum = vfmaq_n_f32(sum, z, f.c[p]);
+        sum = vfmaq_n_f32(sum, ex, std::fabs(f.a[p]));
+        sum = vfmaq_n_f32(sum, ey, std::fabs(f.b[p]));
+        sum = vfmaq_n_f32(sum, ez, std::fabs(f.c[p]));
+        inside = vandq_u32(inside, vcgeq_f32(sum, vdupq_n_f32(0.0f)));
+      }
+      mask |= MoveMask(inside) << half;
+    }
+    EmitVisible(mask, static_cast<uint32_t>(i), out, count);
+  }
+  return count + CullBoxesScalar(f, b, i, out + count);
+}
+#endif
+
+} // namespace
+
+FrustumCuller::FrustumCuller() : m_Kernel(Kernel::Scalar) {
+  for (Kernel kernel : {Kernel::AVX2, Kernel::SSE, Kernel::NEON}) {
+    if (IsSupported(kernel)) {
+      m_Kernel = kernel;
+      break;
+    }
+  }
+}
+
+FrustumCuller::FrustumCuller(Kernel kernel)
+    : m_Kernel(IsSupported(kernel) ? kernel : Kernel::Scalar) {}
+
+bool FrustumCuller::IsSupported(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Scalar:
+    return true;
+#if RENDERER_CULL_SSE
+  case Kernel::SSE:
+    return true;
+#endif
+#if RENDERER_CULL_AVX2
+  case Kernel::AVX2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#if RENDERER_CULL_NEON
+  case Kernel::NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *FrustumCuller::GetKernelName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::SSE:
+    return "SSE";
+  case Kernel::AVX2:
+    return "AVX2";
+  case Kernel::NEON:
+    return "NEON";
+  default:
+    return "Scalar";
+  }
+}
+
+size_t FrustumCuller::Cull(const Frustum &frustum,
+                           const BoundingSpheres &spheres,
+                           std::vector<uint32_t> &visible) const {
+  visible.resize(spheres.Size());
+  size_t count = 0;
+  switch (m_Kernel) {
+#if RENDERER_CULL_AVX2
+  case Kernel::AVX2:
+    count = CullSpheresAVX2(frustum, spheres, visible.data());
+    break;
+#endif
+#if RENDERER_CULL_SSE
+  case Kernel::SSE:
+    count = CullSpheresSSE(frustum, spheres, visible.data());
+    break;
+#endif
+#if RENDERER_CULL_NEON
+  case Kernel::NEON:
+    count = CullSpheresNEON(frustum, spheres, visible.data());
+    break;
+#endif
+  default:
+    count = CullSpheresScalar(frustum, spheres, 0, visible.data());
+    break;
+  }
+  visible.resize(count);
+  return count;
+}
+
+size_t FrustumCuller::Cull(const Frustum &frustum, const BoundingBoxes &boxes,
+                           std::vector<uint32_t> &visible) const {
+  visible.resize(boxes.Size());
+  size_t count = 0;
+  switch (m_Kernel) {
+#if RENDERER_CULL_AVX2
+  case Kernel::AVX2:
+    count = CullBoxesAVX2(frustum, boxes, visible.data());
+    break;
+#endif
+#if RENDERER_CULL_SSE
+  case Kernel::SSE:
+    count = CullBoxesSSE(frustum, boxes, visible.data());
+    break;
+#endif
+#if RENDERER_CULL_NEON
+  case Kernel::NEON:
+    count = CullBoxesNEON(frustum, boxes, visible.data());
+    break;
+#endif
+  default:
+    count = CullBoxesScalar(frustum, boxes, 0, visible.data());
+    break;
+  }
+  visible.resize(count);
+  return count;
+}
+
+} // namespace Renderer
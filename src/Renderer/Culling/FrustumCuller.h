@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Renderer {
+
+// Six planes as ax + by + cz + d >= 0 inside, stored plane-major so the
+// kernels can broadcast one coefficient at a time
+struct Frustum {
+  enum Plane : uint32_t { Left = 0, Right, Bottom, Top, Near, Far, Count };
+
+  alignas(16) float a[Count];
+  alignas(16) float b[Count];
+  alignas(16) float c[Count];
+  alignas(16) float d[Count];
+
+  // Gribb/Hartmann extraction from proj * view (world space planes) or
+  // proj * view * model (object space). zeroToOne matches Vulkan / the
+  // GLM_FORCE_DEPTH_ZERO_TO_ONE projections used by the app.
+  static Frustum FromMatrix(const glm::mat4 &viewProj, bool zeroToOne = true);
+};
+
+// Bounding spheres, one array per component
+struct BoundingSpheres {
+  std::vector<float> centerX, centerY, centerZ, radius;
+
+  uint32_t Add(const glm::vec3 &center, float r);
+  void Set(uint32_t index, const glm::vec3 &center, float r);
+  void Reserve(size_t count);
+  void Clear();
+  size_t Size() const { return radius.size(); }
+};
+
+// Axis aligned boxes in center/half-extent form, which turns the box/plane
+// test into a single dot product per plane
+struct BoundingBoxes {
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  uint32_t Add(const glm::vec3 &min, const glm::vec3 &max);
+  void Set(uint32_t index, const glm::vec3 &min, const glm::vec3 &max);
+  void Reserve(size_t count);
+  void Clear();
+  size_t Size() const { return centerX.size(); }
+};
+
+class FrustumCuller {
+public:
+  enum class Kernel { Scalar, SSE, AVX2, NEON };
+
+  // Picks the widest kernel the CPU supports (AVX2 is detected at runtime)
+  FrustumCuller();
+  // Forces a kernel, falling back to Scalar if unavailable
+  explicit FrustumCuller(Kernel kernel);
+
+  // Fills `visible` with the indices of the volumes intersecting the
+  // frustum, in ascending order. Returns the visible count.
+  size_t Cull(const Frustum &frustum, const BoundingSpheres &spheres,
+              std::vector<uint32_t> &visible) const;
+  size_t Cull(const Frustum &frustum, const BoundingBoxes &boxes,
+              std::vector<uint32_t> &visible) const;
+
+  Kernel GetKernel() const { return m_Kernel; }
+  static const char *GetKernelName(Kernel kernel);
+  static bool IsSupported(Kernel kernel);
+
+private:
+  Kernel m_Kernel;
+};
+
+} // namespace Renderer
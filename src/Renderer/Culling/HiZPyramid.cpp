@@ -0,0 +1,164 @@
+#include "HiZPyramid.h"
+#include "../Helpers/helpers.h"
+#include "shaders/hiz_downsample.spv.h"
+#include <algorithm>
+
+namespace Renderer {
+
+namespace {
+constexpr uint32_t DOWNSAMPLE_GROUP_SIZE = 8;
+
+struct DownsampleParams {
+  uint32_t srcWidth, srcHeight;
+  uint32_t dstWidth, dstHeight;
+};
+
+uint32_t previousPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result * 2 <= value)
+    result *= 2;
+  return result;
+}
+} // namespace
+
+HiZPyramid::HiZPyramid(Renderer::Device &device,
+                       const std::vector<vk::raii::ImageView> &depthViews,
+                       vk::Extent2D depthExtent) {
+  // Texels are fetched with Load(), the sampler only completes the
+  // combined descriptor
+  vk::SamplerCreateInfo samplerInfo{};
+  samplerInfo.magFilter = vk::Filter::eNearest;
+  samplerInfo.minFilter = vk::Filter::eNearest;
+  samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  m_Sampler = vk::raii::Sampler(device.GetDevice(), samplerInfo);
+
+  // The meshlet path tests against the pyramid in its task shader
+  m_ReaderStages = vk::PipelineStageFlagBits2::eComputeShader;
+  if (device.HasMeshShader())
+    m_ReaderStages |= vk::PipelineStageFlagBits2::eTaskShaderEXT;
+
+  Create(device, depthViews, depthExtent);
+}
+
+HiZPyramid::~HiZPyramid() {}
+
+void HiZPyramid::Resize(Renderer::Device &device,
+                        const std::vector<vk::raii::ImageView> &depthViews,
+                        vk::Extent2D depthExtent) {
+  m_Downsample.reset();
+  m_MipViews.clear();
+  m_ImageView = nullptr;
+  m_Image = nullptr;
+  m_ImageMemory = nullptr;
+
+  Create(device, depthViews, depthExtent);
+}
+
+void HiZPyramid::Create(Renderer::Device &device,
+                        const std::vector<vk::raii::ImageView> &depthViews,
+                        vk::Extent2D depthExtent) {
+  m_DepthExtent = depthExtent;
+  m_DepthCount = static_cast<uint32_t>(depthViews.size());
+  m_Extent = vk::Extent2D{previousPowerOfTwo(depthExtent.width),
+                          previousPowerOfTwo(depthExtent.height)};
+  m_MipLevels = getMipLevelCount(m_Extent.width, m_Extent.height);
+
+  createImage(device, m_Extent.width, m_Extent.height, vk::Format::eR32Sfloat,
+              vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eStorage |
+                  vk::ImageUsageFlagBits::eSampled,
+              vk::MemoryPropertyFlagBits::eDeviceLocal, m_Image,
+              m_ImageMemory, m_MipLevels);
+  m_ImageView = createImageView(device, m_Image, vk::Format::eR32Sfloat,
+                                vk::ImageAspectFlagBits::eColor, m_MipLevels);
+
+  for (uint32_t level = 0; level < m_MipLevels; ++level) {
+    vk::ImageViewCreateInfo viewInfo(
+        {}, m_Image, vk::ImageViewType::e2D, vk::Format::eR32Sfloat, {},
+        {vk::ImageAspectFlagBits::eColor, level, 1, 0, 1});
+    m_MipViews.emplace_back(device.GetDevice(), viewInfo);
+  }
+
+  m_Downsample = std::make_unique<ComputePipeline>(
+      device, Shaders::HiZDownsample, "downsampleMain",
+      std::vector<ComputeBinding>{
+          {0, vk::DescriptorType::eCombinedImageSampler},
+          {1, vk::DescriptorType::eStorageImage},
+      },
+      m_MipLevels - 1 + m_DepthCount, sizeof(DownsampleParams));
+
+  for (uint32_t level = 1; level < m_MipLevels; ++level) {
+    m_Downsample->WriteSampledImage(device, level - 1, 0,
+                                    *m_MipViews[level - 1], *m_Sampler,
+                                    vk::ImageLayout::eGeneral);
+    m_Downsample->WriteStorageImage(device, level - 1, 1,
+                                    *m_MipViews[level]);
+  }
+  for (uint32_t i = 0; i < m_DepthCount; ++i) {
+    m_Downsample->WriteSampledImage(device, m_MipLevels - 1 + i, 0,
+                                    *depthViews[i], *m_Sampler);
+    m_Downsample->WriteStorageImage(device, m_MipLevels - 1 + i, 1,
+                                    *m_MipViews[0]);
+  }
+}
+
+vk::Extent2D HiZPyramid::GetMipExtent(uint32_t level) const {
+  return vk::Extent2D{std::max(m_Extent.width >> level, 1u),
+                      std::max(m_Extent.height >> level, 1u)};
+}
+
+void HiZPyramid::Build(const vk::raii::CommandBuffer &commandBuffer,
+                       uint32_t depthIndex, vk::Extent2D sourceExtent) {
+  if (sourceExtent.width == 0 || sourceExtent.height == 0)
+    sourceExtent = m_DepthExtent;
+
+  // Contents are fully rewritten, but last frame's culling pass may still
+  // be reading them, in compute or in the task shader
+  vk::ImageMemoryBarrier2 barrier{};
+  barrier.srcStageMask = m_ReaderStages;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eShaderRead;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eShaderWrite;
+  barrier.oldLayout = vk::ImageLayout::eUndefined;
+  barrier.newLayout = vk::ImageLayout::eGeneral;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = *m_Image;
+  barrier.subresourceRange = vk::ImageSubresourceRange(
+      vk::ImageAspectFlagBits::eColor, 0, m_MipLevels, 0, 1);
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount = 1;
+  dependencyInfo.pImageMemoryBarriers = &barrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  for (uint32_t level = 0; level < m_MipLevels; ++level) {
+    vk::Extent2D dst = GetMipExtent(level);
+    vk::Extent2D src = level == 0 ? sourceExtent : GetMipExtent(level - 1);
+    DownsampleParams params{src.width, src.height, dst.width, dst.height};
+
+    uint32_t set = level == 0 ? m_MipLevels - 1 + depthIndex : level - 1;
+    m_Downsample->Dispatch(
+        commandBuffer, set,
+        ComputePipeline::GroupCount(dst.width, DOWNSAMPLE_GROUP_SIZE),
+        ComputePipeline::GroupCount(dst.height, DOWNSAMPLE_GROUP_SIZE), 1,
+        &params);
+
+    // The next level (and the culling pass) reads what was just written
+    barrier.srcStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+    barrier.srcAccessMask = vk::AccessFlagBits2::eShaderWrite;
+    barrier.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+    barrier.dstAccessMask = vk::AccessFlagBits2::eShaderRead;
+    barrier.oldLayout = vk::ImageLayout::eGeneral;
+    barrier.newLayout = vk::ImageLayout::eGeneral;
+    barrier.subresourceRange = vk::ImageSubresourceRange(
+        vk::ImageAspectFlagBits::eColor, level, 1, 0, 1);
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+  }
+}
+
+} // namespace Renderer
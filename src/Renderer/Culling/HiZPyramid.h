@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Device/Device.h"
+#include "../Device/DeviceMemory.h"
+#include "../Pipeline/ComputePipeline.h"
+
+namespace Renderer {
+
+// Max-depth mip chain of a depth buffer, built with compute. Level 0 is the
+// depth extent rounded down to a power of two so every further level halves
+// exactly.
+class HiZPyramid {
+public:
+  // One source per depth image (e.g. one per swapchain image); the images
+  // need eSampled usage
+  HiZPyramid(Renderer::Device &device,
+             const std::vector<vk::raii::ImageView> &depthViews,
+             vk::Extent2D depthExtent);
+  ~HiZPyramid();
+
+  // Recreates the pyramid for new depth targets (e.g. after a swapchain
+  // resize). The device must be idle; the sampler stays, but the image view
+  // changes, so users have to rewrite their descriptors.
+  void Resize(Renderer::Device &device,
+              const std::vector<vk::raii::ImageView> &depthViews,
+              vk::Extent2D depthExtent);
+
+  // Records the downsample chain from depth image `depthIndex`, which must be
+  // in eShaderReadOnlyOptimal. Leaves the pyramid in eGeneral, readable by
+  // compute and task shaders. sourceExtent limits the read to the top left
+  // corner of the depth image, for frames rendered below full resolution;
+  // empty means the whole image.
+  void Build(const vk::raii::CommandBuffer &commandBuffer, uint32_t depthIndex,
+             vk::Extent2D sourceExtent = {});
+
+  vk::ImageView GetImageView() const { return *m_ImageView; }
+  vk::Sampler GetSampler() const { return *m_Sampler; }
+  vk::Extent2D GetExtent() const { return m_Extent; }
+  uint32_t GetMipLevels() const { return m_MipLevels; }
+
+private:
+  void Create(Renderer::Device &device,
+              const std::vector<vk::raii::ImageView> &depthViews,
+              vk::Extent2D depthExtent);
+  vk::Extent2D GetMipExtent(uint32_t level) const;
+
+private:
+  vk::Extent2D m_DepthExtent;
+  vk::Extent2D m_Extent;
+  uint32_t m_MipLevels = 1;
+  uint32_t m_DepthCount = 0;
+  // Stages that may still sample the pyramid when the next build starts
+  vk::PipelineStageFlags2 m_ReaderStages;
+
+  vk::raii::Image m_Image = nullptr;
+  Renderer::DeviceMemory m_ImageMemory = nullptr;
+  vk::raii::ImageView m_ImageView = nullptr;
+  std::vector<vk::raii::ImageView> m_MipViews;
+  vk::raii::Sampler m_Sampler = nullptr;
+
+  // Sets [0, levels - 1) read level i and write i + 1, the remaining ones
+  // read depth image j and write level 0
+  std::unique_ptr<ComputePipeline> m_Downsample;
+};
+
+} // namespace Renderer
@@ -0,0 +1,186 @@
+#include "OcclusionCuller.h"
+#include "shaders/occlusion_cull.spv.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+// Matches CullParams in shaders/occlusion_cull.slang
+struct CullParams {
+  glm::mat4 viewProj;
+  float pyramidWidth, pyramidHeight;
+  uint32_t objectCount;
+  uint32_t phase;
+  uint32_t pyramidLevels;
+};
+} // namespace
+
+OcclusionCuller::OcclusionCuller(Renderer::Device &device,
+                                 Renderer::CommandPool &commandPool,
+                                 Renderer::BufferManager &bufferManager,
+                                 Renderer::HiZPyramid &pyramid,
+                                 uint32_t maxObjects,
+                                 uint32_t maxFramesInFlight)
+    : m_Pyramid(pyramid), m_MaxObjects(maxObjects),
+      m_MultiDrawIndirect(device.HasMultiDrawIndirect()) {
+  vk::DeviceSize objectsSize = sizeof(OcclusionObject) * maxObjects;
+  for (uint32_t i = 0; i < maxFramesInFlight; ++i) {
+    vk::raii::Buffer buffer({});
+    Renderer::DeviceMemory bufferMem = nullptr;
+    if (!bufferManager.CreateDirectWriteBuffer(
+            device, objectsSize, vk::BufferUsageFlagBits::eStorageBuffer,
+            buffer, bufferMem)) {
+      bufferManager.CreateBuffer(device, objectsSize,
+                                 vk::BufferUsageFlagBits::eStorageBuffer,
+                                 vk::MemoryPropertyFlagBits::eHostVisible |
+                                     vk::MemoryPropertyFlagBits::eHostCoherent,
+                                 buffer, bufferMem);
+    }
+    m_ObjectBuffers.emplace_back(std::move(buffer));
+    m_ObjectBuffersMemory.emplace_back(std::move(bufferMem));
+    m_ObjectBuffersMapped.emplace_back(
+        m_ObjectBuffersMemory[i].mapMemory(0, objectsSize));
+  }
+  m_ObjectCounts.assign(maxFramesInFlight, 0);
+
+  vk::DeviceSize drawsSize =
+      sizeof(vk::DrawIndexedIndirectCommand) * maxObjects;
+  bufferManager.CreateBuffer(device, drawsSize,
+                             vk::BufferUsageFlagBits::eStorageBuffer |
+                                 vk::BufferUsageFlagBits::eIndirectBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             m_EarlyDraws, m_EarlyDrawsMemory);
+  bufferManager.CreateBuffer(device, drawsSize,
+                             vk::BufferUsageFlagBits::eStorageBuffer |
+                                 vk::BufferUsageFlagBits::eIndirectBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             m_LateDraws, m_LateDrawsMemory);
+
+  // Nothing was visible before the first frame
+  std::vector<uint32_t> visibility(maxObjects, 0);
+  bufferManager.CreateBufferWithData(
+      device, commandPool, visibility.data(),
+      sizeof(uint32_t) * visibility.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer, m_Visibility,
+      m_VisibilityMemory);
+
+  m_Cull = std::make_unique<ComputePipeline>(
+      device, Shaders::OcclusionCull, "cullMain",
+      std::vector<ComputeBinding>{
+          {0, vk::DescriptorType::eStorageBuffer},
+          {1, vk::DescriptorType::eStorageBuffer},
+          {2, vk::DescriptorType::eStorageBuffer},
+          {3, vk::DescriptorType::eStorageBuffer},
+          {4, vk::DescriptorType::eCombinedImageSampler},
+      },
+      maxFramesInFlight, sizeof(CullParams));
+
+  for (uint32_t i = 0; i < maxFramesInFlight; ++i) {
+    m_Cull->WriteStorageBuffer(device, i, 0, *m_ObjectBuffers[i]);
+    m_Cull->WriteStorageBuffer(device, i, 1, *m_EarlyDraws);
+    m_Cull->WriteStorageBuffer(device, i, 2, *m_LateDraws);
+    m_Cull->WriteStorageBuffer(device, i, 3, *m_Visibility);
+  }
+  RefreshPyramidDescriptors(device);
+}
+
+OcclusionCuller::~OcclusionCuller() {}
+
+void OcclusionCuller::RefreshPyramidDescriptors(Renderer::Device &device) {
+  for (uint32_t i = 0; i < m_ObjectCounts.size(); ++i) {
+    m_Cull->WriteSampledImage(device, i, 4, m_Pyramid.GetImageView(),
+                              m_Pyramid.GetSampler(),
+                              vk::ImageLayout::eGeneral);
+  }
+}
+
+void OcclusionCuller::SetObjects(uint32_t frameIndex,
+                                 const std::vector<OcclusionObject> &objects) {
+  if (objects.size() > m_MaxObjects) {
+    throw std::runtime_error("too many objects for the occlusion culler!");
+  }
+  memcpy(m_ObjectBuffersMapped[frameIndex], objects.data(),
+         sizeof(OcclusionObject) * objects.size());
+  m_ObjectCounts[frameIndex] = static_cast<uint32_t>(objects.size());
+}
+
+void OcclusionCuller::RecordEarly(const vk::raii::CommandBuffer &commandBuffer,
+                                  uint32_t frameIndex,
+                                  const glm::mat4 &viewProj) {
+  Record(commandBuffer, frameIndex, viewProj, 0);
+}
+
+void OcclusionCuller::RecordLate(const vk::raii::CommandBuffer &commandBuffer,
+                                 uint32_t frameIndex,
+                                 const glm::mat4 &viewProj) {
+  Record(commandBuffer, frameIndex, viewProj, 1);
+}
+
+void OcclusionCuller::Record(const vk::raii::CommandBuffer &commandBuffer,
+                             uint32_t frameIndex, const glm::mat4 &viewProj,
+                             uint32_t phase) {
+  // Last frame's indirect draws and visibility writes must finish before
+  // the commands and flags are rewritten
+  vk::MemoryBarrier2 barrier{};
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect |
+                         vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eIndirectCommandRead |
+                          vk::AccessFlagBits2::eShaderWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.dstAccessMask =
+      vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite;
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.memoryBarrierCount = 1;
+  dependencyInfo.pMemoryBarriers = &barrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  CullParams params{};
+  params.viewProj = viewProj;
+  params.pyramidWidth = static_cast<float>(m_Pyramid.GetExtent().width);
+  params.pyramidHeight = static_cast<float>(m_Pyramid.GetExtent().height);
+  params.objectCount = m_ObjectCounts[frameIndex];
+  params.phase = phase;
+  params.pyramidLevels = m_Pyramid.GetMipLevels();
+
+  m_Cull->Dispatch(
+      commandBuffer, frameIndex,
+      ComputePipeline::GroupCount(std::max(params.objectCount, 1u),
+                                  CULL_GROUP_SIZE),
+      1, 1, &params);
+
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eShaderWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void OcclusionCuller::DrawEarly(const vk::raii::CommandBuffer &commandBuffer,
+                                uint32_t frameIndex) const {
+  Draw(commandBuffer, m_EarlyDraws, m_ObjectCounts[frameIndex]);
+}
+
+void OcclusionCuller::DrawLate(const vk::raii::CommandBuffer &commandBuffer,
+                               uint32_t frameIndex) const {
+  Draw(commandBuffer, m_LateDraws, m_ObjectCounts[frameIndex]);
+}
+
+void OcclusionCuller::Draw(const vk::raii::CommandBuffer &commandBuffer,
+                           const vk::raii::Buffer &drawBuffer,
+                           uint32_t drawCount) const {
+  // Culled objects have instanceCount 0 and cost next to nothing
+  constexpr uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+  if (m_MultiDrawIndirect) {
+    commandBuffer.drawIndexedIndirect(*drawBuffer, 0, drawCount, stride);
+    return;
+  }
+  for (uint32_t i = 0; i < drawCount; ++i)
+    commandBuffer.drawIndexedIndirect(*drawBuffer, i * stride, 1, stride);
+}
+
+} // namespace Renderer
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <glm/glm.hpp>
+
+#include "../Buffer/Buffer.h"
+#include "../Device/Device.h"
+#include "../Pipeline/ComputePipeline.h"
+#include "HiZPyramid.h"
+
+namespace Renderer {
+
+// Matches CullObject in shaders/occlusion_cull.slang
+struct OcclusionObject {
+  glm::vec4 sphere; // world space center, radius
+  uint32_t indexCount;
+  uint32_t firstIndex;
+  int32_t vertexOffset;
+  uint32_t padding = 0;
+};
+
+// Two-phase GPU occlusion culling against a HiZPyramid. Per frame:
+//
+//   RecordEarly  -> draw DrawEarly() (last frame's visible set)
+//   depth -> eShaderReadOnlyOptimal, HiZPyramid::Build
+//   RecordLate   -> draw DrawLate() (newly disoccluded objects)
+//
+// Visibility persists on the GPU between frames; the object list is
+// written by the CPU into a per-frame buffer.
+class OcclusionCuller {
+public:
+  OcclusionCuller(Renderer::Device &device, Renderer::CommandPool &commandPool,
+                  Renderer::BufferManager &bufferManager,
+                  Renderer::HiZPyramid &pyramid, uint32_t maxObjects,
+                  uint32_t maxFramesInFlight);
+  ~OcclusionCuller();
+
+  // Object order must stay stable between frames, visibility is per index
+  void SetObjects(uint32_t frameIndex,
+                  const std::vector<OcclusionObject> &objects);
+
+  // Points the culling pass at the pyramid again after HiZPyramid::Resize;
+  // the device must be idle
+  void RefreshPyramidDescriptors(Renderer::Device &device);
+
+  void RecordEarly(const vk::raii::CommandBuffer &commandBuffer,
+                   uint32_t frameIndex, const glm::mat4 &viewProj);
+  void RecordLate(const vk::raii::CommandBuffer &commandBuffer,
+                  uint32_t frameIndex, const glm::mat4 &viewProj);
+
+  // Indexed indirect draws; the caller binds pipeline, vertex/index buffers
+  // and descriptors
+  void DrawEarly(const vk::raii::CommandBuffer &commandBuffer,
+                 uint32_t frameIndex) const;
+  void DrawLate(const vk::raii::CommandBuffer &commandBuffer,
+                uint32_t frameIndex) const;
+
+private:
+  void Record(const vk::raii::CommandBuffer &commandBuffer,
+              uint32_t frameIndex, const glm::mat4 &viewProj, uint32_t phase);
+  void Draw(const vk::raii::CommandBuffer &commandBuffer,
+            const vk::raii::Buffer &drawBuffer, uint32_t drawCount) const;
+
+private:
+  Renderer::HiZPyramid &m_Pyramid;
+  uint32_t m_MaxObjects;
+  bool m_MultiDrawIndirect;
+
+  std::vector<vk::raii::Buffer> m_ObjectBuffers;
+  std::vector<Renderer::DeviceMemory> m_ObjectBuffersMemory;
+  std::vector<void *> m_ObjectBuffersMapped;
+  std::vector<uint32_t> m_ObjectCounts;
+
+  vk::raii::Buffer m_EarlyDraws = nullptr;
+  Renderer::DeviceMemory m_EarlyDrawsMemory = nullptr;
+  vk::raii::Buffer m_LateDraws = nullptr;
+  Renderer::DeviceMemory m_LateDrawsMemory = nullptr;
+  vk::raii::Buffer m_Visibility = nullptr;
+  Renderer::DeviceMemory m_VisibilityMemory = nullptr;
+
+  std::unique_ptr<ComputePipeline> m_Cull;
+};
+
+} // namespace Renderer
@@ -0,0 +1,105 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace Renderer {
+
+DescriptorAllocator::DescriptorAllocator(
+    std::vector<DescriptorPoolRatio> ratios, uint32_t initialSetsPerPool)
+    : m_Ratios(std::move(ratios)),
+      m_SetsPerPool(std::clamp(initialSetsPerPool, 1u, MAX_SETS_PER_POOL)) {}
+
+std::vector<DescriptorPoolRatio> DescriptorAllocator::GetDefaultRatios() {
+  return {
+      {vk::DescriptorType::eUniformBuffer, 2.0f},
+      {vk::DescriptorType::eCombinedImageSampler, 2.0f},
+      {vk::DescriptorType::eStorageBuffer, 1.0f},
+      {vk::DescriptorType::eStorageImage, 1.0f},
+  };
+}
+
+vk::raii::DescriptorPool
+DescriptorAllocator::CreatePool(Renderer::Device &device) {
+  std::vector<vk::DescriptorPoolSize> poolSizes;
+  poolSizes.reserve(m_Ratios.size());
+  for (const DescriptorPoolRatio &ratio : m_Ratios) {
+    uint32_t count = static_cast<uint32_t>(
+        std::ceil(ratio.ratio * static_cast<float>(m_SetsPerPool)));
+    poolSizes.emplace_back(ratio.type, std::max(count, 1u));
+  }
+
+  // No eFreeDescriptorSet: sets only ever go back through a pool reset
+  vk::DescriptorPoolCreateInfo poolInfo{};
+  poolInfo.maxSets = m_SetsPerPool;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  vk::raii::DescriptorPool pool(device.GetDevice(), poolInfo);
+
+  // The next pool is bigger, so a busy allocator needs few of them
+  m_SetsPerPool = std::min(m_SetsPerPool + m_SetsPerPool / 2,
+                           MAX_SETS_PER_POOL);
+  return pool;
+}
+
+vk::DescriptorSet
+DescriptorAllocator::Allocate(Renderer::Device &device,
+                              vk::DescriptorSetLayout layout) {
+  vk::DescriptorSetAllocateInfo allocInfo{};
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  for (;;) {
+    bool freshPool = m_ReadyPools.empty();
+    if (freshPool)
+      m_ReadyPools.push_back(CreatePool(device));
+
+    allocInfo.descriptorPool = *m_ReadyPools.back();
+    try {
+      // The pool is reset wholesale, so hand the handle back instead of
+      // letting the RAII wrapper free it individually
+      vk::DescriptorSet set = device.GetDevice()
+                                  .allocateDescriptorSets(allocInfo)
+                                  .front()
+                                  .release();
+      m_AllocatedSets++;
+      return set;
+    } catch (const vk::OutOfPoolMemoryError &) {
+    } catch (const vk::FragmentedPoolError &) {
+    }
+
+    if (freshPool)
+      throw std::runtime_error(
+          "descriptor set layout needs more than a whole pool holds");
+    // Full: retire it until the next Reset and move on to the next pool
+    m_FullPools.push_back(std::move(m_ReadyPools.back()));
+    m_ReadyPools.pop_back();
+  }
+}
+
+void DescriptorAllocator::Reset() {
+  for (auto &pool : m_ReadyPools)
+    pool.reset();
+  for (auto &pool : m_FullPools) {
+    pool.reset();
+    m_ReadyPools.push_back(std::move(pool));
+  }
+  m_FullPools.clear();
+  m_AllocatedSets = 0;
+}
+
+FrameDescriptorAllocator::FrameDescriptorAllocator(
+    uint32_t framesInFlight, std::vector<DescriptorPoolRatio> ratios,
+    uint32_t initialSetsPerPool) {
+  m_Frames.reserve(framesInFlight);
+  for (uint32_t i = 0; i < framesInFlight; ++i)
+    m_Frames.emplace_back(ratios, initialSetsPerPool);
+}
+
+void FrameDescriptorAllocator::BeginFrame(uint32_t frameIndex) {
+  m_CurrentFrame = frameIndex;
+  m_Frames[frameIndex].Reset();
+}
+
+} // namespace Renderer
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Device/Device.h"
+
+namespace Renderer {
+
+// Descriptors of one type to reserve per set in a pool
+struct DescriptorPoolRatio {
+  vk::DescriptorType type;
+  float ratio;
+};
+
+// Hands out descriptor sets from a list of pools. When the current pool runs
+// out, it is retired and a larger one takes over, so allocation never fails
+// for lack of space. Sets are never freed one by one: Reset() returns all of
+// them at once. Not thread safe.
+class DescriptorAllocator {
+public:
+  static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+  explicit DescriptorAllocator(
+      std::vector<DescriptorPoolRatio> ratios = GetDefaultRatios(),
+      uint32_t initialSetsPerPool = 64);
+
+  vk::DescriptorSet Allocate(Renderer::Device &device,
+                             vk::DescriptorSetLayout layout);
+
+  // Every set allocated so far becomes invalid; only call once the GPU is
+  // done with all of them. Pools are kept for reuse.
+  void Reset();
+
+  uint32_t GetPoolCount() const {
+    return static_cast<uint32_t>(m_FullPools.size() + m_ReadyPools.size());
+  }
+  uint32_t GetAllocatedSetCount() const { return m_AllocatedSets; }
+
+  // Uniform buffers, combined image samplers, storage buffers and images
+  static std::vector<DescriptorPoolRatio> GetDefaultRatios();
+
+private:
+  vk::raii::DescriptorPool CreatePool(Renderer::Device &device);
+
+private:
+  std::vector<DescriptorPoolRatio> m_Ratios;
+  uint32_t m_SetsPerPool;
+
+  std::vector<vk::raii::DescriptorPool> m_FullPools;
+  // Pools with space left; allocation takes from back()
+  std::vector<vk::raii::DescriptorPool> m_ReadyPools;
+  uint32_t m_AllocatedSets = 0;
+};
+
+// One DescriptorAllocator per frame in flight for transient sets, rewritten
+// every frame. BeginFrame resets the frame's pools wholesale, which is only
+// safe once that frame's previous submission has completed (its fence).
+class FrameDescriptorAllocator {
+public:
+  explicit FrameDescriptorAllocator(
+      uint32_t framesInFlight,
+      std::vector<DescriptorPoolRatio> ratios =
+          DescriptorAllocator::GetDefaultRatios(),
+      uint32_t initialSetsPerPool = 64);
+
+  void BeginFrame(uint32_t frameIndex);
+
+  // From the frame passed to the last BeginFrame
+  vk::DescriptorSet Allocate(Renderer::Device &device,
+                             vk::DescriptorSetLayout layout) {
+    return m_Frames[m_CurrentFrame].Allocate(device, layout);
+  }
+
+  DescriptorAllocator &GetFrame(uint32_t frameIndex) {
+    return m_Frames[frameIndex];
+  }
+
+private:
+  std::vector<DescriptorAllocator> m_Frames;
+  uint32_t m_CurrentFrame = 0;
+};
+
+} // namespace Renderer
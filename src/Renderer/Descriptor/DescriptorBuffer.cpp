@@ -0,0 +1,125 @@
+#include "DescriptorBuffer.h"
+
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+constexpr vk::DeviceSize UnknownOffset = ~vk::DeviceSize(0);
+}
+
+DescriptorBuffer::DescriptorBuffer(Renderer::Device &device,
+                                   BufferManager &bufferManager,
+                                   vk::DescriptorSetLayout layout,
+                                   uint32_t setsPerFrame,
+                                   uint32_t framesInFlight)
+    : m_Layout(layout), m_Properties(device.GetDescriptorBufferProperties()),
+      m_SetsPerFrame(setsPerFrame) {
+  if (!device.HasDescriptorBuffer())
+    throw std::runtime_error("device has no descriptor buffer support");
+
+  // The layout queries are not on the RAII device, so go through the
+  // plain handle with the RAII dispatcher
+  vk::Device handle = *device.GetDevice();
+  vk::DeviceSize setSize = handle.getDescriptorSetLayoutSizeEXT(
+      layout, *device.GetDevice().getDispatcher());
+  vk::DeviceSize alignment = m_Properties.descriptorBufferOffsetAlignment;
+  m_SetStride = (setSize + alignment - 1) / alignment * alignment;
+
+  // Combined image samplers need the sampler usage on top of the resource
+  // one
+  m_Usage = vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT |
+            vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT |
+            vk::BufferUsageFlagBits::eShaderDeviceAddress;
+  vk::DeviceSize size = m_SetStride * setsPerFrame * framesInFlight;
+  if (!bufferManager.CreateDirectWriteBuffer(device, size, m_Usage, m_Buffer,
+                                             m_Memory)) {
+    bufferManager.CreateBuffer(device, size, m_Usage,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               m_Buffer, m_Memory);
+  }
+  m_Mapped = static_cast<unsigned char *>(m_Memory.mapMemory(0, size));
+
+  vk::BufferDeviceAddressInfo addressInfo{};
+  addressInfo.buffer = *m_Buffer;
+  m_Address = device.GetDevice().getBufferAddress(addressInfo);
+}
+
+void DescriptorBuffer::BeginFrame(uint32_t frameIndex) {
+  m_FrameIndex = frameIndex;
+  m_FrameSetCount = 0;
+}
+
+vk::DeviceSize DescriptorBuffer::AllocateSet() {
+  if (m_FrameSetCount == m_SetsPerFrame)
+    throw std::runtime_error("descriptor buffer frame region is full");
+  vk::DeviceSize frameOffset =
+      static_cast<vk::DeviceSize>(m_FrameIndex) * m_SetsPerFrame * m_SetStride;
+  return frameOffset + m_SetStride * m_FrameSetCount++;
+}
+
+vk::DeviceSize DescriptorBuffer::GetBindingOffset(Renderer::Device &device,
+                                                  uint32_t binding) {
+  if (binding >= m_BindingOffsets.size())
+    m_BindingOffsets.resize(binding + 1, UnknownOffset);
+  if (m_BindingOffsets[binding] == UnknownOffset) {
+    vk::Device handle = *device.GetDevice();
+    m_BindingOffsets[binding] = handle.getDescriptorSetLayoutBindingOffsetEXT(
+        m_Layout, binding, *device.GetDevice().getDispatcher());
+  }
+  return m_BindingOffsets[binding];
+}
+
+void DescriptorBuffer::WriteUniformBuffer(Renderer::Device &device,
+                                          vk::DeviceSize set, uint32_t binding,
+                                          vk::DeviceAddress address,
+                                          vk::DeviceSize range) {
+  vk::DescriptorAddressInfoEXT addressInfo{};
+  addressInfo.address = address;
+  addressInfo.range = range;
+
+  vk::DescriptorGetInfoEXT getInfo{};
+  getInfo.type = vk::DescriptorType::eUniformBuffer;
+  getInfo.data.pUniformBuffer = &addressInfo;
+
+  device.GetDevice().getDescriptorEXT(
+      getInfo, m_Properties.uniformBufferDescriptorSize,
+      m_Mapped + set + GetBindingOffset(device, binding));
+}
+
+void DescriptorBuffer::WriteCombinedImageSampler(Renderer::Device &device,
+                                                 vk::DeviceSize set,
+                                                 uint32_t binding,
+                                                 vk::ImageView imageView,
+                                                 vk::Sampler sampler,
+                                                 vk::ImageLayout layout) {
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.sampler = sampler;
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = layout;
+
+  vk::DescriptorGetInfoEXT getInfo{};
+  getInfo.type = vk::DescriptorType::eCombinedImageSampler;
+  getInfo.data.pCombinedImageSampler = &imageInfo;
+
+  device.GetDevice().getDescriptorEXT(
+      getInfo, m_Properties.combinedImageSamplerDescriptorSize,
+      m_Mapped + set + GetBindingOffset(device, binding));
+}
+
+void DescriptorBuffer::Bind(const vk::raii::CommandBuffer &commandBuffer,
+                            vk::PipelineBindPoint bindPoint,
+                            vk::PipelineLayout pipelineLayout,
+                            uint32_t firstSet, vk::DeviceSize set) const {
+  vk::DescriptorBufferBindingInfoEXT bindingInfo{};
+  bindingInfo.address = m_Address;
+  bindingInfo.usage = m_Usage;
+  commandBuffer.bindDescriptorBuffersEXT(bindingInfo);
+
+  uint32_t bufferIndex = 0;
+  commandBuffer.setDescriptorBufferOffsetsEXT(bindPoint, pipelineLayout,
+                                              firstSet, bufferIndex, set);
+}
+
+} // namespace Renderer
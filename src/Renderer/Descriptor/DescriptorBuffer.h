@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Buffer/Buffer.h"
+#include "../Device/Device.h"
+#include "../Device/DeviceMemory.h"
+
+namespace Renderer {
+
+// VK_EXT_descriptor_buffer backend: descriptors are written straight into
+// persistently mapped buffer memory and bound by offset, with no pools and
+// no vkUpdateDescriptorSets. Only usable when Device::HasDescriptorBuffer(),
+// with a layout created with eDescriptorBufferEXT and pipelines created with
+// the matching eDescriptorBufferEXT flag.
+//
+// Each frame in flight owns a region of `setsPerFrame` sets that is filled
+// linearly and started over by BeginFrame.
+class DescriptorBuffer {
+public:
+  DescriptorBuffer(Renderer::Device &device, BufferManager &bufferManager,
+                   vk::DescriptorSetLayout layout, uint32_t setsPerFrame,
+                   uint32_t framesInFlight);
+
+  // Only once the frame's previous submission has completed
+  void BeginFrame(uint32_t frameIndex);
+
+  // Offset of a new set in the frame's region; throws when it is full
+  vk::DeviceSize AllocateSet();
+
+  void WriteUniformBuffer(Renderer::Device &device, vk::DeviceSize set,
+                          uint32_t binding, vk::DeviceAddress address,
+                          vk::DeviceSize range);
+  void WriteCombinedImageSampler(
+      Renderer::Device &device, vk::DeviceSize set, uint32_t binding,
+      vk::ImageView imageView, vk::Sampler sampler,
+      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  // Binds the buffer and points set `firstSet` of `pipelineLayout` at `set`
+  void Bind(const vk::raii::CommandBuffer &commandBuffer,
+            vk::PipelineBindPoint bindPoint,
+            vk::PipelineLayout pipelineLayout, uint32_t firstSet,
+            vk::DeviceSize set) const;
+
+  vk::DeviceSize GetSetSize() const { return m_SetStride; }
+
+private:
+  vk::DeviceSize GetBindingOffset(Renderer::Device &device, uint32_t binding);
+
+private:
+  vk::raii::Buffer m_Buffer = nullptr;
+  Renderer::DeviceMemory m_Memory = nullptr;
+  unsigned char *m_Mapped = nullptr;
+  vk::DeviceAddress m_Address = 0;
+  vk::BufferUsageFlags m_Usage;
+
+  vk::DescriptorSetLayout m_Layout;
+  vk::PhysicalDeviceDescriptorBufferPropertiesEXT m_Properties;
+  // Set size rounded up to the offset alignment
+  vk::DeviceSize m_SetStride = 0;
+  std::vector<vk::DeviceSize> m_BindingOffsets;
+
+  uint32_t m_SetsPerFrame = 0;
+  uint32_t m_FrameIndex = 0;
+  uint32_t m_FrameSetCount = 0;
+};
+
+} // namespace Renderer
@@ -0,0 +1,79 @@
+#include "DescriptorLayoutCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Renderer {
+
+bool DescriptorLayoutCache::Key::operator==(const Key &other) const {
+  if (flags != other.flags || bindings.size() != other.bindings.size())
+    return false;
+  for (size_t i = 0; i < bindings.size(); ++i) {
+    const vk::DescriptorSetLayoutBinding &a = bindings[i];
+    const vk::DescriptorSetLayoutBinding &b = other.bindings[i];
+    if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+        a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags)
+      return false;
+  }
+  return true;
+}
+
+size_t DescriptorLayoutCache::KeyHash::operator()(const Key &key) const {
+  size_t hash = key.bindings.size() ^
+                static_cast<size_t>(static_cast<uint32_t>(key.flags)) << 8;
+  for (const vk::DescriptorSetLayoutBinding &binding : key.bindings) {
+    uint64_t packed =
+        static_cast<uint64_t>(binding.binding) |
+        static_cast<uint64_t>(binding.descriptorType) << 16 |
+        static_cast<uint64_t>(binding.descriptorCount) << 32 |
+        static_cast<uint64_t>(static_cast<uint32_t>(binding.stageFlags)) << 48;
+    hash ^= std::hash<uint64_t>()(packed) + 0x9e3779b9 + (hash << 6) +
+            (hash >> 2);
+  }
+  return hash;
+}
+
+vk::DescriptorSetLayout DescriptorLayoutCache::Get(
+    vk::raii::Device &device,
+    std::vector<vk::DescriptorSetLayoutBinding> bindings,
+    vk::DescriptorSetLayoutCreateFlags flags) {
+  std::sort(bindings.begin(), bindings.end(),
+            [](const vk::DescriptorSetLayoutBinding &a,
+               const vk::DescriptorSetLayoutBinding &b) {
+              return a.binding < b.binding;
+            });
+  for (const vk::DescriptorSetLayoutBinding &binding : bindings) {
+    if (binding.pImmutableSamplers)
+      throw std::runtime_error(
+          "descriptor layout cache does not take immutable samplers");
+  }
+
+  Key key{std::move(bindings), flags};
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  auto found = m_Layouts.find(key);
+  if (found != m_Layouts.end())
+    return *found->second;
+
+  vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.flags = flags;
+  layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+  layoutInfo.pBindings = key.bindings.data();
+  vk::raii::DescriptorSetLayout layout(device, layoutInfo);
+
+  vk::DescriptorSetLayout handle = *layout;
+  m_Layouts.emplace(std::move(key), std::move(layout));
+  return handle;
+}
+
+size_t DescriptorLayoutCache::GetLayoutCount() const {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Layouts.size();
+}
+
+void DescriptorLayoutCache::Clear() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Layouts.clear();
+}
+
+} // namespace Renderer
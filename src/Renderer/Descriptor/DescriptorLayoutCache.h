@@ -0,0 +1,41 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer {
+
+// Descriptor set layouts deduplicated by their bindings, so pipelines that
+// declare the same interface share one layout (and their sets are
+// interchangeable). Layouts live as long as the cache. Thread safe.
+class DescriptorLayoutCache {
+public:
+  // Binding order does not matter. Immutable samplers are not supported.
+  vk::DescriptorSetLayout
+  Get(vk::raii::Device &device,
+      std::vector<vk::DescriptorSetLayoutBinding> bindings,
+      vk::DescriptorSetLayoutCreateFlags flags = {});
+
+  size_t GetLayoutCount() const;
+
+  void Clear();
+
+private:
+  struct Key {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    vk::DescriptorSetLayoutCreateFlags flags;
+
+    bool operator==(const Key &other) const;
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+
+  mutable std::mutex m_Mutex;
+  std::unordered_map<Key, vk::raii::DescriptorSetLayout, KeyHash> m_Layouts;
+};
+
+} // namespace Renderer
@@ -1,23 +1,42 @@
 #include "Device.h"
+#include "../Profiling/Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <tuple>
 #include <vulkan/vulkan_structs.hpp>
 
 namespace Renderer {
 
 Device::Device(Renderer::Instance &instance, const vk::SurfaceKHR &surface) {
+  RENDERER_PROFILE_ZONE("Device::Device");
   PickPhysicalDevice(instance);
   CreateLogicalDevice(surface);
 }
 
+Device::Device(Renderer::Instance &instance) {
+  RENDERER_PROFILE_ZONE("Device::Device");
+  // No surface to present to, so the swapchain extension is not required
+  m_RequiredDeviceExtensions.erase(
+      std::remove_if(m_RequiredDeviceExtensions.begin(),
+                     m_RequiredDeviceExtensions.end(),
+                     [](const char *extension) {
+                       return strcmp(extension,
+                                     vk::KHRSwapchainExtensionName) == 0;
+                     }),
+      m_RequiredDeviceExtensions.end());
+
+  PickPhysicalDevice(instance);
+  CreateLogicalDevice(vk::SurfaceKHR{});
+}
+
 Device::~Device() {}
 
 uint32_t Device::FindMemoryType(uint32_t typeFilter,
                                 vk::MemoryPropertyFlags properties) {
-  vk::PhysicalDeviceMemoryProperties memProperties =
-      m_PhysicalDevice.getMemoryProperties();
-
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
-                                    properties) == properties) {
+  for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
       return i;
     }
   }
@@ -25,7 +44,157 @@ uint32_t Device::FindMemoryType(uint32_t typeFilter,
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+vk::DeviceSize MemoryUsage::TotalBytes() const {
+  vk::DeviceSize total = 0;
+  for (vk::DeviceSize b : bytes)
+    total += b;
+  return total;
+}
+
+uint32_t MemoryUsage::TotalAllocations() const {
+  uint32_t total = 0;
+  for (uint32_t a : allocations)
+    total += a;
+  return total;
+}
+
+MemoryStats Device::GetMemoryStats() {
+  std::lock_guard<std::mutex> lock(m_MemoryMutex);
+  return CollectMemoryStats();
+}
+
+MemoryStats Device::CollectMemoryStats() const {
+  MemoryStats stats;
+  stats.budgetExtension = m_MemoryBudgetSupported;
+
+  stats.heaps.resize(m_MemoryProperties.memoryHeapCount);
+  for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+    stats.heaps[i].size = m_MemoryProperties.memoryHeaps[i].size;
+    stats.heaps[i].flags = m_MemoryProperties.memoryHeaps[i].flags;
+    stats.heaps[i].budget = m_HeapBudget[i];
+    stats.heaps[i].driverUsage = m_HeapDriverUsage[i];
+  }
+
+  stats.types.resize(m_MemoryProperties.memoryTypeCount);
+  for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+    const vk::MemoryType &type = m_MemoryProperties.memoryTypes[i];
+    stats.types[i].heapIndex = type.heapIndex;
+    stats.types[i].flags = type.propertyFlags;
+    stats.types[i].usage = m_TypeUsage[i];
+
+    MemoryUsage &heapUsage = stats.heaps[type.heapIndex].usage;
+    for (size_t c = 0; c < MemoryCategoryCount; c++) {
+      heapUsage.bytes[c] += m_TypeUsage[i].bytes[c];
+      heapUsage.allocations[c] += m_TypeUsage[i].allocations[c];
+    }
+  }
+
+  // Without the extension the driver usage is unknown, our own count is the
+  // best estimate
+  if (!m_MemoryBudgetSupported) {
+    for (auto &heap : stats.heaps)
+      heap.driverUsage = heap.usage.TotalBytes();
+  }
+
+  return stats;
+}
+
+void Device::UpdateMemoryBudget() {
+  RENDERER_PROFILE_ZONE("Device::UpdateMemoryBudget");
+  {
+    std::lock_guard<std::mutex> lock(m_MemoryMutex);
+
+    if (m_MemoryBudgetSupported) {
+      auto chain = m_PhysicalDevice.getMemoryProperties2<
+          vk::PhysicalDeviceMemoryProperties2,
+          vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+      const auto &budget =
+          chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+      for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+        m_HeapBudget[i] = budget.heapBudget[i];
+        m_HeapDriverUsage[i] = budget.heapUsage[i];
+      }
+    } else {
+      // Leave 20% of each heap as headroom for the rest of the system
+      for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++) {
+        m_HeapBudget[i] = m_MemoryProperties.memoryHeaps[i].size / 10 * 8;
+      }
+    }
+  }
+
+  CheckBudgetPressure();
+}
+
+void Device::SetBudgetPressureCallback(float threshold,
+                                       BudgetPressureCallback callback) {
+  {
+    std::lock_guard<std::mutex> lock(m_MemoryMutex);
+    m_PressureThreshold = threshold;
+    m_PressureCallback = std::move(callback);
+    m_HeapUnderPressure.assign(m_MemoryProperties.memoryHeapCount, false);
+  }
+
+  CheckBudgetPressure();
+}
+
+void Device::TrackAllocation(uint32_t memoryTypeIndex, vk::DeviceSize size,
+                             MemoryCategory category) {
+  {
+    std::lock_guard<std::mutex> lock(m_MemoryMutex);
+    MemoryUsage &usage = m_TypeUsage[memoryTypeIndex];
+    usage.bytes[static_cast<size_t>(category)] += size;
+    usage.allocations[static_cast<size_t>(category)]++;
+  }
+}
+
+void Device::TrackFree(uint32_t memoryTypeIndex, vk::DeviceSize size,
+                       MemoryCategory category) {
+  {
+    std::lock_guard<std::mutex> lock(m_MemoryMutex);
+    MemoryUsage &usage = m_TypeUsage[memoryTypeIndex];
+    usage.bytes[static_cast<size_t>(category)] -= size;
+    usage.allocations[static_cast<size_t>(category)]--;
+  }
+}
+
+void Device::CheckBudgetPressure() {
+  // Heaps whose pressure state changed, with their new state
+  std::vector<std::tuple<uint32_t, MemoryHeapStats, bool>> changed;
+  BudgetPressureCallback callback;
+
+  {
+    std::lock_guard<std::mutex> lock(m_MemoryMutex);
+    if (!m_PressureCallback)
+      return;
+
+    MemoryStats stats = CollectMemoryStats();
+    for (uint32_t i = 0; i < stats.heaps.size(); i++) {
+      const MemoryHeapStats &heap = stats.heaps[i];
+      // The driver figure lags behind until the next UpdateMemoryBudget, so
+      // allocations made since then are covered by our own count
+      vk::DeviceSize usage =
+          std::max(heap.driverUsage, heap.usage.TotalBytes());
+      bool underPressure =
+          heap.budget > 0 &&
+          static_cast<double>(usage) >=
+              static_cast<double>(heap.budget) * m_PressureThreshold;
+
+      if (underPressure != m_HeapUnderPressure[i])
+        changed.emplace_back(i, heap, underPressure);
+      m_HeapUnderPressure[i] = underPressure;
+    }
+    callback = m_PressureCallback;
+  }
+
+  // Invoked unlocked so the callback can free memory or query stats
+  for (const auto &[heapIndex, heap, underPressure] : changed) {
+    callback(heapIndex, heap, underPressure);
+  }
+}
+
 void Device::PickPhysicalDevice(Renderer::Instance &instance) {
+  RENDERER_PROFILE_ZONE("Device::PickPhysicalDevice");
   auto devices = instance.GetRaii().enumeratePhysicalDevices();
   for (const auto &device : devices) {
     // Check if the device supports the Vulkan 1.3 API version
@@ -84,6 +253,7 @@ void Device::PickPhysicalDevice(Renderer::Instance &instance) {
 }
 
 void Device::CreateLogicalDevice(const vk::SurfaceKHR &surface) {
+  RENDERER_PROFILE_ZONE("Device::CreateLogicalDevice");
   if (m_PhysicalDevice == nullptr) {
     throw std::runtime_error("Physical device not initialized!");
   }
@@ -109,9 +279,11 @@ void Device::CreateLogicalDevice(const vk::SurfaceKHR &surface) {
       queueFamilyProperties.begin(), graphicsQueueFamilyProperty));
 
   // determine a queueFamilyIndex that supports present
-  // first check if the m_GraphicIndex is good enough
+  // first check if the m_GraphicIndex is good enough (a headless device has
+  // no surface and simply aliases present to graphics)
   m_PresentIndex =
-      m_PhysicalDevice.getSurfaceSupportKHR(m_GraphicsIndex, surface)
+      !surface ||
+              m_PhysicalDevice.getSurfaceSupportKHR(m_GraphicsIndex, surface)
           ? m_GraphicsIndex
           : static_cast<uint32_t>(queueFamilyProperties.size());
   if (m_PresentIndex == queueFamilyProperties.size()) {
@@ -148,6 +320,7 @@ void Device::CreateLogicalDevice(const vk::SurfaceKHR &surface) {
 
   // query for Vulkan 1.3 features
   auto features = m_PhysicalDevice.getFeatures2();
+  vk::PhysicalDeviceVulkan12Features vulkan12Features;
   vk::PhysicalDeviceVulkan13Features vulkan13Features;
   vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
       extendedDynamicStateFeatures;
@@ -155,29 +328,114 @@ void Device::CreateLogicalDevice(const vk::SurfaceKHR &surface) {
   extendedDynamicStateFeatures.extendedDynamicState = vk::True;
   vulkan13Features.pNext = &extendedDynamicStateFeatures;
   vulkan13Features.synchronization2 = vk::True;
+  vulkan12Features.pNext = &vulkan13Features;
   features.features.samplerAnisotropy = vk::True;
-  features.pNext = &vulkan13Features;
-  // create a Device
+  // Every supported core feature is enabled; remember the optional ones the
+  // renderer branches on
+  m_MultiDrawIndirect = features.features.multiDrawIndirect;
+  features.pNext = &vulkan12Features;
+
+  // Descriptor buffers need buffer device addresses for the descriptors'
+  // own memory and for the buffers they point at
+  vk::PhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures;
+  auto deviceExtensions = m_PhysicalDevice.enumerateDeviceExtensionProperties();
+  auto hasExtension = [&deviceExtensions](const char *name) {
+    return std::any_of(deviceExtensions.begin(), deviceExtensions.end(),
+                       [name](const vk::ExtensionProperties &extension) {
+                         return strcmp(extension.extensionName, name) == 0;
+                       });
+  };
+  if (hasExtension(vk::EXTDescriptorBufferExtensionName)) {
+    auto supported = m_PhysicalDevice.getFeatures2<
+        vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features,
+        vk::PhysicalDeviceDescriptorBufferFeaturesEXT>();
+    m_DescriptorBufferSupported =
+        supported.get<vk::PhysicalDeviceVulkan12Features>()
+            .bufferDeviceAddress &&
+        supported.get<vk::PhysicalDeviceDescriptorBufferFeaturesEXT>()
+            .descriptorBuffer;
+  }
+  if (m_DescriptorBufferSupported) {
+    descriptorBufferFeatures.descriptorBuffer = vk::True;
+    extendedDynamicStateFeatures.pNext = &descriptorBufferFeatures;
+    vulkan12Features.bufferDeviceAddress = vk::True;
+
+    auto properties = m_PhysicalDevice.getProperties2<
+        vk::PhysicalDeviceProperties2,
+        vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+    m_DescriptorBufferProperties =
+        properties.get<vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+    m_DescriptorBufferProperties.pNext = nullptr;
+  }
+
+  // Task and mesh shaders for the meshlet path; without them meshlets are
+  // culled in compute and drawn through the vertex pipeline
+  vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures;
+  if (hasExtension(vk::EXTMeshShaderExtensionName)) {
+    auto supported = m_PhysicalDevice.getFeatures2<
+        vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+    const auto &meshShader =
+        supported.get<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+    m_MeshShaderSupported = meshShader.taskShader && meshShader.meshShader;
+  }
+  if (m_MeshShaderSupported) {
+    meshShaderFeatures.taskShader = vk::True;
+    meshShaderFeatures.meshShader = vk::True;
+    meshShaderFeatures.pNext = extendedDynamicStateFeatures.pNext;
+    extendedDynamicStateFeatures.pNext = &meshShaderFeatures;
+  }
+  // create a Device, one queue per distinct family
   float queuePriority = 0.0f;
-  vk::DeviceQueueCreateInfo deviceQueueCreateInfo{};
-  deviceQueueCreateInfo.queueFamilyIndex = m_GraphicsIndex;
-  deviceQueueCreateInfo.queueCount = 1;
-  deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+  std::vector<uint32_t> queueFamilies = {m_GraphicsIndex};
+  for (uint32_t family : {m_PresentIndex}) {
+    if (std::find(queueFamilies.begin(), queueFamilies.end(), family) ==
+        queueFamilies.end())
+      queueFamilies.push_back(family);
+  }
+  std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+  for (uint32_t family : queueFamilies) {
+    vk::DeviceQueueCreateInfo deviceQueueCreateInfo{};
+    deviceQueueCreateInfo.queueFamilyIndex = family;
+    deviceQueueCreateInfo.queueCount = 1;
+    deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+    queueCreateInfos.push_back(deviceQueueCreateInfo);
+  }
 
   vk::DeviceCreateInfo deviceCreateInfo{};
   deviceCreateInfo.pNext = &features;
-  deviceCreateInfo.queueCreateInfoCount = 1;
-  deviceCreateInfo.pQueueCreateInfos = &deviceQueueCreateInfo;
-  deviceCreateInfo.enabledExtensionCount =
-      static_cast<uint32_t>(m_RequiredDeviceExtensions.size());
-  deviceCreateInfo.ppEnabledExtensionNames = m_RequiredDeviceExtensions.data();
+  deviceCreateInfo.queueCreateInfoCount =
+      static_cast<uint32_t>(queueCreateInfos.size());
+  deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+
+  // Optional extensions, enabled on top of the required ones when present
+  std::vector<const char *> enabledExtensions = m_RequiredDeviceExtensions;
+  for (const auto &extension : deviceExtensions) {
+    if (strcmp(extension.extensionName, vk::EXTMemoryBudgetExtensionName) ==
+        0) {
+      m_MemoryBudgetSupported = true;
+      enabledExtensions.push_back(vk::EXTMemoryBudgetExtensionName);
+    }
+  }
+  if (m_DescriptorBufferSupported)
+    enabledExtensions.push_back(vk::EXTDescriptorBufferExtensionName);
+  if (m_MeshShaderSupported)
+    enabledExtensions.push_back(vk::EXTMeshShaderExtensionName);
 
-  deviceCreateInfo.ppEnabledExtensionNames = m_RequiredDeviceExtensions.data();
+  deviceCreateInfo.enabledExtensionCount =
+      static_cast<uint32_t>(enabledExtensions.size());
+  deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // m_Device = vk::Device(m_PhysicalDevice, deviceCreateInfo);
   m_Device = m_PhysicalDevice.createDevice(deviceCreateInfo);
   m_GraphicsQueue = m_Device.getQueue(m_GraphicsIndex, 0);
   m_PresentQueue = m_Device.getQueue(m_PresentIndex, 0);
+
+  m_MemoryProperties = m_PhysicalDevice.getMemoryProperties();
+  m_TypeUsage.assign(m_MemoryProperties.memoryTypeCount, MemoryUsage{});
+  m_HeapBudget.assign(m_MemoryProperties.memoryHeapCount, 0);
+  m_HeapDriverUsage.assign(m_MemoryProperties.memoryHeapCount, 0);
+  m_HeapUnderPressure.assign(m_MemoryProperties.memoryHeapCount, false);
+  UpdateMemoryBudget();
 }
 
 void Device::clean() {}
@@ -1,14 +1,65 @@
 #pragma once
 
+#include "../Descriptor/DescriptorLayoutCache.h"
 #include "../Instance/Instance.h"
+#include <array>
 #include <cstdint>
+#include <functional>
+#include <mutex>
 #include <vulkan/vulkan_raii.hpp>
 
 namespace Renderer {
 
+class DeviceMemory;
+
+// What an allocation backs, for the per-heap/per-type accounting
+enum class MemoryCategory : uint32_t { Buffer = 0, Image, Staging, Count };
+
+constexpr size_t MemoryCategoryCount =
+    static_cast<size_t>(MemoryCategory::Count);
+
+struct MemoryUsage {
+  std::array<vk::DeviceSize, MemoryCategoryCount> bytes{};
+  std::array<uint32_t, MemoryCategoryCount> allocations{};
+
+  vk::DeviceSize TotalBytes() const;
+  uint32_t TotalAllocations() const;
+};
+
+struct MemoryHeapStats {
+  vk::DeviceSize size = 0;
+  vk::MemoryHeapFlags flags;
+  // From VK_EXT_memory_budget when enabled, otherwise estimated from the heap
+  // size and our own accounting
+  vk::DeviceSize budget = 0;
+  vk::DeviceSize driverUsage = 0;
+  MemoryUsage usage;
+};
+
+struct MemoryTypeStats {
+  uint32_t heapIndex = 0;
+  vk::MemoryPropertyFlags flags;
+  MemoryUsage usage;
+};
+
+struct MemoryStats {
+  bool budgetExtension = false;
+  std::vector<MemoryHeapStats> heaps;
+  std::vector<MemoryTypeStats> types;
+};
+
+// Called when a heap crosses the pressure threshold (usage / budget), with
+// underPressure set, and again without it once the heap has dropped back
+// below the threshold
+using BudgetPressureCallback =
+    std::function<void(uint32_t heapIndex, const MemoryHeapStats &heap,
+                       bool underPressure)>;
+
 class Device {
 public:
   Device(Renderer::Instance &instance, const vk::SurfaceKHR &surface);
+  // Headless device: no surface, no swapchain support
+  Device(Renderer::Instance &instance);
   ~Device();
 
   vk::raii::PhysicalDevice &GetPhysicalDevice() { return m_PhysicalDevice; }
@@ -20,6 +71,20 @@ public:
   uint32_t FindMemoryType(uint32_t typeFilter,
                           vk::MemoryPropertyFlags properties);
 
+  const vk::PhysicalDeviceMemoryProperties &GetMemoryProperties() const {
+    return m_MemoryProperties;
+  }
+
+  // Memory accounting
+  bool HasMemoryBudget() const { return m_MemoryBudgetSupported; }
+  MemoryStats GetMemoryStats();
+  // Re-queries the driver budget and checks the heaps against the pressure
+  // threshold; call once per frame. Allocations in between only update the
+  // accounting, so pressure is noticed at the next call.
+  void UpdateMemoryBudget();
+  void SetBudgetPressureCallback(float threshold,
+                                 BudgetPressureCallback callback);
+
   // TODO: HACK implementation, remove for a queue handler
   vk::raii::Queue GetGraphicsQueue() { return m_GraphicsQueue; }
   vk::raii::Queue GetPresentQueue() { return m_PresentQueue; }
@@ -27,8 +92,38 @@ public:
   uint32_t GetGraphicsIndex() { return m_GraphicsIndex; }
   uint32_t GetPresentIndex() { return m_PresentIndex; }
 
+  bool HasMultiDrawIndirect() const { return m_MultiDrawIndirect; }
+
+  // VK_EXT_descriptor_buffer, with bufferDeviceAddress enabled alongside
+  bool HasDescriptorBuffer() const { return m_DescriptorBufferSupported; }
+  const vk::PhysicalDeviceDescriptorBufferPropertiesEXT &
+  GetDescriptorBufferProperties() const {
+    return m_DescriptorBufferProperties;
+  }
+
+  // VK_EXT_mesh_shader with task and mesh shaders enabled
+  bool HasMeshShader() const { return m_MeshShaderSupported; }
+
+  // Deduplicated by bindings and owned by the device, so sets allocated for
+  // one pipeline work with any other that declares the same bindings
+  vk::DescriptorSetLayout
+  GetDescriptorSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings,
+                         vk::DescriptorSetLayoutCreateFlags flags = {}) {
+    return m_DescriptorLayouts.Get(m_Device, std::move(bindings), flags);
+  }
+
   void clean();
 
+private:
+  friend class DeviceMemory; // For allocation tracking
+
+  void TrackAllocation(uint32_t memoryTypeIndex, vk::DeviceSize size,
+                       MemoryCategory category);
+  void TrackFree(uint32_t memoryTypeIndex, vk::DeviceSize size,
+                 MemoryCategory category);
+  void CheckBudgetPressure();
+  MemoryStats CollectMemoryStats() const; // m_MemoryMutex must be held
+
 private:
   vk::raii::PhysicalDevice m_PhysicalDevice = nullptr;
   vk::raii::Device m_Device = nullptr;
@@ -47,5 +142,24 @@ private:
 
   uint32_t m_GraphicsIndex;
   uint32_t m_PresentIndex;
+
+  bool m_MultiDrawIndirect = false;
+  bool m_DescriptorBufferSupported = false;
+  vk::PhysicalDeviceDescriptorBufferPropertiesEXT m_DescriptorBufferProperties;
+  bool m_MeshShaderSupported = false;
+
+  vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+  bool m_MemoryBudgetSupported = false;
+
+  std::mutex m_MemoryMutex;
+  std::vector<MemoryUsage> m_TypeUsage;
+  std::vector<vk::DeviceSize> m_HeapBudget;
+  std::vector<vk::DeviceSize> m_HeapDriverUsage;
+  std::vector<bool> m_HeapUnderPressure;
+  float m_PressureThreshold = 0.9f;
+  BudgetPressureCallback m_PressureCallback;
+
+  // After m_Device, so the layouts are destroyed first
+  DescriptorLayoutCache m_DescriptorLayouts;
 };
 } // namespace Renderer
@@ -0,0 +1,45 @@
+#include "DeviceMemory.h"
+#include <utility>
+
+namespace Renderer {
+
+DeviceMemory::DeviceMemory(Renderer::Device &device,
+                           const vk::MemoryAllocateInfo &allocInfo,
+                           MemoryCategory category)
+    : m_Device(&device), m_Memory(device.GetDevice(), allocInfo),
+      m_Size(allocInfo.allocationSize),
+      m_MemoryTypeIndex(allocInfo.memoryTypeIndex), m_Category(category) {
+  m_Device->TrackAllocation(m_MemoryTypeIndex, m_Size, m_Category);
+}
+
+DeviceMemory::~DeviceMemory() { clear(); }
+
+DeviceMemory::DeviceMemory(DeviceMemory &&other) noexcept
+    : m_Device(std::exchange(other.m_Device, nullptr)),
+      m_Memory(std::move(other.m_Memory)),
+      m_Size(std::exchange(other.m_Size, 0)),
+      m_MemoryTypeIndex(other.m_MemoryTypeIndex), m_Category(other.m_Category) {
+}
+
+DeviceMemory &DeviceMemory::operator=(DeviceMemory &&other) noexcept {
+  if (this != &other) {
+    clear();
+    m_Device = std::exchange(other.m_Device, nullptr);
+    m_Memory = std::move(other.m_Memory);
+    m_Size = std::exchange(other.m_Size, 0);
+    m_MemoryTypeIndex = other.m_MemoryTypeIndex;
+    m_Category = other.m_Category;
+  }
+  return *this;
+}
+
+void DeviceMemory::clear() {
+  if (m_Device && *m_Memory) {
+    m_Device->TrackFree(m_MemoryTypeIndex, m_Size, m_Category);
+  }
+  m_Memory.clear();
+  m_Device = nullptr;
+  m_Size = 0;
+}
+
+} // namespace Renderer
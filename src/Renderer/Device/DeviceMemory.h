@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Device.h"
+#include <cstddef>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer {
+
+// vk::raii::DeviceMemory that reports its allocation and release to the
+// owning Device's memory accounting
+class DeviceMemory {
+public:
+  DeviceMemory(std::nullptr_t) {}
+  DeviceMemory(Renderer::Device &device,
+               const vk::MemoryAllocateInfo &allocInfo,
+               MemoryCategory category);
+  ~DeviceMemory();
+
+  DeviceMemory(const DeviceMemory &) = delete;
+  DeviceMemory &operator=(const DeviceMemory &) = delete;
+  DeviceMemory(DeviceMemory &&other) noexcept;
+  DeviceMemory &operator=(DeviceMemory &&other) noexcept;
+
+  void *mapMemory(vk::DeviceSize offset, vk::DeviceSize size) const {
+    return m_Memory.mapMemory(offset, size);
+  }
+  void unmapMemory() const { m_Memory.unmapMemory(); }
+
+  void clear();
+
+  vk::DeviceMemory operator*() const { return *m_Memory; }
+  const vk::raii::DeviceMemory &Get() const { return m_Memory; }
+
+  vk::DeviceSize GetSize() const { return m_Size; }
+  uint32_t GetMemoryTypeIndex() const { return m_MemoryTypeIndex; }
+  MemoryCategory GetCategory() const { return m_Category; }
+
+private:
+  Renderer::Device *m_Device = nullptr;
+  vk::raii::DeviceMemory m_Memory = nullptr;
+
+  vk::DeviceSize m_Size = 0;
+  uint32_t m_MemoryTypeIndex = 0;
+  MemoryCategory m_Category = MemoryCategory::Buffer;
+};
+
+} // namespace Renderer
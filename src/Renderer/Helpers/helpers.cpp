@@ -1,4 +1,6 @@
 #include "helpers.h"
+#include <algorithm>
+#include <cmath>
 #include <vulkan/vulkan_raii.hpp>
 
 namespace Renderer {
@@ -6,10 +8,11 @@ namespace Renderer {
 void createImage(Device &device, uint32_t width, uint32_t height,
                  vk::Format format, vk::ImageTiling tiling,
                  vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties,
-                 vk::raii::Image &image, vk::raii::DeviceMemory &imageMemory) {
+                 vk::raii::Image &image, Renderer::DeviceMemory &imageMemory,
+                 uint32_t mipLevels, uint32_t arrayLayers) {
 
   vk::ImageCreateInfo imageInfo({}, vk::ImageType::e2D, format,
-                                {width, height, 1}, 1, 1,
+                                {width, height, 1}, mipLevels, arrayLayers,
                                 vk::SampleCountFlagBits::e1, tiling, usage,
                                 vk::SharingMode::eExclusive, 0);
 
@@ -19,16 +22,18 @@ void createImage(Device &device, uint32_t width, uint32_t height,
   vk::MemoryAllocateInfo allocInfo(
       memRequirements.size,
       device.FindMemoryType(memRequirements.memoryTypeBits, properties));
-  imageMemory = vk::raii::DeviceMemory(device.GetDevice(), allocInfo);
+  imageMemory =
+      Renderer::DeviceMemory(device, allocInfo, MemoryCategory::Image);
   image.bindMemory(*imageMemory, 0);
 }
 
 vk::raii::ImageView createImageView(Device &device, vk::raii::Image &image,
                                     vk::Format format,
-                                    vk::ImageAspectFlagBits aspect) {
+                                    vk::ImageAspectFlagBits aspect,
+                                    uint32_t mipLevels) {
 
   vk::ImageViewCreateInfo viewInfo({}, image, vk::ImageViewType::e2D, format,
-                                   {}, {aspect, 0, 1, 0, 1});
+                                   {}, {aspect, 0, mipLevels, 0, 1});
   return vk::raii::ImageView(device.GetDevice(), viewInfo);
 }
 
@@ -111,4 +116,48 @@ bool hasStencilComponent(vk::Format format) {
          format == vk::Format::eD24UnormS8Uint;
 }
 
+uint32_t getMipLevelCount(uint32_t width, uint32_t height) {
+  return static_cast<uint32_t>(
+             std::floor(std::log2(std::max(width, height)))) +
+         1;
+}
+
+std::vector<std::vector<unsigned char>>
+generateMipChain(const unsigned char *data, uint32_t width, uint32_t height,
+                 uint32_t mipLevels) {
+  std::vector<std::vector<unsigned char>> chain(mipLevels);
+  chain[0].assign(data, data + static_cast<size_t>(width) * height * 4);
+
+  // Edges of odd sized levels are clamped
+  for (uint32_t level = 1; level < mipLevels; level++) {
+    const std::vector<unsigned char> &src = chain[level - 1];
+    uint32_t srcWidth = std::max(1u, width >> (level - 1));
+    uint32_t srcHeight = std::max(1u, height >> (level - 1));
+    uint32_t dstWidth = std::max(1u, width >> level);
+    uint32_t dstHeight = std::max(1u, height >> level);
+
+    std::vector<unsigned char> &dst = chain[level];
+    dst.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+      uint32_t y0 = std::min(2 * y, srcHeight - 1);
+      uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+      for (uint32_t x = 0; x < dstWidth; x++) {
+        uint32_t x0 = std::min(2 * x, srcWidth - 1);
+        uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+        for (uint32_t c = 0; c < 4; c++) {
+          uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] +
+                         src[(y0 * srcWidth + x1) * 4 + c] +
+                         src[(y1 * srcWidth + x0) * 4 + c] +
+                         src[(y1 * srcWidth + x1) * 4 + c];
+          dst[(y * dstWidth + x) * 4 + c] =
+              static_cast<unsigned char>((sum + 2) / 4);
+        }
+      }
+    }
+  }
+
+  return chain;
+}
+
 } // namespace Renderer
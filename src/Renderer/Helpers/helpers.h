@@ -1,21 +1,25 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 #include <vulkan/vulkan_raii.hpp>
 
 #include "../Command/CommandPool.h"
 #include "../Device/Device.h"
+#include "../Device/DeviceMemory.h"
 
 namespace Renderer {
 
 void createImage(Device &device, uint32_t width, uint32_t height,
                  vk::Format format, vk::ImageTiling tiling,
                  vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties,
-                 vk::raii::Image &image, vk::raii::DeviceMemory &imageMemory);
+                 vk::raii::Image &image, Renderer::DeviceMemory &imageMemory,
+                 uint32_t mipLevels = 1, uint32_t arrayLayers = 1);
 
 vk::raii::ImageView createImageView(Device &device, vk::raii::Image &image,
                                     vk::Format format,
-                                    vk::ImageAspectFlagBits aspect);
+                                    vk::ImageAspectFlagBits aspect,
+                                    uint32_t mipLevels = 1);
 
 void transitionImageLayout(Device &device, CommandPool &commandPool,
                            vk::Format format, vk::ImageLayout oldLayout,
@@ -23,4 +27,12 @@ void transitionImageLayout(Device &device, CommandPool &commandPool,
 
 bool hasStencilComponent(vk::Format format);
 
+// Number of levels in a full mip chain down to 1x1
+uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+// CPU mip chain of an RGBA8 image (2x2 box filter), level 0 included
+std::vector<std::vector<unsigned char>>
+generateMipChain(const unsigned char *data, uint32_t width, uint32_t height,
+                 uint32_t mipLevels);
+
 } // namespace Renderer
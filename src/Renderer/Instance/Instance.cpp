@@ -11,12 +11,16 @@ constexpr bool enableValidationLayers = false;
 constexpr bool enableValidationLayers = true;
 #endif
 
-std::vector<const char *> getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-  if (enableValidationLayers) {
+std::vector<const char *> getRequiredExtensions(bool headless,
+                                               bool validation) {
+  std::vector<const char *> extensions;
+  if (!headless) {
+    uint32_t glfwExtensionCount = 0;
+    auto glfwExtensions =
+        glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
+  if (validation) {
     extensions.push_back(vk::EXTDebugUtilsExtensionName);
   }
 
@@ -33,7 +37,7 @@ static VKAPI_ATTR vk::Bool32 VKAPI_CALL debugCallback(
 }
 
 void Instance::SetupDebugMessenger() {
-  if (!enableValidationLayers)
+  if (!m_Validation)
     return;
 
   vk::DebugUtilsMessageSeverityFlagsEXT severityFlags(
@@ -84,10 +88,11 @@ void Instance::SetupDebugMessenger() {
 //             << std::endl;
 // }
 
-Instance::Instance(const char *appName) {
+Instance::Instance(const char *appName, bool headless, bool validation)
+    : m_Validation(enableValidationLayers && validation) {
 
   std::cout << "Creating Vulkan instance with validation layers: "
-            << (enableValidationLayers ? "ENABLED" : "DISABLED") << std::endl;
+            << (m_Validation ? "ENABLED" : "DISABLED") << std::endl;
 
   vk::ApplicationInfo appInfo{};
   appInfo.pApplicationName = appName;
@@ -98,7 +103,7 @@ Instance::Instance(const char *appName) {
 
   // Setup validation layers
   std::vector<const char *> requiredLayers;
-  if (enableValidationLayers) {
+  if (m_Validation) {
     requiredLayers.assign(validationLayers.begin(), validationLayers.end());
     std::cout << "Validation layers to enable:" << std::endl;
     for (const auto &layer : requiredLayers) {
@@ -129,7 +134,7 @@ Instance::Instance(const char *appName) {
   }
 
   // Get required extensions
-  auto extensions = getRequiredExtensions();
+  auto extensions = getRequiredExtensions(headless, m_Validation);
   uint32_t extensionCount = static_cast<uint32_t>(extensions.size());
 
   std::cout << "Required extensions:" << std::endl;
@@ -169,7 +174,7 @@ Instance::Instance(const char *appName) {
 
   // Setup debug messenger info for instance creation validation
   vk::DebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
-  if (enableValidationLayers) {
+  if (m_Validation) {
     debugCreateInfo.messageSeverity =
         vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose |
         vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
@@ -189,7 +194,7 @@ Instance::Instance(const char *appName) {
   // Setup persistent debug messenger
   SetupDebugMessenger();
 
-  if (enableValidationLayers) {
+  if (m_Validation) {
     std::cout << "Debug messenger created successfully!" << std::endl;
     std::cout << "Validation layers are now active and monitoring."
               << std::endl;
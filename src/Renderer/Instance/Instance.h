@@ -6,7 +6,12 @@
 namespace Renderer {
 class Instance {
 public:
-  Instance(const char *appName);
+  // A headless instance skips the GLFW surface extensions, so it can be
+  // created without a window (benchmarks, offscreen tools). Validation
+  // layers are only ever enabled in debug builds; pass validation = false to
+  // keep them off there too, e.g. where timings matter.
+  Instance(const char *appName, bool headless = false,
+           bool validation = true);
   ~Instance();
 
   vk::Instance Get() { return *m_Handler; }
@@ -20,6 +25,7 @@ private:
   void SetupDebugMessenger();
 
 private:
+  bool m_Validation = false;
   vk::raii::Instance m_Handler = nullptr;
   vk::raii::DebugUtilsMessengerEXT m_DebugMessenger = nullptr; // Fixed type
   const std::vector<const char *> validationLayers = {
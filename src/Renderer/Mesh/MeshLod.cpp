@@ -0,0 +1,365 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Renderer {
+
+namespace {
+// Boundary edges get a plane perpendicular to their triangle, weighted well
+// above the surface planes so open borders don't shrink
+constexpr double BOUNDARY_WEIGHT = 10.0;
+
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0;
+  double b2 = 0, bc = 0, bd = 0;
+  double c2 = 0, cd = 0;
+  double d2 = 0;
+  double weight = 0;
+
+  void AddPlane(const glm::vec3 &normal, float distance, double w) {
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    a2 += w * a * a;
+    ab += w * a * b;
+    ac += w * a * c;
+    ad += w * a * d;
+    b2 += w * b * b;
+    bc += w * b * c;
+    bd += w * b * d;
+    c2 += w * c * c;
+    cd += w * c * d;
+    d2 += w * d * d;
+    weight += w;
+  }
+
+  void Add(const Quadric &other) {
+    a2 += other.a2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    b2 += other.b2;
+    bc += other.bc;
+    bd += other.bd;
+    c2 += other.c2;
+    cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+  }
+
+  // Weighted mean squared distance from p to the accumulated planes
+  double Evaluate(const glm::vec3 &p) const {
+    double x = p.x, y = p.y, z = p.z;
+    double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z +
+                   2 * ad * x + b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                   c2 * z * z + 2 * cd * z + d2;
+    return weight > 0 ? std::max(error, 0.0) / weight : 0.0;
+  }
+};
+
+struct PositionKey {
+  uint32_t x, y, z;
+  bool operator==(const PositionKey &other) const {
+    return x == other.x && y == other.y && z == other.z;
+  }
+};
+
+struct PositionKeyHash {
+  size_t operator()(const PositionKey &key) const {
+    return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+  return (static_cast<uint64_t>(a) << 32) | b;
+}
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(const float *positions, size_t vertexCount,
+                                   size_t positionStride,
+                                   const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float maxError,
+                                   float *outError) {
+  std::vector<glm::vec3> position(vertexCount);
+  const auto *base = reinterpret_cast<const unsigned char *>(positions);
+  for (size_t v = 0; v < vertexCount; ++v)
+    memcpy(&position[v], base + v * positionStride, sizeof(glm::vec3));
+
+  // Seam vertices would need their twins to collapse the same way, keep them
+  std::vector<uint8_t> locked(vertexCount, 0);
+  std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstAtPosition;
+  for (size_t v = 0; v < vertexCount; ++v) {
+    PositionKey key{};
+    memcpy(&key, &position[v], sizeof(key));
+    auto [it, inserted] =
+        firstAtPosition.emplace(key, static_cast<uint32_t>(v));
+    if (!inserted) {
+      locked[v] = 1;
+      locked[it->second] = 1;
+    }
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  std::unordered_set<uint64_t> directedEdges;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    for (int e = 0; e < 3; ++e)
+      directedEdges.insert(EdgeKey(indices[i + e], indices[i + (e + 1) % 3]));
+  }
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const uint32_t tri[3] = {indices[i], indices[i + 1], indices[i + 2]};
+    glm::vec3 normal = glm::cross(position[tri[1]] - position[tri[0]],
+                                  position[tri[2]] - position[tri[0]]);
+    float doubleArea = glm::length(normal);
+    if (doubleArea == 0.0f)
+      continue;
+    normal /= doubleArea;
+
+    float distance = -glm::dot(normal, position[tri[0]]);
+    for (uint32_t v : tri)
+      quadrics[v].AddPlane(normal, distance, doubleArea * 0.5);
+
+    for (int e = 0; e < 3; ++e) {
+      uint32_t a = tri[e];
+      uint32_t b = tri[(e + 1) % 3];
+      if (directedEdges.count(EdgeKey(b, a)))
+        continue;
+      glm::vec3 edge = position[b] - position[a];
+      float edgeLength = glm::length(edge);
+      if (edgeLength == 0.0f)
+        continue;
+      glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+      float edgeDistance = -glm::dot(edgeNormal, position[a]);
+      double weight = BOUNDARY_WEIGHT * edgeLength * edgeLength;
+      quadrics[a].AddPlane(edgeNormal, edgeDistance, weight);
+      quadrics[b].AddPlane(edgeNormal, edgeDistance, weight);
+    }
+  }
+
+  std::vector<uint32_t> result = indices;
+  float error = 0.0f;
+  const size_t targetTriangles = targetIndexCount / 3;
+
+  std::vector<uint32_t> adjacencyOffsets;
+  std::vector<uint32_t> adjacency;
+  std::vector<uint64_t> edges;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<uint8_t> touched(vertexCount);
+
+  // Each pass collapses the cheapest independent edges, then rebuilds
+  while (result.size() / 3 > targetTriangles) {
+    const size_t triangleCount = result.size() / 3;
+
+    // Vertex -> triangle adjacency
+    adjacencyOffsets.assign(vertexCount + 1, 0);
+    for (uint32_t v : result)
+      adjacencyOffsets[v + 1]++;
+    for (size_t v = 0; v < vertexCount; ++v)
+      adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    adjacency.resize(result.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(),
+                               adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < result.size(); ++i)
+      adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+
+    edges.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+      for (int e = 0; e < 3; ++e) {
+        uint32_t a = result[i + e];
+        uint32_t b = result[i + (e + 1) % 3];
+        edges.push_back(EdgeKey(std::min(a, b), std::max(a, b)));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    collapses.clear();
+    for (uint64_t key : edges) {
+      uint32_t a = static_cast<uint32_t>(key >> 32);
+      uint32_t b = static_cast<uint32_t>(key & 0xffffffffu);
+      Quadric q = quadrics[a];
+      q.Add(quadrics[b]);
+      double costAB = locked[a] ? std::numeric_limits<double>::infinity()
+                                : q.Evaluate(position[b]);
+      double costBA = locked[b] ? std::numeric_limits<double>::infinity()
+                                : q.Evaluate(position[a]);
+      if (costAB <= costBA && !locked[a]) {
+        collapses.push_back({a, b, costAB});
+      } else if (!locked[b]) {
+        collapses.push_back({b, a, costBA});
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse &x, const Collapse &y) {
+                return x.cost < y.cost;
+              });
+
+    for (size_t v = 0; v < vertexCount; ++v)
+      remap[v] = static_cast<uint32_t>(v);
+    std::fill(touched.begin(), touched.end(), 0);
+
+    size_t trianglesLeft = triangleCount;
+    bool collapsed = false;
+    for (const Collapse &collapse : collapses) {
+      if (trianglesLeft <= targetTriangles)
+        break;
+      float distance = static_cast<float>(std::sqrt(collapse.cost));
+      if (distance > maxError)
+        break; // sorted, everything after costs more
+      if (touched[collapse.from] || touched[collapse.to])
+        continue;
+
+      // Reject collapses that fold a surviving triangle over
+      bool flips = false;
+      size_t removed = 0;
+      for (uint32_t k = adjacencyOffsets[collapse.from];
+           k < adjacencyOffsets[collapse.from + 1] && !flips; ++k) {
+        const uint32_t *tri = &result[adjacency[k] * 3];
+        if (tri[0] == collapse.to || tri[1] == collapse.to ||
+            tri[2] == collapse.to) {
+          removed++;
+          continue;
+        }
+        glm::vec3 p[3], q[3];
+        for (int c = 0; c < 3; ++c) {
+          p[c] = position[tri[c]];
+          q[c] = tri[c] == collapse.from ? position[collapse.to] : p[c];
+        }
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        flips = glm::dot(before, after) <= 0.0f;
+      }
+      if (flips)
+        continue;
+
+      // Freeze every triangle around the moved vertex for the rest of the
+      // pass, so later flip tests in this pass see up to date positions
+      for (uint32_t k = adjacencyOffsets[collapse.from];
+           k < adjacencyOffsets[collapse.from + 1]; ++k) {
+        const uint32_t *tri = &result[adjacency[k] * 3];
+        touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+      }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].Add(quadrics[collapse.from]);
+      trianglesLeft -= std::min(removed, trianglesLeft);
+      error = std::max(error, distance);
+      collapsed = true;
+    }
+    if (!collapsed)
+      break;
+
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      uint32_t a = remap[result[i]];
+      uint32_t b = remap[result[i + 1]];
+      uint32_t c = remap[result[i + 2]];
+      if (a == b || b == c || a == c)
+        continue;
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  if (outError)
+    *outError = error;
+  return result;
+}
+
+LodChain GenerateLodChain(const float *positions, size_t vertexCount,
+                          size_t positionStride,
+                          const std::vector<uint32_t> &indices,
+                          uint32_t maxLods, float reduction, float maxError) {
+  LodChain chain;
+  chain.indices = indices;
+  chain.lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+  // Error bound in mesh units, from the bounding sphere around the centroid
+  const auto *base = reinterpret_cast<const unsigned char *>(positions);
+  auto positionAt = [&](uint32_t v) {
+    glm::vec3 p;
+    memcpy(&p, base + v * positionStride, sizeof(p));
+    return p;
+  };
+  glm::vec3 center(0.0f);
+  for (uint32_t v : indices)
+    center += positionAt(v);
+  center /= static_cast<float>(std::max<size_t>(indices.size(), 1));
+  float radius = 0.0f;
+  for (uint32_t v : indices)
+    radius = std::max(radius, glm::length(positionAt(v) - center));
+  const float errorLimit = maxError * radius;
+
+  std::vector<uint32_t> current = indices;
+  float error = 0.0f;
+  for (uint32_t level = 1; level < maxLods; ++level) {
+    size_t targetTriangles = static_cast<size_t>(
+        static_cast<float>(current.size() / 3) * reduction);
+    if (targetTriangles == 0)
+      break;
+
+    float levelError = 0.0f;
+    std::vector<uint32_t> next =
+        SimplifyMesh(positions, vertexCount, positionStride, current,
+                     targetTriangles * 3, errorLimit, &levelError);
+    if (next.empty() ||
+        static_cast<float>(next.size()) >
+            static_cast<float>(current.size()) * 0.9f)
+      break;
+
+    // Each level is simplified from the previous one, so deviations add up
+    error += levelError;
+    chain.lods.push_back({static_cast<uint32_t>(chain.indices.size()),
+                          static_cast<uint32_t>(next.size()), error});
+    chain.indices.insert(chain.indices.end(), next.begin(), next.end());
+    current = std::move(next);
+  }
+  return chain;
+}
+
+LodSelector::LodSelector(float pixelThreshold, float hysteresis)
+    : m_PixelThreshold(pixelThreshold), m_Hysteresis(hysteresis) {}
+
+void LodSelector::SetProjection(const glm::mat4 &proj, float viewportHeight) {
+  m_ProjectionScale = std::fabs(proj[1][1]) * viewportHeight * 0.5f;
+}
+
+float LodSelector::GetScreenError(const MeshLod &lod, float distance,
+                                  float scale) const {
+  return lod.error * scale / std::max(distance, 1e-4f) * m_ProjectionScale;
+}
+
+uint32_t LodSelector::Select(const std::vector<MeshLod> &lods, float distance,
+                             uint32_t currentLod, float scale) const {
+  if (lods.empty() || distance <= 0.0f)
+    return 0;
+
+  uint32_t target = 0;
+  for (uint32_t i = static_cast<uint32_t>(lods.size()); i-- > 0;) {
+    if (GetScreenError(lods[i], distance, scale) <= m_PixelThreshold) {
+      target = i;
+      break;
+    }
+  }
+
+  // Refining happens right away, coarsening only once well inside the band
+  const float coarsenThreshold = m_PixelThreshold * (1.0f - m_Hysteresis);
+  while (target > currentLod &&
+         GetScreenError(lods[target], distance, scale) > coarsenThreshold)
+    target--;
+  return target;
+}
+
+} // namespace Renderer
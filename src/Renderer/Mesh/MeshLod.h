@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Renderer {
+
+// One level of detail: a range of the shared LOD index buffer
+struct MeshLod {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  // Object space geometric deviation from level 0, in mesh units
+  float error = 0.0f;
+};
+
+struct LodChain {
+  // All levels back to back, every one indexing the original vertex buffer
+  std::vector<uint32_t> indices;
+  std::vector<MeshLod> lods;
+};
+
+// Quadric error metric (Garland/Heckbert) edge collapse. Vertices only ever
+// collapse onto an existing neighbour, so the result indexes the same vertex
+// buffer. Vertices that share a position with another vertex (UV or normal
+// seams) are kept in place and open boundaries are held by extra quadrics.
+//
+// Stops at targetIndexCount or once the next collapse would exceed maxError
+// (same units as the positions). Writes the error reached to outError.
+std::vector<uint32_t> SimplifyMesh(const float *positions, size_t vertexCount,
+                                   size_t positionStride,
+                                   const std::vector<uint32_t> &indices,
+                                   size_t targetIndexCount, float maxError,
+                                   float *outError = nullptr);
+
+// Level 0 is `indices` itself; each further level aims for `reduction` of
+// the previous one's triangles. maxError is relative to the mesh's bounding
+// radius. The chain ends early when a level can't get below 90% of its
+// parent within that error.
+LodChain GenerateLodChain(const float *positions, size_t vertexCount,
+                          size_t positionStride,
+                          const std::vector<uint32_t> &indices,
+                          uint32_t maxLods = 5, float reduction = 0.5f,
+                          float maxError = 0.05f);
+
+// Picks the coarsest level whose error projects to at most pixelThreshold
+// pixels. Moving to a coarser level additionally requires the error to drop
+// below pixelThreshold * (1 - hysteresis), so objects near a boundary don't
+// flip levels every frame.
+class LodSelector {
+public:
+  explicit LodSelector(float pixelThreshold = 1.0f, float hysteresis = 0.25f);
+
+  // Pixels per unit of error at distance 1, from the projection's vertical
+  // scale (proj[1][1]) and the viewport height
+  void SetProjection(const glm::mat4 &proj, float viewportHeight);
+
+  float GetScreenError(const MeshLod &lod, float distance,
+                       float scale = 1.0f) const;
+
+  // distance: camera to bounding sphere center, minus its radius
+  uint32_t Select(const std::vector<MeshLod> &lods, float distance,
+                  uint32_t currentLod, float scale = 1.0f) const;
+
+private:
+  float m_PixelThreshold;
+  float m_Hysteresis;
+  float m_ProjectionScale = 1.0f;
+};
+
+} // namespace Renderer
@@ -0,0 +1,237 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+// Cone cutoff that no dot product reaches, so the meshlet is never culled
+constexpr float NO_CONE_CULL = 2.0f;
+
+constexpr uint32_t UNASSIGNED = ~0u;
+
+// Triangles around each vertex, CSR style
+struct Adjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+  // Triangles around the vertex not yet placed in a meshlet
+  std::vector<uint32_t> liveCounts;
+};
+
+Adjacency BuildAdjacency(const std::vector<uint32_t> &indices,
+                         size_t vertexCount) {
+  Adjacency adjacency;
+  adjacency.offsets.assign(vertexCount + 1, 0);
+  for (uint32_t index : indices)
+    adjacency.offsets[index + 1]++;
+  for (size_t v = 0; v < vertexCount; ++v)
+    adjacency.offsets[v + 1] += adjacency.offsets[v];
+  adjacency.liveCounts.resize(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v)
+    adjacency.liveCounts[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> cursor(adjacency.offsets.begin(),
+                               adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); ++i)
+    adjacency.triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  return adjacency;
+}
+
+void ComputeBounds(Meshlet &meshlet, const MeshletMesh &mesh,
+                   const std::vector<glm::vec3> &position) {
+  const uint32_t *vertices = mesh.vertices.data() + meshlet.vertexOffset;
+  const uint32_t *triangles = mesh.triangles.data() + meshlet.triangleOffset;
+
+  // Centroid sphere: not minimal, but cheap and within a few percent for
+  // the compact clusters the builder produces
+  glm::vec3 center(0.0f);
+  for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    center += position[vertices[i]];
+  center /= static_cast<float>(meshlet.vertexCount);
+  float radius = 0.0f;
+  for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+    radius = std::max(radius, glm::length(position[vertices[i]] - center));
+  meshlet.sphere = glm::vec4(center, radius);
+
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet.triangleCount);
+  std::vector<glm::vec3> corners;
+  corners.reserve(meshlet.triangleCount);
+  glm::vec3 axis(0.0f);
+  for (uint32_t t = 0; t < meshlet.triangleCount; ++t) {
+    uint32_t packed = triangles[t];
+    glm::vec3 p0 = position[vertices[packed & 0xff]];
+    glm::vec3 p1 = position[vertices[(packed >> 8) & 0xff]];
+    glm::vec3 p2 = position[vertices[(packed >> 16) & 0xff]];
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float area = glm::length(normal);
+    if (area == 0.0f)
+      continue;
+    normals.push_back(normal / area);
+    corners.push_back(p0);
+    axis += normals.back();
+  }
+
+  meshlet.coneApex = glm::vec4(center, 0.0f);
+  meshlet.coneAxis = glm::vec4(0.0f, 0.0f, 1.0f, NO_CONE_CULL);
+  float axisLength = glm::length(axis);
+  if (normals.empty() || axisLength == 0.0f)
+    return;
+  axis /= axisLength;
+
+  float minDot = 1.0f;
+  for (const glm::vec3 &normal : normals)
+    minDot = std::min(minDot, glm::dot(axis, normal));
+  // Normals spanning a hemisphere or more: some triangle always faces the
+  // viewer
+  if (minDot <= 0.1f)
+    return;
+
+  // Slide the apex back along the axis until every triangle plane is in
+  // front of it, so the cone test is conservative for all of them
+  float maxT = 0.0f;
+  for (size_t i = 0; i < normals.size(); ++i) {
+    float denominator = glm::dot(axis, normals[i]);
+    float t = glm::dot(center - corners[i], normals[i]) / denominator;
+    maxT = std::max(maxT, t);
+  }
+  meshlet.coneApex = glm::vec4(center - axis * maxT, 0.0f);
+  meshlet.coneAxis =
+      glm::vec4(axis, std::sqrt(std::max(0.0f, 1.0f - minDot * minDot)));
+}
+} // namespace
+
+std::vector<uint32_t> MeshletMesh::BuildIndexBuffer() const {
+  std::vector<uint32_t> indices;
+  indices.reserve(triangles.size() * 3);
+  for (const Meshlet &meshlet : meshlets) {
+    const uint32_t *local = vertices.data() + meshlet.vertexOffset;
+    for (uint32_t t = 0; t < meshlet.triangleCount; ++t) {
+      uint32_t packed = triangles[meshlet.triangleOffset + t];
+      indices.push_back(local[packed & 0xff]);
+      indices.push_back(local[(packed >> 8) & 0xff]);
+      indices.push_back(local[(packed >> 16) & 0xff]);
+    }
+  }
+  return indices;
+}
+
+MeshletMesh BuildMeshlets(const float *positions, size_t vertexCount,
+                          size_t positionStride,
+                          const std::vector<uint32_t> &indices,
+                          uint32_t maxVertices, uint32_t maxTriangles) {
+  if (maxVertices < 3 || maxVertices > 256 || maxTriangles == 0)
+    throw std::runtime_error("invalid meshlet limits");
+  if (indices.size() % 3 != 0)
+    throw std::runtime_error("meshlet input is not a triangle list");
+  for (uint32_t index : indices) {
+    if (index >= vertexCount)
+      throw std::runtime_error("meshlet input index out of range");
+  }
+
+  std::vector<glm::vec3> position(vertexCount);
+  const auto *base = reinterpret_cast<const unsigned char *>(positions);
+  for (size_t v = 0; v < vertexCount; ++v)
+    memcpy(&position[v], base + v * positionStride, sizeof(glm::vec3));
+
+  const size_t triangleCount = indices.size() / 3;
+  Adjacency adjacency = BuildAdjacency(indices, vertexCount);
+  std::vector<uint8_t> emitted(triangleCount, 0);
+  // Meshlet-local slot of each vertex in the meshlet being built
+  std::vector<uint32_t> localIndex(vertexCount, UNASSIGNED);
+
+  MeshletMesh mesh;
+  mesh.meshlets.reserve(triangleCount / maxTriangles + 1);
+  mesh.triangles.reserve(triangleCount);
+
+  Meshlet current{};
+  auto finish = [&]() {
+    if (current.triangleCount == 0)
+      return;
+    for (uint32_t i = 0; i < current.vertexCount; ++i)
+      localIndex[mesh.vertices[current.vertexOffset + i]] = UNASSIGNED;
+    ComputeBounds(current, mesh, position);
+    mesh.meshlets.push_back(current);
+    current = Meshlet{};
+    current.vertexOffset = static_cast<uint32_t>(mesh.vertices.size());
+    current.triangleOffset = static_cast<uint32_t>(mesh.triangles.size());
+  };
+
+  auto newVertices = [&](size_t triangle) {
+    uint32_t count = 0;
+    for (size_t k = 0; k < 3; ++k)
+      count += localIndex[indices[triangle * 3 + k]] == UNASSIGNED;
+    return count;
+  };
+
+  auto emit = [&](size_t triangle) {
+    if (current.vertexCount + newVertices(triangle) > maxVertices ||
+        current.triangleCount == maxTriangles)
+      finish();
+
+    uint32_t packed = 0;
+    for (size_t k = 0; k < 3; ++k) {
+      uint32_t vertex = indices[triangle * 3 + k];
+      if (localIndex[vertex] == UNASSIGNED) {
+        localIndex[vertex] = current.vertexCount++;
+        mesh.vertices.push_back(vertex);
+      }
+      packed |= localIndex[vertex] << (8 * k);
+      adjacency.liveCounts[vertex]--;
+    }
+    mesh.triangles.push_back(packed);
+    current.triangleCount++;
+    emitted[triangle] = 1;
+  };
+
+  size_t seed = 0;
+  for (;;) {
+    // Best neighbour: fewest vertices added, ties to the triangle whose
+    // vertices have the fewest other triangles left, which keeps the
+    // frontier from leaving stragglers behind
+    size_t best = triangleCount;
+    uint32_t bestNew = std::numeric_limits<uint32_t>::max();
+    uint32_t bestLive = std::numeric_limits<uint32_t>::max();
+    const uint32_t *local = mesh.vertices.data() + current.vertexOffset;
+    for (uint32_t i = 0; i < current.vertexCount && bestNew > 0; ++i) {
+      uint32_t vertex = local[i];
+      if (adjacency.liveCounts[vertex] == 0)
+        continue;
+      for (uint32_t a = adjacency.offsets[vertex];
+           a < adjacency.offsets[vertex + 1]; ++a) {
+        uint32_t triangle = adjacency.triangles[a];
+        if (emitted[triangle])
+          continue;
+        uint32_t added = newVertices(triangle);
+        uint32_t live = 0;
+        for (size_t k = 0; k < 3; ++k)
+          live += adjacency.liveCounts[indices[triangle * 3 + k]];
+        if (added < bestNew || (added == bestNew && live < bestLive)) {
+          best = triangle;
+          bestNew = added;
+          bestLive = live;
+        }
+      }
+    }
+
+    // A neighbour that doesn't fit closes the meshlet; the next one starts
+    // from it rather than jumping across the mesh
+    if (best == triangleCount) {
+      while (seed < triangleCount && emitted[seed])
+        ++seed;
+      if (seed == triangleCount)
+        break;
+      best = seed;
+    }
+    emit(best);
+  }
+  finish();
+  return mesh;
+}
+
+} // namespace Renderer
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Renderer {
+
+// Matches Meshlet in shaders/meshlet_common.slang
+struct Meshlet {
+  // Object space bounding sphere: center, radius
+  glm::vec4 sphere;
+  // Normal cone for back-face culling. The meshlet faces away from every
+  // viewer with dot(normalize(apex - eye), axis) >= cutoff; coneAxis.w is
+  // the cutoff, above 1 when the normals spread too far to ever cull.
+  glm::vec4 coneApex;
+  glm::vec4 coneAxis;
+  // Ranges of MeshletMesh::vertices and MeshletMesh::triangles
+  uint32_t vertexOffset;
+  uint32_t triangleOffset;
+  uint32_t vertexCount;
+  uint32_t triangleCount;
+};
+
+struct MeshletMesh {
+  std::vector<Meshlet> meshlets;
+  // Meshlet-local vertex -> index into the original vertex buffer
+  std::vector<uint32_t> vertices;
+  // One triangle per entry: three meshlet-local vertex indices packed into
+  // the low three bytes
+  std::vector<uint32_t> triangles;
+
+  // The same triangles as an index buffer into the original vertices,
+  // meshlet after meshlet, so meshlet i is drawn by
+  // drawIndexed(triangleCount * 3, 1, triangleOffset * 3)
+  std::vector<uint32_t> BuildIndexBuffer() const;
+};
+
+// 64 vertices / 124 triangles keeps a meshlet's mesh shader output within
+// the minimum limits of VK_EXT_mesh_shader, in one 64-lane workgroup
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Greedy clustering: each meshlet grows from a seed triangle by the
+// adjacent triangle that adds the fewest new vertices, and the next seed is
+// the first triangle not yet taken. maxVertices must not exceed 256.
+MeshletMesh BuildMeshlets(const float *positions, size_t vertexCount,
+                          size_t positionStride,
+                          const std::vector<uint32_t> &indices,
+                          uint32_t maxVertices = MESHLET_MAX_VERTICES,
+                          uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+} // namespace Renderer
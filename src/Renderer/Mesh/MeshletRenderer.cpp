@@ -0,0 +1,495 @@
+#include "MeshletRenderer.h"
+#include "../Helpers/helpers.h"
+#include "../Pipeline/Pipeline.h"
+#include "shaders/meshlet_cull.spv.h"
+#include "shaders/meshlet_mesh.spv.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+// TASK_GROUP_SIZE in shaders/meshlet_mesh.slang
+constexpr uint32_t TASK_GROUP_SIZE = 32;
+constexpr uint64_t NO_TEXTURE = std::numeric_limits<uint64_t>::max();
+
+// Matches MeshletFrame in shaders/meshlet_common.slang
+struct MeshletFrame {
+  glm::mat4 model;
+  glm::mat4 viewProj;
+  glm::vec3 cameraPosition;
+  float radiusScale;
+  float pyramidWidth, pyramidHeight;
+  uint32_t meshletCount;
+  uint32_t pyramidLevels;
+};
+
+// Matches MeshletPass in shaders/meshlet_common.slang
+struct MeshletPass {
+  uint32_t phase;
+};
+
+// The mesh shader reads vertices as VERTEX_STRIDE floats with the position
+// first and the texture coordinate last
+static_assert(sizeof(Vertex) == 8 * sizeof(float) &&
+                  offsetof(Vertex, pos) == 0 &&
+                  offsetof(Vertex, texCoord) == 6 * sizeof(float),
+              "Vertex no longer matches VERTEX_STRIDE in meshlet_mesh.slang");
+static_assert(sizeof(Meshlet) == 64, "Meshlet must match the shader struct");
+} // namespace
+
+MeshletRenderer::MeshletRenderer(Renderer::Device &device,
+                                 Renderer::CommandPool &commandPool,
+                                 Renderer::BufferManager &bufferManager,
+                                 Renderer::HiZPyramid &pyramid,
+                                 const MeshletMesh &mesh,
+                                 vk::Buffer vertexBuffer,
+                                 uint32_t maxFramesInFlight,
+                                 vk::Format colorFormat,
+                                 vk::Format depthFormat, bool meshShaders)
+    : m_Pyramid(pyramid), m_MeshShaders(meshShaders),
+      m_MultiDrawIndirect(device.HasMultiDrawIndirect()),
+      m_MeshletCount(static_cast<uint32_t>(mesh.meshlets.size())) {
+  if (meshShaders && !device.HasMeshShader())
+    throw std::runtime_error("device has no mesh shader support");
+  if (mesh.meshlets.empty())
+    throw std::runtime_error("mesh has no meshlets!");
+
+  bufferManager.CreateBufferWithData(
+      device, commandPool, mesh.meshlets.data(),
+      sizeof(Meshlet) * mesh.meshlets.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer, m_Meshlets, m_MeshletsMemory);
+
+  // Nothing was visible before the first frame
+  std::vector<uint32_t> visibility(m_MeshletCount, 0);
+  bufferManager.CreateBufferWithData(
+      device, commandPool, visibility.data(),
+      sizeof(uint32_t) * visibility.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer, m_Visibility,
+      m_VisibilityMemory);
+
+  vk::DeviceSize frameSize = sizeof(MeshletFrame);
+  for (uint32_t i = 0; i < maxFramesInFlight; ++i) {
+    vk::raii::Buffer buffer({});
+    Renderer::DeviceMemory bufferMem = nullptr;
+    if (!bufferManager.CreateDirectWriteBuffer(
+            device, frameSize, vk::BufferUsageFlagBits::eUniformBuffer,
+            buffer, bufferMem)) {
+      bufferManager.CreateBuffer(device, frameSize,
+                                 vk::BufferUsageFlagBits::eUniformBuffer,
+                                 vk::MemoryPropertyFlagBits::eHostVisible |
+                                     vk::MemoryPropertyFlagBits::eHostCoherent,
+                                 buffer, bufferMem);
+    }
+    m_FrameBuffers.emplace_back(std::move(buffer));
+    m_FrameBuffersMemory.emplace_back(std::move(bufferMem));
+    m_FrameBuffersMapped.emplace_back(
+        m_FrameBuffersMemory[i].mapMemory(0, frameSize));
+  }
+
+  if (m_MeshShaders) {
+    bufferManager.CreateBufferWithData(
+        device, commandPool, mesh.vertices.data(),
+        sizeof(uint32_t) * mesh.vertices.size(),
+        vk::BufferUsageFlagBits::eStorageBuffer, m_MeshletVertices,
+        m_MeshletVerticesMemory);
+    bufferManager.CreateBufferWithData(
+        device, commandPool, mesh.triangles.data(),
+        sizeof(uint32_t) * mesh.triangles.size(),
+        vk::BufferUsageFlagBits::eStorageBuffer, m_MeshletTriangles,
+        m_MeshletTrianglesMemory);
+    CreateMeshPipeline(device, colorFormat, depthFormat);
+    CreateMeshDescriptorSets(device, vertexBuffer, maxFramesInFlight);
+    return;
+  }
+
+  std::vector<uint32_t> indices = mesh.BuildIndexBuffer();
+  bufferManager.CreateBufferWithData(
+      device, commandPool, indices.data(), sizeof(uint32_t) * indices.size(),
+      vk::BufferUsageFlagBits::eIndexBuffer, m_IndexBuffer,
+      m_IndexBufferMemory);
+
+  vk::DeviceSize drawsSize =
+      sizeof(vk::DrawIndexedIndirectCommand) * m_MeshletCount;
+  bufferManager.CreateBuffer(device, drawsSize,
+                             vk::BufferUsageFlagBits::eStorageBuffer |
+                                 vk::BufferUsageFlagBits::eIndirectBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             m_EarlyDraws, m_EarlyDrawsMemory);
+  bufferManager.CreateBuffer(device, drawsSize,
+                             vk::BufferUsageFlagBits::eStorageBuffer |
+                                 vk::BufferUsageFlagBits::eIndirectBuffer,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             m_LateDraws, m_LateDrawsMemory);
+
+  m_Cull = std::make_unique<ComputePipeline>(
+      device, Shaders::MeshletCull, "cullMain",
+      std::vector<ComputeBinding>{
+          {0, vk::DescriptorType::eStorageBuffer},
+          {1, vk::DescriptorType::eStorageBuffer},
+          {2, vk::DescriptorType::eCombinedImageSampler},
+          {3, vk::DescriptorType::eUniformBuffer},
+          {4, vk::DescriptorType::eStorageBuffer},
+          {5, vk::DescriptorType::eStorageBuffer},
+      },
+      maxFramesInFlight, sizeof(MeshletPass));
+
+  for (uint32_t i = 0; i < maxFramesInFlight; ++i) {
+    m_Cull->WriteStorageBuffer(device, i, 0, *m_Meshlets);
+    m_Cull->WriteStorageBuffer(device, i, 1, *m_Visibility);
+    m_Cull->WriteUniformBuffer(device, i, 3, *m_FrameBuffers[i]);
+    m_Cull->WriteStorageBuffer(device, i, 4, *m_EarlyDraws);
+    m_Cull->WriteStorageBuffer(device, i, 5, *m_LateDraws);
+  }
+  RefreshPyramidDescriptors(device);
+}
+
+MeshletRenderer::~MeshletRenderer() {}
+
+void MeshletRenderer::CreateMeshPipeline(Renderer::Device &device,
+                                         vk::Format colorFormat,
+                                         vk::Format depthFormat) {
+  const vk::ShaderStageFlags taskMesh =
+      vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT;
+  auto binding = [](uint32_t index, vk::DescriptorType type,
+                    vk::ShaderStageFlags stages) {
+    vk::DescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.binding = index;
+    layoutBinding.descriptorType = type;
+    layoutBinding.descriptorCount = 1;
+    layoutBinding.stageFlags = stages;
+    return layoutBinding;
+  };
+  m_DescriptorSetLayout = device.GetDescriptorSetLayout({
+      binding(0, vk::DescriptorType::eStorageBuffer, taskMesh),
+      binding(1, vk::DescriptorType::eStorageBuffer,
+              vk::ShaderStageFlagBits::eTaskEXT),
+      binding(2, vk::DescriptorType::eCombinedImageSampler,
+              vk::ShaderStageFlagBits::eTaskEXT),
+      binding(3, vk::DescriptorType::eUniformBuffer, taskMesh),
+      binding(4, vk::DescriptorType::eStorageBuffer,
+              vk::ShaderStageFlagBits::eMeshEXT),
+      binding(5, vk::DescriptorType::eStorageBuffer,
+              vk::ShaderStageFlagBits::eMeshEXT),
+      binding(6, vk::DescriptorType::eStorageBuffer,
+              vk::ShaderStageFlagBits::eMeshEXT),
+      binding(7, vk::DescriptorType::eCombinedImageSampler,
+              vk::ShaderStageFlagBits::eFragment),
+  });
+
+  ShaderCode code(Shaders::MeshletMesh);
+  vk::ShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.codeSize = code.GetSize();
+  moduleInfo.pCode = code.words;
+  vk::raii::ShaderModule shaderModule{device.GetDevice(), moduleInfo};
+
+  vk::PipelineShaderStageCreateInfo taskShaderStageInfo{};
+  taskShaderStageInfo.stage = vk::ShaderStageFlagBits::eTaskEXT;
+  taskShaderStageInfo.module = shaderModule;
+  taskShaderStageInfo.pName = "taskMain";
+
+  vk::PipelineShaderStageCreateInfo meshShaderStageInfo{};
+  meshShaderStageInfo.stage = vk::ShaderStageFlagBits::eMeshEXT;
+  meshShaderStageInfo.module = shaderModule;
+  meshShaderStageInfo.pName = "meshMain";
+
+  vk::PipelineShaderStageCreateInfo fragShaderStageInfo{};
+  fragShaderStageInfo.stage = vk::ShaderStageFlagBits::eFragment;
+  fragShaderStageInfo.module = shaderModule;
+  fragShaderStageInfo.pName = "fragMain";
+
+  vk::PipelineShaderStageCreateInfo shaderStages[] = {
+      taskShaderStageInfo,
+      meshShaderStageInfo,
+      fragShaderStageInfo,
+  };
+
+  // Same fixed function state as the scene Pipeline; no vertex input or
+  // input assembly with mesh shaders
+  vk::PipelineViewportStateCreateInfo viewportState{};
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount = 1;
+
+  vk::PipelineRasterizationStateCreateInfo rasterizer{};
+  rasterizer.depthClampEnable = vk::False;
+  rasterizer.rasterizerDiscardEnable = vk::False;
+  rasterizer.polygonMode = vk::PolygonMode::eFill;
+  rasterizer.cullMode = vk::CullModeFlagBits::eBack;
+  rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+  rasterizer.depthBiasEnable = vk::False;
+  rasterizer.lineWidth = 1.0f;
+
+  vk::PipelineMultisampleStateCreateInfo multisampling{};
+  multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+  multisampling.sampleShadingEnable = vk::False;
+
+  vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.depthTestEnable = depthFormat != vk::Format::eUndefined;
+  depthStencil.depthWriteEnable = depthFormat != vk::Format::eUndefined;
+  depthStencil.depthCompareOp = vk::CompareOp::eLess;
+  depthStencil.depthBoundsTestEnable = vk::False;
+  depthStencil.stencilTestEnable = vk::False;
+
+  vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+  colorBlendAttachment.blendEnable = vk::False;
+  colorBlendAttachment.colorWriteMask =
+      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+      vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+  vk::PipelineColorBlendStateCreateInfo colorBlending{};
+  colorBlending.logicOpEnable = vk::False;
+  colorBlending.logicOp = vk::LogicOp::eCopy;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments = &colorBlendAttachment;
+
+  std::vector<vk::DynamicState> dynamicStates = {vk::DynamicState::eViewport,
+                                                 vk::DynamicState::eScissor};
+
+  vk::PipelineDynamicStateCreateInfo dynamicState{};
+  dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+  dynamicState.pDynamicStates = dynamicStates.data();
+
+  vk::PushConstantRange pushConstantRange{taskMesh, 0, sizeof(MeshletPass)};
+  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  m_PipelineLayout =
+      vk::raii::PipelineLayout(device.GetDevice(), pipelineLayoutInfo);
+
+  vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{};
+  pipelineRenderingCreateInfo.colorAttachmentCount = 1;
+  pipelineRenderingCreateInfo.pColorAttachmentFormats = &colorFormat;
+  pipelineRenderingCreateInfo.depthAttachmentFormat = depthFormat;
+  if (hasStencilComponent(depthFormat))
+    pipelineRenderingCreateInfo.stencilAttachmentFormat = depthFormat;
+
+  vk::GraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.pNext = &pipelineRenderingCreateInfo;
+  pipelineInfo.stageCount = 3;
+  pipelineInfo.pStages = shaderStages;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = m_PipelineLayout;
+
+  m_MeshPipeline =
+      vk::raii::Pipeline(device.GetDevice(), nullptr, pipelineInfo);
+}
+
+void MeshletRenderer::CreateMeshDescriptorSets(Renderer::Device &device,
+                                               vk::Buffer vertexBuffer,
+                                               uint32_t maxFramesInFlight) {
+  for (uint32_t i = 0; i < maxFramesInFlight; ++i) {
+    vk::DescriptorSet set =
+        m_DescriptorAllocator.Allocate(device, m_DescriptorSetLayout);
+    m_DescriptorSets.push_back(set);
+
+    vk::DescriptorBufferInfo bufferInfos[] = {
+        {*m_Meshlets, 0, vk::WholeSize},
+        {*m_Visibility, 0, vk::WholeSize},
+        {*m_FrameBuffers[i], 0, vk::WholeSize},
+        {vertexBuffer, 0, vk::WholeSize},
+        {*m_MeshletVertices, 0, vk::WholeSize},
+        {*m_MeshletTriangles, 0, vk::WholeSize},
+    };
+    const uint32_t bufferBindings[] = {0, 1, 3, 4, 5, 6};
+
+    std::vector<vk::WriteDescriptorSet> writes;
+    for (size_t b = 0; b < std::size(bufferBindings); ++b) {
+      vk::WriteDescriptorSet write{};
+      write.dstSet = set;
+      write.dstBinding = bufferBindings[b];
+      write.descriptorCount = 1;
+      write.descriptorType = bufferBindings[b] == 3
+                                 ? vk::DescriptorType::eUniformBuffer
+                                 : vk::DescriptorType::eStorageBuffer;
+      write.pBufferInfo = &bufferInfos[b];
+      writes.push_back(write);
+    }
+
+    device.GetDevice().updateDescriptorSets(writes, {});
+  }
+  RefreshPyramidDescriptors(device);
+  // The texture comes with the first RefreshTextureDescriptor
+  m_TextureGenerations.assign(maxFramesInFlight, NO_TEXTURE);
+}
+
+void MeshletRenderer::RefreshPyramidDescriptors(Renderer::Device &device) {
+  if (!m_MeshShaders) {
+    for (uint32_t i = 0; i < m_FrameBuffers.size(); ++i) {
+      m_Cull->WriteSampledImage(device, i, 2, m_Pyramid.GetImageView(),
+                                m_Pyramid.GetSampler(),
+                                vk::ImageLayout::eGeneral);
+    }
+    return;
+  }
+
+  vk::DescriptorImageInfo pyramidInfo{};
+  pyramidInfo.sampler = m_Pyramid.GetSampler();
+  pyramidInfo.imageView = m_Pyramid.GetImageView();
+  pyramidInfo.imageLayout = vk::ImageLayout::eGeneral;
+
+  std::vector<vk::WriteDescriptorSet> writes;
+  for (vk::DescriptorSet set : m_DescriptorSets) {
+    vk::WriteDescriptorSet pyramidWrite{};
+    pyramidWrite.dstSet = set;
+    pyramidWrite.dstBinding = 2;
+    pyramidWrite.descriptorCount = 1;
+    pyramidWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    pyramidWrite.pImageInfo = &pyramidInfo;
+    writes.push_back(pyramidWrite);
+  }
+  device.GetDevice().updateDescriptorSets(writes, {});
+}
+
+void MeshletRenderer::SetInstance(uint32_t frameIndex, const glm::mat4 &model,
+                                  const glm::mat4 &viewProj,
+                                  const glm::vec3 &cameraPosition) {
+  MeshletFrame frame{};
+  frame.model = model;
+  frame.viewProj = viewProj;
+  frame.cameraPosition = cameraPosition;
+  frame.radiusScale = std::max({glm::length(glm::vec3(model[0])),
+                                glm::length(glm::vec3(model[1])),
+                                glm::length(glm::vec3(model[2]))});
+  frame.pyramidWidth = static_cast<float>(m_Pyramid.GetExtent().width);
+  frame.pyramidHeight = static_cast<float>(m_Pyramid.GetExtent().height);
+  frame.meshletCount = m_MeshletCount;
+  frame.pyramidLevels = m_Pyramid.GetMipLevels();
+  memcpy(m_FrameBuffersMapped[frameIndex], &frame, sizeof(frame));
+}
+
+void MeshletRenderer::RefreshTextureDescriptor(Renderer::Device &device,
+                                               uint32_t frameIndex,
+                                               const Texture &texture) {
+  if (!m_MeshShaders ||
+      m_TextureGenerations[frameIndex] == texture.getGeneration())
+    return;
+
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.sampler = texture.getSampler();
+  imageInfo.imageView = texture.getImageView();
+  imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+  vk::WriteDescriptorSet texDescriptorWrite{};
+  texDescriptorWrite.dstSet = m_DescriptorSets[frameIndex];
+  texDescriptorWrite.dstBinding = 7;
+  texDescriptorWrite.dstArrayElement = 0;
+  texDescriptorWrite.descriptorCount = 1;
+  texDescriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  texDescriptorWrite.pImageInfo = &imageInfo;
+
+  device.GetDevice().updateDescriptorSets(texDescriptorWrite, {});
+  m_TextureGenerations[frameIndex] = texture.getGeneration();
+}
+
+void MeshletRenderer::RecordEarly(const vk::raii::CommandBuffer &commandBuffer,
+                                  uint32_t frameIndex) {
+  Record(commandBuffer, frameIndex, 0);
+}
+
+void MeshletRenderer::RecordLate(const vk::raii::CommandBuffer &commandBuffer,
+                                 uint32_t frameIndex) {
+  Record(commandBuffer, frameIndex, 1);
+}
+
+void MeshletRenderer::Record(const vk::raii::CommandBuffer &commandBuffer,
+                             uint32_t frameIndex, uint32_t phase) {
+  vk::MemoryBarrier2 barrier{};
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.memoryBarrierCount = 1;
+  dependencyInfo.pMemoryBarriers = &barrier;
+
+  if (m_MeshShaders) {
+    // Visibility is read and written by the task shader of the previous
+    // phase (or frame); the late phase also reads the pyramid just built
+    barrier.srcStageMask = vk::PipelineStageFlagBits2::eTaskShaderEXT;
+    barrier.srcAccessMask = vk::AccessFlagBits2::eShaderWrite;
+    barrier.dstStageMask = vk::PipelineStageFlagBits2::eTaskShaderEXT;
+    barrier.dstAccessMask =
+        vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite;
+    if (phase == 1) {
+      barrier.srcStageMask |= vk::PipelineStageFlagBits2::eComputeShader;
+      barrier.dstAccessMask |= vk::AccessFlagBits2::eShaderSampledRead;
+    }
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+    return;
+  }
+
+  // Last frame's indirect draws and visibility writes must finish before
+  // the commands and flags are rewritten
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect |
+                         vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eIndirectCommandRead |
+                          vk::AccessFlagBits2::eShaderWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.dstAccessMask =
+      vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  MeshletPass pass{phase};
+  m_Cull->Dispatch(commandBuffer, frameIndex,
+                   ComputePipeline::GroupCount(m_MeshletCount,
+                                               CULL_GROUP_SIZE),
+                   1, 1, &pass);
+
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eComputeShader;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eShaderWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+void MeshletRenderer::DrawEarly(Renderer::CommandBuffer &commandBuffer,
+                                uint32_t frameIndex) {
+  Draw(commandBuffer, frameIndex, 0);
+}
+
+void MeshletRenderer::DrawLate(Renderer::CommandBuffer &commandBuffer,
+                               uint32_t frameIndex) {
+  Draw(commandBuffer, frameIndex, 1);
+}
+
+void MeshletRenderer::Draw(Renderer::CommandBuffer &commandBuffer,
+                           uint32_t frameIndex, uint32_t phase) {
+  if (m_MeshShaders) {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                               *m_MeshPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                     *m_PipelineLayout, 0,
+                                     {m_DescriptorSets[frameIndex]});
+    commandBuffer.pushConstants(*m_PipelineLayout,
+                                vk::ShaderStageFlagBits::eTaskEXT |
+                                    vk::ShaderStageFlagBits::eMeshEXT,
+                                MeshletPass{phase});
+    commandBuffer.get().drawMeshTasksEXT(
+        ComputePipeline::GroupCount(m_MeshletCount, TASK_GROUP_SIZE), 1, 1);
+    return;
+  }
+
+  // Culled meshlets have instanceCount 0 and cost next to nothing
+  commandBuffer.bindIndexBuffer(*m_IndexBuffer, vk::IndexType::eUint32);
+  const vk::raii::Buffer &drawBuffer = phase == 0 ? m_EarlyDraws : m_LateDraws;
+  constexpr uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+  if (m_MultiDrawIndirect) {
+    commandBuffer.get().drawIndexedIndirect(*drawBuffer, 0, m_MeshletCount,
+                                            stride);
+    return;
+  }
+  for (uint32_t i = 0; i < m_MeshletCount; ++i)
+    commandBuffer.get().drawIndexedIndirect(*drawBuffer, i * stride, 1,
+                                            stride);
+}
+
+} // namespace Renderer
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include <glm/glm.hpp>
+
+#include "../Buffer/Buffer.h"
+#include "../Command/CommandBuffer.h"
+#include "../Culling/HiZPyramid.h"
+#include "../Descriptor/DescriptorAllocator.h"
+#include "../Device/Device.h"
+#include "../Pipeline/ComputePipeline.h"
+#include "../Texture/Texture.h"
+#include "Meshlet.h"
+
+namespace Renderer {
+
+// Draws one mesh as meshlets with per-meshlet frustum, normal cone and
+// two-phase HiZ occlusion culling, in the same frame structure as
+// OcclusionCuller:
+//
+//   RecordEarly  -> draw DrawEarly() (meshlets visible last frame)
+//   depth -> eShaderReadOnlyOptimal, HiZPyramid::Build
+//   RecordLate   -> draw DrawLate() (newly disoccluded meshlets)
+//
+// With mesh shaders the task shader culls and the mesh shader emits the
+// surviving meshlets through the renderer's own pipeline. Without them a
+// compute pass writes one indexed indirect draw per meshlet, drawn with the
+// caller's scene pipeline from a meshlet-ordered index buffer.
+class MeshletRenderer {
+public:
+  // vertexBuffer holds the mesh's Vertex data; the mesh shader path reads it
+  // as a storage buffer, so it needs eStorageBuffer usage
+  MeshletRenderer(Renderer::Device &device, Renderer::CommandPool &commandPool,
+                  Renderer::BufferManager &bufferManager,
+                  Renderer::HiZPyramid &pyramid, const MeshletMesh &mesh,
+                  vk::Buffer vertexBuffer, uint32_t maxFramesInFlight,
+                  vk::Format colorFormat, vk::Format depthFormat,
+                  bool meshShaders);
+  ~MeshletRenderer();
+
+  void SetInstance(uint32_t frameIndex, const glm::mat4 &model,
+                   const glm::mat4 &viewProj, const glm::vec3 &cameraPosition);
+
+  // Mesh shader path: rewrites the frame's texture descriptor if the view
+  // changed (streaming). Only call for a frame whose previous submission
+  // completed.
+  void RefreshTextureDescriptor(Renderer::Device &device, uint32_t frameIndex,
+                                const Texture &texture);
+
+  // Points culling at the pyramid again after HiZPyramid::Resize; the
+  // device must be idle
+  void RefreshPyramidDescriptors(Renderer::Device &device);
+
+  // Culling for the fallback, barriers only for the mesh shader path. Both
+  // outside of rendering.
+  void RecordEarly(const vk::raii::CommandBuffer &commandBuffer,
+                   uint32_t frameIndex);
+  void RecordLate(const vk::raii::CommandBuffer &commandBuffer,
+                  uint32_t frameIndex);
+
+  // Inside rendering. The mesh shader path binds everything it needs; the
+  // fallback binds the meshlet index buffer and leaves pipeline, vertex
+  // buffer, descriptors and push constants to the caller.
+  void DrawEarly(Renderer::CommandBuffer &commandBuffer, uint32_t frameIndex);
+  void DrawLate(Renderer::CommandBuffer &commandBuffer, uint32_t frameIndex);
+
+  bool UsesMeshShaders() const { return m_MeshShaders; }
+  uint32_t GetMeshletCount() const { return m_MeshletCount; }
+
+private:
+  void CreateMeshPipeline(Renderer::Device &device, vk::Format colorFormat,
+                          vk::Format depthFormat);
+  void CreateMeshDescriptorSets(Renderer::Device &device,
+                                vk::Buffer vertexBuffer,
+                                uint32_t maxFramesInFlight);
+  void Record(const vk::raii::CommandBuffer &commandBuffer,
+              uint32_t frameIndex, uint32_t phase);
+  void Draw(Renderer::CommandBuffer &commandBuffer, uint32_t frameIndex,
+            uint32_t phase);
+
+private:
+  Renderer::HiZPyramid &m_Pyramid;
+  bool m_MeshShaders;
+  bool m_MultiDrawIndirect;
+  uint32_t m_MeshletCount;
+
+  vk::raii::Buffer m_Meshlets = nullptr;
+  Renderer::DeviceMemory m_MeshletsMemory = nullptr;
+  vk::raii::Buffer m_Visibility = nullptr;
+  Renderer::DeviceMemory m_VisibilityMemory = nullptr;
+
+  std::vector<vk::raii::Buffer> m_FrameBuffers;
+  std::vector<Renderer::DeviceMemory> m_FrameBuffersMemory;
+  std::vector<void *> m_FrameBuffersMapped;
+
+  // Mesh shader path
+  vk::raii::Buffer m_MeshletVertices = nullptr;
+  Renderer::DeviceMemory m_MeshletVerticesMemory = nullptr;
+  vk::raii::Buffer m_MeshletTriangles = nullptr;
+  Renderer::DeviceMemory m_MeshletTrianglesMemory = nullptr;
+  vk::raii::PipelineLayout m_PipelineLayout = nullptr;
+  vk::raii::Pipeline m_MeshPipeline = nullptr;
+  vk::DescriptorSetLayout m_DescriptorSetLayout;
+  DescriptorAllocator m_DescriptorAllocator;
+  std::vector<vk::DescriptorSet> m_DescriptorSets;
+  std::vector<uint64_t> m_TextureGenerations;
+
+  // Fallback
+  vk::raii::Buffer m_IndexBuffer = nullptr;
+  Renderer::DeviceMemory m_IndexBufferMemory = nullptr;
+  vk::raii::Buffer m_EarlyDraws = nullptr;
+  Renderer::DeviceMemory m_EarlyDrawsMemory = nullptr;
+  vk::raii::Buffer m_LateDraws = nullptr;
+  Renderer::DeviceMemory m_LateDrawsMemory = nullptr;
+  std::unique_ptr<ComputePipeline> m_Cull;
+};
+
+} // namespace Renderer
@@ -0,0 +1,230 @@
+#include "ComputePipeline.h"
+#include "Pipeline.h"
+#include <algorithm>
+
+namespace Renderer {
+
+ComputePipeline::ComputePipeline(Renderer::Device &device,
+                                 const std::string &shaderPath,
+                                 const char *entryPoint,
+                                 const std::vector<ComputeBinding> &bindings,
+                                 uint32_t setCount, uint32_t pushConstantSize)
+    : ComputePipeline(device, Pipeline::readFile(shaderPath), entryPoint,
+                      bindings, setCount, pushConstantSize) {}
+
+ComputePipeline::ComputePipeline(Renderer::Device &device,
+                                 const std::vector<char> &code,
+                                 const char *entryPoint,
+                                 const std::vector<ComputeBinding> &bindings,
+                                 uint32_t setCount, uint32_t pushConstantSize)
+    : ComputePipeline(device,
+                      ShaderCode(reinterpret_cast<const uint32_t *>(
+                                     code.data()),
+                                 code.size() / sizeof(uint32_t)),
+                      entryPoint, bindings, setCount, pushConstantSize) {}
+
+ComputePipeline::ComputePipeline(Renderer::Device &device, ShaderCode code,
+                                 const char *entryPoint,
+                                 const std::vector<ComputeBinding> &bindings,
+                                 uint32_t setCount, uint32_t pushConstantSize)
+    : m_PushConstantSize(pushConstantSize) {
+  CreateDescriptorSetLayout(device, bindings);
+  CreateDescriptorPool(device, bindings, setCount);
+  CreateDescriptorSets(device, setCount);
+
+  vk::ShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.codeSize = code.GetSize();
+  moduleInfo.pCode = code.words;
+  vk::raii::ShaderModule shaderModule{device.GetDevice(), moduleInfo};
+
+  vk::PushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = m_PushConstantSize;
+
+  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = m_PushConstantSize > 0 ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+  m_PipelineLayout =
+      vk::raii::PipelineLayout(device.GetDevice(), pipelineLayoutInfo);
+
+  vk::PipelineShaderStageCreateInfo stageInfo{};
+  stageInfo.stage = vk::ShaderStageFlagBits::eCompute;
+  stageInfo.module = shaderModule;
+  stageInfo.pName = entryPoint;
+
+  vk::ComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.stage = stageInfo;
+  pipelineInfo.layout = m_PipelineLayout;
+
+  m_ComputePipeline =
+      vk::raii::Pipeline(device.GetDevice(), nullptr, pipelineInfo);
+}
+ComputePipeline::~ComputePipeline() {}
+
+void ComputePipeline::CreateDescriptorSetLayout(
+    Renderer::Device &device, const std::vector<ComputeBinding> &bindings) {
+  std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+  layoutBindings.reserve(bindings.size());
+  for (const auto &binding : bindings) {
+    vk::DescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.binding = binding.binding;
+    layoutBinding.descriptorType = binding.type;
+    layoutBinding.descriptorCount = 1;
+    layoutBinding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+    layoutBindings.push_back(layoutBinding);
+  }
+
+  m_DescriptorSetLayout =
+      device.GetDescriptorSetLayout(std::move(layoutBindings));
+}
+
+void ComputePipeline::CreateDescriptorPool(
+    Renderer::Device &device, const std::vector<ComputeBinding> &bindings,
+    uint32_t setCount) {
+  std::vector<vk::DescriptorPoolSize> poolSizes;
+  for (const auto &binding : bindings) {
+    auto it = std::find_if(poolSizes.begin(), poolSizes.end(),
+                           [&](const vk::DescriptorPoolSize &size) {
+                             return size.type == binding.type;
+                           });
+    if (it == poolSizes.end()) {
+      poolSizes.emplace_back(binding.type, setCount);
+    } else {
+      it->descriptorCount += setCount;
+    }
+  }
+
+  vk::DescriptorPoolCreateInfo poolInfo{};
+  poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+  poolInfo.maxSets = setCount;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+
+  m_DescriptorPool = vk::raii::DescriptorPool(device.GetDevice(), poolInfo);
+}
+
+void ComputePipeline::CreateDescriptorSets(Renderer::Device &device,
+                                           uint32_t setCount) {
+  std::vector<vk::DescriptorSetLayout> layouts(setCount,
+                                               m_DescriptorSetLayout);
+  vk::DescriptorSetAllocateInfo allocInfo{};
+  allocInfo.descriptorPool = *m_DescriptorPool;
+  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+  allocInfo.pSetLayouts = layouts.data();
+
+  m_DescriptorSets = device.GetDevice().allocateDescriptorSets(allocInfo);
+}
+
+void ComputePipeline::WriteBuffer(Renderer::Device &device, uint32_t set,
+                                  uint32_t binding, vk::DescriptorType type,
+                                  vk::Buffer buffer, vk::DeviceSize offset,
+                                  vk::DeviceSize range) {
+  vk::DescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = buffer;
+  bufferInfo.offset = offset;
+  bufferInfo.range = range;
+
+  vk::WriteDescriptorSet descriptorWrite{};
+  descriptorWrite.dstSet = m_DescriptorSets[set];
+  descriptorWrite.dstBinding = binding;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.descriptorType = type;
+  descriptorWrite.pBufferInfo = &bufferInfo;
+
+  device.GetDevice().updateDescriptorSets(descriptorWrite, {});
+}
+
+void ComputePipeline::WriteStorageBuffer(Renderer::Device &device,
+                                         uint32_t set, uint32_t binding,
+                                         vk::Buffer buffer,
+                                         vk::DeviceSize offset,
+                                         vk::DeviceSize range) {
+  WriteBuffer(device, set, binding, vk::DescriptorType::eStorageBuffer, buffer,
+              offset, range);
+}
+
+void ComputePipeline::WriteUniformBuffer(Renderer::Device &device,
+                                         uint32_t set, uint32_t binding,
+                                         vk::Buffer buffer,
+                                         vk::DeviceSize offset,
+                                         vk::DeviceSize range) {
+  WriteBuffer(device, set, binding, vk::DescriptorType::eUniformBuffer, buffer,
+              offset, range);
+}
+
+void ComputePipeline::WriteStorageImage(Renderer::Device &device, uint32_t set,
+                                        uint32_t binding,
+                                        vk::ImageView imageView,
+                                        vk::ImageLayout layout) {
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = layout;
+
+  vk::WriteDescriptorSet descriptorWrite{};
+  descriptorWrite.dstSet = m_DescriptorSets[set];
+  descriptorWrite.dstBinding = binding;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.descriptorType = vk::DescriptorType::eStorageImage;
+  descriptorWrite.pImageInfo = &imageInfo;
+
+  device.GetDevice().updateDescriptorSets(descriptorWrite, {});
+}
+
+void ComputePipeline::WriteSampledImage(Renderer::Device &device, uint32_t set,
+                                        uint32_t binding,
+                                        vk::ImageView imageView,
+                                        vk::Sampler sampler,
+                                        vk::ImageLayout layout) {
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.sampler = sampler;
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = layout;
+
+  vk::WriteDescriptorSet descriptorWrite{};
+  descriptorWrite.dstSet = m_DescriptorSets[set];
+  descriptorWrite.dstBinding = binding;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  descriptorWrite.pImageInfo = &imageInfo;
+
+  device.GetDevice().updateDescriptorSets(descriptorWrite, {});
+}
+
+void ComputePipeline::Bind(const vk::raii::CommandBuffer &commandBuffer,
+                           uint32_t set, const void *pushConstants) const {
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                             *m_ComputePipeline);
+  commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                   *m_PipelineLayout, 0,
+                                   *m_DescriptorSets[set], nullptr);
+  if (pushConstants && m_PushConstantSize > 0) {
+    commandBuffer.pushConstants<uint8_t>(
+        *m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0,
+        vk::ArrayProxy<const uint8_t>(
+            m_PushConstantSize, static_cast<const uint8_t *>(pushConstants)));
+  }
+}
+
+void ComputePipeline::Dispatch(const vk::raii::CommandBuffer &commandBuffer,
+                               uint32_t set, uint32_t groupCountX,
+                               uint32_t groupCountY, uint32_t groupCountZ,
+                               const void *pushConstants) const {
+  Bind(commandBuffer, set, pushConstants);
+  commandBuffer.dispatch(groupCountX, groupCountY, groupCountZ);
+}
+
+void ComputePipeline::DispatchIndirect(
+    const vk::raii::CommandBuffer &commandBuffer, uint32_t set,
+    vk::Buffer buffer, vk::DeviceSize offset, const void *pushConstants) const {
+  Bind(commandBuffer, set, pushConstants);
+  commandBuffer.dispatchIndirect(buffer, offset);
+}
+
+} // namespace Renderer
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../Device/Device.h"
+#include "ShaderCode.h"
+
+namespace Renderer {
+
+struct ComputeBinding {
+  uint32_t binding;
+  // eStorageBuffer, eStorageImage, eUniformBuffer or eCombinedImageSampler
+  vk::DescriptorType type;
+};
+
+class ComputePipeline {
+public:
+  // One descriptor set layout built from `bindings`, `setCount` sets
+  // allocated from it (typically one per frame in flight)
+  ComputePipeline(Renderer::Device &device, ShaderCode code,
+                  const char *entryPoint,
+                  const std::vector<ComputeBinding> &bindings,
+                  uint32_t setCount, uint32_t pushConstantSize = 0);
+  ComputePipeline(Renderer::Device &device, const std::vector<char> &code,
+                  const char *entryPoint,
+                  const std::vector<ComputeBinding> &bindings,
+                  uint32_t setCount, uint32_t pushConstantSize = 0);
+  ComputePipeline(Renderer::Device &device, const std::string &shaderPath,
+                  const char *entryPoint,
+                  const std::vector<ComputeBinding> &bindings,
+                  uint32_t setCount, uint32_t pushConstantSize = 0);
+  ~ComputePipeline();
+
+  vk::raii::Pipeline &Get() { return m_ComputePipeline; }
+  vk::raii::PipelineLayout &GetLayout() { return m_PipelineLayout; }
+  vk::DescriptorSetLayout GetDescriptorSetLayout() const {
+    return m_DescriptorSetLayout;
+  }
+  std::vector<vk::raii::DescriptorSet> &GetDescriptorSets() {
+    return m_DescriptorSets;
+  }
+
+  // Descriptor writes; only touch a set whose previous dispatch completed
+  void WriteStorageBuffer(Renderer::Device &device, uint32_t set,
+                          uint32_t binding, vk::Buffer buffer,
+                          vk::DeviceSize offset = 0,
+                          vk::DeviceSize range = vk::WholeSize);
+  void WriteUniformBuffer(Renderer::Device &device, uint32_t set,
+                          uint32_t binding, vk::Buffer buffer,
+                          vk::DeviceSize offset = 0,
+                          vk::DeviceSize range = vk::WholeSize);
+  void WriteStorageImage(Renderer::Device &device, uint32_t set,
+                         uint32_t binding, vk::ImageView imageView,
+                         vk::ImageLayout layout = vk::ImageLayout::eGeneral);
+  void WriteSampledImage(
+      Renderer::Device &device, uint32_t set, uint32_t binding,
+      vk::ImageView imageView, vk::Sampler sampler,
+      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  // Binds the pipeline and `set`, pushes `pushConstants` (pushConstantSize
+  // bytes) when given, then dispatches
+  void Dispatch(const vk::raii::CommandBuffer &commandBuffer, uint32_t set,
+                uint32_t groupCountX, uint32_t groupCountY = 1,
+                uint32_t groupCountZ = 1,
+                const void *pushConstants = nullptr) const;
+  void DispatchIndirect(const vk::raii::CommandBuffer &commandBuffer,
+                        uint32_t set, vk::Buffer buffer,
+                        vk::DeviceSize offset = 0,
+                        const void *pushConstants = nullptr) const;
+
+  static uint32_t GroupCount(uint32_t itemCount, uint32_t groupSize) {
+    return (itemCount + groupSize - 1) / groupSize;
+  }
+
+private:
+  void CreateDescriptorSetLayout(Renderer::Device &device,
+                                 const std::vector<ComputeBinding> &bindings);
+  void CreateDescriptorPool(Renderer::Device &device,
+                            const std::vector<ComputeBinding> &bindings,
+                            uint32_t setCount);
+  void CreateDescriptorSets(Renderer::Device &device, uint32_t setCount);
+  void WriteBuffer(Renderer::Device &device, uint32_t set, uint32_t binding,
+                   vk::DescriptorType type, vk::Buffer buffer,
+                   vk::DeviceSize offset, vk::DeviceSize range);
+  void Bind(const vk::raii::CommandBuffer &commandBuffer, uint32_t set,
+            const void *pushConstants) const;
+
+private:
+  vk::raii::PipelineLayout m_PipelineLayout = nullptr;
+  vk::raii::Pipeline m_ComputePipeline = nullptr;
+
+  vk::DescriptorSetLayout m_DescriptorSetLayout;
+  vk::raii::DescriptorPool m_DescriptorPool = nullptr;
+  std::vector<vk::raii::DescriptorSet> m_DescriptorSets;
+
+  uint32_t m_PushConstantSize = 0;
+};
+
+} // namespace Renderer
@@ -1,24 +1,47 @@
 #include "Pipeline.h"
+#include "../Helpers/helpers.h"
+#include "../Profiling/Profiler.h"
+#include "shaders/shader.spv.h"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 
 namespace Renderer {
 
-;
+static_assert(SceneVertexLayout::MatchesShader(Shaders::SceneShader,
+                                               "vertMain"),
+              "Vertex does not match the vertex inputs of shader.slang");
+static_assert(CompactVertexLayout::MatchesShader(Shaders::SceneShader,
+                                                 "vertMain"),
+              "CompactVertex does not match the vertex inputs of shader.slang");
 
 Pipeline::Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
                    uint32_t maxFramesInFlight,
                    std::vector<vk::raii::Buffer> &uniformBuffers,
-                   size_t uniformBufferObjectSize, Texture &texture) {
+                   size_t uniformBufferObjectSize, Texture &texture,
+                   vk::Format depthFormat)
+    : Pipeline(device, swapchain.GetFormat(), maxFramesInFlight,
+               uniformBuffers, uniformBufferObjectSize, texture,
+               depthFormat) {}
 
+Pipeline::Pipeline(Renderer::Device &device, vk::Format colorFormat,
+                   uint32_t maxFramesInFlight,
+                   std::vector<vk::raii::Buffer> &uniformBuffers,
+                   size_t uniformBufferObjectSize, Texture &texture,
+                   vk::Format depthFormat)
+    : Pipeline(device, colorFormat, depthFormat) {
+  BindResources(device, maxFramesInFlight, uniformBuffers,
+                uniformBufferObjectSize, texture);
+}
+
+Pipeline::Pipeline(Renderer::Device &device, vk::Format colorFormat,
+                   vk::Format depthFormat, bool descriptorBuffer)
+    : m_DescriptorBuffer(descriptorBuffer) {
+  RENDERER_PROFILE_ZONE("Pipeline::Pipeline");
   CreateDescriptorSetLayout(device);
-  CreateDescriptorPool(device, maxFramesInFlight);
-  CreateDescriptorSets(device, maxFramesInFlight, uniformBuffers,
-                       uniformBufferObjectSize, texture);
 
   vk::raii::ShaderModule shaderModule =
-      createShaderModule(readFile("shaders/slang.spv"), device);
+      createShaderModule(Shaders::SceneShader, device);
 
   vk::PipelineShaderStageCreateInfo vertShaderStageInfo{};
   vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
@@ -36,11 +59,14 @@ Pipeline::Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
   };
 
   vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
-  auto bindingDescription = Vertex::getBindingDescription();
-  auto attributeDescriptions = Vertex::getAttributeDescriptions();
+  constexpr auto bindingDescription =
+      SceneVertexLayout::GetBindingDescription();
+  constexpr auto attributeDescriptions =
+      SceneVertexLayout::GetAttributeDescriptions();
   vertexInputInfo.vertexBindingDescriptionCount = 1;
   vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-  vertexInputInfo.vertexAttributeDescriptionCount = 3;
+  vertexInputInfo.vertexAttributeDescriptionCount =
+      SceneVertexLayout::ATTRIBUTE_COUNT;
   vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
   vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -64,6 +90,13 @@ Pipeline::Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
   multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
   multisampling.sampleShadingEnable = vk::False;
 
+  vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.depthTestEnable = depthFormat != vk::Format::eUndefined;
+  depthStencil.depthWriteEnable = depthFormat != vk::Format::eUndefined;
+  depthStencil.depthCompareOp = vk::CompareOp::eLess;
+  depthStencil.depthBoundsTestEnable = vk::False;
+  depthStencil.stencilTestEnable = vk::False;
+
   vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
   colorBlendAttachment.blendEnable = vk::False;
   colorBlendAttachment.colorWriteMask =
@@ -85,15 +118,21 @@ Pipeline::Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
 
   vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.setLayoutCount = 1;
-  pipelineLayoutInfo.pSetLayouts = &*m_DescriptorSetLayout;
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+  vk::PushConstantRange pushConstantRange =
+      DrawConstants::getPushConstantRange();
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
   m_PipelineLayout =
       vk::raii::PipelineLayout(device.GetDevice(), pipelineLayoutInfo);
 
   vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo{};
   pipelineRenderingCreateInfo.colorAttachmentCount = 1;
-  pipelineRenderingCreateInfo.pColorAttachmentFormats = &swapchain.GetFormat();
+  pipelineRenderingCreateInfo.pColorAttachmentFormats = &colorFormat;
+  pipelineRenderingCreateInfo.depthAttachmentFormat = depthFormat;
+  if (hasStencilComponent(depthFormat))
+    pipelineRenderingCreateInfo.stencilAttachmentFormat = depthFormat;
 
   vk::GraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.pNext = &pipelineRenderingCreateInfo;
@@ -104,16 +143,33 @@ Pipeline::Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
   pipelineInfo.pViewportState = &viewportState;
   pipelineInfo.pRasterizationState = &rasterizer;
   pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
   pipelineInfo.pColorBlendState = &colorBlending;
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = m_PipelineLayout;
   pipelineInfo.renderPass = nullptr;
+  if (m_DescriptorBuffer)
+    pipelineInfo.flags = vk::PipelineCreateFlagBits::eDescriptorBufferEXT;
 
   m_GraphicsPipeline =
       vk::raii::Pipeline(device.GetDevice(), nullptr, pipelineInfo);
 }
 Pipeline::~Pipeline() {}
 
+void Pipeline::BindResources(Renderer::Device &device,
+                             uint32_t maxFramesInFlight,
+                             std::vector<vk::raii::Buffer> &uniformBuffers,
+                             size_t uniformBufferObjectSize,
+                             Texture &texture) {
+  RENDERER_PROFILE_ZONE("Pipeline::BindResources");
+  if (m_DescriptorBuffer)
+    throw std::runtime_error(
+        "descriptor buffer pipelines take their descriptors from a "
+        "DescriptorBuffer");
+  CreateDescriptorSets(device, maxFramesInFlight, uniformBuffers,
+                       uniformBufferObjectSize, texture);
+}
+
 std::vector<char> Pipeline::readFile(const std::string &filename) {
   std::ifstream file(filename, std::ios::ate | std::ios::binary);
   std::cout << "Opening file: " << filename << '\n'
@@ -134,11 +190,10 @@ std::vector<char> Pipeline::readFile(const std::string &filename) {
 }
 
 [[nodiscard]] vk::raii::ShaderModule
-Pipeline::createShaderModule(const std::vector<char> &code,
-                             Renderer::Device &device) {
+Pipeline::createShaderModule(ShaderCode code, Renderer::Device &device) {
   vk::ShaderModuleCreateInfo createInfo{};
-  createInfo.codeSize = code.size() * sizeof(char);
-  createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+  createInfo.codeSize = code.GetSize();
+  createInfo.pCode = code.words;
   vk::raii::ShaderModule shaderModule{device.GetDevice(), createInfo};
 
   return shaderModule;
@@ -158,81 +213,76 @@ void Pipeline::CreateDescriptorSetLayout(Renderer::Device &device) {
   textureLayoutBinding.descriptorCount = 1;
   textureLayoutBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
 
-  std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
-      uboLayoutBinding, textureLayoutBinding};
-
-  vk::DescriptorSetLayoutCreateInfo layoutInfo{};
-  layoutInfo.flags = {};
-  layoutInfo.bindingCount = bindings.size();
-  layoutInfo.pBindings = bindings.data();
-  m_DescriptorSetLayout =
-      vk::raii::DescriptorSetLayout(device.GetDevice(), layoutInfo, nullptr);
-}
-
-void Pipeline::CreateDescriptorPool(Renderer::Device &device,
-                                    uint32_t maxFramesInFlight) {
-  vk::DescriptorPoolSize uniPoolSize(vk::DescriptorType::eUniformBuffer,
-                                     maxFramesInFlight);
-  vk::DescriptorPoolSize texPoolSize(vk::DescriptorType::eCombinedImageSampler,
-                                     maxFramesInFlight);
-
-  std::array<vk::DescriptorPoolSize, 2> poolSize = {uniPoolSize, texPoolSize};
-
-  vk::DescriptorPoolCreateInfo poolInfo{};
-  poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
-  poolInfo.maxSets = maxFramesInFlight;
-  poolInfo.poolSizeCount = poolSize.size();
-  poolInfo.pPoolSizes = poolSize.data();
-
-  m_DescriptorPool = vk::raii::DescriptorPool(device.GetDevice(), poolInfo);
+  // Shared with every other user of the same bindings
+  m_DescriptorSetLayout = device.GetDescriptorSetLayout(
+      {uboLayoutBinding, textureLayoutBinding},
+      m_DescriptorBuffer
+          ? vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT
+          : vk::DescriptorSetLayoutCreateFlags{});
 }
 
 void Pipeline::CreateDescriptorSets(
     Renderer::Device &device, uint32_t maxFramesInFlight,
     std::vector<vk::raii::Buffer> &uniformBuffers,
     size_t uniformBufferObjectSize, Texture &texture) {
-  std::vector<vk::DescriptorSetLayout> layouts(maxFramesInFlight,
-                                               *m_DescriptorSetLayout);
-  vk::DescriptorSetAllocateInfo allocInfo{};
-  allocInfo.descriptorPool = *m_DescriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
-  allocInfo.pSetLayouts = layouts.data();
-
   m_DescriptorSets.clear();
-  m_DescriptorSets = device.GetDevice().allocateDescriptorSets(allocInfo);
-
-  for (size_t i = 0; i < maxFramesInFlight; i++) {
-    vk::DescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = uniformBuffers[i];
-    bufferInfo.offset = 0;
-    bufferInfo.range = uniformBufferObjectSize;
-
-    vk::DescriptorImageInfo imageInfo{};
-    imageInfo.sampler = texture.getSampler();
-    imageInfo.imageView = texture.getImageView();
-    imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-
-    vk::WriteDescriptorSet uboDescriptorWrite{};
-    uboDescriptorWrite.dstSet = m_DescriptorSets[i];
-    uboDescriptorWrite.dstBinding = 0;
-    uboDescriptorWrite.dstArrayElement = 0;
-    uboDescriptorWrite.descriptorCount = 1;
-    uboDescriptorWrite.descriptorType = vk::DescriptorType::eUniformBuffer;
-    uboDescriptorWrite.pBufferInfo = &bufferInfo;
-
-    vk::WriteDescriptorSet texDescriptorWrite{};
-    texDescriptorWrite.dstSet = m_DescriptorSets[i];
-    texDescriptorWrite.dstBinding = 1;
-    texDescriptorWrite.dstArrayElement = 0;
-    texDescriptorWrite.descriptorCount = 1;
-    texDescriptorWrite.descriptorType =
-        vk::DescriptorType::eCombinedImageSampler;
-    texDescriptorWrite.pImageInfo = &imageInfo;
-
-    std::array descriptorWrites{uboDescriptorWrite, texDescriptorWrite};
-
-    device.GetDevice().updateDescriptorSets(descriptorWrites, {});
+  for (uint32_t i = 0; i < maxFramesInFlight; i++) {
+    m_DescriptorSets.push_back(
+        m_DescriptorAllocator.Allocate(device, m_DescriptorSetLayout));
+    WriteDescriptorSet(device, m_DescriptorSets[i], *uniformBuffers[i],
+                       uniformBufferObjectSize, texture);
   }
 }
 
+void Pipeline::WriteDescriptorSet(Renderer::Device &device,
+                                  vk::DescriptorSet set,
+                                  vk::Buffer uniformBuffer,
+                                  size_t uniformBufferObjectSize,
+                                  const Texture &texture) {
+  RENDERER_PROFILE_ZONE("Pipeline::WriteDescriptorSet");
+  vk::DescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = uniformBuffer;
+  bufferInfo.offset = 0;
+  bufferInfo.range = uniformBufferObjectSize;
+
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.sampler = texture.getSampler();
+  imageInfo.imageView = texture.getImageView();
+  imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+  vk::WriteDescriptorSet uboDescriptorWrite{};
+  uboDescriptorWrite.dstSet = set;
+  uboDescriptorWrite.dstBinding = 0;
+  uboDescriptorWrite.dstArrayElement = 0;
+  uboDescriptorWrite.descriptorCount = 1;
+  uboDescriptorWrite.descriptorType = vk::DescriptorType::eUniformBuffer;
+  uboDescriptorWrite.pBufferInfo = &bufferInfo;
+
+  vk::WriteDescriptorSet texDescriptorWrite{};
+  texDescriptorWrite.dstSet = set;
+  texDescriptorWrite.dstBinding = 1;
+  texDescriptorWrite.dstArrayElement = 0;
+  texDescriptorWrite.descriptorCount = 1;
+  texDescriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+  texDescriptorWrite.pImageInfo = &imageInfo;
+
+  std::array descriptorWrites{uboDescriptorWrite, texDescriptorWrite};
+
+  device.GetDevice().updateDescriptorSets(descriptorWrites, {});
+}
+
+void Pipeline::WriteDescriptors(Renderer::Device &device,
+                                DescriptorBuffer &descriptorBuffer,
+                                vk::DeviceSize set,
+                                vk::DeviceAddress uniformBuffer,
+                                size_t uniformBufferObjectSize,
+                                const Texture &texture) {
+  RENDERER_PROFILE_ZONE("Pipeline::WriteDescriptors");
+  descriptorBuffer.WriteUniformBuffer(device, set, 0, uniformBuffer,
+                                      uniformBufferObjectSize);
+  descriptorBuffer.WriteCombinedImageSampler(device, set, 1,
+                                             texture.getImageView(),
+                                             texture.getSampler());
+}
+
 } // namespace Renderer
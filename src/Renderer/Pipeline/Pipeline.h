@@ -4,9 +4,13 @@
 
 #include <glm/glm.hpp>
 
+#include "../Descriptor/DescriptorAllocator.h"
+#include "../Descriptor/DescriptorBuffer.h"
 #include "../Device/Device.h"
 #include "../Swapchain/Swapchain.h"
 #include "../Texture/Texture.h"
+#include "ShaderCode.h"
+#include "VertexLayout.h"
 
 namespace Renderer {
 
@@ -14,33 +18,34 @@ struct Vertex {
   glm::vec3 pos;
   glm::vec3 color;
   glm::vec2 texCoord;
+};
 
-  static vk::VertexInputBindingDescription getBindingDescription() {
-    return {0, sizeof(Vertex), vk::VertexInputRate::eVertex};
-  }
+// Matches VSInput in shader.slang
+using SceneVertexLayout =
+    VertexLayout<Vertex, RENDERER_VERTEX_ATTRIBUTE(Vertex, pos, 0),
+                 RENDERER_VERTEX_ATTRIBUTE(Vertex, color, 1),
+                 RENDERER_VERTEX_ATTRIBUTE(Vertex, texCoord, 2)>;
+
+// The same inputs in 20 bytes instead of 32, for meshes whose colors and
+// texture coordinates survive the reduced precision
+struct CompactVertex {
+  glm::vec3 pos;
+  unorm8x4 color;
+  half2 texCoord;
+};
+
+using CompactVertexLayout = VertexLayout<
+    CompactVertex, RENDERER_VERTEX_ATTRIBUTE(CompactVertex, pos, 0),
+    RENDERER_VERTEX_ATTRIBUTE(CompactVertex, color, 1),
+    RENDERER_VERTEX_ATTRIBUTE(CompactVertex, texCoord, 2)>;
 
-  static std::array<vk::VertexInputAttributeDescription, 3>
-  getAttributeDescriptions() {
-    return {{
-        vk::VertexInputAttributeDescription{
-            0,                            // location
-            0,                            // binding
-            vk::Format::eR32G32B32Sfloat, // format
-            offsetof(Vertex, pos)         // offset
-        },
-        vk::VertexInputAttributeDescription{
-            1,                            // location
-            0,                            // binding
-            vk::Format::eR32G32B32Sfloat, // format
-            offsetof(Vertex, color)       // offset
-        },
-        vk::VertexInputAttributeDescription{
-            2,                         // location
-            0,                         // binding
-            vk::Format::eR32G32Sfloat, // format
-            offsetof(Vertex, texCoord) // offset
-        },
-    }};
+// Per-draw data pushed straight into the command buffer; matches
+// DrawConstants in shader.slang
+struct DrawConstants {
+  glm::mat4 model;
+
+  static vk::PushConstantRange getPushConstantRange() {
+    return {vk::ShaderStageFlagBits::eVertex, 0, sizeof(DrawConstants)};
   }
 };
 
@@ -49,24 +54,63 @@ public:
   Pipeline(Renderer::Device &device, Renderer::Swapchain &swapchain,
            uint32_t maxFramesInFlight,
            std::vector<vk::raii::Buffer> &uniformBuffers,
-           size_t uniformBufferObjectSize, Texture &texture);
+           size_t uniformBufferObjectSize, Texture &texture,
+           vk::Format depthFormat = vk::Format::eUndefined);
+  // Renders into an arbitrary color format (offscreen targets, no swapchain).
+  // A depthFormat other than eUndefined enables depth testing.
+  Pipeline(Renderer::Device &device, vk::Format colorFormat,
+           uint32_t maxFramesInFlight,
+           std::vector<vk::raii::Buffer> &uniformBuffers,
+           size_t uniformBufferObjectSize, Texture &texture,
+           vk::Format depthFormat = vk::Format::eUndefined);
+  // Compiles the pipeline only; descriptor sets come later from
+  // BindResources. Needs nothing but the device, so startup can build it
+  // while resources are still being uploaded. With descriptorBuffer the
+  // layout and pipeline are made for VK_EXT_descriptor_buffer, and
+  // descriptors go through WriteDescriptors instead of sets.
+  Pipeline(Renderer::Device &device, vk::Format colorFormat,
+           vk::Format depthFormat, bool descriptorBuffer = false);
   ~Pipeline();
 
+  void BindResources(Renderer::Device &device, uint32_t maxFramesInFlight,
+                     std::vector<vk::raii::Buffer> &uniformBuffers,
+                     size_t uniformBufferObjectSize, Texture &texture);
+
   vk::raii::Pipeline &Get() { return m_GraphicsPipeline; }
   vk::raii::PipelineLayout &GetLayout() { return m_PipelineLayout; }
-  std::vector<vk::raii::DescriptorSet> &GetDescriptorSets() {
+  vk::DescriptorSetLayout GetDescriptorSetLayout() const {
+    return m_DescriptorSetLayout;
+  }
+  // One per frame in flight, from BindResources
+  std::vector<vk::DescriptorSet> &GetDescriptorSets() {
     return m_DescriptorSets;
   }
 
-private:
+  // Points `set` (allocated with GetDescriptorSetLayout()) at the uniform
+  // buffer and the texture's current view, e.g. a transient per-frame set
+  static void WriteDescriptorSet(Renderer::Device &device,
+                                 vk::DescriptorSet set,
+                                 vk::Buffer uniformBuffer,
+                                 size_t uniformBufferObjectSize,
+                                 const Texture &texture);
+  // Same bindings written into a descriptor buffer set
+  static void WriteDescriptors(Renderer::Device &device,
+                               DescriptorBuffer &descriptorBuffer,
+                               vk::DeviceSize set,
+                               vk::DeviceAddress uniformBuffer,
+                               size_t uniformBufferObjectSize,
+                               const Texture &texture);
+
+  bool UsesDescriptorBuffer() const { return m_DescriptorBuffer; }
+
   static std::vector<char> readFile(const std::string &filename);
 
+private:
+
   [[nodiscard]] vk::raii::ShaderModule
-  createShaderModule(const std::vector<char> &code, Renderer::Device &device);
+  createShaderModule(ShaderCode code, Renderer::Device &device);
 
   void CreateDescriptorSetLayout(Renderer::Device &device);
-  void CreateDescriptorPool(Renderer::Device &device,
-                            uint32_t maxFramesInFlight);
   void CreateDescriptorSets(Renderer::Device &device,
                             uint32_t maxFramesInFlight,
                             std::vector<vk::raii::Buffer> &uniformBuffers,
@@ -76,9 +120,14 @@ private:
   vk::raii::PipelineLayout m_PipelineLayout = nullptr;
   vk::raii::Pipeline m_GraphicsPipeline = nullptr;
 
-  vk::raii::DescriptorSetLayout m_DescriptorSetLayout = nullptr;
-  vk::raii::DescriptorPool m_DescriptorPool = nullptr;
-  std::vector<vk::raii::DescriptorSet> m_DescriptorSets;
+  vk::DescriptorSetLayout m_DescriptorSetLayout;
+  bool m_DescriptorBuffer = false;
+  // Only the per-frame sets of BindResources
+  DescriptorAllocator m_DescriptorAllocator{
+      {{vk::DescriptorType::eUniformBuffer, 1.0f},
+       {vk::DescriptorType::eCombinedImageSampler, 1.0f}},
+      4};
+  std::vector<vk::DescriptorSet> m_DescriptorSets;
 };
 
 } // namespace Renderer
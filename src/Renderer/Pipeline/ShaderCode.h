@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Renderer {
+
+// Numeric class of a shader input or a vertex attribute format. Normalized
+// formats read as Float.
+enum class ShaderNumericType : uint8_t { None, Float, SInt, UInt };
+
+// Non-owning view of a SPIR-V module. Usually one of the constexpr arrays
+// the build embeds from shaders/*.slang, e.g.
+//   #include "shaders/shader.spv.h"
+//   ShaderCode code(Shaders::SceneShader);
+struct ShaderCode {
+  const uint32_t *words = nullptr;
+  size_t wordCount = 0;
+
+  constexpr ShaderCode(const uint32_t *code, size_t count)
+      : words(code), wordCount(count) {}
+  template <size_t N>
+  constexpr ShaderCode(const uint32_t (&code)[N]) : words(code), wordCount(N) {}
+
+  size_t GetSize() const { return wordCount * sizeof(uint32_t); }
+
+  // Calls fn(location, numericType) for every user input of the vertex
+  // entry point `entryPoint`; builtins are skipped. Stops at the first fn
+  // returning false. Returns false if it stopped, or if the entry point is
+  // missing or an input has no location. Usable in constant expressions
+  // over the embedded arrays, so mismatches can fail the build.
+  template <typename Fn>
+  constexpr bool VisitVertexInputs(const char *entryPoint, Fn &&fn) const {
+    for (size_t i = HEADER_WORDS; i < wordCount;) {
+      size_t length = words[i] >> 16;
+      if (length == 0 || i + length > wordCount)
+        return false;
+      if ((words[i] & 0xFFFF) == OP_ENTRY_POINT &&
+          words[i + 1] == EXECUTION_MODEL_VERTEX) {
+        size_t interface = MatchString(i + 3, i + length, entryPoint);
+        if (interface != 0)
+          return VisitInputs(interface, i + length, fn);
+      }
+      i += length;
+    }
+    return false;
+  }
+
+private:
+  static constexpr size_t HEADER_WORDS = 5;
+  static constexpr uint32_t OP_TYPE_INT = 21;
+  static constexpr uint32_t OP_TYPE_FLOAT = 22;
+  static constexpr uint32_t OP_TYPE_VECTOR = 23;
+  static constexpr uint32_t OP_TYPE_POINTER = 32;
+  static constexpr uint32_t OP_ENTRY_POINT = 15;
+  static constexpr uint32_t OP_VARIABLE = 59;
+  static constexpr uint32_t OP_DECORATE = 71;
+  static constexpr uint32_t EXECUTION_MODEL_VERTEX = 0;
+  static constexpr uint32_t STORAGE_CLASS_INPUT = 1;
+  static constexpr uint32_t DECORATION_BUILTIN = 11;
+  static constexpr uint32_t DECORATION_LOCATION = 30;
+
+  // Compares the literal string at `first` with `name`. Returns the word
+  // after the string if they are equal, 0 otherwise.
+  constexpr size_t MatchString(size_t first, size_t end,
+                               const char *name) const {
+    for (size_t c = 0; first + c / 4 < end; ++c) {
+      char byte = static_cast<char>(words[first + c / 4] >> (c % 4 * 8));
+      if (byte != name[c])
+        return 0;
+      if (byte == '\0')
+        return first + c / 4 + 1;
+    }
+    return 0;
+  }
+
+  // Word index of the instruction with `opcode` whose word `idWord` is
+  // `id`, 0 if there is none
+  constexpr size_t FindInstruction(uint32_t opcode, size_t idWord,
+                                   uint32_t id) const {
+    for (size_t i = HEADER_WORDS; i < wordCount;) {
+      size_t length = words[i] >> 16;
+      if (length == 0)
+        return 0;
+      if ((words[i] & 0xFFFF) == opcode && idWord < length &&
+          words[i + idWord] == id)
+        return i;
+      i += length;
+    }
+    return 0;
+  }
+
+  constexpr bool FindDecoration(uint32_t id, uint32_t decoration,
+                                uint32_t &value) const {
+    for (size_t i = HEADER_WORDS; i < wordCount;) {
+      size_t length = words[i] >> 16;
+      if (length == 0)
+        return false;
+      if ((words[i] & 0xFFFF) == OP_DECORATE && length >= 3 &&
+          words[i + 1] == id && words[i + 2] == decoration) {
+        value = length > 3 ? words[i + 3] : 0;
+        return true;
+      }
+      i += length;
+    }
+    return false;
+  }
+
+  constexpr ShaderNumericType NumericTypeOf(uint32_t typeId) const {
+    if (size_t vector = FindInstruction(OP_TYPE_VECTOR, 1, typeId))
+      typeId = words[vector + 2];
+    if (FindInstruction(OP_TYPE_FLOAT, 1, typeId))
+      return ShaderNumericType::Float;
+    if (size_t integer = FindInstruction(OP_TYPE_INT, 1, typeId))
+      return words[integer + 3] ? ShaderNumericType::SInt
+                                : ShaderNumericType::UInt;
+    return ShaderNumericType::None;
+  }
+
+  template <typename Fn>
+  constexpr bool VisitInputs(size_t first, size_t end, Fn &fn) const {
+    // From SPIR-V 1.4 on the interface lists every global, not just the
+    // inputs and outputs
+    for (size_t k = first; k < end; ++k) {
+      uint32_t id = words[k];
+      size_t variable = FindInstruction(OP_VARIABLE, 2, id);
+      if (variable == 0 || words[variable + 3] != STORAGE_CLASS_INPUT)
+        continue;
+      uint32_t value = 0;
+      if (FindDecoration(id, DECORATION_BUILTIN, value))
+        continue;
+      uint32_t location = 0;
+      if (!FindDecoration(id, DECORATION_LOCATION, location))
+        return false;
+      size_t pointer = FindInstruction(OP_TYPE_POINTER, 1, words[variable + 1]);
+      ShaderNumericType type = pointer ? NumericTypeOf(words[pointer + 3])
+                                       : ShaderNumericType::None;
+      if (!fn(location, type))
+        return false;
+    }
+    return true;
+  }
+};
+
+} // namespace Renderer
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "ShaderCode.h"
+
+namespace Renderer {
+
+// Packed attribute types. They hold the encoded bits; FromFloat does the
+// conversion when a vertex is written.
+struct half2 {
+  uint16_t x, y;
+  static half2 FromFloat(const glm::vec2 &v) {
+    return {glm::packHalf1x16(v.x), glm::packHalf1x16(v.y)};
+  }
+};
+struct half4 {
+  uint16_t x, y, z, w;
+  static half4 FromFloat(const glm::vec4 &v) {
+    return {glm::packHalf1x16(v.x), glm::packHalf1x16(v.y),
+            glm::packHalf1x16(v.z), glm::packHalf1x16(v.w)};
+  }
+};
+struct snorm16x2 {
+  int16_t x, y;
+  static snorm16x2 FromFloat(const glm::vec2 &v) {
+    return {static_cast<int16_t>(glm::packSnorm1x16(v.x)),
+            static_cast<int16_t>(glm::packSnorm1x16(v.y))};
+  }
+};
+struct snorm16x4 {
+  int16_t x, y, z, w;
+  static snorm16x4 FromFloat(const glm::vec4 &v) {
+    return {static_cast<int16_t>(glm::packSnorm1x16(v.x)),
+            static_cast<int16_t>(glm::packSnorm1x16(v.y)),
+            static_cast<int16_t>(glm::packSnorm1x16(v.z)),
+            static_cast<int16_t>(glm::packSnorm1x16(v.w))};
+  }
+};
+struct unorm16x2 {
+  uint16_t x, y;
+  static unorm16x2 FromFloat(const glm::vec2 &v) {
+    return {glm::packUnorm1x16(v.x), glm::packUnorm1x16(v.y)};
+  }
+};
+struct unorm8x4 {
+  uint8_t x, y, z, w;
+  static unorm8x4 FromFloat(const glm::vec4 &v) {
+    return {glm::packUnorm1x8(v.x), glm::packUnorm1x8(v.y),
+            glm::packUnorm1x8(v.z), glm::packUnorm1x8(v.w)};
+  }
+};
+struct snorm8x4 {
+  int8_t x, y, z, w;
+  static snorm8x4 FromFloat(const glm::vec4 &v) {
+    return {static_cast<int8_t>(glm::packSnorm1x8(v.x)),
+            static_cast<int8_t>(glm::packSnorm1x8(v.y)),
+            static_cast<int8_t>(glm::packSnorm1x8(v.z)),
+            static_cast<int8_t>(glm::packSnorm1x8(v.w))};
+  }
+};
+
+template <vk::Format Format, ShaderNumericType Numeric>
+struct VertexFormatInfo {
+  static constexpr vk::Format FORMAT = Format;
+  static constexpr ShaderNumericType NUMERIC = Numeric;
+};
+
+// Vulkan format for each attribute type. Types without a specialization do
+// not compile as attributes.
+template <typename T> struct VertexFormat;
+
+// clang-format off
+template <> struct VertexFormat<float>
+    : VertexFormatInfo<vk::Format::eR32Sfloat, ShaderNumericType::Float> {};
+template <> struct VertexFormat<glm::vec2>
+    : VertexFormatInfo<vk::Format::eR32G32Sfloat, ShaderNumericType::Float> {};
+template <> struct VertexFormat<glm::vec3>
+    : VertexFormatInfo<vk::Format::eR32G32B32Sfloat,
+                       ShaderNumericType::Float> {};
+template <> struct VertexFormat<glm::vec4>
+    : VertexFormatInfo<vk::Format::eR32G32B32A32Sfloat,
+                       ShaderNumericType::Float> {};
+template <> struct VertexFormat<uint32_t>
+    : VertexFormatInfo<vk::Format::eR32Uint, ShaderNumericType::UInt> {};
+template <> struct VertexFormat<glm::uvec4>
+    : VertexFormatInfo<vk::Format::eR32G32B32A32Uint,
+                       ShaderNumericType::UInt> {};
+template <> struct VertexFormat<half2>
+    : VertexFormatInfo<vk::Format::eR16G16Sfloat, ShaderNumericType::Float> {};
+template <> struct VertexFormat<half4>
+    : VertexFormatInfo<vk::Format::eR16G16B16A16Sfloat,
+                       ShaderNumericType::Float> {};
+template <> struct VertexFormat<snorm16x2>
+    : VertexFormatInfo<vk::Format::eR16G16Snorm, ShaderNumericType::Float> {};
+template <> struct VertexFormat<snorm16x4>
+    : VertexFormatInfo<vk::Format::eR16G16B16A16Snorm,
+                       ShaderNumericType::Float> {};
+template <> struct VertexFormat<unorm16x2>
+    : VertexFormatInfo<vk::Format::eR16G16Unorm, ShaderNumericType::Float> {};
+template <> struct VertexFormat<unorm8x4>
+    : VertexFormatInfo<vk::Format::eR8G8B8A8Unorm, ShaderNumericType::Float> {};
+template <> struct VertexFormat<snorm8x4>
+    : VertexFormatInfo<vk::Format::eR8G8B8A8Snorm, ShaderNumericType::Float> {};
+// clang-format on
+
+template <typename T, uint32_t Offset, uint32_t Location>
+struct VertexAttribute {
+  using Type = T;
+  static constexpr uint32_t OFFSET = Offset;
+  static constexpr uint32_t LOCATION = Location;
+  static constexpr uint32_t SIZE = sizeof(T);
+  static constexpr vk::Format FORMAT = VertexFormat<T>::FORMAT;
+  static constexpr ShaderNumericType NUMERIC = VertexFormat<T>::NUMERIC;
+};
+
+// Attribute for `member` of `vertex` at shader input `location`
+#define RENDERER_VERTEX_ATTRIBUTE(vertex, member, location)                   \
+  ::Renderer::VertexAttribute<decltype(vertex::member),                       \
+                              offsetof(vertex, member), location>
+
+template <uint32_t... Locations> constexpr bool HasUniqueLocations() {
+  constexpr uint32_t locations[] = {Locations...};
+  for (size_t i = 0; i < sizeof...(Locations); ++i) {
+    for (size_t j = i + 1; j < sizeof...(Locations); ++j) {
+      if (locations[i] == locations[j])
+        return false;
+    }
+  }
+  return true;
+}
+
+// Vertex input state of one interleaved vertex buffer binding, derived
+// from the vertex struct at compile time:
+//
+//   struct CompactVertex { glm::vec3 pos; unorm8x4 color; half2 uv; };
+//   using CompactLayout =
+//       VertexLayout<CompactVertex,
+//                    RENDERER_VERTEX_ATTRIBUTE(CompactVertex, pos, 0),
+//                    RENDERER_VERTEX_ATTRIBUTE(CompactVertex, color, 1),
+//                    RENDERER_VERTEX_ATTRIBUTE(CompactVertex, uv, 2)>;
+//   static_assert(CompactLayout::MatchesShader(code, "vertMain"));
+template <typename VertexT, typename... Attributes> class VertexLayout {
+public:
+  static constexpr uint32_t STRIDE = sizeof(VertexT);
+  static constexpr uint32_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+
+  static_assert(std::is_standard_layout_v<VertexT>,
+                "vertex offsets come from offsetof");
+  static_assert(ATTRIBUTE_COUNT > 0, "vertex layout without attributes");
+  static_assert(((Attributes::OFFSET + Attributes::SIZE <= STRIDE) && ...),
+                "vertex attribute extends past the vertex");
+  static_assert(HasUniqueLocations<Attributes::LOCATION...>(),
+                "two vertex attributes share a location");
+
+  static constexpr vk::VertexInputBindingDescription GetBindingDescription(
+      uint32_t binding = 0,
+      vk::VertexInputRate inputRate = vk::VertexInputRate::eVertex) {
+    vk::VertexInputBindingDescription description{};
+    description.binding = binding;
+    description.stride = STRIDE;
+    description.inputRate = inputRate;
+    return description;
+  }
+
+  static constexpr std::array<vk::VertexInputAttributeDescription,
+                              ATTRIBUTE_COUNT>
+  GetAttributeDescriptions(uint32_t binding = 0) {
+    return {MakeAttribute<Attributes>(binding)...};
+  }
+
+  // True if every user input of the vertex entry point has an attribute at
+  // its location with the same numeric type (float, signed or unsigned).
+  // Attributes the shader does not read are allowed.
+  static constexpr bool MatchesShader(ShaderCode code,
+                                      const char *entryPoint) {
+    return code.VisitVertexInputs(
+        entryPoint, [](uint32_t location, ShaderNumericType type) {
+          for (size_t i = 0; i < ATTRIBUTE_COUNT; ++i) {
+            if (LOCATIONS[i] == location)
+              return NUMERICS[i] == type;
+          }
+          return false;
+        });
+  }
+
+private:
+  static constexpr std::array<uint32_t, ATTRIBUTE_COUNT> LOCATIONS = {
+      Attributes::LOCATION...};
+  static constexpr std::array<ShaderNumericType, ATTRIBUTE_COUNT> NUMERICS =
+      {Attributes::NUMERIC...};
+
+  template <typename Attribute>
+  static constexpr vk::VertexInputAttributeDescription
+  MakeAttribute(uint32_t binding) {
+    vk::VertexInputAttributeDescription description{};
+    description.location = Attribute::LOCATION;
+    description.binding = binding;
+    description.format = Attribute::FORMAT;
+    description.offset = Attribute::OFFSET;
+    return description;
+  }
+};
+
+} // namespace Renderer
@@ -0,0 +1,116 @@
+#include "GpuProfiler.h"
+
+namespace Renderer {
+
+GpuProfiler::GpuProfiler(Renderer::Device &device,
+                         Renderer::CommandPool &commandPool,
+                         uint32_t framesInFlight, uint32_t maxZonesPerFrame)
+    : m_MaxZonesPerFrame(maxZonesPerFrame), m_ZoneNames(framesInFlight) {
+  uint32_t validBits =
+      device.GetPhysicalDevice()
+          .getQueueFamilyProperties()[device.GetGraphicsIndex()]
+          .timestampValidBits;
+  if (validBits == 0)
+    return;
+
+  m_TimestampPeriod =
+      device.GetPhysicalDevice().getProperties().limits.timestampPeriod;
+  if (validBits < 64)
+    m_TimestampMask = (1ull << validBits) - 1;
+
+  vk::QueryPoolCreateInfo poolInfo{};
+  poolInfo.queryType = vk::QueryType::eTimestamp;
+  poolInfo.queryCount = framesInFlight * maxZonesPerFrame * 2 + 1;
+  m_QueryPool = vk::raii::QueryPool(device.GetDevice(), poolInfo);
+
+  Calibrate(device, commandPool);
+}
+
+void GpuProfiler::Calibrate(Renderer::Device &device,
+                            Renderer::CommandPool &commandPool) {
+  if (!HasTimestamps())
+    return;
+
+  uint32_t query =
+      static_cast<uint32_t>(m_ZoneNames.size()) * m_MaxZonesPerFrame * 2;
+  vk::raii::CommandBuffer commandBuffer =
+      commandPool.beginSingleTimeCommands(device);
+  commandBuffer.resetQueryPool(*m_QueryPool, query, 1);
+  commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                                *m_QueryPool, query);
+
+  // The timestamp lands somewhere between submit and the wait returning
+  uint64_t submitNs = Profiler::Now();
+  commandPool.endSingleTimeCommands(device, commandBuffer);
+  uint64_t completeNs = Profiler::Now();
+
+  auto [result, ticks] = m_QueryPool.getResult<uint64_t>(
+      query, 1, sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+  if (result != vk::Result::eSuccess)
+    return;
+  m_CalibrationTicks = ticks & m_TimestampMask;
+  m_CalibrationNs = submitNs + (completeNs - submitNs) / 2;
+}
+
+uint64_t GpuProfiler::ToProfilerNs(uint64_t ticks) const {
+  // Masked so a counter that wrapped since calibration still maps forward
+  uint64_t elapsed = (ticks - m_CalibrationTicks) & m_TimestampMask;
+  return m_CalibrationNs +
+         static_cast<uint64_t>(static_cast<double>(elapsed) *
+                               m_TimestampPeriod);
+}
+
+void GpuProfiler::BeginFrame(const vk::raii::CommandBuffer &commandBuffer,
+                             uint32_t frameIndex) {
+  m_FrameIndex = frameIndex;
+  if (!HasTimestamps())
+    return;
+
+  uint32_t firstQuery = frameIndex * m_MaxZonesPerFrame * 2;
+  std::vector<const char *> &names = m_ZoneNames[frameIndex];
+  if (!names.empty()) {
+    // The slot's fence has signalled, so this doesn't stall
+    uint32_t queryCount = static_cast<uint32_t>(names.size()) * 2;
+    auto [result, ticks] = m_QueryPool.getResults<uint64_t>(
+        firstQuery, queryCount, queryCount * sizeof(uint64_t),
+        sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess) {
+      Profiler &profiler = Profiler::Get();
+      for (size_t i = 0; i < names.size(); ++i) {
+        profiler.Record(names[i], ToProfilerNs(ticks[i * 2]),
+                        ToProfilerNs(ticks[i * 2 + 1]), true);
+      }
+    }
+    names.clear();
+  }
+
+  commandBuffer.resetQueryPool(*m_QueryPool, firstQuery,
+                               m_MaxZonesPerFrame * 2);
+}
+
+uint32_t GpuProfiler::BeginZone(const vk::raii::CommandBuffer &commandBuffer,
+                                const char *name) {
+  std::vector<const char *> &names = m_ZoneNames[m_FrameIndex];
+  if (!HasTimestamps() || names.size() == m_MaxZonesPerFrame)
+    return NO_ZONE;
+
+  uint32_t zone = static_cast<uint32_t>(names.size());
+  names.push_back(name);
+  commandBuffer.writeTimestamp2(
+      vk::PipelineStageFlagBits2::eTopOfPipe, *m_QueryPool,
+      (m_FrameIndex * m_MaxZonesPerFrame + zone) * 2);
+  return zone;
+}
+
+void GpuProfiler::EndZone(const vk::raii::CommandBuffer &commandBuffer,
+                          uint32_t zone) {
+  if (zone == NO_ZONE)
+    return;
+
+  commandBuffer.writeTimestamp2(
+      vk::PipelineStageFlagBits2::eAllCommands, *m_QueryPool,
+      (m_FrameIndex * m_MaxZonesPerFrame + zone) * 2 + 1);
+}
+
+} // namespace Renderer
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Command/CommandPool.h"
+#include "../Device/Device.h"
+#include "Profiler.h"
+
+namespace Renderer {
+
+// GPU zones from timestamp pairs on the graphics queue, merged into the
+// Profiler timeline on a track of their own. Each frame in flight owns a
+// range of queries; once the frame's fence has been waited on, BeginFrame
+// reads the slot's zones back and records them.
+//
+// GPU ticks are mapped onto Profiler::Now() by one calibration submission at
+// construction, accurate to the submit latency; Calibrate() again after long
+// runs if the clocks drift apart.
+class GpuProfiler {
+public:
+  static constexpr uint32_t NO_ZONE = ~0u;
+
+  GpuProfiler(Renderer::Device &device, Renderer::CommandPool &commandPool,
+              uint32_t framesInFlight, uint32_t maxZonesPerFrame = 32);
+
+  // Records the slot's previous zones and resets its queries. Call right
+  // after beginning the frame's command buffer, outside any render pass.
+  void BeginFrame(const vk::raii::CommandBuffer &commandBuffer,
+                  uint32_t frameIndex);
+
+  // NO_ZONE (which EndZone ignores) without timestamp support or once the
+  // frame's zones are used up. `name` must outlive the profiler.
+  uint32_t BeginZone(const vk::raii::CommandBuffer &commandBuffer,
+                     const char *name);
+  void EndZone(const vk::raii::CommandBuffer &commandBuffer, uint32_t zone);
+
+  // Blocks on a one-off submission
+  void Calibrate(Renderer::Device &device, Renderer::CommandPool &commandPool);
+
+  bool HasTimestamps() const { return m_TimestampPeriod > 0.0f; }
+
+private:
+  uint64_t ToProfilerNs(uint64_t ticks) const;
+
+private:
+  uint32_t m_MaxZonesPerFrame;
+  uint32_t m_FrameIndex = 0;
+
+  // Nanoseconds per timestamp tick, 0 when the queue can't write them
+  float m_TimestampPeriod = 0.0f;
+  uint64_t m_TimestampMask = ~0ull;
+  // Two queries per zone per frame, then one for calibration
+  vk::raii::QueryPool m_QueryPool = nullptr;
+
+  // Zone names per frame slot, in query order
+  std::vector<std::vector<const char *>> m_ZoneNames;
+
+  uint64_t m_CalibrationTicks = 0;
+  uint64_t m_CalibrationNs = 0;
+};
+
+// Brackets the enclosing scope's commands with a GPU zone; a null profiler
+// records nothing
+class GpuProfileZone {
+public:
+  GpuProfileZone(GpuProfiler *profiler,
+                 const vk::raii::CommandBuffer &commandBuffer,
+                 const char *name)
+      : m_Profiler(profiler), m_CommandBuffer(commandBuffer) {
+    if (m_Profiler)
+      m_Zone = m_Profiler->BeginZone(commandBuffer, name);
+  }
+  ~GpuProfileZone() {
+    if (m_Profiler)
+      m_Profiler->EndZone(m_CommandBuffer, m_Zone);
+  }
+
+  GpuProfileZone(const GpuProfileZone &) = delete;
+  GpuProfileZone &operator=(const GpuProfileZone &) = delete;
+
+private:
+  GpuProfiler *m_Profiler;
+  const vk::raii::CommandBuffer &m_CommandBuffer;
+  uint32_t m_Zone = GpuProfiler::NO_ZONE;
+};
+
+} // namespace Renderer
+
+#if RENDERER_PROFILING
+#define RENDERER_PROFILE_GPU_ZONE(profiler, commandBuffer, name)               \
+  ::Renderer::GpuProfileZone RENDERER_PROFILE_CONCAT(gpuZone, __LINE__)(       \
+      profiler, commandBuffer, name)
+#else
+#define RENDERER_PROFILE_GPU_ZONE(profiler, commandBuffer, name) ((void)0)
+#endif
@@ -0,0 +1,127 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+
+std::string escapeJson(const char *in) {
+  std::string out;
+  for (; in && *in; ++in) {
+    char c = *in;
+    if (c == '"' || c == '\\')
+      out.push_back('\\');
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out.push_back(c);
+  }
+  return out;
+}
+
+} // namespace
+
+thread_local Profiler::ThreadBuffer *Profiler::m_ThreadBuffer = nullptr;
+
+Profiler &Profiler::Get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+uint64_t Profiler::Now() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+Profiler::ThreadBuffer &Profiler::GetThreadBuffer() {
+  if (m_ThreadBuffer)
+    return *m_ThreadBuffer;
+
+  auto buffer = std::make_unique<ThreadBuffer>();
+  buffer->events.resize(RING_CAPACITY);
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  buffer->threadId = static_cast<uint32_t>(m_Buffers.size()) + 1;
+  buffer->name = "Thread " + std::to_string(buffer->threadId);
+  m_ThreadBuffer = buffer.get();
+  m_Buffers.push_back(std::move(buffer));
+  return *m_Buffers.back();
+}
+
+void Profiler::SetThreadName(const std::string &name) {
+  ThreadBuffer &buffer = GetThreadBuffer();
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  buffer.name = name;
+}
+
+void Profiler::Record(const char *name, uint64_t startNs, uint64_t endNs,
+                      bool gpu) {
+  ThreadBuffer &buffer = GetThreadBuffer();
+
+  uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+  if (tail - buffer.head.load(std::memory_order_acquire) == RING_CAPACITY) {
+    m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ProfileEvent &event = buffer.events[tail % RING_CAPACITY];
+  event.name = name;
+  event.startNs = startNs;
+  event.endNs = endNs;
+  event.gpu = gpu;
+  buffer.tail.store(tail + 1, std::memory_order_release);
+}
+
+void Profiler::Collect() {
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  for (const std::unique_ptr<ThreadBuffer> &buffer : m_Buffers) {
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    uint64_t tail = buffer->tail.load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+      ProfileEvent event = buffer->events[head % RING_CAPACITY];
+      event.threadId = event.gpu ? GPU_THREAD_ID : buffer->threadId;
+      m_History.push_back(event);
+    }
+    // Hands the slots back to the producer
+    buffer->head.store(tail, std::memory_order_release);
+  }
+
+  while (m_History.size() > MAX_HISTORY_EVENTS)
+    m_History.pop_front();
+}
+
+void Profiler::WriteChromeTrace(const std::string &path) {
+  Collect();
+
+  std::ofstream out(path);
+  if (!out.is_open())
+    throw std::runtime_error("failed to open trace output: " + path);
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  // Timestamps are microseconds; keep nanosecond resolution
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+      << GPU_THREAD_ID << ", \"args\": {\"name\": \"GPU\"}}";
+  for (const std::unique_ptr<ThreadBuffer> &buffer : m_Buffers) {
+    out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+        << "\"tid\": " << buffer->threadId << ", \"args\": {\"name\": \""
+        << escapeJson(buffer->name.c_str()) << "\"}}";
+  }
+  for (const ProfileEvent &event : m_History) {
+    uint64_t duration =
+        event.endNs > event.startNs ? event.endNs - event.startNs : 0;
+    out << ",\n{\"name\": \"" << escapeJson(event.name) << "\", \"cat\": \""
+        << (event.gpu ? "gpu" : "cpu")
+        << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.threadId
+        << ", \"ts\": " << event.startNs / 1000.0
+        << ", \"dur\": " << duration / 1000.0 << "}";
+  }
+  out << "\n]}\n";
+}
+
+} // namespace Renderer
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Profiling zones are only compiled in with -DRENDERER_PROFILING=1 (CMake
+// option RENDERER_PROFILING); otherwise the macros below expand to nothing.
+#ifndef RENDERER_PROFILING
+#define RENDERER_PROFILING 0
+#endif
+
+namespace Renderer {
+
+constexpr bool PROFILING_ENABLED = RENDERER_PROFILING != 0;
+
+struct ProfileEvent {
+  // String literal (or otherwise never freed)
+  const char *name = nullptr;
+  // Profiler::Now() clock
+  uint64_t startNs = 0;
+  uint64_t endNs = 0;
+  // Filled by Collect
+  uint32_t threadId = 0;
+  bool gpu = false;
+};
+
+// Process-wide timeline of scoped zones. Each thread records into its own
+// fixed-size ring without locking; Collect, called once per frame, drains
+// the rings into a bounded history of the most recent events, and
+// WriteChromeTrace exports that history as Chrome trace JSON (opens in
+// chrome://tracing and ui.perfetto.dev). A full ring drops events rather
+// than blocking the thread that records them.
+//
+// Zone names are stored by pointer, so they have to outlive the profiler:
+// string literals, __func__.
+class Profiler {
+public:
+  static constexpr uint32_t RING_CAPACITY = 8192;
+  static constexpr size_t MAX_HISTORY_EVENTS = 1 << 18;
+  // Trace thread id of GPU zones; CPU threads count up from 1
+  static constexpr uint32_t GPU_THREAD_ID = 0;
+
+  static Profiler &Get();
+
+  // Nanoseconds on the steady clock, the timebase of every event
+  static uint64_t Now();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  // Names the calling thread in the trace
+  void SetThreadName(const std::string &name);
+
+  // Lock-free unless this is the calling thread's first event. GPU events
+  // (GpuProfiler) are recorded by the thread that reads them back and
+  // shown on a track of their own.
+  void Record(const char *name, uint64_t startNs, uint64_t endNs,
+              bool gpu = false);
+
+  // Moves the threads' recorded events into the history, dropping the
+  // oldest beyond MAX_HISTORY_EVENTS
+  void Collect();
+
+  // Collects, then writes the history; throws if the file can't be written
+  void WriteChromeTrace(const std::string &path);
+
+  uint64_t GetDroppedCount() const {
+    return m_DroppedCount.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Single producer (the owning thread), single consumer (Collect, under
+  // m_Mutex). Positions only grow; the slot is position % RING_CAPACITY.
+  struct ThreadBuffer {
+    std::vector<ProfileEvent> events;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    uint32_t threadId = 0;
+    std::string name;
+  };
+
+  Profiler() = default;
+
+  ThreadBuffer &GetThreadBuffer();
+
+private:
+  // Guards the buffer list, thread names and the history
+  std::mutex m_Mutex;
+  // Buffers outlive their threads, so events of finished threads still get
+  // collected
+  std::vector<std::unique_ptr<ThreadBuffer>> m_Buffers;
+  std::deque<ProfileEvent> m_History;
+  std::atomic<uint64_t> m_DroppedCount{0};
+
+  // The calling thread's entry of m_Buffers, once it has one
+  static thread_local ThreadBuffer *m_ThreadBuffer;
+};
+
+// Records the enclosing scope as one zone
+class ProfileZone {
+public:
+  explicit ProfileZone(const char *name)
+      : m_Name(name), m_StartNs(Profiler::Now()) {}
+  ~ProfileZone() {
+    Profiler::Get().Record(m_Name, m_StartNs, Profiler::Now());
+  }
+
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone &operator=(const ProfileZone &) = delete;
+
+private:
+  const char *m_Name;
+  uint64_t m_StartNs;
+};
+
+} // namespace Renderer
+
+#define RENDERER_PROFILE_CONCAT_INNER(a, b) a##b
+#define RENDERER_PROFILE_CONCAT(a, b) RENDERER_PROFILE_CONCAT_INNER(a, b)
+
+#if RENDERER_PROFILING
+#define RENDERER_PROFILE_ZONE(name)                                            \
+  ::Renderer::ProfileZone RENDERER_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define RENDERER_PROFILE_FUNCTION() RENDERER_PROFILE_ZONE(__func__)
+#define RENDERER_PROFILE_THREAD(name)                                          \
+  ::Renderer::Profiler::Get().SetThreadName(name)
+#else
+#define RENDERER_PROFILE_ZONE(name) ((void)0)
+#define RENDERER_PROFILE_FUNCTION() ((void)0)
+#define RENDERER_PROFILE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,175 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Renderer {
+
+DynamicResolution::DynamicResolution(Renderer::Device &device,
+                                     uint32_t framesInFlight,
+                                     const DynamicResolutionSettings &settings)
+    : m_Settings(settings), m_Scale(settings.maxScale),
+      m_QueriesWritten(framesInFlight, false) {
+  uint32_t validBits =
+      device.GetPhysicalDevice()
+          .getQueueFamilyProperties()[device.GetGraphicsIndex()]
+          .timestampValidBits;
+  if (validBits == 0)
+    return;
+
+  m_TimestampPeriod =
+      device.GetPhysicalDevice().getProperties().limits.timestampPeriod;
+  if (validBits < 64)
+    m_TimestampMask = (1ull << validBits) - 1;
+
+  vk::QueryPoolCreateInfo poolInfo{};
+  poolInfo.queryType = vk::QueryType::eTimestamp;
+  poolInfo.queryCount = framesInFlight * 2;
+  m_QueryPool = vk::raii::QueryPool(device.GetDevice(), poolInfo);
+}
+
+DynamicResolution::~DynamicResolution() {}
+
+void DynamicResolution::BeginFrame(
+    const vk::raii::CommandBuffer &commandBuffer, uint32_t frameIndex) {
+  if (!HasTimestamps())
+    return;
+
+  uint32_t firstQuery = frameIndex * 2;
+  if (m_QueriesWritten[frameIndex]) {
+    // The slot's fence has signalled, so this doesn't stall
+    auto [result, ticks] = m_QueryPool.getResults<uint64_t>(
+        firstQuery, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64);
+    if (result == vk::Result::eSuccess) {
+      uint64_t elapsed = (ticks[1] - ticks[0]) & m_TimestampMask;
+      Update(static_cast<float>(static_cast<double>(elapsed) *
+                                m_TimestampPeriod * 1e-6));
+    }
+  }
+
+  commandBuffer.resetQueryPool(*m_QueryPool, firstQuery, 2);
+  commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe,
+                                *m_QueryPool, firstQuery);
+  m_QueriesWritten[frameIndex] = true;
+}
+
+void DynamicResolution::EndFrame(const vk::raii::CommandBuffer &commandBuffer,
+                                 uint32_t frameIndex) {
+  if (!HasTimestamps())
+    return;
+
+  commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                                *m_QueryPool, frameIndex * 2 + 1);
+}
+
+void DynamicResolution::Update(float gpuFrameMs) {
+  m_GpuFrameMs = gpuFrameMs;
+  if (gpuFrameMs <= 0.0f)
+    return;
+
+  // GPU cost follows the pixel count, which goes with the square of the
+  // scale. Over budget drops straight to the estimate, under budget creeps
+  // back up so one cheap frame doesn't bounce the resolution.
+  float target = m_Settings.targetFrameMs;
+  float estimate = m_Scale * std::sqrt(target / gpuFrameMs);
+  if (gpuFrameMs > target) {
+    m_Scale = estimate;
+  } else if (gpuFrameMs < target * (1.0f - m_Settings.headroom)) {
+    m_Scale = std::min(estimate, m_Scale + m_Settings.maxIncreasePerFrame);
+  }
+  m_Scale = std::clamp(m_Scale, m_Settings.minScale, m_Settings.maxScale);
+}
+
+vk::Extent2D
+DynamicResolution::GetRenderExtent(vk::Extent2D outputExtent) const {
+  auto scaled = [this](uint32_t size) {
+    uint32_t step = std::max(m_Settings.granularity, 1u);
+    auto steps = static_cast<uint32_t>(
+        std::lround(static_cast<float>(size) * m_Scale / step));
+    return std::min(std::max(steps, 1u) * step, size);
+  };
+  return vk::Extent2D{scaled(outputExtent.width), scaled(outputExtent.height)};
+}
+
+void DynamicResolution::Upscale(const vk::raii::CommandBuffer &commandBuffer,
+                                vk::Image source, vk::Extent2D renderExtent,
+                                vk::Image destination,
+                                vk::Extent2D outputExtent,
+                                vk::ImageLayout finalLayout) {
+  vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0,
+                                  1);
+
+  vk::ImageMemoryBarrier2 barriers[2];
+  barriers[0].srcStageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+  barriers[0].srcAccessMask = vk::AccessFlagBits2::eColorAttachmentWrite;
+  barriers[0].dstStageMask = vk::PipelineStageFlagBits2::eBlit;
+  barriers[0].dstAccessMask = vk::AccessFlagBits2::eTransferRead;
+  barriers[0].oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  barriers[0].newLayout = vk::ImageLayout::eTransferSrcOptimal;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image = source;
+  barriers[0].subresourceRange = range;
+
+  // Chained to the acquire semaphore, which waits at color attachment output
+  barriers[1].srcStageMask =
+      vk::PipelineStageFlagBits2::eColorAttachmentOutput;
+  barriers[1].dstStageMask = vk::PipelineStageFlagBits2::eBlit;
+  barriers[1].dstAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+  barriers[1].newLayout = vk::ImageLayout::eTransferDstOptimal;
+  barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].image = destination;
+  barriers[1].subresourceRange = range;
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount = 2;
+  dependencyInfo.pImageMemoryBarriers = barriers;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  vk::ImageBlit2 region{};
+  region.srcSubresource =
+      vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+  region.srcOffsets[1] =
+      vk::Offset3D(static_cast<int32_t>(renderExtent.width),
+                   static_cast<int32_t>(renderExtent.height), 1);
+  region.dstSubresource = region.srcSubresource;
+  region.dstOffsets[1] =
+      vk::Offset3D(static_cast<int32_t>(outputExtent.width),
+                   static_cast<int32_t>(outputExtent.height), 1);
+
+  vk::BlitImageInfo2 blitInfo{};
+  blitInfo.srcImage = source;
+  blitInfo.srcImageLayout = vk::ImageLayout::eTransferSrcOptimal;
+  blitInfo.dstImage = destination;
+  blitInfo.dstImageLayout = vk::ImageLayout::eTransferDstOptimal;
+  blitInfo.regionCount = 1;
+  blitInfo.pRegions = &region;
+  blitInfo.filter = vk::Filter::eLinear;
+  commandBuffer.blitImage2(blitInfo);
+
+  barriers[1].srcStageMask = vk::PipelineStageFlagBits2::eBlit;
+  barriers[1].srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barriers[1].dstStageMask = vk::PipelineStageFlagBits2::eBottomOfPipe;
+  barriers[1].dstAccessMask = {};
+  barriers[1].oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barriers[1].newLayout = finalLayout;
+  dependencyInfo.imageMemoryBarrierCount = 1;
+  dependencyInfo.pImageMemoryBarriers = &barriers[1];
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+bool DynamicResolution::SupportsUpscale(Renderer::Device &device,
+                                        vk::Format format) {
+  vk::FormatFeatureFlags required =
+      vk::FormatFeatureFlagBits::eBlitSrc |
+      vk::FormatFeatureFlagBits::eBlitDst |
+      vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+  vk::FormatProperties props =
+      device.GetPhysicalDevice().getFormatProperties(format);
+  return (props.optimalTilingFeatures & required) == required;
+}
+
+} // namespace Renderer
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "../Device/Device.h"
+
+namespace Renderer {
+
+struct DynamicResolutionSettings {
+  // GPU time the controller steers towards, a little under the vsync
+  // interval so spikes have room before a frame is missed
+  float targetFrameMs = 14.0f;
+  float minScale = 0.5f;
+  float maxScale = 1.0f;
+  // Largest scale increase per frame; decreases are applied at once
+  float maxIncreasePerFrame = 0.02f;
+  // Only grow again once the frame is this far below the target
+  float headroom = 0.1f;
+  // Render extents are rounded to this many pixels so small corrections
+  // don't change the resolution every frame
+  uint32_t granularity = 8;
+};
+
+// Scales the scene's render resolution from GPU frame time. A timestamp pair
+// per frame in flight brackets the frame; once the frame's fence has been
+// waited on, BeginFrame reads them back and feeds the controller.
+//
+// The scene renders into the top left GetRenderExtent() of a target sized for
+// the full output, and Upscale() blits that region over the output image.
+class DynamicResolution {
+public:
+  DynamicResolution(Renderer::Device &device, uint32_t framesInFlight,
+                    const DynamicResolutionSettings &settings = {});
+  ~DynamicResolution();
+
+  // Reads back the previous use of this frame slot, updates the scale and
+  // writes the opening timestamp. Call right after beginning the frame's
+  // command buffer.
+  void BeginFrame(const vk::raii::CommandBuffer &commandBuffer,
+                  uint32_t frameIndex);
+  void EndFrame(const vk::raii::CommandBuffer &commandBuffer,
+                uint32_t frameIndex);
+
+  // Feeds one GPU frame time to the controller. BeginFrame does this from
+  // the timestamps; exposed for drivers without timestamp support.
+  void Update(float gpuFrameMs);
+
+  // Scaled output extent, rounded to the granularity and never larger than
+  // the output itself
+  vk::Extent2D GetRenderExtent(vk::Extent2D outputExtent) const;
+
+  // Blits the top left `renderExtent` of `source` (in
+  // eColorAttachmentOptimal, left in eTransferSrcOptimal) over `destination`
+  // with linear filtering. The destination's contents are discarded and it
+  // ends up in `finalLayout`.
+  static void Upscale(const vk::raii::CommandBuffer &commandBuffer,
+                      vk::Image source, vk::Extent2D renderExtent,
+                      vk::Image destination, vk::Extent2D outputExtent,
+                      vk::ImageLayout finalLayout);
+
+  // Whether `format` can be the source and destination of a filtered blit
+  static bool SupportsUpscale(Renderer::Device &device, vk::Format format);
+
+  float GetScale() const { return m_Scale; }
+  float GetGpuFrameMs() const { return m_GpuFrameMs; }
+  bool HasTimestamps() const { return m_TimestampPeriod > 0.0f; }
+
+private:
+  DynamicResolutionSettings m_Settings;
+  float m_Scale;
+  float m_GpuFrameMs = 0.0f;
+
+  // Nanoseconds per timestamp tick, 0 when the queue can't write them
+  float m_TimestampPeriod = 0.0f;
+  uint64_t m_TimestampMask = ~0ull;
+  vk::raii::QueryPool m_QueryPool = nullptr;
+  std::vector<bool> m_QueriesWritten;
+};
+
+} // namespace Renderer
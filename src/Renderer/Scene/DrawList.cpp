@@ -0,0 +1,190 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Renderer {
+
+namespace {
+constexpr uint32_t RADIX_BITS = 8;
+constexpr uint32_t RADIX = 1u << RADIX_BITS;
+constexpr uint32_t PASS_COUNT = 64 / RADIX_BITS;
+// Below this a comparison sort beats the histogram passes
+constexpr size_t MIN_RADIX_SORT_SIZE = 256;
+// Below this many draws per chunk the pool's wake-up costs more than it saves
+constexpr size_t MIN_DRAWS_PER_TASK = 16384;
+
+uint32_t Digit(uint64_t key, uint32_t pass) {
+  return static_cast<uint32_t>(key >> (pass * RADIX_BITS)) & (RADIX - 1);
+}
+
+uint64_t CheckedField(uint32_t value, uint32_t bits, const char *name) {
+  if (value >= (1u << bits))
+    throw std::runtime_error(std::string("draw key ") + name +
+                             " id out of range");
+  return value;
+}
+
+// Non-negative floats order like their bit patterns. Dropping the sign bit
+// and the low mantissa bits leaves DEPTH_BITS with a fixed relative
+// precision, fine near the camera and coarse far away.
+uint64_t QuantizeDistance(float distance) {
+  if (!(distance > 0.0f))
+    return 0;
+  uint32_t bits;
+  std::memcpy(&bits, &distance, sizeof(bits));
+  return bits >> (31 - DrawList::DEPTH_BITS);
+}
+
+uint64_t StateBits(uint32_t pipeline, uint32_t material, uint32_t mesh) {
+  return CheckedField(pipeline, DrawList::PIPELINE_BITS, "pipeline")
+             << (DrawList::MATERIAL_BITS + DrawList::MESH_BITS) |
+         CheckedField(material, DrawList::MATERIAL_BITS, "material")
+             << DrawList::MESH_BITS |
+         CheckedField(mesh, DrawList::MESH_BITS, "mesh");
+}
+} // namespace
+
+uint64_t DrawList::MakeOpaqueKey(uint32_t pipeline, uint32_t material,
+                                 uint32_t mesh, float distance) {
+  return StateBits(pipeline, material, mesh) << DEPTH_BITS |
+         QuantizeDistance(distance);
+}
+
+uint64_t DrawList::MakeTransparentKey(uint32_t pipeline, uint32_t material,
+                                      uint32_t mesh, float distance) {
+  constexpr uint32_t stateBits = PIPELINE_BITS + MATERIAL_BITS + MESH_BITS;
+  constexpr uint64_t depthMask = (uint64_t(1) << DEPTH_BITS) - 1;
+  uint64_t farFirst = ~QuantizeDistance(distance) & depthMask;
+  return uint64_t(1) << 63 | farFirst << stateBits |
+         StateBits(pipeline, material, mesh);
+}
+
+uint32_t DrawList::GetMesh(uint64_t key) {
+  constexpr uint64_t meshMask = (uint64_t(1) << MESH_BITS) - 1;
+  // Transparent keys end in the state bits, opaque ones in the depth
+  bool transparent = (key >> 63) != 0;
+  return static_cast<uint32_t>((transparent ? key : key >> DEPTH_BITS) &
+                               meshMask);
+}
+
+void DrawList::AddOpaque(uint32_t pipeline, uint32_t material, uint32_t mesh,
+                         float distance, uint32_t payload) {
+  Add(MakeOpaqueKey(pipeline, material, mesh, distance), payload);
+}
+
+void DrawList::AddTransparent(uint32_t pipeline, uint32_t material,
+                              uint32_t mesh, float distance,
+                              uint32_t payload) {
+  Add(MakeTransparentKey(pipeline, material, mesh, distance), payload);
+}
+
+void DrawList::Add(uint64_t key, uint32_t payload) {
+  m_Entries.push_back({key, payload});
+}
+
+void DrawList::Reserve(size_t count) {
+  m_Entries.reserve(count);
+  m_Scratch.reserve(count);
+}
+
+void DrawList::Sort(ThreadPool *pool) {
+  const size_t count = m_Entries.size();
+  if (count < MIN_RADIX_SORT_SIZE) {
+    std::stable_sort(m_Entries.begin(), m_Entries.end(),
+                     [](const DrawListEntry &a, const DrawListEntry &b) {
+                       return a.key < b.key;
+                     });
+    return;
+  }
+
+  // Fixed chunks, so each chunk's entries land in a known order and the
+  // parallel scatter stays stable
+  size_t chunkCount = 1;
+  if (pool) {
+    chunkCount = std::clamp<size_t>(count / MIN_DRAWS_PER_TASK, 1,
+                                    pool->GetThreadCount());
+  }
+  auto chunkBegin = [count, chunkCount](size_t chunk) {
+    return chunk * count / chunkCount;
+  };
+  auto forEachChunk = [pool, chunkCount](const ThreadPool::RangeFunction &fn) {
+    if (chunkCount > 1) {
+      pool->ParallelFor(chunkCount, 1, fn);
+    } else {
+      fn(0, 1);
+    }
+  };
+
+  // Every pass's histogram in one read of the keys
+  m_ChunkCounts.assign(chunkCount * PASS_COUNT * RADIX, 0);
+  forEachChunk([&](size_t first, size_t last) {
+    for (size_t chunk = first; chunk < last; ++chunk) {
+      uint32_t *counts = &m_ChunkCounts[chunk * PASS_COUNT * RADIX];
+      for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+        uint64_t key = m_Entries[i].key;
+        for (uint32_t pass = 0; pass < PASS_COUNT; ++pass)
+          counts[pass * RADIX + Digit(key, pass)]++;
+      }
+    }
+  });
+  std::array<uint32_t, PASS_COUNT * RADIX> totals{};
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+    for (size_t j = 0; j < totals.size(); ++j)
+      totals[j] += m_ChunkCounts[chunk * PASS_COUNT * RADIX + j];
+  }
+
+  m_Scratch.resize(count);
+  std::vector<DrawListEntry> *src = &m_Entries;
+  std::vector<DrawListEntry> *dst = &m_Scratch;
+  for (uint32_t pass = 0; pass < PASS_COUNT; ++pass) {
+    // A byte shared by every key would leave the order as it is
+    const uint32_t *passTotals = &totals[pass * RADIX];
+    if (passTotals[Digit((*src)[0].key, pass)] == count)
+      continue;
+
+    // Later passes see a different order, so each chunk recounts its digits
+    if (chunkCount > 1) {
+      std::fill_n(m_ChunkCounts.begin(), chunkCount * RADIX, 0);
+      forEachChunk([&](size_t first, size_t last) {
+        for (size_t chunk = first; chunk < last; ++chunk) {
+          uint32_t *counts = &m_ChunkCounts[chunk * RADIX];
+          for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i)
+            counts[Digit((*src)[i].key, pass)]++;
+        }
+      });
+    } else {
+      std::copy_n(passTotals, RADIX, m_ChunkCounts.begin());
+    }
+
+    // Digit-major, chunk-minor offsets
+    uint32_t running = 0;
+    for (uint32_t digit = 0; digit < RADIX; ++digit) {
+      for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        uint32_t &slot = m_ChunkCounts[chunk * RADIX + digit];
+        uint32_t digitCount = slot;
+        slot = running;
+        running += digitCount;
+      }
+    }
+
+    forEachChunk([&](size_t first, size_t last) {
+      for (size_t chunk = first; chunk < last; ++chunk) {
+        uint32_t *offsets = &m_ChunkCounts[chunk * RADIX];
+        for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); ++i) {
+          const DrawListEntry &entry = (*src)[i];
+          (*dst)[offsets[Digit(entry.key, pass)]++] = entry;
+        }
+      }
+    });
+    std::swap(src, dst);
+  }
+
+  if (src != &m_Entries)
+    m_Entries.swap(m_Scratch);
+}
+
+} // namespace Renderer
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../Threading/ThreadPool.h"
+
+namespace Renderer {
+
+struct DrawListEntry {
+  uint64_t key;
+  // Caller's handle for the draw, e.g. an index into its object arrays
+  uint32_t payload;
+};
+
+// Draws of one frame ordered by a 64-bit key, so submission order follows
+// the key instead of the order the draws were added in. Keys, high bit
+// first:
+//
+//   opaque:      0 | pipeline:10 | material:14 | mesh:15 | depth:24
+//   transparent: 1 | ~depth:24 | pipeline:10 | material:14 | mesh:15
+//
+// Opaque draws come first, grouped by state and front to back within equal
+// state; transparent draws follow, back to front. Depth is the distance to
+// the camera, quantized logarithmically, so no depth range is needed.
+class DrawList {
+public:
+  static constexpr uint32_t PIPELINE_BITS = 10;
+  static constexpr uint32_t MATERIAL_BITS = 14;
+  static constexpr uint32_t MESH_BITS = 15;
+  static constexpr uint32_t DEPTH_BITS = 24;
+
+  // Throw if an id does not fit its field
+  static uint64_t MakeOpaqueKey(uint32_t pipeline, uint32_t material,
+                                uint32_t mesh, float distance);
+  static uint64_t MakeTransparentKey(uint32_t pipeline, uint32_t material,
+                                     uint32_t mesh, float distance);
+  // The mesh id a key was made with, opaque or transparent
+  static uint32_t GetMesh(uint64_t key);
+
+  void AddOpaque(uint32_t pipeline, uint32_t material, uint32_t mesh,
+                 float distance, uint32_t payload);
+  void AddTransparent(uint32_t pipeline, uint32_t material, uint32_t mesh,
+                      float distance, uint32_t payload);
+  void Add(uint64_t key, uint32_t payload);
+
+  void Reserve(size_t count);
+  void Clear() { m_Entries.clear(); }
+  size_t Size() const { return m_Entries.size(); }
+
+  // Stable LSD radix sort on the key, one byte per pass. Passes whose byte
+  // is the same for every key are skipped. Large lists split the histogram
+  // and scatter steps across the pool.
+  void Sort(ThreadPool *pool = nullptr);
+
+  const std::vector<DrawListEntry> &GetEntries() const { return m_Entries; }
+
+private:
+  std::vector<DrawListEntry> m_Entries;
+  // Scatter target of every other pass
+  std::vector<DrawListEntry> m_Scratch;
+  // Per chunk digit counts for the parallel sort, chunk-major
+  std::vector<uint32_t> m_ChunkCounts;
+};
+
+} // namespace Renderer
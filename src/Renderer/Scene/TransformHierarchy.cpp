@@ -0,0 +1,174 @@
+#include "TransformHierarchy.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+// Below this many nodes per level the pool's wake-up costs more than it saves
+constexpr size_t MIN_NODES_PER_TASK = 512;
+
+glm::mat4 ComposeTRS(const glm::vec3 &translation, const glm::quat &rotation,
+                     const glm::vec3 &scale) {
+  glm::mat4 matrix = glm::mat4_cast(rotation);
+  matrix[0] *= scale.x;
+  matrix[1] *= scale.y;
+  matrix[2] *= scale.z;
+  matrix[3] = glm::vec4(translation, 1.0f);
+  return matrix;
+}
+} // namespace
+
+uint32_t TransformHierarchy::AddNode(uint32_t parent,
+                                     const glm::vec3 &translation,
+                                     const glm::quat &rotation,
+                                     const glm::vec3 &scale) {
+  if (parent != InvalidNode && parent >= Size()) {
+    throw std::runtime_error("transform parent must be added before child!");
+  }
+
+  uint32_t node = static_cast<uint32_t>(Size());
+  uint32_t depth = parent == InvalidNode ? 0 : m_Depth[parent] + 1;
+
+  m_Translation.push_back(translation);
+  m_Rotation.push_back(rotation);
+  m_Scale.push_back(scale);
+  m_Parent.push_back(parent);
+  m_Depth.push_back(depth);
+  m_Dirty.push_back(0);
+  m_World.push_back(glm::mat4(1.0f));
+
+  if (m_DirtyLevels.size() <= depth)
+    m_DirtyLevels.resize(depth + 1);
+  for (auto &target : m_Targets)
+    target.stale.push_back(0);
+
+  MarkDirty(node);
+  return node;
+}
+
+void TransformHierarchy::Reserve(size_t count) {
+  m_Translation.reserve(count);
+  m_Rotation.reserve(count);
+  m_Scale.reserve(count);
+  m_Parent.reserve(count);
+  m_Depth.reserve(count);
+  m_Dirty.reserve(count);
+  m_World.reserve(count);
+}
+
+void TransformHierarchy::MarkDirty(uint32_t node) {
+  m_Dirty[node] = 1;
+  m_AnyDirty = true;
+}
+
+void TransformHierarchy::SetTranslation(uint32_t node,
+                                        const glm::vec3 &translation) {
+  m_Translation[node] = translation;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(uint32_t node,
+                                     const glm::quat &rotation) {
+  m_Rotation[node] = rotation;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(uint32_t node, const glm::vec3 &scale) {
+  m_Scale[node] = scale;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const glm::vec3 &translation,
+                                  const glm::quat &rotation,
+                                  const glm::vec3 &scale) {
+  m_Translation[node] = translation;
+  m_Rotation[node] = rotation;
+  m_Scale[node] = scale;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetTargetCount(uint32_t count) {
+  m_Targets.resize(count);
+  for (auto &target : m_Targets) {
+    target.stale.assign(Size(), 1);
+    target.pending.resize(Size());
+    for (size_t i = 0; i < Size(); ++i)
+      target.pending[i] = static_cast<uint32_t>(i);
+  }
+}
+
+void TransformHierarchy::Update(ThreadPool *pool) {
+  if (!m_AnyDirty)
+    return;
+
+  // Parents precede children, so a single forward pass pushes dirtiness down
+  // every subtree
+  for (auto &level : m_DirtyLevels)
+    level.clear();
+  for (size_t i = 0; i < Size(); ++i) {
+    uint32_t parent = m_Parent[i];
+    if (parent != InvalidNode && m_Dirty[parent])
+      m_Dirty[i] = 1;
+    if (m_Dirty[i])
+      m_DirtyLevels[m_Depth[i]].push_back(static_cast<uint32_t>(i));
+  }
+
+  // Nodes of one level only read the level above, which is complete
+  for (const auto &level : m_DirtyLevels) {
+    if (level.empty())
+      continue;
+
+    auto updateRange = [this, &level](size_t begin, size_t end) {
+      for (size_t k = begin; k < end; ++k) {
+        uint32_t node = level[k];
+        glm::mat4 local =
+            ComposeTRS(m_Translation[node], m_Rotation[node], m_Scale[node]);
+        uint32_t parent = m_Parent[node];
+        m_World[node] =
+            parent == InvalidNode ? local : m_World[parent] * local;
+      }
+    };
+    if (pool) {
+      pool->ParallelFor(level.size(), MIN_NODES_PER_TASK, updateRange);
+    } else {
+      updateRange(0, level.size());
+    }
+  }
+
+  for (const auto &level : m_DirtyLevels) {
+    for (uint32_t node : level) {
+      m_Dirty[node] = 0;
+      for (auto &target : m_Targets) {
+        if (!target.stale[node]) {
+          target.stale[node] = 1;
+          target.pending.push_back(node);
+        }
+      }
+    }
+  }
+  m_AnyDirty = false;
+}
+
+void TransformHierarchy::Write(uint32_t target, void *dst, size_t stride,
+                               ThreadPool *pool) {
+  Target &out = m_Targets[target];
+  auto *base = static_cast<unsigned char *>(dst);
+
+  auto writeRange = [this, &out, base, stride](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      uint32_t node = out.pending[k];
+      memcpy(base + node * stride, &m_World[node], sizeof(glm::mat4));
+      out.stale[node] = 0;
+    }
+  };
+  if (pool) {
+    pool->ParallelFor(out.pending.size(), MIN_NODES_PER_TASK, writeRange);
+  } else {
+    writeRange(0, out.pending.size());
+  }
+  out.pending.clear();
+}
+
+} // namespace Renderer
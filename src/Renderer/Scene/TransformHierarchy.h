@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../Threading/ThreadPool.h"
+
+namespace Renderer {
+
+// Scene transforms in structure-of-arrays form. A node can only be added
+// after its parent, so index order is always a parent-before-child order
+// and a node's handle is simply its index.
+class TransformHierarchy {
+public:
+  static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+  uint32_t AddNode(uint32_t parent = InvalidNode,
+                   const glm::vec3 &translation = glm::vec3(0.0f),
+                   const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f,
+                                                         0.0f),
+                   const glm::vec3 &scale = glm::vec3(1.0f));
+  void Reserve(size_t count);
+  size_t Size() const { return m_Parent.size(); }
+
+  // Local TRS; setters mark the node's subtree for the next Update()
+  void SetTranslation(uint32_t node, const glm::vec3 &translation);
+  void SetRotation(uint32_t node, const glm::quat &rotation);
+  void SetScale(uint32_t node, const glm::vec3 &scale);
+  void SetLocal(uint32_t node, const glm::vec3 &translation,
+                const glm::quat &rotation, const glm::vec3 &scale);
+
+  const glm::vec3 &GetTranslation(uint32_t node) const {
+    return m_Translation[node];
+  }
+  const glm::quat &GetRotation(uint32_t node) const {
+    return m_Rotation[node];
+  }
+  const glm::vec3 &GetScale(uint32_t node) const { return m_Scale[node]; }
+  uint32_t GetParent(uint32_t node) const { return m_Parent[node]; }
+  uint32_t GetDepth(uint32_t node) const { return m_Depth[node]; }
+  const glm::mat4 &GetWorldMatrix(uint32_t node) const {
+    return m_World[node];
+  }
+  const std::vector<glm::mat4> &GetWorldMatrices() const { return m_World; }
+
+  // Number of destinations Write() keeps in sync, typically one per frame
+  // in flight. New targets start out with every node pending.
+  void SetTargetCount(uint32_t count);
+
+  // Recomputes the world matrices of dirty nodes and their descendants, one
+  // depth level at a time, each level split across the pool
+  void Update(ThreadPool *pool = nullptr);
+  // Copies every world matrix that changed since `target` was last written
+  // to dst + node * stride, e.g. straight into mapped uniform memory
+  void Write(uint32_t target, void *dst, size_t stride,
+             ThreadPool *pool = nullptr);
+
+private:
+  void MarkDirty(uint32_t node);
+
+private:
+  // Local TRS, one array per component
+  std::vector<glm::vec3> m_Translation;
+  std::vector<glm::quat> m_Rotation;
+  std::vector<glm::vec3> m_Scale;
+
+  std::vector<uint32_t> m_Parent;
+  std::vector<uint32_t> m_Depth;
+  std::vector<uint8_t> m_Dirty;
+  std::vector<glm::mat4> m_World;
+  bool m_AnyDirty = false;
+
+  // Scratch for Update(): dirty nodes grouped by depth
+  std::vector<std::vector<uint32_t>> m_DirtyLevels;
+
+  struct Target {
+    std::vector<uint8_t> stale;
+    std::vector<uint32_t> pending;
+  };
+  std::vector<Target> m_Targets;
+};
+
+} // namespace Renderer
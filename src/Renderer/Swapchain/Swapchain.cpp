@@ -1,5 +1,6 @@
 #include "Swapchain.h"
 #include "../Texture/Texture.h"
+#include "../Profiling/Profiler.h"
 #include <iostream>
 #include <limits>
 
@@ -12,6 +13,7 @@ Swapchain::Swapchain(Renderer::Device &device, Renderer::Window &window) {
 Swapchain::~Swapchain() {}
 
 void Swapchain::Create(Renderer::Device &device, Renderer::Window &window) {
+  RENDERER_PROFILE_ZONE("Swapchain::Create");
 
   auto surfaceCapabilities =
       device.GetPhysicalDevice().getSurfaceCapabilitiesKHR(window.GetSurface());
@@ -42,7 +44,16 @@ void Swapchain::Create(Renderer::Device &device, Renderer::Window &window) {
   swapChainCreateInfo.imageColorSpace = swapChainSurfaceFormat.colorSpace;
   swapChainCreateInfo.imageExtent = swapChainExtent;
   swapChainCreateInfo.imageArrayLayers = 1;
-  swapChainCreateInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+  // Transfer destination lets a lower resolution frame be blitted in,
+  // transfer source lets presented frames be read back
+  m_SwapChainImageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+  if (surfaceCapabilities.supportedUsageFlags &
+      vk::ImageUsageFlagBits::eTransferDst)
+    m_SwapChainImageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+  if (surfaceCapabilities.supportedUsageFlags &
+      vk::ImageUsageFlagBits::eTransferSrc)
+    m_SwapChainImageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+  swapChainCreateInfo.imageUsage = m_SwapChainImageUsage;
   swapChainCreateInfo.imageSharingMode = vk::SharingMode::eExclusive;
   swapChainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
   swapChainCreateInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
@@ -99,6 +110,7 @@ vk::PresentModeKHR Swapchain::ChooseSwapPresentMode(
 }
 
 void Swapchain::CreateImageViews(Renderer::Device &device) {
+  RENDERER_PROFILE_ZONE("Swapchain::CreateImageViews");
   m_SwapChainImageViews.clear();
 
   vk::ImageViewCreateInfo imageViewCreateInfo{};
@@ -121,6 +133,7 @@ void Swapchain::CleanupSwapChain() {
 
 void Swapchain::RecreateSwapChain(Renderer::Device &device,
                                   Renderer::Window &window) {
+  RENDERER_PROFILE_ZONE("Swapchain::RecreateSwapChain");
   int width = 0, height = 0;
   glfwGetFramebufferSize(window.GetWindow(), &width, &height);
   while (width == 0 || height == 0) {
@@ -17,6 +17,7 @@ public:
 
   vk::Format &GetFormat() { return m_SwapChainImageFormat; }
   vk::Extent2D &GetExtend2D() { return m_SwapChainExtent; }
+  vk::ImageUsageFlags GetImageUsage() const { return m_SwapChainImageUsage; }
   std::vector<vk::Image> GetImages() { return m_SwapChainImages; }
   std::vector<vk::raii::ImageView> &GetImageViews() {
     return m_SwapChainImageViews;
@@ -41,6 +42,7 @@ private:
 private:
   vk::Format m_SwapChainImageFormat = vk::Format::eUndefined;
   vk::Extent2D m_SwapChainExtent;
+  vk::ImageUsageFlags m_SwapChainImageUsage;
   std::vector<vk::Image> m_SwapChainImages;
   vk::raii::SwapchainKHR m_SwapChain = nullptr;
   std::vector<vk::raii::ImageView> m_SwapChainImageViews;
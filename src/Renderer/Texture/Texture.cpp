@@ -1,24 +1,31 @@
 #include "Texture.h"
+#include "../Asset/AssetPack.h"
 #include "../Buffer/Buffer.h"
 #include "../Command/CommandPool.h"
 #include "../Device/Device.h"
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include <vulkan/vulkan_enums.hpp>
 
 #include "../Helpers/helpers.h"
+#include "../Profiling/Profiler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 namespace Renderer {
 
+// Streaming textures start out with every mip up to this size resident
+constexpr uint32_t InitialResidentSize = 64;
+
 Texture::Texture(BufferManager &bufferManager)
     : m_bufferManager(bufferManager) {}
 
 bool Texture::loadFromFile(Device &device, CommandPool &commandPool,
                            BufferManager &bufferManager,
-                           const std::string &filepath) {
+                           const std::string &filepath, bool streaming) {
+  RENDERER_PROFILE_ZONE("Texture::loadFromFile");
   int texWidth, texHeight, texChannels;
   stbi_uc *pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight,
                               &texChannels, STBI_rgb_alpha);
@@ -29,16 +36,160 @@ bool Texture::loadFromFile(Device &device, CommandPool &commandPool,
 
   // Force 4 channels (RGBA)
   texChannels = 4;
-  bool result = createFromData(device, commandPool, bufferManager, pixels,
-                               texWidth, texHeight, texChannels);
+  bool result =
+      streaming ? createStreamingFromData(device, commandPool, bufferManager,
+                                          pixels, texWidth, texHeight)
+                : createFromData(device, commandPool, bufferManager, pixels,
+                                 texWidth, texHeight, texChannels);
   stbi_image_free(pixels);
   return result;
 }
 
+TextureImageData Texture::decodeFile(const std::string &filepath,
+                                     bool streaming) {
+  RENDERER_PROFILE_ZONE("Texture::decodeFile");
+  int texWidth, texHeight, texChannels;
+  stbi_uc *pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight,
+                              &texChannels, STBI_rgb_alpha);
+
+  if (!pixels) {
+    throw std::runtime_error("Failed to load texture image: " + filepath);
+  }
+
+  TextureImageData image;
+  image.width = static_cast<uint32_t>(texWidth);
+  image.height = static_cast<uint32_t>(texHeight);
+  image.mips = generateMipChain(
+      pixels, image.width, image.height,
+      streaming ? getMipLevelCount(image.width, image.height) : 1);
+  stbi_image_free(pixels);
+  return image;
+}
+
+bool Texture::loadFromImageData(Device &device, CommandPool &commandPool,
+                                BufferManager &bufferManager,
+                                TextureImageData &&image) {
+  RENDERER_PROFILE_ZONE("Texture::loadFromImageData");
+  if (image.mips.empty())
+    return false;
+  if (image.mips.size() == 1)
+    return createFromData(device, commandPool, bufferManager,
+                          image.mips[0].data(), image.width, image.height, 4);
+
+  m_width = image.width;
+  m_height = image.height;
+  m_format = vk::Format::eR8G8B8A8Srgb;
+
+  m_mipLevels = static_cast<uint32_t>(image.mips.size());
+  m_mipData = std::move(image.mips);
+  uploadInitialMips(device, commandPool, bufferManager);
+  return true;
+}
+
+void Texture::loadFromPack(Device &device, CommandPool &commandPool,
+                           BufferManager &bufferManager, const AssetPack &pack,
+                           const std::string &name) {
+  RENDERER_PROFILE_ZONE("Texture::loadFromPack");
+  const PackEntry *entry = pack.Find(name, AssetType::Texture);
+  if (!entry)
+    throw std::runtime_error("Asset pack has no texture: " + name);
+  const PackTexture &packed = entry->texture;
+  pack.Prefetch(*entry);
+
+  m_width = packed.width;
+  m_height = packed.height;
+  m_format = static_cast<vk::Format>(packed.format);
+  // AssetPack::Validate checked the mip table against format and extent
+  m_mipLevels = packed.mipLevels;
+  m_mipData.clear();
+  m_residentBase = 0;
+  m_uploadedBase = 0;
+
+  // 16 byte staging offsets are a multiple of every format's texel block
+  // size; the mips themselves are copied straight out of the mapping
+  vk::DeviceSize stagingSize = 0;
+  for (uint32_t level = 0; level < m_mipLevels; level++)
+    stagingSize = (stagingSize + 15) / 16 * 16 + packed.mipSize[level];
+
+  vk::raii::Buffer stagingBuffer = nullptr;
+  Renderer::DeviceMemory stagingBufferMemory = nullptr;
+  bufferManager.CreateBuffer(device, stagingSize,
+                             vk::BufferUsageFlagBits::eTransferSrc,
+                             vk::MemoryPropertyFlagBits::eHostVisible |
+                                 vk::MemoryPropertyFlagBits::eHostCoherent,
+                             stagingBuffer, stagingBufferMemory);
+
+  auto *mappedData = static_cast<unsigned char *>(
+      stagingBufferMemory.mapMemory(0, stagingSize));
+
+  std::vector<vk::BufferImageCopy> regions;
+  vk::DeviceSize offset = 0;
+  for (uint32_t level = 0; level < m_mipLevels; level++) {
+    offset = (offset + 15) / 16 * 16;
+    memcpy(mappedData + offset, pack.GetMipData(packed, level),
+           packed.mipSize[level]);
+
+    vk::Extent2D mipExtent = getMipExtent(level);
+    vk::BufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.imageSubresource = vk::ImageSubresourceLayers(
+        vk::ImageAspectFlagBits::eColor, level, 0, 1);
+    region.imageExtent = vk::Extent3D(mipExtent.width, mipExtent.height, 1);
+    regions.push_back(region);
+
+    offset += packed.mipSize[level];
+  }
+  stagingBufferMemory.unmapMemory();
+
+  createImage(device, m_width, m_height, m_format, vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eTransferDst |
+                  vk::ImageUsageFlagBits::eSampled,
+              vk::MemoryPropertyFlagBits::eDeviceLocal, m_image, m_imageMemory,
+              m_mipLevels);
+
+  auto commandBuffer = commandPool.beginSingleTimeCommands(device);
+
+  vk::ImageMemoryBarrier2 barrier{};
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eTransfer;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barrier.oldLayout = vk::ImageLayout::eUndefined;
+  barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = *m_image;
+  barrier.subresourceRange = vk::ImageSubresourceRange(
+      vk::ImageAspectFlagBits::eColor, 0, m_mipLevels, 0, 1);
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount = 1;
+  dependencyInfo.pImageMemoryBarriers = &barrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  commandBuffer.copyBufferToImage(*stagingBuffer, *m_image,
+                                  vk::ImageLayout::eTransferDstOptimal,
+                                  regions);
+
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  commandPool.endSingleTimeCommands(device, commandBuffer);
+
+  m_imageView = createImageView(device, m_image, m_format,
+                                vk::ImageAspectFlagBits::eColor, m_mipLevels);
+  createSampler(device);
+}
+
 bool Texture::createFromData(Device &device, CommandPool &commandPool,
                              BufferManager &bufferManager,
                              const unsigned char *data, int width, int height,
                              int channels) {
+  RENDERER_PROFILE_ZONE("Texture::createFromData");
   if (!data)
     return false;
 
@@ -50,7 +201,7 @@ bool Texture::createFromData(Device &device, CommandPool &commandPool,
 
   // Create staging buffer
   vk::raii::Buffer stagingBuffer = nullptr;
-  vk::raii::DeviceMemory stagingBufferMemory = nullptr;
+  Renderer::DeviceMemory stagingBufferMemory = nullptr;
 
   bufferManager.CreateBuffer(device, imageSize,
                              vk::BufferUsageFlagBits::eTransferSrc,
@@ -83,6 +234,169 @@ bool Texture::createFromData(Device &device, CommandPool &commandPool,
   return true;
 }
 
+bool Texture::createStreamingFromData(Device &device, CommandPool &commandPool,
+                                      BufferManager &bufferManager,
+                                      const unsigned char *data, int width,
+                                      int height) {
+  if (!data)
+    return false;
+
+  m_width = static_cast<uint32_t>(width);
+  m_height = static_cast<uint32_t>(height);
+  m_format = vk::Format::eR8G8B8A8Srgb;
+
+  m_mipLevels = getMipLevelCount(m_width, m_height);
+  m_mipData = generateMipChain(data, m_width, m_height, m_mipLevels);
+  uploadInitialMips(device, commandPool, bufferManager);
+  return true;
+}
+
+void Texture::uploadInitialMips(Device &device, CommandPool &commandPool,
+                                BufferManager &bufferManager) {
+  createSampler(device);
+
+  uint32_t baseLevel = m_mipLevels - 1;
+  while (baseLevel > 0) {
+    vk::Extent2D extent = getMipExtent(baseLevel - 1);
+    if (std::max(extent.width, extent.height) > InitialResidentSize)
+      break;
+    baseLevel--;
+  }
+
+  // The whole chain is allocated once; streaming only uploads levels and
+  // moves the view over them
+  createImage(device, m_width, m_height, m_format, vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eTransferDst |
+                  vk::ImageUsageFlagBits::eSampled,
+              vk::MemoryPropertyFlagBits::eDeviceLocal, m_image, m_imageMemory,
+              m_mipLevels);
+
+  // Nothing uploaded or resident yet
+  m_residentBase = m_mipLevels;
+  m_uploadedBase = m_mipLevels;
+
+  auto commandBuffer = commandPool.beginSingleTimeCommands(device);
+  RetiredTextureResources retired =
+      changeResidency(device, bufferManager, commandBuffer, baseLevel);
+  commandPool.endSingleTimeCommands(device, commandBuffer);
+}
+
+vk::Extent2D Texture::getMipExtent(uint32_t level) const {
+  vk::Extent2D extent;
+  extent.width = std::max(1u, m_width >> level);
+  extent.height = std::max(1u, m_height >> level);
+  return extent;
+}
+
+vk::DeviceSize Texture::getMipSize(uint32_t level) const {
+  vk::Extent2D extent = getMipExtent(level);
+  return static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+}
+
+vk::DeviceSize Texture::getResidentSize() const {
+  vk::DeviceSize size = 0;
+  for (uint32_t level = m_residentBase; level < m_mipLevels; level++)
+    size += getMipSize(level);
+  return size;
+}
+
+RetiredTextureResources
+Texture::changeResidency(Device &device, BufferManager &bufferManager,
+                         const vk::raii::CommandBuffer &commandBuffer,
+                         uint32_t newBaseLevel) {
+  RENDERER_PROFILE_ZONE("Texture::changeResidency");
+  RetiredTextureResources retired;
+
+  newBaseLevel = std::min(newBaseLevel, m_mipLevels - 1);
+  if (!isStreaming() || newBaseLevel == m_residentBase)
+    return retired;
+
+  // Levels that were never written come from the CPU copy of the chain. No
+  // view so far covered them, so frames in flight can't be sampling them.
+  if (newBaseLevel < m_uploadedBase) {
+    vk::DeviceSize uploadSize = 0;
+    for (uint32_t level = newBaseLevel; level < m_uploadedBase; level++)
+      uploadSize += getMipSize(level);
+
+    bufferManager.CreateBuffer(device, uploadSize,
+                               vk::BufferUsageFlagBits::eTransferSrc,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               retired.stagingBuffer,
+                               retired.stagingBufferMemory);
+
+    auto *mappedData = static_cast<unsigned char *>(
+        retired.stagingBufferMemory.mapMemory(0, uploadSize));
+
+    std::vector<vk::BufferImageCopy> regions;
+    vk::DeviceSize offset = 0;
+    for (uint32_t level = newBaseLevel; level < m_uploadedBase; level++) {
+      memcpy(mappedData + offset, m_mipData[level].data(),
+             m_mipData[level].size());
+
+      vk::Extent2D mipExtent = getMipExtent(level);
+      vk::BufferImageCopy region{};
+      region.bufferOffset = offset;
+      region.imageSubresource = vk::ImageSubresourceLayers(
+          vk::ImageAspectFlagBits::eColor, level, 0, 1);
+      region.imageExtent = vk::Extent3D(mipExtent.width, mipExtent.height, 1);
+      regions.push_back(region);
+
+      offset += getMipSize(level);
+    }
+    retired.stagingBufferMemory.unmapMemory();
+
+    vk::ImageMemoryBarrier2 barrier{};
+    barrier.srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe;
+    barrier.dstStageMask = vk::PipelineStageFlagBits2::eTransfer;
+    barrier.dstAccessMask = vk::AccessFlagBits2::eTransferWrite;
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = *m_image;
+    barrier.subresourceRange = vk::ImageSubresourceRange(
+        vk::ImageAspectFlagBits::eColor, newBaseLevel,
+        m_uploadedBase - newBaseLevel, 0, 1);
+
+    vk::DependencyInfo dependencyInfo{};
+    dependencyInfo.imageMemoryBarrierCount = 1;
+    dependencyInfo.pImageMemoryBarriers = &barrier;
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+
+    commandBuffer.copyBufferToImage(*retired.stagingBuffer, *m_image,
+                                    vk::ImageLayout::eTransferDstOptimal,
+                                    regions);
+
+    barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+    barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+    barrier.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader;
+    barrier.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+
+    m_uploadedBase = newBaseLevel;
+  }
+
+  // Moving the view's base level is the clamp: sampling can't reach below
+  // it, and levels above it keep their contents for when they're wanted back
+  vk::ImageViewCreateInfo viewInfo{};
+  viewInfo.image = *m_image;
+  viewInfo.viewType = vk::ImageViewType::e2D;
+  viewInfo.format = m_format;
+  viewInfo.subresourceRange = vk::ImageSubresourceRange(
+      vk::ImageAspectFlagBits::eColor, newBaseLevel, m_mipLevels - newBaseLevel,
+      0, 1);
+
+  retired.imageView = std::move(m_imageView);
+  m_imageView = vk::raii::ImageView(device.GetDevice(), viewInfo);
+  m_residentBase = newBaseLevel;
+  m_generation++;
+
+  return retired;
+}
+
 bool Texture::createEmpty(Device &device, uint32_t width, uint32_t height,
                           vk::Format format, vk::ImageUsageFlags usage) {
   m_width = width;
@@ -121,7 +435,10 @@ void Texture::createSampler(Device &device) {
   samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
   samplerInfo.mipLodBias = 0.0f;
   samplerInfo.minLod = 0.0f;
-  samplerInfo.maxLod = 0.0f;
+  // Streaming views only cover resident mips and packed textures upload
+  // their whole chain, so the whole view is sampleable
+  samplerInfo.maxLod =
+      isStreaming() || m_mipLevels > 1 ? VK_LOD_CLAMP_NONE : 0.0f;
 
   samplerInfo.anisotropyEnable = VK_FALSE;
   samplerInfo.maxAnisotropy = 1.0f;
@@ -132,6 +449,7 @@ void Texture::createSampler(Device &device) {
 void Texture::copyBufferToImage(Device &device, CommandPool &commandPool,
                                 const vk::raii::Buffer &buffer, uint32_t width,
                                 uint32_t height) {
+  RENDERER_PROFILE_ZONE("Texture::copyBufferToImage");
   auto commandBuffer = commandPool.beginSingleTimeCommands(device);
 
   vk::BufferImageCopy region;
@@ -154,6 +472,7 @@ void Texture::copyBufferToImage(Device &device, CommandPool &commandPool,
 }
 
 void Texture::cleanup() {
+  m_mipData.clear();
   m_sampler.clear();
   m_imageView.clear();
   m_imageMemory.clear();
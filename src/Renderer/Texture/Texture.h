@@ -3,6 +3,7 @@
 #include "../Buffer/Buffer.h"
 #include <memory>
 #include <string>
+#include <vector>
 #include <vulkan/vulkan_raii.hpp>
 
 namespace Renderer {
@@ -10,6 +11,23 @@ namespace Renderer {
 class Device;
 class CommandPool;
 class BufferManager;
+class AssetPack;
+
+// Resources replaced by a residency change. They may still be referenced by
+// frames in flight, so the owner keeps them until those frames complete.
+struct RetiredTextureResources {
+  vk::raii::ImageView imageView = nullptr;
+  vk::raii::Buffer stagingBuffer = nullptr;
+  Renderer::DeviceMemory stagingBufferMemory = nullptr;
+};
+
+// Decoded RGBA8 image; mips[0] is the full size image, followed by the rest
+// of the chain for streaming textures
+struct TextureImageData {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<std::vector<unsigned char>> mips;
+};
 
 class Texture {
 public:
@@ -18,19 +36,67 @@ public:
 
   Texture(BufferManager &bufferManager);
 
+  // With streaming set, only the smallest mips are uploaded up front and the
+  // rest are brought in later through a TextureStreamer
   bool loadFromFile(Device &device, CommandPool &commandPool,
-                    BufferManager &bufferManager, const std::string &filepath);
+                    BufferManager &bufferManager, const std::string &filepath,
+                    bool streaming = false);
+
+  // loadFromFile in two halves. decodeFile only touches the CPU, so it can
+  // run on any thread while the device is still being set up.
+  static TextureImageData decodeFile(const std::string &filepath,
+                                     bool streaming = false);
+  bool loadFromImageData(Device &device, CommandPool &commandPool,
+                         BufferManager &bufferManager,
+                         TextureImageData &&image);
+
+  // Uploads every mip of pack texture `name` straight from the pack's
+  // mapping, in the format it was packed in. Throws if there is no such
+  // texture. Pack textures are fully resident: no CPU copy of the mips is
+  // kept, so they aren't streaming and a TextureStreamer leaves them alone.
+  void loadFromPack(Device &device, CommandPool &commandPool,
+                    BufferManager &bufferManager, const AssetPack &pack,
+                    const std::string &name);
 
   bool createFromData(Device &device, CommandPool &commandPool,
                       BufferManager &bufferManager, const unsigned char *data,
                       int width, int height, int channels);
 
+  bool createStreamingFromData(Device &device, CommandPool &commandPool,
+                               BufferManager &bufferManager,
+                               const unsigned char *data, int width,
+                               int height);
+
   bool createEmpty(
       Device &device, uint32_t width, uint32_t height,
       vk::Format format = vk::Format::eR8G8B8A8Srgb,
       vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment |
                                   vk::ImageUsageFlagBits::eSampled);
 
+  // Streaming. Mip levels are numbered in the full chain. The image is
+  // allocated with every level up front, but only levels from
+  // getUploadedBaseLevel() on hold data, and the view only covers
+  // [getResidentBaseLevel(), getMipLevels()), so sampling can never reach a
+  // missing mip. Evicting a level narrows the view; its contents stay.
+  bool isStreaming() const { return !m_mipData.empty(); }
+  uint32_t getMipLevels() const { return m_mipLevels; }
+  uint32_t getResidentBaseLevel() const { return m_residentBase; }
+  uint32_t getUploadedBaseLevel() const { return m_uploadedBase; }
+  vk::DeviceSize getMipSize(uint32_t level) const;
+  vk::DeviceSize getResidentSize() const;
+
+  // Records the upload of any level in [newBaseLevel, getMipLevels()) that
+  // holds no data yet into `commandBuffer` and swaps in a view starting at
+  // newBaseLevel
+  RetiredTextureResources
+  changeResidency(Device &device, BufferManager &bufferManager,
+                  const vk::raii::CommandBuffer &commandBuffer,
+                  uint32_t newBaseLevel);
+
+  // Bumped whenever the image view changes, so descriptor owners know to
+  // rewrite their sets
+  uint64_t getGeneration() const { return m_generation; }
+
   const vk::raii::Image &getImage() const { return m_image; }
   const vk::raii::ImageView &getImageView() const { return m_imageView; }
   const vk::raii::Sampler &getSampler() const { return m_sampler; }
@@ -45,13 +111,19 @@ private:
 
   void createSampler(Device &device);
 
+  // Streaming setup once m_mipData holds the full chain
+  void uploadInitialMips(Device &device, CommandPool &commandPool,
+                         BufferManager &bufferManager);
+
   void copyBufferToImage(Device &device, CommandPool &commandPool,
                          const vk::raii::Buffer &buffer, uint32_t width,
                          uint32_t height);
 
+  vk::Extent2D getMipExtent(uint32_t level) const;
+
 private:
   vk::raii::Image m_image = nullptr;
-  vk::raii::DeviceMemory m_imageMemory = nullptr;
+  Renderer::DeviceMemory m_imageMemory = nullptr;
   vk::raii::ImageView m_imageView = nullptr;
   vk::raii::Sampler m_sampler = nullptr;
 
@@ -60,6 +132,13 @@ private:
   uint32_t m_width = 0;
   uint32_t m_height = 0;
   vk::Format m_format = vk::Format::eR8G8B8A8Srgb;
+
+  // Streaming state: CPU copy of every mip level (RGBA8)
+  std::vector<std::vector<unsigned char>> m_mipData;
+  uint32_t m_mipLevels = 1;
+  uint32_t m_residentBase = 0;
+  uint32_t m_uploadedBase = 0;
+  uint64_t m_generation = 0;
 };
 
 } // namespace Renderer
@@ -0,0 +1,162 @@
+#include "TextureArray.h"
+#include "../Command/CommandPool.h"
+#include "../Device/Device.h"
+#include "../Helpers/helpers.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Renderer {
+
+namespace {
+// Layers are staged and box filtered as 8 bit RGBA texels
+constexpr uint32_t TEXEL_SIZE = 4;
+
+bool isRgba8(vk::Format format) {
+  switch (format) {
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+  case vk::Format::eB8G8R8A8Unorm:
+  case vk::Format::eB8G8R8A8Srgb:
+    return true;
+  default:
+    return false;
+  }
+}
+} // namespace
+
+TextureArray::TextureArray(uint32_t width, uint32_t height, uint32_t mipLevels,
+                           vk::Format format)
+    : m_width(width), m_height(height),
+      m_mipLevels(std::min(mipLevels, getMipLevelCount(width, height))),
+      m_format(format) {
+  if (!isRgba8(format)) {
+    throw std::runtime_error("texture array format must be RGBA8 or BGRA8!");
+  }
+}
+
+uint32_t TextureArray::AddLayer(const unsigned char *data) {
+  if (IsBuilt()) {
+    throw std::runtime_error("texture array already uploaded!");
+  }
+
+  size_t layerSize = static_cast<size_t>(m_width) * m_height * TEXEL_SIZE;
+  if (data) {
+    m_layers.emplace_back(data, data + layerSize);
+  } else {
+    m_layers.emplace_back(layerSize, 0);
+  }
+  return m_layerCount++;
+}
+
+void TextureArray::Build(Device &device, CommandPool &commandPool,
+                         BufferManager &bufferManager) {
+  if (m_layers.empty()) {
+    throw std::runtime_error("texture array has no layers!");
+  }
+
+  vk::DeviceSize layerSize = 0;
+  for (uint32_t level = 0; level < m_mipLevels; level++) {
+    layerSize += static_cast<vk::DeviceSize>(std::max(1u, m_width >> level)) *
+                 std::max(1u, m_height >> level) * TEXEL_SIZE;
+  }
+  vk::DeviceSize uploadSize = layerSize * m_layerCount;
+
+  vk::raii::Buffer stagingBuffer = nullptr;
+  Renderer::DeviceMemory stagingBufferMemory = nullptr;
+  bufferManager.CreateBuffer(device, uploadSize,
+                             vk::BufferUsageFlagBits::eTransferSrc,
+                             vk::MemoryPropertyFlagBits::eHostVisible |
+                                 vk::MemoryPropertyFlagBits::eHostCoherent,
+                             stagingBuffer, stagingBufferMemory);
+
+  auto *mappedData = static_cast<unsigned char *>(
+      stagingBufferMemory.mapMemory(0, uploadSize));
+
+  // Layer major, every level of a layer back to back
+  std::vector<vk::BufferImageCopy> regions;
+  vk::DeviceSize offset = 0;
+  for (uint32_t layer = 0; layer < m_layerCount; layer++) {
+    auto chain = generateMipChain(m_layers[layer].data(), m_width, m_height,
+                                  m_mipLevels);
+    for (uint32_t level = 0; level < m_mipLevels; level++) {
+      memcpy(mappedData + offset, chain[level].data(), chain[level].size());
+
+      vk::BufferImageCopy region{};
+      region.bufferOffset = offset;
+      region.imageSubresource = vk::ImageSubresourceLayers(
+          vk::ImageAspectFlagBits::eColor, level, layer, 1);
+      region.imageExtent = vk::Extent3D(std::max(1u, m_width >> level),
+                                        std::max(1u, m_height >> level), 1);
+      regions.push_back(region);
+
+      offset += chain[level].size();
+    }
+  }
+  stagingBufferMemory.unmapMemory();
+
+  createImage(device, m_width, m_height, m_format, vk::ImageTiling::eOptimal,
+              vk::ImageUsageFlagBits::eTransferDst |
+                  vk::ImageUsageFlagBits::eSampled,
+              vk::MemoryPropertyFlagBits::eDeviceLocal, m_image, m_imageMemory,
+              m_mipLevels, m_layerCount);
+
+  vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0,
+                                  m_mipLevels, 0, m_layerCount);
+
+  auto commandBuffer = commandPool.beginSingleTimeCommands(device);
+
+  vk::ImageMemoryBarrier2 barrier{};
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eTopOfPipe;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eTransfer;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barrier.oldLayout = vk::ImageLayout::eUndefined;
+  barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = *m_image;
+  barrier.subresourceRange = range;
+
+  vk::DependencyInfo dependencyInfo{};
+  dependencyInfo.imageMemoryBarrierCount = 1;
+  dependencyInfo.pImageMemoryBarriers = &barrier;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  commandBuffer.copyBufferToImage(*stagingBuffer, *m_image,
+                                  vk::ImageLayout::eTransferDstOptimal,
+                                  regions);
+
+  barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+  barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+  barrier.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader;
+  barrier.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  commandBuffer.pipelineBarrier2(dependencyInfo);
+
+  commandPool.endSingleTimeCommands(device, commandBuffer);
+
+  vk::ImageViewCreateInfo viewInfo{};
+  viewInfo.image = *m_image;
+  viewInfo.viewType = vk::ImageViewType::e2DArray;
+  viewInfo.format = m_format;
+  viewInfo.subresourceRange = range;
+  m_imageView = vk::raii::ImageView(device.GetDevice(), viewInfo);
+
+  // Clamp so atlas regions on the page border don't wrap around
+  vk::SamplerCreateInfo samplerInfo{};
+  samplerInfo.magFilter = vk::Filter::eLinear;
+  samplerInfo.minFilter = vk::Filter::eLinear;
+  samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.maxLod = static_cast<float>(m_mipLevels);
+  samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
+  m_sampler = vk::raii::Sampler(device.GetDevice(), samplerInfo);
+
+  m_layers.clear();
+  m_layers.shrink_to_fit();
+}
+
+} // namespace Renderer
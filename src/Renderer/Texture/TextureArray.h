@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../Buffer/Buffer.h"
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer {
+
+class Device;
+class CommandPool;
+
+// Same sized RGBA8 textures packed as the layers of one 2D array image, so
+// they share a single allocation, view, sampler and descriptor. Shaders
+// sample it as Sampler2DArray with the layer index as third coordinate.
+// The format must be one of the 4 byte RGBA8/BGRA8 formats; the constructor
+// throws otherwise.
+class TextureArray {
+public:
+  TextureArray(uint32_t width, uint32_t height, uint32_t mipLevels = 1,
+               vk::Format format = vk::Format::eR8G8B8A8Srgb);
+  ~TextureArray() = default;
+
+  TextureArray(const TextureArray &) = delete;
+  TextureArray &operator=(const TextureArray &) = delete;
+  TextureArray(TextureArray &&) = default;
+
+  // Copies width * height RGBA8 texels (zeros when data is null) into a new
+  // layer and returns its index. Only valid before Build.
+  uint32_t AddLayer(const unsigned char *data);
+
+  // Level 0 of a layer, for writing before Build
+  unsigned char *GetLayerData(uint32_t layer) { return m_layers[layer].data(); }
+
+  // Generates the mips, uploads every layer in one copy and drops the CPU
+  // copies
+  void Build(Device &device, CommandPool &commandPool,
+             BufferManager &bufferManager);
+
+  uint32_t GetLayerCount() const { return m_layerCount; }
+  uint32_t GetWidth() const { return m_width; }
+  uint32_t GetHeight() const { return m_height; }
+  uint32_t GetMipLevels() const { return m_mipLevels; }
+  bool IsBuilt() const { return static_cast<bool>(*m_image); }
+
+  const vk::raii::Image &getImage() const { return m_image; }
+  const vk::raii::ImageView &getImageView() const { return m_imageView; }
+  const vk::raii::Sampler &getSampler() const { return m_sampler; }
+
+private:
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_mipLevels;
+  vk::Format m_format;
+  uint32_t m_layerCount = 0;
+
+  std::vector<std::vector<unsigned char>> m_layers;
+
+  vk::raii::Image m_image = nullptr;
+  Renderer::DeviceMemory m_imageMemory = nullptr;
+  vk::raii::ImageView m_imageView = nullptr;
+  vk::raii::Sampler m_sampler = nullptr;
+};
+
+} // namespace Renderer
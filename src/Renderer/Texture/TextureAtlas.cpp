@@ -0,0 +1,108 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Renderer {
+
+static uint32_t alignUp(uint32_t value, uint32_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t padding,
+                           uint32_t mipLevels)
+    : m_PageSize(pageSize), m_Pages(pageSize, pageSize, mipLevels) {
+  m_Alignment = 1u << (m_Pages.GetMipLevels() - 1);
+  // Less padding than a texel of the last mip would blend neighbours there
+  m_Padding = std::max(padding, m_Alignment);
+}
+
+bool TextureAtlas::Place(Page &page, uint32_t width, uint32_t height,
+                         uint32_t &x, uint32_t &y) {
+  // Best fit: the lowest shelf that still takes the height
+  Shelf *best = nullptr;
+  for (Shelf &shelf : page.shelves) {
+    if (shelf.height >= height && shelf.cursorX + width <= m_PageSize &&
+        (!best || shelf.height < best->height)) {
+      best = &shelf;
+    }
+  }
+
+  if (best) {
+    x = best->cursorX;
+    y = best->y;
+    best->cursorX += width;
+    return true;
+  }
+
+  if (page.nextShelfY + height <= m_PageSize) {
+    Shelf shelf;
+    shelf.y = page.nextShelfY;
+    shelf.height = height;
+    shelf.cursorX = width;
+    page.shelves.push_back(shelf);
+    page.nextShelfY += height;
+
+    x = 0;
+    y = shelf.y;
+    return true;
+  }
+
+  return false;
+}
+
+std::optional<AtlasRegion> TextureAtlas::Add(const unsigned char *data,
+                                             uint32_t width, uint32_t height) {
+  if (m_Pages.IsBuilt()) {
+    throw std::runtime_error("texture atlas already uploaded!");
+  }
+
+  uint32_t paddedWidth = alignUp(width + 2 * m_Padding, m_Alignment);
+  uint32_t paddedHeight = alignUp(height + 2 * m_Padding, m_Alignment);
+  if (width == 0 || height == 0 || paddedWidth > m_PageSize ||
+      paddedHeight > m_PageSize) {
+    return std::nullopt;
+  }
+
+  uint32_t page = 0;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  while (page < m_PageShelves.size() &&
+         !Place(m_PageShelves[page], paddedWidth, paddedHeight, x, y)) {
+    page++;
+  }
+  if (page == m_PageShelves.size()) {
+    m_PageShelves.emplace_back();
+    m_Pages.AddLayer(nullptr);
+    Place(m_PageShelves[page], paddedWidth, paddedHeight, x, y);
+  }
+
+  // Copy with the edges extruded into the padding
+  unsigned char *pixels = m_Pages.GetLayerData(page);
+  for (uint32_t py = 0; py < paddedHeight; py++) {
+    uint32_t sy = std::min(height - 1, py > m_Padding ? py - m_Padding : 0);
+    for (uint32_t px = 0; px < paddedWidth; px++) {
+      uint32_t sx = std::min(width - 1, px > m_Padding ? px - m_Padding : 0);
+      const unsigned char *src = data + (sy * width + sx) * 4;
+      unsigned char *dst = pixels + ((y + py) * m_PageSize + x + px) * 4;
+      std::copy(src, src + 4, dst);
+    }
+  }
+
+  float pageSize = static_cast<float>(m_PageSize);
+  AtlasRegion region;
+  region.layer = page;
+  region.uvMin = glm::vec2(static_cast<float>(x + m_Padding) / pageSize,
+                           static_cast<float>(y + m_Padding) / pageSize);
+  region.uvMax =
+      glm::vec2(static_cast<float>(x + m_Padding + width) / pageSize,
+                static_cast<float>(y + m_Padding + height) / pageSize);
+  return region;
+}
+
+void TextureAtlas::Build(Device &device, CommandPool &commandPool,
+                         BufferManager &bufferManager) {
+  m_Pages.Build(device, commandPool, bufferManager);
+  m_PageShelves.clear();
+}
+
+} // namespace Renderer
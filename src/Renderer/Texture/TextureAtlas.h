@@ -0,0 +1,64 @@
+#pragma once
+
+#include "TextureArray.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Renderer {
+
+// Where a packed texture ended up: array layer plus UV rectangle
+struct AtlasRegion {
+  uint32_t layer = 0;
+  glm::vec2 uvMin{0.0f};
+  glm::vec2 uvMax{0.0f};
+};
+
+// Shelf packer for small textures of arbitrary size. Pages are layers of a
+// single TextureArray, so the whole atlas is one image and one descriptor.
+// Every region is surrounded by its own edge texels, `padding` wide, so
+// filtering and the lower mips don't bleed in the neighbours.
+class TextureAtlas {
+public:
+  TextureAtlas(uint32_t pageSize = 2048, uint32_t padding = 4,
+               uint32_t mipLevels = 3);
+
+  // Packs width * height RGBA8 texels. Returns nullopt if the texture can't
+  // fit in a page even on its own.
+  std::optional<AtlasRegion> Add(const unsigned char *data, uint32_t width,
+                                 uint32_t height);
+
+  void Build(Device &device, CommandPool &commandPool,
+             BufferManager &bufferManager);
+
+  TextureArray &GetTexture() { return m_Pages; }
+  uint32_t GetPageCount() const { return m_Pages.GetLayerCount(); }
+
+private:
+  struct Shelf {
+    uint32_t y = 0;
+    uint32_t height = 0;
+    uint32_t cursorX = 0;
+  };
+
+  struct Page {
+    std::vector<Shelf> shelves;
+    uint32_t nextShelfY = 0;
+  };
+
+  bool Place(Page &page, uint32_t width, uint32_t height, uint32_t &x,
+             uint32_t &y);
+
+private:
+  uint32_t m_PageSize;
+  uint32_t m_Padding;
+  // Regions start on multiples of the coarsest mip's texel size
+  uint32_t m_Alignment;
+
+  TextureArray m_Pages;
+  std::vector<Page> m_PageShelves;
+};
+
+} // namespace Renderer
@@ -0,0 +1,146 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Renderer {
+
+TextureStreamer::TextureStreamer(vk::DeviceSize budget,
+                                 uint32_t maxFramesInFlight,
+                                 vk::DeviceSize maxUploadPerFrame)
+    : m_Budget(budget), m_MaxFramesInFlight(maxFramesInFlight),
+      m_MaxUploadPerFrame(maxUploadPerFrame) {}
+
+TextureStreamer::~TextureStreamer() {}
+
+void TextureStreamer::Register(Texture &texture) {
+  if (!texture.isStreaming())
+    return;
+
+  Entry entry;
+  entry.texture = &texture;
+  entry.requestedLevel = texture.getResidentBaseLevel();
+  m_Entries[&texture] = entry;
+}
+
+void TextureStreamer::Unregister(Texture &texture) {
+  m_Entries.erase(&texture);
+}
+
+void TextureStreamer::RequestLod(Texture &texture, float lod) {
+  auto it = m_Entries.find(&texture);
+  if (it == m_Entries.end())
+    return;
+
+  Entry &entry = it->second;
+  uint32_t level = static_cast<uint32_t>(std::clamp(
+      std::floor(lod), 0.0f, static_cast<float>(texture.getMipLevels() - 1)));
+
+  // Requests are made for the upcoming Update
+  if (entry.lastRequestFrame == m_FrameNumber + 1) {
+    entry.requestedLevel = std::min(entry.requestedLevel, level);
+  } else {
+    entry.requestedLevel = level;
+    entry.lastRequestFrame = m_FrameNumber + 1;
+  }
+}
+
+vk::DeviceSize TextureStreamer::GetResidentSize() const {
+  vk::DeviceSize size = 0;
+  for (const auto &[texture, entry] : m_Entries)
+    size += texture->getResidentSize();
+  return size;
+}
+
+void TextureStreamer::Retire(RetiredTextureResources &&resources) {
+  Retired retired;
+  retired.frame = m_FrameNumber;
+  retired.resources = std::move(resources);
+  m_Retired.push_back(std::move(retired));
+}
+
+void TextureStreamer::Update(Device &device, BufferManager &bufferManager,
+                             const vk::raii::CommandBuffer &commandBuffer) {
+  m_FrameNumber++;
+
+  // Whatever was retired maxFramesInFlight frames ago is no longer in use
+  while (!m_Retired.empty() &&
+         m_Retired.front().frame + m_MaxFramesInFlight <= m_FrameNumber) {
+    m_Retired.pop_front();
+  }
+
+  std::vector<Entry *> entries;
+  entries.reserve(m_Entries.size());
+  for (auto &[texture, entry] : m_Entries)
+    entries.push_back(&entry);
+
+  vk::DeviceSize resident = GetResidentSize();
+
+  // Over budget: drop one top mip per texture, coldest first, and textures
+  // holding more than they were asked for before anything else
+  if (resident > m_Budget) {
+    std::sort(entries.begin(), entries.end(), [](Entry *a, Entry *b) {
+      bool aOver = a->texture->getResidentBaseLevel() < a->requestedLevel;
+      bool bOver = b->texture->getResidentBaseLevel() < b->requestedLevel;
+      if (aOver != bOver)
+        return aOver;
+      return a->lastRequestFrame < b->lastRequestFrame;
+    });
+
+    for (Entry *entry : entries) {
+      if (resident <= m_Budget)
+        break;
+
+      Texture &texture = *entry->texture;
+      uint32_t base = texture.getResidentBaseLevel();
+      if (base + 1 >= texture.getMipLevels())
+        continue;
+      // Never drop a level this update asked for, only what's held beyond
+      // the request
+      if (entry->lastRequestFrame == m_FrameNumber &&
+          base >= entry->requestedLevel)
+        continue;
+
+      resident -= texture.getMipSize(base);
+      Retire(texture.changeResidency(device, bufferManager, commandBuffer,
+                                     base + 1));
+    }
+  }
+
+  // Stream in one level per texture, most recently requested and furthest
+  // from their request first
+  std::sort(entries.begin(), entries.end(), [](Entry *a, Entry *b) {
+    if (a->lastRequestFrame != b->lastRequestFrame)
+      return a->lastRequestFrame > b->lastRequestFrame;
+    int64_t aGap = static_cast<int64_t>(a->texture->getResidentBaseLevel()) -
+                   a->requestedLevel;
+    int64_t bGap = static_cast<int64_t>(b->texture->getResidentBaseLevel()) -
+                   b->requestedLevel;
+    return aGap > bGap;
+  });
+
+  vk::DeviceSize uploaded = 0;
+  for (Entry *entry : entries) {
+    Texture &texture = *entry->texture;
+    uint32_t base = texture.getResidentBaseLevel();
+    if (entry->requestedLevel >= base)
+      continue;
+
+    vk::DeviceSize size = texture.getMipSize(base - 1);
+    if (resident + size > m_Budget)
+      continue;
+    // A level evicted earlier still holds its data and costs no upload
+    vk::DeviceSize uploadSize =
+        base - 1 < texture.getUploadedBaseLevel() ? size : 0;
+    if (uploaded > 0 && uploaded + uploadSize > m_MaxUploadPerFrame)
+      break;
+
+    Retire(texture.changeResidency(device, bufferManager, commandBuffer,
+                                   base - 1));
+    resident += size;
+    uploaded += uploadSize;
+  }
+}
+
+} // namespace Renderer
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Texture.h"
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer {
+
+// Moves mip levels of streaming textures in and out of residency over
+// frames, coarse to fine, within a budget on the resident (sampleable) size.
+// Each texture's full chain is allocated up front, so the budget bounds what
+// is uploaded and sampled, not the allocation.
+class TextureStreamer {
+public:
+  TextureStreamer(vk::DeviceSize budget, uint32_t maxFramesInFlight,
+                  vk::DeviceSize maxUploadPerFrame = 8ull << 20);
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer &) = delete;
+  TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+  // Textures that aren't streaming (Texture::isStreaming) are ignored
+  void Register(Texture &texture);
+  void Unregister(Texture &texture);
+
+  // Finest mip level the texture is wanted at this frame (0 = full size).
+  // Several requests in one frame keep the finest.
+  void RequestLod(Texture &texture, float lod);
+
+  void SetBudget(vk::DeviceSize budget) { m_Budget = budget; }
+  vk::DeviceSize GetBudget() const { return m_Budget; }
+  vk::DeviceSize GetResidentSize() const;
+
+  // Call once per frame, after the frame's fence was waited on, with the
+  // frame's command buffer recording and before anything samples the
+  // registered textures. Descriptor sets referencing them must be refreshed
+  // afterwards (see Texture::getGeneration).
+  void Update(Device &device, BufferManager &bufferManager,
+              const vk::raii::CommandBuffer &commandBuffer);
+
+private:
+  struct Entry {
+    Texture *texture = nullptr;
+    uint32_t requestedLevel = 0;
+    uint64_t lastRequestFrame = 0;
+  };
+
+  struct Retired {
+    uint64_t frame = 0;
+    RetiredTextureResources resources;
+  };
+
+  void Retire(RetiredTextureResources &&resources);
+
+private:
+  vk::DeviceSize m_Budget;
+  uint32_t m_MaxFramesInFlight;
+  vk::DeviceSize m_MaxUploadPerFrame;
+
+  uint64_t m_FrameNumber = 0;
+  std::unordered_map<Texture *, Entry> m_Entries;
+  std::deque<Retired> m_Retired;
+};
+
+} // namespace Renderer
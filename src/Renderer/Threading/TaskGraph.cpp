@@ -0,0 +1,174 @@
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace Renderer {
+
+TaskGraph::TaskId TaskGraph::Add(const std::string &name,
+                                 std::vector<TaskId> dependencies,
+                                 TaskFunction fn, Affinity affinity) {
+  TaskId id = static_cast<TaskId>(m_Tasks.size());
+
+  std::sort(dependencies.begin(), dependencies.end());
+  dependencies.erase(std::unique(dependencies.begin(), dependencies.end()),
+                     dependencies.end());
+  for (TaskId dependency : dependencies) {
+    if (dependency >= id)
+      throw std::runtime_error("task '" + name +
+                               "' depends on a task added after it");
+    m_Tasks[dependency].dependents.push_back(id);
+  }
+
+  Task task;
+  task.name = name;
+  task.fn = std::move(fn);
+  task.affinity = affinity;
+  task.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  m_Tasks.push_back(std::move(task));
+  return id;
+}
+
+void TaskGraph::Run(uint32_t workerCount) {
+  using Clock = std::chrono::steady_clock;
+
+  if (workerCount == UINT32_MAX) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+  // More workers than tasks could never all be busy
+  workerCount = std::min<uint32_t>(workerCount,
+                                   static_cast<uint32_t>(m_Tasks.size()));
+
+  m_Timings.assign(m_Tasks.size(), {});
+  for (size_t i = 0; i < m_Tasks.size(); ++i)
+    m_Timings[i].name = m_Tasks[i].name;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<TaskId> readyAny;
+  std::deque<TaskId> readyCaller;
+  std::vector<uint32_t> pending(m_Tasks.size());
+  size_t remaining = m_Tasks.size();
+  std::exception_ptr error;
+
+  auto makeReady = [&](TaskId id) {
+    if (m_Tasks[id].affinity == Affinity::Caller)
+      readyCaller.push_back(id);
+    else
+      readyAny.push_back(id);
+  };
+
+  for (TaskId id = 0; id < m_Tasks.size(); ++id) {
+    pending[id] = m_Tasks[id].dependencyCount;
+    if (pending[id] == 0)
+      makeReady(id);
+  }
+
+  const Clock::time_point start = Clock::now();
+  auto sinceStartMs = [&](Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(t - start).count();
+  };
+
+  auto runTasks = [&](uint32_t thread) {
+    const bool isCaller = thread == 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      changed.wait(lock, [&] {
+        return remaining == 0 || !readyAny.empty() ||
+               (isCaller && !readyCaller.empty());
+      });
+      if (remaining == 0)
+        return;
+
+      // The caller drains its own queue first, since nobody else can
+      std::deque<TaskId> &queue =
+          isCaller && !readyCaller.empty() ? readyCaller : readyAny;
+      TaskId id = queue.front();
+      queue.pop_front();
+
+      TaskTiming &timing = m_Timings[id];
+      timing.thread = thread;
+      timing.skipped = error != nullptr;
+      if (timing.skipped) {
+        timing.startMs = sinceStartMs(Clock::now());
+      } else {
+        lock.unlock();
+        Clock::time_point taskStart = Clock::now();
+        std::exception_ptr taskError;
+        try {
+          m_Tasks[id].fn();
+        } catch (...) {
+          taskError = std::current_exception();
+        }
+        Clock::time_point taskEnd = Clock::now();
+        lock.lock();
+
+        timing.startMs = sinceStartMs(taskStart);
+        timing.durationMs = sinceStartMs(taskEnd) - timing.startMs;
+        if (taskError && !error)
+          error = taskError;
+      }
+
+      // Dependents of a failed or skipped task are released as well and
+      // then skipped, so the graph always drains
+      for (TaskId dependent : m_Tasks[id].dependents) {
+        if (--pending[dependent] == 0)
+          makeReady(dependent);
+      }
+      remaining--;
+      changed.notify_all();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; ++i)
+    workers.emplace_back(runTasks, i + 1);
+  runTasks(0);
+  for (auto &worker : workers)
+    worker.join();
+
+  m_WallTimeMs = sinceStartMs(Clock::now());
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void TaskGraph::PrintReport(std::ostream &out) const {
+  std::vector<const TaskTiming *> order;
+  order.reserve(m_Timings.size());
+  double busyMs = 0.0;
+  uint32_t threadCount = 0;
+  for (const TaskTiming &timing : m_Timings) {
+    order.push_back(&timing);
+    busyMs += timing.durationMs;
+    threadCount = std::max(threadCount, timing.thread + 1);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const TaskTiming *a, const TaskTiming *b) {
+                     return a->startMs < b->startMs;
+                   });
+
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "%.1f ms wall, %.1f ms in tasks on %u threads\n",
+                m_WallTimeMs, busyMs, threadCount);
+  out << line;
+  out << "  start ms    time ms  thread  task\n";
+  for (const TaskTiming *timing : order) {
+    std::snprintf(line, sizeof(line), "%10.2f %10.2f %7u  %s%s\n",
+                  timing->startMs, timing->durationMs, timing->thread,
+                  timing->name.c_str(), timing->skipped ? " (skipped)" : "");
+    out << line;
+  }
+}
+
+} // namespace Renderer
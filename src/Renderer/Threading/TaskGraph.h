@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Renderer {
+
+// One-shot dependency graph of tasks, used for startup. Unlike ThreadPool's
+// fork-join ParallelFor, each task starts as soon as the tasks it depends on
+// have finished, on whichever thread is free.
+class TaskGraph {
+public:
+  using TaskId = uint32_t;
+  using TaskFunction = std::function<void()>;
+
+  enum class Affinity {
+    Any,
+    // Runs on the thread that calls Run(): window system calls and anything
+    // using a command pool or queue that the rest of the app also uses
+    Caller,
+  };
+
+  struct TaskTiming {
+    std::string name;
+    uint32_t thread = 0; // 0 is the calling thread
+    double startMs = 0.0;
+    double durationMs = 0.0;
+    bool skipped = false;
+  };
+
+  // Dependencies must be tasks that were already added, so the graph can
+  // never have a cycle
+  TaskId Add(const std::string &name, std::vector<TaskId> dependencies,
+             TaskFunction fn, Affinity affinity = Affinity::Any);
+
+  // Runs every task on the calling thread plus up to workerCount worker
+  // threads (UINT32_MAX: one per hardware thread minus the caller) and
+  // returns when all of them are done. After a task throws, tasks that have
+  // not started yet are skipped, and the first exception is rethrown.
+  void Run(uint32_t workerCount = UINT32_MAX);
+
+  // Valid after Run(), in task order
+  const std::vector<TaskTiming> &GetTimings() const { return m_Timings; }
+  double GetWallTimeMs() const { return m_WallTimeMs; }
+
+  // Table of the timings in start order, plus wall time against time spent
+  // in tasks
+  void PrintReport(std::ostream &out) const;
+
+private:
+  struct Task {
+    std::string name;
+    TaskFunction fn;
+    Affinity affinity = Affinity::Any;
+    uint32_t dependencyCount = 0;
+    std::vector<TaskId> dependents;
+  };
+
+  std::vector<Task> m_Tasks;
+  std::vector<TaskTiming> m_Timings;
+  double m_WallTimeMs = 0.0;
+};
+
+} // namespace Renderer
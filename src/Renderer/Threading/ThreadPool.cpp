@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+#include "../Profiling/Profiler.h"
+
+#include <algorithm>
+
+namespace Renderer {
+
+ThreadPool::ThreadPool(uint32_t workerCount) {
+  if (workerCount == UINT32_MAX) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  m_Workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; ++i)
+    m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stop = true;
+  }
+  m_WorkAvailable.notify_all();
+  for (auto &worker : m_Workers)
+    worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunk,
+                             const RangeFunction &fn) {
+  if (count == 0)
+    return;
+
+  minChunk = std::max<size_t>(minChunk, 1);
+  if (m_Workers.empty() || count <= minChunk) {
+    fn(0, count);
+    return;
+  }
+
+  // A few chunks per thread so uneven chunks still balance out
+  size_t chunkSize = (count + GetThreadCount() * 4 - 1) /
+                     (static_cast<size_t>(GetThreadCount()) * 4);
+  chunkSize = std::max(chunkSize, minChunk);
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Job = &fn;
+    m_Count = count;
+    m_ChunkSize = chunkSize;
+    m_ChunkCount = (count + chunkSize - 1) / chunkSize;
+    m_NextChunk.store(0, std::memory_order_relaxed);
+    m_PendingChunks.store(m_ChunkCount, std::memory_order_relaxed);
+    m_Generation++;
+  }
+  m_WorkAvailable.notify_all();
+
+  RunChunks();
+
+  // Workers still inside RunChunks() may touch the job, which lives on the
+  // caller's stack, so wait for them as well as for the chunks
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_WorkDone.wait(lock, [this] {
+    return m_PendingChunks.load(std::memory_order_acquire) == 0 &&
+           m_BusyWorkers == 0;
+  });
+  m_Job = nullptr;
+}
+
+void ThreadPool::RunChunks() {
+  for (;;) {
+    size_t chunk = m_NextChunk.fetch_add(1, std::memory_order_relaxed);
+    if (chunk >= m_ChunkCount)
+      break;
+
+    size_t begin = chunk * m_ChunkSize;
+    size_t end = std::min(begin + m_ChunkSize, m_Count);
+    (*m_Job)(begin, end);
+
+    if (m_PendingChunks.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_WorkDone.notify_all();
+    }
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  RENDERER_PROFILE_THREAD("Worker");
+  uint64_t seenGeneration = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_WorkAvailable.wait(lock, [&] {
+        return m_Stop || m_Generation != seenGeneration;
+      });
+      if (m_Stop)
+        return;
+      seenGeneration = m_Generation;
+      // Woke up after the caller already finished this job on its own
+      if (!m_Job)
+        continue;
+      m_BusyWorkers++;
+    }
+
+    RunChunks();
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_BusyWorkers--;
+    }
+    m_WorkDone.notify_all();
+  }
+}
+
+} // namespace Renderer
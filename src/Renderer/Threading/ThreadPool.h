@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Renderer {
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// always takes part, so a pool with zero workers simply runs inline.
+class ThreadPool {
+public:
+  using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+  // workerCount == UINT32_MAX: one worker per hardware thread minus the
+  // caller
+  explicit ThreadPool(uint32_t workerCount = UINT32_MAX);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Workers plus the calling thread
+  uint32_t GetThreadCount() const {
+    return static_cast<uint32_t>(m_Workers.size()) + 1;
+  }
+
+  // Calls fn over [0, count) in chunks of at least minChunk items and blocks
+  // until all chunks ran. Not reentrant: fn must not call ParallelFor.
+  void ParallelFor(size_t count, size_t minChunk, const RangeFunction &fn);
+
+private:
+  void WorkerLoop();
+  void RunChunks();
+
+private:
+  std::vector<std::thread> m_Workers;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_WorkAvailable;
+  std::condition_variable m_WorkDone;
+  uint64_t m_Generation = 0;
+  uint32_t m_BusyWorkers = 0;
+  bool m_Stop = false;
+
+  // Current job, written under m_Mutex before m_Generation is bumped
+  const RangeFunction *m_Job = nullptr;
+  size_t m_Count = 0;
+  size_t m_ChunkSize = 0;
+  size_t m_ChunkCount = 0;
+  std::atomic<size_t> m_NextChunk{0};
+  std::atomic<size_t> m_PendingChunks{0};
+};
+
+} // namespace Renderer
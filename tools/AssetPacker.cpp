@@ -0,0 +1,194 @@
+// Offline packer for the Renderer's asset pack format (Asset/AssetPack.h).
+//
+// Decodes source assets once, ahead of time, into the layout the GPU
+// consumes, so the runtime only maps the pack and copies:
+//
+//   asset_packer <out.pack> [--texture name=image] [--texture-linear
+//                name=image] [--mesh name=model.obj] ...
+//
+// Textures become RGBA8 (sRGB unless --texture-linear) with a full box
+// filtered mip chain. Meshes are Wavefront OBJ (positions, texcoords,
+// polygons fanned into triangles) written as Renderer::Vertex with 16 bit
+// indices when they fit.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stb_image.h>
+
+#include "../src/Renderer/Asset/AssetPack.h"
+#include "../src/Renderer/Helpers/helpers.h"
+#include "../src/Renderer/Pipeline/Pipeline.h"
+
+namespace {
+
+struct Input {
+  std::string name;
+  std::string path;
+};
+
+Input parseInput(const std::string &arg) {
+  size_t split = arg.find('=');
+  if (split == std::string::npos || split == 0 || split + 1 == arg.size())
+    throw std::runtime_error("expected name=path, got '" + arg + "'");
+  return {arg.substr(0, split), arg.substr(split + 1)};
+}
+
+void packTexture(Renderer::AssetPackWriter &writer, const Input &input,
+                 bool srgb) {
+  int width, height, channels;
+  stbi_uc *pixels = stbi_load(input.path.c_str(), &width, &height, &channels,
+                              STBI_rgb_alpha);
+  if (!pixels)
+    throw std::runtime_error("failed to load image: " + input.path);
+
+  uint32_t mipLevels =
+      std::min(Renderer::getMipLevelCount(width, height),
+               Renderer::MAX_PACK_MIPS);
+  auto mips = Renderer::generateMipChain(pixels, width, height, mipLevels);
+  stbi_image_free(pixels);
+
+  writer.AddTexture(input.name,
+                    srgb ? vk::Format::eR8G8B8A8Srgb
+                         : vk::Format::eR8G8B8A8Unorm,
+                    width, height, mips);
+  std::cout << "texture " << input.name << ": " << width << "x" << height
+            << ", " << mipLevels << " mips" << std::endl;
+}
+
+// OBJ indices are 1 based, negative ones count back from the end
+uint32_t objIndex(const std::string &token, size_t count) {
+  long index = std::stol(token);
+  if (index < 0)
+    index += static_cast<long>(count) + 1;
+  if (index < 1 || static_cast<size_t>(index) > count)
+    throw std::runtime_error("OBJ index out of range: " + token);
+  return static_cast<uint32_t>(index - 1);
+}
+
+void packMesh(Renderer::AssetPackWriter &writer, const Input &input) {
+  std::ifstream file(input.path);
+  if (!file)
+    throw std::runtime_error("failed to open mesh: " + input.path);
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+  std::vector<Renderer::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  // position/texcoord pair -> vertex, so shared corners are shared vertices
+  std::unordered_map<uint64_t, uint32_t> vertexLookup;
+
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    std::string type;
+    stream >> type;
+
+    if (type == "v") {
+      glm::vec3 p;
+      stream >> p.x >> p.y >> p.z;
+      positions.push_back(p);
+    } else if (type == "vt") {
+      glm::vec2 t;
+      stream >> t.x >> t.y;
+      texCoords.push_back(t);
+    } else if (type == "f") {
+      std::vector<uint32_t> face;
+      std::string corner;
+      while (stream >> corner) {
+        size_t slash = corner.find('/');
+        uint32_t position = objIndex(corner.substr(0, slash), positions.size());
+        uint32_t texCoord = UINT32_MAX;
+        if (slash != std::string::npos && slash + 1 < corner.size() &&
+            corner[slash + 1] != '/') {
+          texCoord = objIndex(
+              corner.substr(slash + 1, corner.find('/', slash + 1) - slash - 1),
+              texCoords.size());
+        }
+
+        uint64_t key = (static_cast<uint64_t>(position) << 32) | texCoord;
+        auto [it, inserted] = vertexLookup.emplace(
+            key, static_cast<uint32_t>(vertices.size()));
+        if (inserted) {
+          Renderer::Vertex vertex{};
+          vertex.pos = positions[position];
+          vertex.color = glm::vec3(1.0f);
+          // OBJ puts v = 0 at the bottom of the image
+          if (texCoord != UINT32_MAX)
+            vertex.texCoord = glm::vec2(texCoords[texCoord].x,
+                                        1.0f - texCoords[texCoord].y);
+          vertices.push_back(vertex);
+        }
+        face.push_back(it->second);
+      }
+      for (size_t i = 2; i < face.size(); ++i)
+        indices.insert(indices.end(), {face[0], face[i - 1], face[i]});
+    }
+  }
+
+  if (indices.empty())
+    throw std::runtime_error("mesh has no faces: " + input.path);
+
+  if (vertices.size() <= UINT16_MAX + 1) {
+    std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+    writer.AddMesh(input.name, vertices.data(),
+                   static_cast<uint32_t>(vertices.size()),
+                   sizeof(Renderer::Vertex), shortIndices.data(),
+                   static_cast<uint32_t>(shortIndices.size()),
+                   vk::IndexType::eUint16);
+  } else {
+    writer.AddMesh(input.name, vertices.data(),
+                   static_cast<uint32_t>(vertices.size()),
+                   sizeof(Renderer::Vertex), indices.data(),
+                   static_cast<uint32_t>(indices.size()),
+                   vk::IndexType::eUint32);
+  }
+  std::cout << "mesh " << input.name << ": " << vertices.size()
+            << " vertices, " << indices.size() / 3 << " triangles"
+            << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0]
+              << " <out.pack> [--texture name=image] [--texture-linear "
+                 "name=image] [--mesh name=model.obj] ..."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    Renderer::AssetPackWriter writer;
+    for (int i = 2; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (i + 1 >= argc)
+        throw std::runtime_error("missing value for " + arg);
+
+      if (arg == "--texture") {
+        packTexture(writer, parseInput(argv[++i]), true);
+      } else if (arg == "--texture-linear") {
+        packTexture(writer, parseInput(argv[++i]), false);
+      } else if (arg == "--mesh") {
+        packMesh(writer, parseInput(argv[++i]));
+      } else {
+        throw std::runtime_error("unknown option " + arg);
+      }
+    }
+    writer.Write(argv[1]);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}